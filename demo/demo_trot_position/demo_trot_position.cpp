@@ -42,8 +42,9 @@ int main(int argc, char **argv)
     spinner.start();
     nh.setParam("isSim", true);
   
-    // create a service client to receive the link state from gazebo.
-    ros::ServiceClient baseStateClient = nh.serviceClient<gazebo_msgs::GetLinkState>("/gazebo/get_link_state");
+    // follow the base pose that gazebo publishes, on a thread of its own.
+    qrGroundTruth groundTruth;
+    qrGroundTruthReceiver groundTruthReceiver(nh, &groundTruth);
     std::cout << "---------Ros Module Init finished---------" << std::endl;
 
     if(argc == 1 || (argc == 2 && std::string(argv[1]) == "sim")) {
@@ -72,6 +73,9 @@ int main(int argc, char **argv)
     // create the locomotion controller.
     qrLocomotionController *locomotionController = setUpController(quadruped, pathToNode,nh);
     locomotionController->Reset();
+    if (quadruped->config->isSim) {
+        locomotionController->SetGroundTruth(&groundTruth);
+    }
 
     // initialize the desired speed of the robot.
     float desiredTwistingSpeed = 0.;
@@ -98,9 +102,6 @@ int main(int argc, char **argv)
                                 desiredSpeed,
                                 desiredTwistingSpeed);
 
-        // get the COM of the robot which was computed from the link state received from the gazebo.
-        locomotionController->GetComPositionInWorldFrame(baseStateClient);
-
         // update the locomotion controller include many estimators' update. 
         locomotionController->Update();
 
@@ -0,0 +1,382 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares the dynamics of one state at a time (FloatingBaseModel, FixedFloatingBaseModel) with the batched
+// evaluation of BatchedFloatingBaseModel on an A1 sized quadruped: articulated body algorithm, mass matrix and
+// bias forces. Then compares the analytical derivatives of the inverse and forward dynamics of FloatingBaseModel
+// with central differences. Reports the largest deviation and the time per state, and fails if the fixed size
+// model deviates from FloatingBaseModel or the batched model from the fixed size one by more than float rounding.
+//
+// usage: qr_dynamics_benchmark [--samples N] [--threads N] [--passes N]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "dynamics/qr_batched_floating_base_model.hpp"
+#include "dynamics/qr_floating_base_model.hpp"
+
+namespace {
+
+typedef BatchedQuadrupedModel::State State;
+typedef BatchedQuadrupedModel::StateDerivative StateDerivative;
+typedef BatchedQuadrupedModel::JointVector JointVector;
+
+/**
+ * @brief largest deviation of two float results relative to 1 + their magnitude, above it the models disagree
+ */
+const float kMaxRelativeDeviation = 1e-4f;
+
+template <typename A, typename B>
+float RelativeDeviation(const A& result, const B& reference)
+{
+    return (result - reference).cwiseAbs().maxCoeff() / (1.f + reference.cwiseAbs().maxCoeff());
+}
+
+double NsPerState(Clock::time_point start, Clock::time_point end, int states)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count() / states;
+}
+
+/**
+ * @brief Three revolute joints per leg (ab/ad about x, hip and knee about y) with rotors, roughly the
+ * dimensions and masses of an A1.
+ */
+template <typename T, typename Model>
+void BuildQuadruped(Model& model)
+{
+    Mat3<T> bodyInertia;
+    bodyInertia << 0.0158, 0., 0., 0., 0.0377, 0., 0., 0., 0.0457;
+    model.addBase(T(4.713), Vec3<T>(0., 0.004, -0.0005), bodyInertia);
+
+    const T gearRatio = 9.1;
+    SpatialInertia<T> rotor(T(0.055), Vec3<T>::Zero(), Vec3<T>(6.3e-5, 3.3e-5, 3.3e-5).asDiagonal());
+    SpatialInertia<T> hip(T(0.696), Vec3<T>(-0.0033, 0., 0.), Vec3<T>(5.5e-4, 9.2e-4, 5.9e-4).asDiagonal());
+    SpatialInertia<T> thigh(T(1.013), Vec3<T>(-0.0032, 0., -0.0275), Vec3<T>(5.5e-3, 5.1e-3, 1.0e-3).asDiagonal());
+    SpatialInertia<T> calf(T(0.166), Vec3<T>(0.006, 0., -0.1), Vec3<T>(2.9e-3, 2.9e-3, 3.1e-5).asDiagonal());
+    const Mat3<T> I3 = Mat3<T>::Identity();
+
+    for (int legId = 0; legId < 4; legId++) {
+        const T front = legId < 2 ? 1. : -1.;
+        const T side = legId % 2 ? 1. : -1.;
+        Mat6<T> Xhip = createSXform(I3, Vec3<T>(front * 0.183, side * 0.047, 0.));
+        int body = model.addBody(hip, rotor, gearRatio, 5, JointType::Revolute, CoordinateAxis::X, Xhip, Xhip) - 1;
+        Mat6<T> Xthigh = createSXform(I3, Vec3<T>(0., side * 0.08505, 0.));
+        body = model.addBody(thigh, rotor, gearRatio, body, JointType::Revolute, CoordinateAxis::Y, Xthigh, Xthigh) - 1;
+        Mat6<T> Xcalf = createSXform(I3, Vec3<T>(0., 0., -0.2));
+        body = model.addBody(calf, rotor, gearRatio, body, JointType::Revolute, CoordinateAxis::Y, Xcalf, Xcalf) - 1;
+        model.addGroundContactPoint(body, Vec3<T>(0., 0., -0.2));
+    }
+}
+
+/**
+ * @brief Move a state by h along coordinate k of the configuration tangent (tangent 0) or of the velocity
+ * (tangent 1), in the order used by FloatingBaseModel::inverseDynamicsDerivatives
+ */
+FBModelState<double> Perturbed(FBModelState<double> state, int tangent, int k, double h)
+{
+    if (tangent == 1) {
+        if (k < 6) {
+            state.bodyVelocity[k] += h;
+        } else {
+            state.qd[k - 6] += h;
+        }
+    } else if (k < 3) {
+        // rotate the body about its own axis k
+        Eigen::Quaterniond q(state.bodyOrientation[0], state.bodyOrientation[1], state.bodyOrientation[2],
+                             state.bodyOrientation[3]);
+        q = q * Eigen::Quaterniond(Eigen::AngleAxisd(h, Vec3<double>::Unit(k)));
+        state.bodyOrientation << q.w(), q.x(), q.y(), q.z();
+    } else if (k < 6) {
+        Mat3<double> R = quaternionToRotationMatrix(state.bodyOrientation);
+        state.bodyPosition += R.transpose() * Vec3<double>::Unit(k - 3) * h;
+    } else {
+        state.q[k - 6] += h;
+    }
+    return state;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int samples = 4096;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    int passes = 5;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--samples") {
+            samples = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--threads") {
+            threads = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--passes") {
+            passes = std::max(1, atoi(argv[++i]));
+        }
+    }
+
+    FloatingBaseModel<float> dynamicModel;
+    FixedQuadrupedModel<float> fixedModel;
+    BuildQuadruped<float>(dynamicModel);
+    BuildQuadruped<float>(fixedModel);
+    BatchedQuadrupedModel batchedModel(fixedModel);
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<State> states(samples);
+    std::vector<JointVector> tau(samples);
+    for (int k = 0; k < samples; ++k) {
+        State& s = states[k];
+        s.bodyOrientation << 1.f, 0.1f * uniform(rng), 0.1f * uniform(rng), uniform(rng);
+        s.bodyOrientation.normalize();
+        s.bodyPosition << uniform(rng), uniform(rng), 0.3f + 0.05f * uniform(rng);
+        for (int j = 0; j < 6; ++j) {
+            s.bodyVelocity[j] = uniform(rng);
+        }
+        for (int j = 0; j < 12; ++j) {
+            s.q[j] = (j % 3 == 0 ? 0.f : j % 3 == 1 ? 0.9f : -1.7f) + 0.5f * uniform(rng);
+            s.qd[j] = 5.f * uniform(rng);
+            tau[k][j] = 10.f * uniform(rng);
+        }
+    }
+    std::vector<StateDerivative> batchedDState(samples), fixedDState(samples);
+    std::vector<BatchedQuadrupedModel::MassMatrix> H(samples);
+    std::vector<BatchedQuadrupedModel::GeneralizedForce> bias(samples);
+
+    // deviation of the fixed size model from FloatingBaseModel and of the batched results from the fixed size
+    // model, per state relative to the magnitude of the reference
+    batchedModel.runABA(states.data(), tau.data(), batchedDState.data(), samples);
+    batchedModel.massMatrix(states.data(), H.data(), samples);
+    batchedModel.biasForces(states.data(), bias.data(), samples);
+    FBModelState<float> dynamicState;
+    FBModelStateDerivative<float> dynamicDState;
+    DVec<float> dynamicTau(12);
+    float fixedError[3] = {0.f, 0.f, 0.f}, batchedError[3] = {0.f, 0.f, 0.f};
+    for (int k = 0; k < samples; ++k) {
+        dynamicState.bodyOrientation = states[k].bodyOrientation;
+        dynamicState.bodyPosition = states[k].bodyPosition;
+        dynamicState.bodyVelocity = states[k].bodyVelocity;
+        dynamicState.q = states[k].q;
+        dynamicState.qd = states[k].qd;
+        dynamicModel.setState(dynamicState);
+        dynamicTau = tau[k];
+        dynamicModel.runABA(dynamicTau, dynamicDState);
+        const DMat<float> dynamicH = dynamicModel.massMatrix();
+        const DVec<float> dynamicBias = dynamicModel.generalizedCoriolisForce() + dynamicModel.generalizedGravityForce();
+
+        fixedModel.setState(states[k]);
+        fixedModel.runABA(tau[k], fixedDState[k]);
+        const BatchedQuadrupedModel::MassMatrix fixedH = fixedModel.massMatrix();
+        const BatchedQuadrupedModel::GeneralizedForce fixedBias =
+            fixedModel.generalizedCoriolisForce() + fixedModel.generalizedGravityForce();
+
+        fixedError[0] = std::max(fixedError[0], RelativeDeviation(fixedDState[k].qdd, dynamicDState.qdd));
+        fixedError[0] = std::max(fixedError[0], RelativeDeviation(fixedDState[k].dBodyVelocity,
+                                                                  dynamicDState.dBodyVelocity));
+        fixedError[1] = std::max(fixedError[1], RelativeDeviation(fixedH, dynamicH));
+        fixedError[2] = std::max(fixedError[2], RelativeDeviation(fixedBias, dynamicBias));
+
+        batchedError[0] = std::max(batchedError[0], RelativeDeviation(batchedDState[k].qdd, fixedDState[k].qdd));
+        batchedError[0] = std::max(batchedError[0], RelativeDeviation(batchedDState[k].dBodyVelocity,
+                                                                      fixedDState[k].dBodyVelocity));
+        batchedError[1] = std::max(batchedError[1], RelativeDeviation(H[k], fixedH));
+        batchedError[2] = std::max(batchedError[2], RelativeDeviation(bias[k], fixedBias));
+    }
+    printf("max relative deviation of fixed from dynamic: ABA %.3e, mass matrix %.3e, bias forces %.3e\n",
+           fixedError[0], fixedError[1], fixedError[2]);
+    printf("max relative deviation of batched from fixed: ABA %.3e, mass matrix %.3e, bias forces %.3e\n",
+           batchedError[0], batchedError[1], batchedError[2]);
+    for (int algorithm = 0; algorithm < 3; ++algorithm) {
+        if (!(fixedError[algorithm] <= kMaxRelativeDeviation && batchedError[algorithm] <= kMaxRelativeDeviation)) {
+            printf("the models disagree, the largest allowed deviation is %.1e\n", kMaxRelativeDeviation);
+            return 1;
+        }
+    }
+
+    // accumulate one entry of every result so that no call is optimized away
+    volatile float sink = 0.f;
+    // the fastest of several passes, the others were disturbed by the rest of the system
+    double perState[3][4];
+    std::fill(&perState[0][0], &perState[0][0] + 12, 1e300);
+    for (int pass = 0; pass < passes; ++pass) {
+        for (int algorithm = 0; algorithm < 3; ++algorithm) {
+            Clock::time_point t0 = Clock::now();
+            for (int k = 0; k < samples; ++k) {
+                dynamicState.bodyOrientation = states[k].bodyOrientation;
+                dynamicState.bodyPosition = states[k].bodyPosition;
+                dynamicState.bodyVelocity = states[k].bodyVelocity;
+                dynamicState.q = states[k].q;
+                dynamicState.qd = states[k].qd;
+                dynamicModel.setState(dynamicState);
+                if (algorithm == 0) {
+                    dynamicTau = tau[k];
+                    dynamicModel.runABA(dynamicTau, dynamicDState);
+                    sink = sink + dynamicDState.qdd[k % 12];
+                } else if (algorithm == 1) {
+                    sink = sink + dynamicModel.massMatrix()(k % 18, 6);
+                } else {
+                    sink = sink + (dynamicModel.generalizedCoriolisForce() +
+                                   dynamicModel.generalizedGravityForce())[k % 18];
+                }
+            }
+            Clock::time_point t1 = Clock::now();
+            for (int k = 0; k < samples; ++k) {
+                fixedModel.setState(states[k]);
+                if (algorithm == 0) {
+                    fixedModel.runABA(tau[k], fixedDState[k]);
+                    sink = sink + fixedDState[k].qdd[k % 12];
+                } else if (algorithm == 1) {
+                    sink = sink + fixedModel.massMatrix()(k % 18, 6);
+                } else {
+                    sink = sink + fixedModel.generalizedCoriolisForce()[k % 18] +
+                           fixedModel.generalizedGravityForce()[k % 18];
+                }
+            }
+            Clock::time_point t2 = Clock::now();
+            Clock::time_point batched[3];
+            for (int run = 0; run < 2; ++run) {
+                batchedModel.setNumThreads(run == 0 ? 1 : threads);
+                batched[run] = Clock::now();
+                if (algorithm == 0) {
+                    batchedModel.runABA(states.data(), tau.data(), batchedDState.data(), samples);
+                } else if (algorithm == 1) {
+                    batchedModel.massMatrix(states.data(), H.data(), samples);
+                } else {
+                    batchedModel.biasForces(states.data(), bias.data(), samples);
+                }
+                batched[run + 1] = Clock::now();
+            }
+            sink = sink + batchedDState[0].qdd[0] + H[0](0, 0) + bias[0][0];
+            perState[algorithm][0] = std::min(perState[algorithm][0], NsPerState(t0, t1, samples));
+            perState[algorithm][1] = std::min(perState[algorithm][1], NsPerState(t1, t2, samples));
+            perState[algorithm][2] = std::min(perState[algorithm][2], NsPerState(batched[0], batched[1], samples));
+            perState[algorithm][3] = std::min(perState[algorithm][3], NsPerState(batched[1], batched[2], samples));
+        }
+    }
+
+    const char* names[3] = {"ABA", "mass matrix", "bias forces"};
+    char threadsColumn[32];
+    snprintf(threadsColumn, sizeof(threadsColumn), "batch %d thr ns", threads);
+    printf("%-12s %12s %12s %12s %16s\n", "per state", "dynamic ns", "fixed ns", "batch ns", threadsColumn);
+    for (int algorithm = 0; algorithm < 3; ++algorithm) {
+        printf("%-12s %12.1f %12.1f %12.1f %16.1f\n", names[algorithm], perState[algorithm][0],
+               perState[algorithm][1], perState[algorithm][2], perState[algorithm][3]);
+    }
+
+    // derivatives of the inverse dynamics at random accelerations and of the forward dynamics at random torques
+    // in double, float rounding would swamp the central differences
+    FloatingBaseModel<double> model;
+    BuildQuadruped<double>(model);
+    FBModelStateDerivative<double> dstate;
+    const int derivativeSamples = std::max(1, std::min(samples, 200));
+    const double h = 1e-6;
+    std::vector<FBModelState<double>> dynamicStates(derivativeSamples);
+    std::vector<FBModelStateDerivative<double>> accelerations(derivativeSamples);
+    std::vector<DVec<double>> dynamicTaus(derivativeSamples);
+    for (int k = 0; k < derivativeSamples; ++k) {
+        dynamicStates[k].bodyOrientation = states[k].bodyOrientation.cast<double>();
+        dynamicStates[k].bodyPosition = states[k].bodyPosition.cast<double>();
+        dynamicStates[k].bodyVelocity = states[k].bodyVelocity.cast<double>();
+        dynamicStates[k].q = states[k].q.cast<double>();
+        dynamicStates[k].qd = states[k].qd.cast<double>();
+        accelerations[k].dBodyPosition.setZero();
+        accelerations[k].dBodyVelocity = 2. * SVec<double>::Random();
+        accelerations[k].qdd = 10. * DVec<double>::Random(12);
+        dynamicTaus[k] = tau[k].cast<double>();
+    }
+
+    DMat<double> dtau_dq, dtau_dv, dqdd_dq, dqdd_dv, dqdd_dtau;
+    double idError = 0., fdError = 0.;
+    model.resetExternalForces();
+    for (int k = 0; k < derivativeSamples; ++k) {
+        model.setState(dynamicStates[k]);
+        model.inverseDynamicsDerivatives(accelerations[k], dtau_dq, dtau_dv);
+        model.forwardDynamicsDerivatives(dynamicTaus[k], dstate, dqdd_dq, dqdd_dv, dqdd_dtau);
+        for (int tangent = 0; tangent < 2; ++tangent) {
+            for (int j = 0; j < 18; ++j) {
+                model.setState(Perturbed(dynamicStates[k], tangent, j, h));
+                DVec<double> tauPlus = model.inverseDynamics(accelerations[k]);
+                model.runABA(dynamicTaus[k], dstate);
+                SVec<double> afbPlus = dstate.dBodyVelocity;
+                DVec<double> qddPlus = dstate.qdd;
+                model.setState(Perturbed(dynamicStates[k], tangent, j, -h));
+                DVec<double> tauMinus = model.inverseDynamics(accelerations[k]);
+                model.runABA(dynamicTaus[k], dstate);
+
+                const DMat<double>& idAnalytical = tangent == 0 ? dtau_dq : dtau_dv;
+                const DMat<double>& fdAnalytical = tangent == 0 ? dqdd_dq : dqdd_dv;
+                DVec<double> idNumerical = (tauPlus - tauMinus) / (2. * h);
+                idError = std::max(idError, (idAnalytical.col(j) - idNumerical).cwiseAbs().maxCoeff() /
+                                            (1. + idNumerical.cwiseAbs().maxCoeff()));
+                DVec<double> fdNumerical(18);
+                fdNumerical.head(6) = (afbPlus - dstate.dBodyVelocity) / (2. * h);
+                fdNumerical.tail(12) = (qddPlus - dstate.qdd) / (2. * h);
+                fdError = std::max(fdError, (fdAnalytical.col(j) - fdNumerical).cwiseAbs().maxCoeff() /
+                                            (1. + fdNumerical.cwiseAbs().maxCoeff()));
+            }
+        }
+    }
+    printf("derivatives, max relative deviation from central differences: inverse dynamics %.3e, "
+           "forward dynamics %.3e\n", idError, fdError);
+
+    Clock::time_point d0 = Clock::now();
+    for (int k = 0; k < derivativeSamples; ++k) {
+        model.setState(dynamicStates[k]);
+        sink = sink + model.inverseDynamics(accelerations[k])[k % 18];
+    }
+    Clock::time_point d1 = Clock::now();
+    for (int k = 0; k < derivativeSamples; ++k) {
+        model.setState(dynamicStates[k]);
+        model.inverseDynamicsDerivatives(accelerations[k], dtau_dq, dtau_dv);
+        sink = sink + dtau_dq(k % 18, 6) + dtau_dv(k % 18, 6);
+    }
+    Clock::time_point d2 = Clock::now();
+    for (int k = 0; k < derivativeSamples; ++k) {
+        model.setState(dynamicStates[k]);
+        model.runABA(dynamicTaus[k], dstate);
+        sink = sink + dstate.qdd[k % 12];
+    }
+    Clock::time_point d3 = Clock::now();
+    for (int k = 0; k < derivativeSamples; ++k) {
+        model.setState(dynamicStates[k]);
+        model.forwardDynamicsDerivatives(dynamicTaus[k], dstate, dqdd_dq, dqdd_dv, dqdd_dtau);
+        sink = sink + dqdd_dq(k % 18, 6) + dqdd_dv(k % 18, 6);
+    }
+    Clock::time_point d4 = Clock::now();
+
+    // central differences need two evaluations per column of dq and dv
+    const int finiteDifferenceCalls = 2 * (18 + 18);
+    printf("%-12s %12s %16s %20s\n", "per state", "dynamics ns", "derivatives ns", "central diff est ns");
+    printf("%-12s %12.1f %16.1f %20.1f\n", "inverse", NsPerState(d0, d1, derivativeSamples),
+           NsPerState(d1, d2, derivativeSamples), finiteDifferenceCalls * NsPerState(d0, d1, derivativeSamples));
+    printf("%-12s %12.1f %16.1f %20.1f\n", "forward", NsPerState(d2, d3, derivativeSamples),
+           NsPerState(d3, d4, derivativeSamples), finiteDifferenceCalls * NsPerState(d2, d3, derivativeSamples));
+    return 0;
+}
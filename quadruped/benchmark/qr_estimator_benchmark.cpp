@@ -0,0 +1,139 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Runs the linear Kalman filter qrLinearKF on a synthetic trot: the base moves forward with a swaying
+// acceleration, diagonal leg pairs alternate between stance and swing, and the IMU and leg kinematics are
+// read with noise. Reports the time per tick (predict and update) against the budget, the heap allocations
+// made in the loop, and the error of the estimated velocity, height and horizontal drift.
+//
+// usage: qr_estimator_benchmark [--ticks N] [--budget us]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "state_estimator/qr_linear_kf.h"
+
+int main(int argc, char** argv)
+{
+    int ticks = 20000;
+    double budgetUs = 15.;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ticks") {
+            ticks = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--budget") {
+            budgetUs = atof(argv[++i]);
+        }
+    }
+
+    const float dt = 0.001f;
+    const int halfPeriod = 250;
+    Eigen::Matrix<float, 3, 4> hips;
+    hips << 0.183f, 0.183f, -0.183f, -0.183f,
+            -0.13f, 0.13f, -0.13f, 0.13f,
+            0.f, 0.f, 0.f, 0.f;
+    Vec3<float> position(0.f, 0.f, 0.3f);
+    Vec3<float> velocity(0.5f, 0.f, 0.f);
+    Eigen::Matrix<float, 3, 4> feet = hips;
+    feet.colwise() += position;
+    feet.row(2).setZero();
+
+    qrLinearKF filter;
+    filter.Reset(position, velocity, feet);
+
+    std::mt19937 generator(7);
+    std::normal_distribution<float> noise(0.f, 1.f);
+    std::vector<double> tickUs;
+    tickUs.reserve(ticks);
+    int overBudget = 0;
+    double maxVelocityError = 0.;
+    double maxHeightError = 0.;
+    long loopAllocations = 0;
+
+    for (int k = 0; k < ticks; ++k) {
+        const float t = k * dt;
+        Vec3<float> acceleration(0.3f * std::sin(3.f * t), 0.2f * std::cos(2.f * t), 0.5f * std::sin(10.f * t));
+        position += dt * velocity + 0.5f * dt * dt * acceleration;
+        velocity += dt * acceleration;
+
+        const bool firstPair = (k / halfPeriod) % 2 == 0;
+        Vec4<float> trust(firstPair, !firstPair, !firstPair, firstPair);
+        Eigen::Matrix<float, 3, 4> footPositions, footVelocities;
+        for (int legId = 0; legId < 4; ++legId) {
+            if (trust[legId] < 0.5f) {
+                // swing towards the next foothold, 5 cm above the ground
+                Vec3<float> target = position + hips.col(legId);
+                target[2] = 0.05f;
+                feet.col(legId) += 0.02f * (target - feet.col(legId));
+                footVelocities.col(legId).setZero();
+            } else {
+                feet(2, legId) = 0.f;
+                footVelocities.col(legId) = -velocity;
+            }
+            footPositions.col(legId) = feet.col(legId) - position;
+            for (int i = 0; i < 3; ++i) {
+                footPositions(i, legId) += 0.001f * noise(generator);
+                footVelocities(i, legId) += 0.05f * noise(generator);
+            }
+        }
+        Vec3<float> measuredAcceleration = acceleration;
+        for (int i = 0; i < 3; ++i) {
+            measuredAcceleration[i] += 0.1f * noise(generator);
+        }
+
+        const long before = allocations.load();
+        Clock::time_point start = Clock::now();
+        filter.Predict(dt, measuredAcceleration);
+        filter.Update(footPositions, footVelocities, trust);
+        const double us = Microseconds(start, Clock::now());
+        loopAllocations += allocations.load() - before;
+        tickUs.push_back(us);
+        overBudget += us > budgetUs;
+
+        if (k > halfPeriod) {
+            maxVelocityError = std::max<double>(maxVelocityError, (filter.GetVelocity() - velocity).norm());
+            maxHeightError = std::max<double>(maxHeightError, std::abs(filter.GetPosition()[2] - position[2]));
+        }
+    }
+
+    double mean = 0.;
+    for (double us : tickUs) {
+        mean += us;
+    }
+    mean /= ticks;
+    printf("%d ticks, us per tick: mean %.2f, median %.2f, p99 %.2f, max %.1f; %d over the %.0f us budget\n", ticks,
+           mean, Percentile(tickUs, 0.5), Percentile(tickUs, 0.99), Percentile(tickUs, 1.), overBudget, budgetUs);
+    printf("heap allocations in the loop: %ld\n", loopAllocations);
+    printf("max velocity error %.4f m/s, max height error %.4f m, horizontal drift %.4f m after %.1f s\n",
+           maxVelocityError, maxHeightError, (filter.GetPosition() - position).head<2>().norm(), ticks * dt);
+    return 0;
+}
@@ -0,0 +1,162 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Compares the per-leg kinematics of qrRobotConfig with the four-leg SIMD batch kernels:
+// forward kinematics, leg Jacobians and inverse kinematics. Reports the largest deviation and the time per call.
+//
+// usage: qr_kinematics_benchmark [--samples N] robot_config.yaml
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "robots/qr_robot_config.h"
+
+namespace {
+
+typedef Eigen::Matrix<float, 12, 1> Angles;
+
+double NsPerCall(Clock::time_point start, Clock::time_point end, int calls)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+Eigen::Matrix<float, 3, 4> PerLegFootPositions(qrRobotConfig& config, const Angles& angles)
+{
+    Eigen::Matrix<float, 3, 4> footPositions;
+    for (int legId = 0; legId < qrRobotConfig::numLegs; ++legId) {
+        Eigen::Matrix<float, 3, 1> legAngles = angles.segment<3>(3 * legId);
+        footPositions.col(legId) = config.FootPositionInHipFrame(legAngles, legId % 2 ? 1 : -1);
+    }
+    return footPositions + config.hipOffset;
+}
+
+Angles PerLegJointAngles(qrRobotConfig& config, const Eigen::Matrix<float, 3, 4>& footPositions)
+{
+    Angles angles;
+    Eigen::Matrix<int, 3, 1> jointIdx;
+    Eigen::Matrix<float, 3, 1> jointAngles;
+    for (int legId = 0; legId < qrRobotConfig::numLegs; ++legId) {
+        config.ComputeMotorAnglesFromFootLocalPosition(legId, footPositions.col(legId), jointIdx, jointAngles);
+        angles.segment<3>(3 * legId) = jointAngles;
+    }
+    return angles;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int samples = 100000;
+    std::string path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--samples") {
+            samples = std::max(1, atoi(argv[++i]));
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty()) {
+        printf("usage: %s [--samples N] robot_config.yaml\n", argv[0]);
+        return 1;
+    }
+    qrRobotConfig config(path, LocomotionMode::VELOCITY_LOCOMOTION);
+
+    // joint angles around the standing posture
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    std::vector<Angles> angles(samples);
+    std::vector<Eigen::Matrix<float, 3, 4>> footPositions(samples);
+    for (int k = 0; k < samples; ++k) {
+        for (int legId = 0; legId < qrRobotConfig::numLegs; ++legId) {
+            angles[k][3 * legId] = 0.4f * uniform(rng);
+            angles[k][3 * legId + 1] = 0.9f + 0.8f * uniform(rng);
+            angles[k][3 * legId + 2] = -1.7f + 0.8f * uniform(rng);
+        }
+        footPositions[k] = PerLegFootPositions(config, angles[k]);
+    }
+
+    float fkError = 0.f, jacobianError = 0.f, ikError = 0.f;
+    std::array<Eigen::Matrix<float, 3, 3>, 4> jacobians;
+    for (int k = 0; k < samples; ++k) {
+        fkError = std::max(fkError, (config.FootPositionsInBaseFrame(angles[k]) - footPositions[k]).cwiseAbs().maxCoeff());
+        config.AnalyticalLegJacobians(angles[k], jacobians);
+        for (int legId = 0; legId < qrRobotConfig::numLegs; ++legId) {
+            Eigen::Matrix<float, 3, 1> legAngles = angles[k].segment<3>(3 * legId);
+            jacobianError = std::max(jacobianError,
+                (config.AnalyticalLegJacobian(legAngles, legId) - jacobians[legId]).cwiseAbs().maxCoeff());
+        }
+        Angles batch = config.ComputeMotorAnglesFromFootLocalPositions(footPositions[k]);
+        ikError = std::max(ikError, (PerLegJointAngles(config, footPositions[k]) - batch).cwiseAbs().maxCoeff());
+    }
+    printf("max deviation: forward kinematics %.3e m, Jacobian %.3e, inverse kinematics %.3e rad\n",
+           fkError, jacobianError, ikError);
+
+    // accumulate one entry of every result so that no call is optimized away
+    volatile float sink = 0.f;
+    Clock::time_point t0 = Clock::now();
+    for (int k = 0; k < samples; ++k) {
+        sink = sink + PerLegFootPositions(config, angles[k])(2, k % 4);
+    }
+    Clock::time_point t1 = Clock::now();
+    for (int k = 0; k < samples; ++k) {
+        sink = sink + config.FootPositionsInBaseFrame(angles[k])(2, k % 4);
+    }
+    Clock::time_point t2 = Clock::now();
+    for (int k = 0; k < samples; ++k) {
+        for (int legId = 0; legId < qrRobotConfig::numLegs; ++legId) {
+            Eigen::Matrix<float, 3, 1> legAngles = angles[k].segment<3>(3 * legId);
+            sink = sink + config.AnalyticalLegJacobian(legAngles, legId)(1, 1);
+        }
+    }
+    Clock::time_point t3 = Clock::now();
+    for (int k = 0; k < samples; ++k) {
+        config.AnalyticalLegJacobians(angles[k], jacobians);
+        sink = sink + jacobians[k % 4](1, 1);
+    }
+    Clock::time_point t4 = Clock::now();
+    for (int k = 0; k < samples; ++k) {
+        sink = sink + PerLegJointAngles(config, footPositions[k])[k % 12];
+    }
+    Clock::time_point t5 = Clock::now();
+    for (int k = 0; k < samples; ++k) {
+        sink = sink + config.ComputeMotorAnglesFromFootLocalPositions(footPositions[k])[k % 12];
+    }
+    Clock::time_point t6 = Clock::now();
+
+    printf("%-20s %12s %12s\n", "4 legs", "per leg ns", "batch ns");
+    printf("%-20s %12.1f %12.1f\n", "forward kinematics", NsPerCall(t0, t1, samples), NsPerCall(t1, t2, samples));
+    printf("%-20s %12.1f %12.1f\n", "Jacobian", NsPerCall(t2, t3, samples), NsPerCall(t3, t4, samples));
+    printf("%-20s %12.1f %12.1f\n", "inverse kinematics", NsPerCall(t4, t5, samples), NsPerCall(t5, t6, samples));
+    return 0;
+}
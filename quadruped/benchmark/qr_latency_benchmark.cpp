@@ -0,0 +1,269 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// Runs twelve joints under a torque PD computed by the controller, as the stance controllers do, through
+// a transport that delays the observations and the commands by a given number of ticks. The legs swing
+// in a trot pattern and are held by the ground in between. qrLatencyEstimator measures the latency online and
+// qrStatePredictor bridges it. The gain starts moderate and steps up to the one given after a quarter
+// of the run. Reports the estimated against the true latency, the prediction error, the tracking error
+// without compensation, with the estimated and with the true latency, and the time per tick.
+//
+// usage: qr_latency_benchmark [--observation-delay N] [--actuation-delay N] [--kp K] [--seconds S] robot_config.yaml
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "state_estimator/qr_latency_estimator.h"
+#include "state_estimator/qr_state_predictor.h"
+
+namespace {
+
+typedef Eigen::Matrix<float, 12, 1> Vec12;
+
+const float dt = 0.001f;
+const int substeps = 10;
+const float swingPeriod = 0.25f;
+const float warmUpKp = 40.f;
+
+enum Compensation {
+    NONE = 0,
+    ESTIMATED,
+    TRUE_LATENCY
+};
+
+struct Result {
+    bool diverged;
+
+    float trackingRms;
+    float latency;
+    float correlation;
+    float predictionRms;
+    float observationRms;
+    double usPerTick;
+};
+
+/**
+ * @brief the joint targets: during its swing a leg moves out and back along a smooth bump, otherwise it holds.
+ */
+void Target(int legId, float t, float &q, float &dq, float &ddq, bool &swinging)
+{
+    const float phase = std::fmod(t / swingPeriod + (legId == 1 || legId == 2 ? 1.f : 0.f), 2.f);
+    swinging = phase < 1.f;
+    q = dq = ddq = 0.f;
+    if (swinging) {
+        const float w = 2.f * float(M_PI) / swingPeriod;
+        const float amplitude = 0.3f;
+        q = amplitude * 0.5f * (1.f - std::cos(w * phase * swingPeriod));
+        dq = amplitude * 0.5f * w * std::sin(w * phase * swingPeriod);
+        ddq = amplitude * 0.5f * w * w * std::cos(w * phase * swingPeriod);
+    }
+}
+
+Result Run(qrRobotConfig &config, int observationDelay, int actuationDelay, float kp, float seconds, Compensation mode)
+{
+    const Vec12 inertia = (Vec12() << 0.01f, 0.02f, 0.02f, 0.01f, 0.02f, 0.02f,
+                                      0.01f, 0.02f, 0.02f, 0.01f, 0.02f, 0.02f).finished();
+    const float damping = 0.05f;
+    const float trueLatency = (observationDelay + actuationDelay) * dt;
+
+    std::mt19937 generator(1);
+    std::normal_distribution<float> noise(0.f, 0.02f);
+    Vec12 q = Vec12::Zero(), dq = Vec12::Zero();
+    // the true states and commands in flight
+    std::deque<std::pair<Vec12, Vec12>> trueStates;
+    std::deque<Eigen::Matrix<bool, 4, 1>> trueContacts;
+    std::deque<Vec12> torques;
+    for (int i = 0; i < actuationDelay; ++i) {
+        torques.push_back(Vec12::Zero());
+    }
+
+    qrStateHistory history;
+    qrLatencyEstimator latencyEstimator;
+    qrStatePredictor predictor(&config);
+    qrStateSample predicted;
+    std::vector<qrStateSample> predictions;
+    double trackingSum = 0., predictionSum = 0., observationSum = 0.;
+    long trackingCount = 0, predictionCount = 0;
+    double computeUs = 0.;
+    const int ticks = int(seconds / dt);
+    for (int k = 0; k < ticks; ++k) {
+        const float t = k * dt;
+        const float gain = t < 0.25f * seconds ? warmUpKp : kp;
+        const float kd = 2.f * std::sqrt(gain * 0.02f);
+        Eigen::Matrix<bool, 4, 1> contacts;
+        for (int legId = 0; legId < 4; ++legId) {
+            float qd, dqd, ddqd;
+            bool swinging;
+            Target(legId, t, qd, dqd, ddqd, swinging);
+            contacts[legId] = !swinging;
+            if (swinging && t > 0.5f * seconds) {
+                for (int motorId = 3 * legId; motorId < 3 * legId + 3; ++motorId) {
+                    trackingSum += (q[motorId] - qd) * (q[motorId] - qd);
+                    ++trackingCount;
+                }
+            }
+        }
+        trueStates.push_back(std::make_pair(q, dq));
+        trueContacts.push_back(contacts);
+        if (int(trueStates.size()) > observationDelay + 1) {
+            trueStates.pop_front();
+            trueContacts.pop_front();
+        }
+
+        // the prediction made actuationDelay ticks ago was for now
+        if (int(predictions.size()) > actuationDelay && t > 0.5f * seconds) {
+            const qrStateSample &old = predictions[predictions.size() - 1 - actuationDelay];
+            const qrStateSample &observed = history.Get(actuationDelay);
+            for (int legId = 0; legId < 4; ++legId) {
+                if (contacts[legId] || old.footContact[legId]) {
+                    continue;
+                }
+                predictionSum += (old.motorAngles - q).segment<3>(3 * legId).squaredNorm();
+                observationSum += (observed.motorAngles - q).segment<3>(3 * legId).squaredNorm();
+                predictionCount += 3;
+            }
+        }
+
+        // observe
+        qrStateSample &sample = history.Push(t);
+        sample.motorAngles = trueStates.front().first;
+        sample.motorVelocities = trueStates.front().second;
+        for (int motorId = 0; motorId < 12; ++motorId) {
+            sample.motorVelocities[motorId] += noise(generator);
+            sample.motorAngles[motorId] += 0.005f * noise(generator);
+        }
+        sample.footContact = trueContacts.front();
+
+        Clock::time_point start = Clock::now();
+        latencyEstimator.Update(history, dt);
+        float horizon = 0.f;
+        if (mode == ESTIMATED) {
+            horizon = latencyEstimator.GetLatency();
+        } else if (mode == TRUE_LATENCY) {
+            horizon = trueLatency;
+        }
+        predictor.Predict(history, latencyEstimator.GetJointResponse(), horizon, dt, predicted);
+        computeUs += Microseconds(start, Clock::now());
+        predictions.push_back(predicted);
+
+        // torque PD on the predicted state, targets for the time the torque will act
+        Eigen::Matrix<float, 5, 12> command = Eigen::Matrix<float, 5, 12>::Zero();
+        for (int legId = 0; legId < 4; ++legId) {
+            float qd, dqd, ddqd;
+            bool swinging;
+            Target(legId, t + trueLatency, qd, dqd, ddqd, swinging);
+            for (int motorId = 3 * legId; motorId < 3 * legId + 3; ++motorId) {
+                command(4, motorId) = gain * (qd - predicted.motorAngles[motorId])
+                                      + kd * (dqd - predicted.motorVelocities[motorId]) + inertia[motorId] * ddqd;
+            }
+        }
+        history.RecordCommand(command, Eigen::Matrix<float, 3, 4>::Zero());
+        torques.push_back(command.row(4).transpose());
+
+        // the legs in the air move under the command sent actuationDelay ticks ago, the others stand
+        const Vec12 &torque = torques.front();
+        for (int i = 0; i < substeps; ++i) {
+            const Vec12 ddq = (torque - damping * dq).cwiseQuotient(inertia);
+            dq += ddq * (dt / substeps);
+            q += dq * (dt / substeps);
+        }
+        torques.pop_front();
+        for (int legId = 0; legId < 4; ++legId) {
+            float qd, dqd, ddqd;
+            bool swinging;
+            Target(legId, t + dt, qd, dqd, ddqd, swinging);
+            if (!swinging) {
+                q.segment<3>(3 * legId).setConstant(qd);
+                dq.segment<3>(3 * legId).setZero();
+            }
+        }
+        if (!q.allFinite() || q.cwiseAbs().maxCoeff() > 10.f) {
+            break;
+        }
+    }
+
+    Result result;
+    result.diverged = !q.allFinite() || q.cwiseAbs().maxCoeff() > 10.f;
+    result.trackingRms = float(std::sqrt(trackingSum / std::max(1L, trackingCount)));
+    result.latency = latencyEstimator.GetLatency();
+    result.correlation = latencyEstimator.GetCorrelation();
+    result.predictionRms = float(std::sqrt(predictionSum / std::max(1L, predictionCount)));
+    result.observationRms = float(std::sqrt(observationSum / std::max(1L, predictionCount)));
+    result.usPerTick = computeUs / ticks;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int observationDelay = 2;
+    int actuationDelay = 3;
+    float kp = 60.f;
+    float seconds = 20.f;
+    std::string path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--observation-delay") {
+            observationDelay = std::max(0, atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--actuation-delay") {
+            actuationDelay = std::max(0, atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--kp") {
+            kp = std::max(1.f, float(atof(argv[++i])));
+        } else if (i + 1 < argc && arg == "--seconds") {
+            seconds = std::max(1.f, float(atof(argv[++i])));
+        } else {
+            path = arg;
+        }
+    }
+    if (path.empty()) {
+        printf("usage: %s [--observation-delay N] [--actuation-delay N] [--kp K] [--seconds S] robot_config.yaml\n", argv[0]);
+        return 1;
+    }
+    qrRobotConfig config(path, LocomotionMode::VELOCITY_LOCOMOTION);
+
+    const char *names[3] = {"none", "estimated latency", "true latency"};
+    printf("true latency %.1f ms, kp %.0f N.m/rad\n", 1e3f * (observationDelay + actuationDelay) * dt, kp);
+    for (int mode = NONE; mode <= TRUE_LATENCY; ++mode) {
+        const Result result = Run(config, observationDelay, actuationDelay, kp, seconds, Compensation(mode));
+        if (result.diverged) {
+            printf("compensation %-17s: diverged, estimated latency %.1f ms (correlation %.2f)\n",
+                   names[mode], 1e3f * result.latency, result.correlation);
+            continue;
+        }
+        printf("compensation %-17s: tracking rms %.4f rad, estimated latency %.1f ms (correlation %.2f), "
+               "angle error predicted %.4f / observed %.4f rad, %.2f us per tick\n",
+               names[mode], result.trackingRms, 1e3f * result.latency, result.correlation,
+               result.predictionRms, result.observationRms, result.usPerTick);
+    }
+    return 0;
+}
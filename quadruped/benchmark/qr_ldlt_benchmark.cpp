@@ -0,0 +1,158 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// Factors quasi-definite KKT matrices [P + sigma*I, A'; A, -1/rho*I] of the JCQP shape with the dense LDLT,
+// once per instruction set this cpu supports, in double and float. Reports the time per setup and solve,
+// the relative residual ||Kx - b|| / ||b|| in double, and how far each solution is from the scalar path's.
+//
+// usage: qr_ldlt_benchmark [--repeat N] [--rho R] [--sigma S]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "controller/mpc/qr_cholesky_solver.h"
+
+namespace {
+
+const int sizes[] = {60, 120, 240, 360, 480, 600};
+
+/**
+ * @brief A KKT matrix with 3 of every 8 rows variables and the rest constraints, as the MPC QP has.
+ */
+Eigen::MatrixXd BuildKkt(int size, double rho, double sigma)
+{
+    const int variables = size * 3 / 8;
+    const int constraints = size - variables;
+    std::mt19937 generator(size);
+    std::normal_distribution<double> normal;
+    Eigen::MatrixXd M(variables, variables), A(constraints, variables);
+    for (int c = 0; c < variables; ++c) {
+        for (int r = 0; r < variables; ++r) {
+            M(r, c) = normal(generator);
+        }
+        for (int r = 0; r < constraints; ++r) {
+            A(r, c) = normal(generator);
+        }
+    }
+    Eigen::MatrixXd K = Eigen::MatrixXd::Zero(size, size);
+    K.topLeftCorner(variables, variables) = M * M.transpose() / variables;
+    K.topLeftCorner(variables, variables).diagonal().array() += sigma;
+    K.topRightCorner(variables, constraints) = A.transpose();
+    K.bottomLeftCorner(constraints, variables) = A;
+    K.bottomRightCorner(constraints, constraints).diagonal().setConstant(-1. / rho);
+    return K;
+}
+
+struct Result {
+    double setupUs;
+    double solveUs;
+    Eigen::VectorXd x;
+    long smallPivots;
+};
+
+template<typename T>
+Result Run(const Eigen::MatrixXd& K, const Eigen::VectorXd& b, LdltIsa isa, int repeat)
+{
+    const DenseMatrix<T> kkt = K.cast<T>();
+    CholeskyDenseSolver<T> solver(false);
+    solver.setIsa(isa);
+    solver.setup(kkt); // allocates
+
+    std::vector<double> setupUs(repeat), solveUs(repeat);
+    Eigen::Matrix<T, Eigen::Dynamic, 1> x;
+    for (int r = 0; r < repeat; ++r) {
+        Clock::time_point start = Clock::now();
+        solver.setup(kkt);
+        Clock::time_point factored = Clock::now();
+        x = b.cast<T>();
+        solver.solve(x);
+        Clock::time_point solved = Clock::now();
+        setupUs[r] = Microseconds(start, factored);
+        solveUs[r] = Microseconds(factored, solved);
+    }
+    Result result;
+    result.setupUs = Percentile(setupUs, 0.5);
+    result.solveUs = Percentile(solveUs, 0.5);
+    result.x = x.template cast<double>();
+    result.smallPivots = solver.getSmallPivots();
+    return result;
+}
+
+template<typename T>
+void Compare(const char* precision, int repeat, double rho, double sigma)
+{
+    std::vector<LdltIsa> isas;
+    for (LdltIsa isa : {LdltIsa::SCALAR, LdltIsa::AVX2, LdltIsa::AVX512}) {
+        if (isa <= detectLdltIsa()) {
+            isas.push_back(isa);
+        }
+    }
+
+    printf("%s, median us per setup / solve, relative residual, relative deviation from scalar\n", precision);
+    for (int size : sizes) {
+        const Eigen::MatrixXd K = BuildKkt(size, rho, sigma);
+        const Eigen::VectorXd b = Eigen::VectorXd::Random(size);
+        const int runs = size <= 240 ? repeat : std::max(1, repeat / 10);
+        Eigen::VectorXd reference;
+        for (LdltIsa isa : isas) {
+            Result result = Run<T>(K, b, isa, runs);
+            if (isa == LdltIsa::SCALAR) {
+                reference = result.x;
+            }
+            printf("  n %4d %-7s setup %9.1f solve %7.1f  residual %.1e  deviation %.1e%s\n", size, ldltIsaName(isa),
+                   result.setupUs, result.solveUs, (K * result.x - b).norm() / b.norm(),
+                   (result.x - reference).norm() / reference.norm(), result.smallPivots ? "  (small pivots)" : "");
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int repeat = 200;
+    double rho = 2.;
+    double sigma = 1e-5;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--repeat") {
+            repeat = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--rho") {
+            rho = atof(argv[++i]);
+        } else if (arg == "--sigma") {
+            sigma = atof(argv[++i]);
+        }
+    }
+
+    printf("cpu supports %s, rho %g, sigma %g\n", ldltIsaName(detectLdltIsa()), rho, sigma);
+    Compare<double>("double", repeat, rho, sigma);
+    Compare<float>("float", repeat, rho, sigma);
+    return 0;
+}
@@ -0,0 +1,487 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Replays QP snapshots recorded by qrQpSnapshotRecorder through every solver backend
+// and reports solve time distribution, iterations and the deviation from the qpOASES solution.
+// The active set solver only takes the 12 x 24 contact force QP and is warm started from its solve of the
+// previous snapshot, so the snapshots of a file are replayed in recording order.
+//
+// usage: qr_qp_benchmark [--repeat N] [--terminate eps] [--rho rho] [--sigma sigma] [--alpha alpha] snapshot_file...
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "qpOASES.hpp"
+#include "osqp/osqp.h"
+
+#include "controller/qr_active_set_qp.h"
+#include "controller/qr_qp_snapshot.h"
+#include "controller/mpc/qr_mixed_precision_qp.h"
+#include "controller/mpc/qr_qp_problem.h"
+
+namespace {
+
+const double kBenchInfinity = 1e20;
+
+struct BenchSettings {
+    int repeat = 5;
+    double terminate = 1e-5;
+    double rho = 1e-3;
+    double sigma = 1e-6;
+    double alpha = 1.6;
+    int maxIterations = 10000;
+};
+
+struct SolveResult {
+    /**
+     * @brief false if the backend does not take problems of this source, the snapshot is not counted.
+     */
+    bool applicable = true;
+    bool solved = false;
+    int iterations = 0;
+    Eigen::VectorXd x;
+};
+
+struct BackendStats {
+    std::vector<double> timesUs;
+    std::vector<int> iterations;
+    int solved = 0;
+    int total = 0;
+    double maxObjectiveDelta = 0;
+    double maxViolation = 0;
+};
+
+double Clamp(double value)
+{
+    return std::max(-kBenchInfinity, std::min(kBenchInfinity, value));
+}
+
+SolveResult SolveQpOases(const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> H = qp.DenseHessian();
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> A = qp.DenseConstraintMatrix();
+    std::vector<double> lb(qp.m), ub(qp.m);
+    for (u32 i = 0; i < qp.m; ++i) {
+        lb[i] = Clamp(qp.lb[i]);
+        ub[i] = Clamp(qp.ub[i]);
+    }
+
+    qpOASES::QProblem problem(qp.n, qp.m);
+    qpOASES::Options op;
+    op.setToMPC();
+    op.printLevel = qpOASES::PL_NONE;
+    problem.setOptions(op);
+    qpOASES::int_t nWSR = settings.maxIterations;
+
+    SolveResult result;
+    qpOASES::returnValue rval = problem.init(H.data(), qp.g.data(), A.data(), NULL, NULL, lb.data(), ub.data(), nWSR);
+    result.x.resize(qp.n);
+    result.solved = rval == qpOASES::SUCCESSFUL_RETURN
+                    && problem.getPrimalSolution(result.x.data()) == qpOASES::SUCCESSFUL_RETURN;
+    result.iterations = nWSR;
+    return result;
+}
+
+/**
+ * @brief qpOASES on a compressed column constraint matrix, set up as the sparse qpOASES path of the MPC.
+ */
+SolveResult SolveQpOasesSparse(const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+#if defined(SOLVER_MA27) || defined(SOLVER_MA57)
+    typedef qpOASES::SQProblemSchur Problem;
+#else
+    typedef qpOASES::SQProblem Problem;
+#endif
+    std::vector<SparseTriple<double>> triples = qp.A;
+    sortAndSumTriples(triples);
+    std::vector<qpOASES::sparse_int_t> aRow, aCol(qp.n + 1, 0);
+    std::vector<qpOASES::real_t> aVal;
+    for (const auto& tri : triples) {
+        aRow.push_back(tri.r);
+        aVal.push_back(tri.value);
+        aCol[tri.c + 1]++;
+    }
+    for (u32 c = 0; c < qp.n; ++c) {
+        aCol[c + 1] += aCol[c];
+    }
+    qpOASES::SparseMatrix A(qp.m, qp.n, aRow.data(), aCol.data(), aVal.data());
+
+    Eigen::MatrixXd dense = qp.DenseHessian();
+#if defined(SOLVER_MA27) || defined(SOLVER_MA57)
+    std::vector<qpOASES::sparse_int_t> hRow, hCol(qp.n + 1, 0);
+    std::vector<qpOASES::real_t> hVal;
+    for (u32 c = 0; c < qp.n; ++c) {
+        for (u32 r = 0; r < qp.n; ++r) {
+            if (dense(r, c) != 0) {
+                hRow.push_back(r);
+                hVal.push_back(dense(r, c));
+            }
+        }
+        hCol[c + 1] = hRow.size();
+    }
+    qpOASES::SymSparseMat H(qp.n, qp.n, hRow.data(), hCol.data(), hVal.data());
+    H.createDiagInfo();
+#else
+    qpOASES::SymDenseMat H(qp.n, qp.n, qp.n, dense.data()); // symmetric, so column major storage is fine
+#endif
+    std::vector<double> lb(qp.m), ub(qp.m);
+    for (u32 i = 0; i < qp.m; ++i) {
+        lb[i] = Clamp(qp.lb[i]);
+        ub[i] = Clamp(qp.ub[i]);
+    }
+
+    Problem problem(qp.n, qp.m);
+    qpOASES::Options op;
+    op.setToMPC();
+    op.printLevel = qpOASES::PL_NONE;
+    problem.setOptions(op);
+    qpOASES::int_t nWSR = settings.maxIterations;
+
+    SolveResult result;
+    qpOASES::returnValue rval = problem.init(&H, qp.g.data(), &A, NULL, NULL, lb.data(), ub.data(), nWSR);
+    result.x.resize(qp.n);
+    result.solved = rval == qpOASES::SUCCESSFUL_RETURN
+                    && problem.getPrimalSolution(result.x.data()) == qpOASES::SUCCESSFUL_RETURN;
+    result.iterations = nWSR;
+    return result;
+}
+
+template<typename Problem>
+void SetupJcqp(Problem& problem, const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+    for (u32 i = 0; i < qp.n; ++i) {
+        problem.q[i] = qp.g[i];
+    }
+    for (u32 i = 0; i < qp.m; ++i) {
+        problem.l[i] = Clamp(qp.lb[i]);
+        problem.u[i] = Clamp(qp.ub[i]);
+    }
+    problem.settings.terminate = settings.terminate;
+    problem.settings.rho = settings.rho;
+    problem.settings.sigma = settings.sigma;
+    problem.settings.alpha = settings.alpha;
+    problem.settings.maxIterations = settings.maxIterations;
+}
+
+SolveResult SolveJcqpDense(const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+    QpProblem<double> problem(qp.n, qp.m, false);
+    problem.P = qp.DenseHessian();
+    problem.A = qp.DenseConstraintMatrix();
+    SetupJcqp(problem, qp, settings);
+    problem.runFromDense(-1, false, false);
+
+    SolveResult result;
+    result.x = problem.getSolution();
+    result.iterations = problem.getIterations();
+    result.solved = result.iterations < settings.maxIterations && result.x.allFinite();
+    return result;
+}
+
+SolveResult SolveJcqpSparse(const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+    QpProblem<double> problem(qp.n, qp.m, false);
+    problem.P_triples = qp.FullHessianTriples();
+    problem.A_triples = qp.A;
+    SetupJcqp(problem, qp, settings);
+    problem.runFromTriples(-1, false);
+
+    SolveResult result;
+    result.x = problem.getSolution();
+    result.iterations = problem.getIterations();
+    result.solved = result.iterations < settings.maxIterations && result.x.allFinite();
+    return result;
+}
+
+/**
+ * @brief Float JCQP with the double residual check and refinement the MPC uses, on the sparse KKT path.
+ */
+SolveResult SolveJcqpFloat(const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+    MixedPrecisionQpProblem problem(qp.n, qp.m);
+    problem.P = qp.DenseHessian().cast<float>();
+    problem.A = qp.DenseConstraintMatrix().cast<float>();
+    for (u32 i = 0; i < qp.n; ++i) {
+        problem.q[i] = qp.g[i];
+    }
+    for (u32 i = 0; i < qp.m; ++i) {
+        problem.l[i] = Clamp(qp.lb[i]);
+        problem.u[i] = Clamp(qp.ub[i]);
+    }
+    problem.settings.terminate = settings.terminate;
+    problem.settings.rho = settings.rho;
+    problem.settings.sigma = settings.sigma;
+    problem.settings.alpha = settings.alpha;
+    problem.settings.maxIterations = settings.maxIterations;
+    problem.run(-1, true);
+
+    SolveResult result;
+    result.x = problem.getSolution();
+    result.iterations = problem.getIterations();
+    result.solved = problem.getResidual() <= problem.residualTolerance && result.x.allFinite();
+    return result;
+}
+
+/**
+ * @brief qrActiveSetQp on the contact force QP  min 0.5 x'Hx + g'x  s.t.  A x >= lb, warm started
+ * from its solve of the previous snapshot. Repeats of one snapshot all start from the same state.
+ */
+SolveResult SolveActiveSet(const qrQpSnapshot& qp, const BenchSettings&)
+{
+    typedef qrActiveSetQp<12, 24> Solver;
+    static Solver start, last;
+    static u64 lastSequence = ~u64(0);
+
+    SolveResult result;
+    if (qp.source != QP_SNAPSHOT_CONTACT_FORCE || qp.n != 12 || qp.m != 24) {
+        result.applicable = false;
+        return result;
+    }
+    if (qp.sequence != lastSequence) {
+        start = last;
+        lastSequence = qp.sequence;
+    }
+    Solver::MatNN G = qp.DenseHessian();
+    Solver::VecN a = Eigen::Map<const Solver::VecN>(qp.g.data());
+    Solver::MatNM C = qp.DenseConstraintMatrix().transpose();
+    Solver::VecM b;
+    for (u32 i = 0; i < qp.m; ++i) {
+        b[i] = Clamp(qp.lb[i]);
+    }
+
+    Solver solver = start;
+    Solver::VecN x;
+    result.solved = solver.Solve(G, a, C, b, x);
+    result.iterations = solver.GetIterations();
+    result.x = x;
+    last = solver;
+    return result;
+}
+
+/**
+ * @brief Compressed column storage of a triplet list.
+ */
+void ToCsc(std::vector<SparseTriple<double>> triples, u32 cols,
+           std::vector<c_float>& values, std::vector<c_int>& rowIdx, std::vector<c_int>& colPtrs)
+{
+    sortAndSumTriples(triples);
+    values.clear();
+    rowIdx.clear();
+    colPtrs.assign(cols + 1, 0);
+    for (const auto& tri : triples) {
+        values.push_back(tri.value);
+        rowIdx.push_back(tri.r);
+        colPtrs[tri.c + 1]++;
+    }
+    for (u32 c = 0; c < cols; ++c) {
+        colPtrs[c + 1] += colPtrs[c];
+    }
+}
+
+SolveResult SolveOsqp(const qrQpSnapshot& qp, const BenchSettings& settings)
+{
+    std::vector<c_float> pValues, aValues;
+    std::vector<c_int> pRows, pCols, aRows, aCols;
+    ToCsc(qp.H, qp.n, pValues, pRows, pCols); // OSQP takes the upper triangle of P
+    ToCsc(qp.A, qp.n, aValues, aRows, aCols);
+    std::vector<c_float> q(qp.g.begin(), qp.g.end()), l(qp.m), u(qp.m);
+    for (u32 i = 0; i < qp.m; ++i) {
+        l[i] = std::max<c_float>(qp.lb[i], -OSQP_INFTY);
+        u[i] = std::min<c_float>(qp.ub[i], OSQP_INFTY);
+    }
+
+    OSQPData data;
+    data.n = qp.n;
+    data.m = qp.m;
+    data.P = csc_matrix(qp.n, qp.n, pValues.size(), pValues.data(), pRows.data(), pCols.data());
+    data.A = csc_matrix(qp.m, qp.n, aValues.size(), aValues.data(), aRows.data(), aCols.data());
+    data.q = q.data();
+    data.l = l.data();
+    data.u = u.data();
+
+    OSQPSettings osqpSettings;
+    osqp_set_default_settings(&osqpSettings);
+    osqpSettings.eps_abs = settings.terminate;
+    osqpSettings.eps_rel = settings.terminate;
+    osqpSettings.max_iter = settings.maxIterations;
+    osqpSettings.verbose = 0;
+
+    SolveResult result;
+    OSQPWorkspace* workspace = nullptr;
+    if (osqp_setup(&workspace, &data, &osqpSettings) == 0) {
+        osqp_solve(workspace);
+        result.solved = workspace->info->status_val == OSQP_SOLVED;
+        result.iterations = workspace->info->iter;
+        result.x = Eigen::Map<Eigen::VectorXd>(workspace->solution->x, qp.n);
+        osqp_cleanup(workspace);
+    }
+    c_free(data.P);
+    c_free(data.A);
+    return result;
+}
+
+const char* SourceName(u32 source)
+{
+    switch (source) {
+        case QP_SNAPSHOT_DENSE_MPC: return "dense MPC";
+        case QP_SNAPSHOT_SPARSE_CMPC: return "sparse CMPC";
+        case QP_SNAPSHOT_CONTACT_FORCE: return "contact force";
+        default: return "unknown";
+    }
+}
+
+void PrintStats(const std::string& name, const BackendStats& stats)
+{
+    double meanTime = 0, meanIterations = 0;
+    int maxIterations = 0;
+    for (double t : stats.timesUs) {
+        meanTime += t;
+    }
+    for (int it : stats.iterations) {
+        meanIterations += it;
+        maxIterations = std::max(maxIterations, it);
+    }
+    meanTime /= std::max<size_t>(stats.timesUs.size(), 1);
+    meanIterations /= std::max<size_t>(stats.iterations.size(), 1);
+    printf("  %-12s %5d/%-5d %9.1f %9.1f %9.1f %9.1f %9.1f %8.1f %6d %10.2e %10.2e\n",
+           name.c_str(), stats.solved, stats.total, meanTime,
+           Percentile(stats.timesUs, 0.5), Percentile(stats.timesUs, 0.9), Percentile(stats.timesUs, 0.99),
+           Percentile(stats.timesUs, 1.0), meanIterations, maxIterations,
+           stats.maxObjectiveDelta, stats.maxViolation);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    BenchSettings settings;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 < argc && arg == "--repeat") {
+            settings.repeat = std::max(1, atoi(argv[++i]));
+        } else if (i + 1 < argc && arg == "--terminate") {
+            settings.terminate = atof(argv[++i]);
+        } else if (i + 1 < argc && arg == "--rho") {
+            settings.rho = atof(argv[++i]);
+        } else if (i + 1 < argc && arg == "--sigma") {
+            settings.sigma = atof(argv[++i]);
+        } else if (i + 1 < argc && arg == "--alpha") {
+            settings.alpha = atof(argv[++i]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty()) {
+        printf("usage: %s [--repeat N] [--terminate eps] [--rho rho] [--sigma sigma] [--alpha alpha] snapshot_file...\n", argv[0]);
+        return 1;
+    }
+
+    typedef std::function<SolveResult(const qrQpSnapshot&, const BenchSettings&)> Backend;
+    const std::vector<std::pair<std::string, Backend>> backends = {
+        {"qpOASES", SolveQpOases},
+        {"qpOASES sp", SolveQpOasesSparse},
+        {"JCQP dense", SolveJcqpDense},
+        {"JCQP sparse", SolveJcqpSparse},
+        {"JCQP float", SolveJcqpFloat},
+        {"OSQP", SolveOsqp},
+        {"active set", SolveActiveSet},
+    };
+
+    // source -> backend -> stats
+    std::map<u32, std::vector<BackendStats>> stats;
+    std::map<u32, int> problemCount;
+    std::map<u32, std::pair<u32, u32>> problemSize;
+    qrQpSnapshot qp;
+    for (const std::string& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            printf("cannot open %s\n", file.c_str());
+            continue;
+        }
+        while (ReadQpSnapshot(in, qp)) {
+            std::vector<BackendStats>& sourceStats = stats[qp.source];
+            sourceStats.resize(backends.size());
+            problemCount[qp.source]++;
+            problemSize[qp.source] = std::make_pair(qp.n, qp.m);
+
+            double reference = 0;
+            bool hasReference = false;
+            for (size_t b = 0; b < backends.size(); ++b) {
+                SolveResult result;
+                std::vector<double> timesUs;
+                for (int r = 0; r < settings.repeat; ++r) {
+                    Clock::time_point start = Clock::now();
+                    result = backends[b].second(qp, settings);
+                    timesUs.push_back(Microseconds(start, Clock::now()));
+                }
+                if (!result.applicable) {
+                    continue;
+                }
+                BackendStats& s = sourceStats[b];
+                s.timesUs.insert(s.timesUs.end(), timesUs.begin(), timesUs.end());
+                s.total++;
+                s.iterations.push_back(result.iterations);
+                if (!result.solved) {
+                    continue;
+                }
+                s.solved++;
+                double objective = qp.Objective(result.x);
+                if (b == 0) {
+                    reference = objective;
+                    hasReference = true;
+                } else if (hasReference) {
+                    s.maxObjectiveDelta = std::max(s.maxObjectiveDelta,
+                                                   std::fabs(objective - reference) / std::max(1.0, std::fabs(reference)));
+                }
+                s.maxViolation = std::max(s.maxViolation, qp.ConstraintViolation(result.x));
+            }
+        }
+    }
+
+    printf("solve times in us, %d repeats per problem; objective delta is relative to qpOASES\n", settings.repeat);
+    for (const auto& entry : stats) {
+        printf("\n%s: %d problems, n = %u, m = %u\n", SourceName(entry.first), problemCount[entry.first],
+               problemSize[entry.first].first, problemSize[entry.first].second);
+        printf("  %-12s %11s %9s %9s %9s %9s %9s %8s %6s %10s %10s\n", "backend", "solved", "mean", "p50", "p90",
+               "p99", "max", "iters", "max", "d_obj", "viol");
+        for (size_t b = 0; b < backends.size(); ++b) {
+            if (entry.second[b].total > 0) {
+                PrintStats(backends[b].first, entry.second[b]);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+// Swings the four legs of a trot through qrSwingTrajectories with the touchdown point moving every tick,
+// as Raibert's foothold does. Reports the time per four-leg evaluation, the heap allocations it made,
+// and how far the closed-form velocity and acceleration are from finite differences of the position.
+//
+// usage: qr_swing_benchmark [--ticks N]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "controller/qr_swing_trajectory.h"
+
+namespace {
+
+const float swingDuration = 0.25f;
+const float dt = 0.001f;
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int ticks = 100000;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ticks") {
+            ticks = std::max(1, atoi(argv[++i]));
+        }
+    }
+
+    Eigen::Matrix<float, 3, 4> hips;
+    hips << 0.183f, 0.183f, -0.183f, -0.183f,
+            -0.13f, 0.13f, -0.13f, 0.13f,
+            -0.28f, -0.28f, -0.28f, -0.28f;
+    // FR and RL swing in the first half of the cycle, FL and RR in the second
+    const Vec4<float> phaseOffset(0.f, 0.5f, 0.f, 0.5f);
+    const int ticksPerSwing = int(swingDuration / dt);
+
+    qrSwingTrajectories trajectories;
+    Eigen::Matrix<float, 3, 4> position, velocity, acceleration;
+    Eigen::Matrix<float, 3, 4> lastPosition, lastVelocity, lastAcceleration;
+    std::vector<double> evaluateUs;
+    evaluateUs.reserve(ticks);
+    long loopAllocations = 0;
+    float velocityError = 0.f;
+    float accelerationError = 0.f;
+    for (int k = 0; k < ticks; ++k) {
+        const float cycle = float(k % (2 * ticksPerSwing)) / (2 * ticksPerSwing);
+        Vec4<float> phase;
+        const long before = allocations.load();
+        Clock::time_point start = Clock::now();
+        for (int legId = 0; legId < 4; ++legId) {
+            const float legCycle = std::fmod(cycle + phaseOffset[legId], 1.f);
+            phase[legId] = std::min(1.f, 2.f * legCycle);
+            const Vec3<float> target = hips.col(legId) + Vec3<float>(0.05f + 0.02f * std::sin(0.001f * k), 0.f, 0.f);
+            if (legCycle * 2 * ticksPerSwing < 1.f) {
+                trajectories.Start(legId, hips.col(legId) - Vec3<float>(0.05f, 0.f, 0.f), target, swingDuration);
+            } else {
+                trajectories.SetTarget(legId, target);
+            }
+        }
+        trajectories.Evaluate(phase, position, velocity, acceleration);
+        evaluateUs.push_back(Microseconds(start, Clock::now()));
+        loopAllocations += allocations.load() - before;
+        // compare away from liftoff, where the trajectory restarts; the drift of the target, up to 2 cm/s,
+        // is not part of the closed-form derivatives
+        if (k > 0 && k % (2 * ticksPerSwing) > 1 && k % (2 * ticksPerSwing) < ticksPerSwing) {
+            for (int legId = 0; legId < 4; legId += 3) {
+                velocityError = std::max(velocityError,
+                    ((position.col(legId) - lastPosition.col(legId)) / dt
+                     - 0.5f * (velocity.col(legId) + lastVelocity.col(legId))).cwiseAbs().maxCoeff());
+                accelerationError = std::max(accelerationError,
+                    ((velocity.col(legId) - lastVelocity.col(legId)) / dt
+                     - 0.5f * (acceleration.col(legId) + lastAcceleration.col(legId))).cwiseAbs().maxCoeff());
+            }
+        }
+        lastPosition = position;
+        lastVelocity = velocity;
+        lastAcceleration = acceleration;
+    }
+
+    printf("%d four-leg evaluations, us each: median %.3f, p99 %.3f, max %.1f\n", ticks,
+           Percentile(evaluateUs, 0.5), Percentile(evaluateUs, 0.99), Percentile(evaluateUs, 1.));
+    printf("heap allocations in the loop: %ld\n", loopAllocations);
+    printf("largest finite difference mismatch: velocity %.3f m/s, acceleration %.2f m/s^2\n",
+           velocityError, accelerationError);
+    return 0;
+}
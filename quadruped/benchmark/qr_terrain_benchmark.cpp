@@ -0,0 +1,144 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Feeds a synthetic depth cloud of a staircase into qrElevationMap, then walks the four nominal footholds
+// over the stairs and lets qrFootholdOptimizer choose each of them. Reports the time per four-leg
+// optimization, the heap allocations it made, and how many chosen footholds lie closer to a stair edge
+// than the nominal ones did.
+//
+// usage: qr_terrain_benchmark [--steps N] [--points N]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "planner/qr_foothold_optimizer.h"
+#include "state_estimator/qr_elevation_map.h"
+
+namespace {
+
+const float stairRun = 0.3f;
+const float stairRise = 0.1f;
+const float firstStair = 0.5f;
+
+float StairHeight(float x)
+{
+    return x < firstStair ? 0.f : stairRise * (1.f + std::floor((x - firstStair) / stairRun));
+}
+
+float DistanceToEdge(float x)
+{
+    if (x < firstStair - stairRun) {
+        return stairRun;
+    }
+    const float u = std::fmod(x - firstStair + 10.f * stairRun, stairRun);
+    return std::min(u, stairRun - u);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int steps = 2000;
+    int points = 60000;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--steps") {
+            steps = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--points") {
+            points = std::max(4, atoi(argv[++i]));
+        }
+    }
+
+    // a camera 0.5 m above the origin sees the stairs with 1 cm noise
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<float> uniform(-2.f, 2.f);
+    std::normal_distribution<float> noise(0.f, 0.01f);
+    std::vector<float> cloud;
+    cloud.reserve(3 * points);
+    for (int i = 0; i < points; ++i) {
+        const float x = uniform(generator);
+        const float y = uniform(generator);
+        cloud.push_back(x);
+        cloud.push_back(y);
+        cloud.push_back(StairHeight(x) + noise(generator) - 0.5f);
+    }
+    qrElevationMap map;
+    for (int k = 0; k < 5; ++k) {
+        map.AddPointCloud(cloud.data(), points, Mat3<float>::Identity(), Vec3<float>(0.f, 0.f, 0.5f));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    const qrElevationMapSnapshot& snapshot = map.GetSnapshot();
+
+    Eigen::Matrix<float, 3, 4> hips;
+    hips << 0.183f, 0.183f, -0.183f, -0.183f,
+            -0.13f, 0.13f, -0.13f, 0.13f,
+            0.f, 0.f, 0.f, 0.f;
+    qrFootholdOptimizer optimizer;
+    std::vector<double> optimizeUs;
+    optimizeUs.reserve(steps);
+    long loopAllocations = 0;
+    int nominalNearEdge = 0;
+    int chosenNearEdge = 0;
+    int infeasible = 0;
+    for (int k = 0; k < steps; ++k) {
+        const float baseX = -0.5f + 2.f * k / steps;
+        const long before = allocations.load();
+        Clock::time_point start = Clock::now();
+        Eigen::Matrix<float, 3, 4> footholds;
+        int found = 0;
+        for (int legId = 0; legId < 4; ++legId) {
+            Vec3<float> hip = hips.col(legId);
+            hip[0] += baseX;
+            hip[2] = StairHeight(hip[0]) + 0.3f;
+            Vec3<float> nominal = hip;
+            nominal[0] += 0.1f;
+            nominal[2] = 0.f;
+            Vec3<float> foothold = nominal;
+            found += optimizer.Optimize(snapshot, nominal, hip, 0.28f, foothold);
+            footholds.col(legId) = foothold;
+        }
+        optimizeUs.push_back(Microseconds(start, Clock::now()));
+        loopAllocations += allocations.load() - before;
+        infeasible += 4 - found;
+        for (int legId = 0; legId < 4; ++legId) {
+            nominalNearEdge += DistanceToEdge(hips(0, legId) + baseX + 0.1f) < 0.04f;
+            chosenNearEdge += DistanceToEdge(footholds(0, legId)) < 0.04f;
+        }
+    }
+
+    printf("%d four-leg optimizations, us each: median %.2f, p99 %.2f, max %.1f\n", steps,
+           Percentile(optimizeUs, 0.5), Percentile(optimizeUs, 0.99), Percentile(optimizeUs, 1.));
+    printf("heap allocations in the loop: %ld, legs without a feasible cell: %d\n", loopAllocations, infeasible);
+    printf("footholds within 4 cm of a stair edge: nominal %d, chosen %d\n", nominalNearEdge, chosenNearEdge);
+    return 0;
+}
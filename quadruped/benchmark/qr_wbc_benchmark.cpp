@@ -0,0 +1,212 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// Runs the whole body impulse controller qrWBIC on a trotting sequence of an A1 sized quadruped: per tick
+// the model update, the tasks (body orientation and position, swing feet) and MakeTorque with the
+// reaction forces an MPC would give. Reports the time per tick against the budget, the heap allocations
+// made in the loop, and the consistency of the result: residual of the floating base dynamics and
+// violation of the friction cones. Then times the kinematic WBC qrKinWBC on the same task stack, once after
+// the model update and once more with new targets only, which reuses the cached projectors.
+//
+// usage: qr_wbc_benchmark [--ticks N] [--budget us]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "qr_benchmark_util.h"
+
+#include "controller/wbc/qr_WBIC.hpp"
+#include "controller/wbc/qr_kinematics_WBC.hpp"
+
+namespace {
+
+typedef FixedQuadrupedModel<float> Model;
+typedef qrQuadrupedWBIC::Task Task;
+/**
+ * @brief Three revolute joints per leg (ab/ad about x, hip and knee about y) with rotors, roughly the
+ * dimensions and masses of an A1.
+ */
+void BuildQuadruped(Model& model)
+{
+    Mat3<float> bodyInertia;
+    bodyInertia << 0.0158, 0., 0., 0., 0.0377, 0., 0., 0., 0.0457;
+    model.addBase(4.713f, Vec3<float>(0., 0.004, -0.0005), bodyInertia);
+
+    const float gearRatio = 9.1;
+    SpatialInertia<float> rotor(0.055f, Vec3<float>::Zero(), Vec3<float>(6.3e-5, 3.3e-5, 3.3e-5).asDiagonal());
+    SpatialInertia<float> hip(0.696f, Vec3<float>(-0.0033, 0., 0.), Vec3<float>(5.5e-4, 9.2e-4, 5.9e-4).asDiagonal());
+    SpatialInertia<float> thigh(1.013f, Vec3<float>(-0.0032, 0., -0.0275), Vec3<float>(5.5e-3, 5.1e-3, 1.0e-3).asDiagonal());
+    SpatialInertia<float> calf(0.166f, Vec3<float>(0.006, 0., -0.1), Vec3<float>(2.9e-3, 2.9e-3, 3.1e-5).asDiagonal());
+    const Mat3<float> I3 = Mat3<float>::Identity();
+
+    for (int legId = 0; legId < 4; legId++) {
+        const float front = legId < 2 ? 1. : -1.;
+        const float side = legId % 2 ? 1. : -1.;
+        Mat6<float> Xhip = createSXform(I3, Vec3<float>(front * 0.183, side * 0.047, 0.));
+        int body = model.addBody(hip, rotor, gearRatio, 5, JointType::Revolute, CoordinateAxis::X, Xhip, Xhip) - 1;
+        Mat6<float> Xthigh = createSXform(I3, Vec3<float>(0., side * 0.08505, 0.));
+        body = model.addBody(thigh, rotor, gearRatio, body, JointType::Revolute, CoordinateAxis::Y, Xthigh, Xthigh) - 1;
+        Mat6<float> Xcalf = createSXform(I3, Vec3<float>(0., 0., -0.2));
+        body = model.addBody(calf, rotor, gearRatio, body, JointType::Revolute, CoordinateAxis::Y, Xcalf, Xcalf) - 1;
+        model.addGroundContactPoint(body, Vec3<float>(0., 0., -0.2));
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int ticks = 20000;
+    double budgetUs = 200.;
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--ticks") {
+            ticks = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--budget") {
+            budgetUs = atof(argv[++i]);
+        }
+    }
+
+    Model model;
+    BuildQuadruped(model);
+    qrQuadrupedWBIC wbic(model);
+    qrQuadrupedKinWBC kinWbc(model);
+    const float totalMass = 4.713f + 4 * (0.696f + 1.013f + 0.166f + 3 * 0.055f);
+    wbic.SetMaxNormalForce(totalMass * 9.81f);
+
+    // a trot: diagonal pairs swing in turn with a four leg stance between them
+    const int period = 100;
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> uniform(-1.f, 1.f);
+    Model::State state;
+    Task tasks[4];
+    std::vector<double> tickUs(ticks), kinUs(ticks), kinTargetsUs(ticks);
+    qrQuadrupedKinWBC::JointVector jposCmd, jvelCmd;
+    int cachedLevels = 0;
+    int qpFailures = 0;
+    double maxResidual = 0, maxConeViolation = 0;
+    long loopAllocations = 0;
+
+    for (int tick = 0; tick < ticks; ++tick) {
+        const int phase = tick % period;
+        Eigen::Matrix<bool, 4, 1> contactState;
+        if (phase < 40) {
+            contactState << true, false, false, true;
+        } else if (phase >= 50 && phase < 90) {
+            contactState << false, true, true, false;
+        } else {
+            contactState.setConstant(true);
+        }
+
+        state.bodyOrientation << 1.f, 0.03f * uniform(rng), 0.03f * uniform(rng), 0.1f * uniform(rng);
+        state.bodyOrientation.normalize();
+        state.bodyPosition << 0.f, 0.f, 0.28f + 0.02f * uniform(rng);
+        for (int j = 0; j < 6; ++j) {
+            state.bodyVelocity[j] = 0.3f * uniform(rng);
+        }
+        for (int j = 0; j < 12; ++j) {
+            state.q[j] = (j % 3 == 0 ? 0.f : j % 3 == 1 ? 0.9f : -1.7f) + 0.1f * uniform(rng);
+            state.qd[j] = 2.f * uniform(rng);
+        }
+        // MPC forces: the weight shared by the stance legs, with some tangential force
+        Eigen::Matrix<float, 3, 4> forcesDes = Eigen::Matrix<float, 3, 4>::Zero();
+        const float fz = totalMass * 9.81f / contactState.count();
+        for (int leg = 0; leg < 4; ++leg) {
+            if (contactState[leg]) {
+                forcesDes.col(leg) << 0.3f * fz * uniform(rng), 0.3f * fz * uniform(rng), fz * (1.f + 0.2f * uniform(rng));
+            }
+        }
+        Quat<float> oriDes(1.f, 0.f, 0.f, 0.f);
+
+        const long allocationsBefore = allocations;
+        Clock::time_point start = Clock::now();
+        model.setState(state);
+        model.contactJacobians();
+        int taskCount = 0;
+        tasks[taskCount++].UpdateBodyOri(model, oriDes, Vec3<float>::Zero(), Vec3<float>::Zero(), 100.f, 10.f);
+        tasks[taskCount++].UpdateBodyPos(model, Vec3<float>(0.f, 0.f, 0.28f), Vec3<float>(0.3f, 0.f, 0.f),
+                                         Vec3<float>::Zero(), 100.f, 10.f);
+        for (int leg = 0; leg < 4; ++leg) {
+            if (!contactState[leg]) {
+                Vec3<float> footDes = model._pGC[leg] + Vec3<float>(0.01f, 0.f, 0.005f);
+                tasks[taskCount++].UpdateLinkPos(model, leg, footDes, Vec3<float>(0.5f, 0.f, 0.f),
+                                                 Vec3<float>::Zero(), 300.f, 10.f);
+            }
+        }
+        bool solved = wbic.MakeTorque(contactState, forcesDes, tasks, taskCount);
+        Clock::time_point end = Clock::now();
+        loopAllocations += allocations - allocationsBefore;
+        tickUs[tick] = Microseconds(start, end);
+        qpFailures += !solved;
+
+        // the floating base rows of the dynamics with the relaxed accelerations and forces
+        const qrQuadrupedWBIC::GeneralizedForce& qdd = wbic.GetQdd();
+        const Eigen::Matrix<float, 3, 4>& forces = wbic.GetReactionForces();
+        Eigen::Matrix<float, 6, 1> residual = (model.getCoriolisForce() + model.getGravityForce()).head<6>();
+        residual.noalias() += model.getMassMatrix().topRows<6>() * qdd;
+        for (int leg = 0; leg < 4; ++leg) {
+            if (contactState[leg]) {
+                residual.noalias() -= model._Jc[leg].leftCols<6>().transpose() * forces.col(leg);
+                const Vec3<float>& f = forces.col(leg);
+                float violation = std::max(std::max(std::fabs(f[0]), std::fabs(f[1])) - 0.4f * f[2], -f[2]);
+                maxConeViolation = std::max(maxConeViolation, double(violation));
+            }
+        }
+        maxResidual = std::max(maxResidual, double(residual.cwiseAbs().maxCoeff()));
+
+        start = Clock::now();
+        kinWbc.FindConfiguration(contactState, tasks, taskCount, jposCmd, jvelCmd);
+        end = Clock::now();
+        kinUs[tick] = Microseconds(start, end);
+        // a faster position loop: the same state and Jacobians, moved targets
+        for (int i = 0; i < taskCount; ++i) {
+            tasks[i].posErr *= 0.9f;
+        }
+        start = Clock::now();
+        kinWbc.FindConfiguration(contactState, tasks, taskCount, jposCmd, jvelCmd);
+        end = Clock::now();
+        kinTargetsUs[tick] = Microseconds(start, end);
+        cachedLevels += kinWbc.GetRecomputedLevels();
+    }
+
+    double mean = 0;
+    int overBudget = 0;
+    for (double t : tickUs) {
+        mean += t / ticks;
+        overBudget += t > budgetUs;
+    }
+    printf("%d ticks, us per tick: mean %.1f, median %.1f, p99 %.1f, max %.1f; %d over the %.0f us budget\n", ticks,
+           mean, Percentile(tickUs, 0.5), Percentile(tickUs, 0.99), Percentile(tickUs, 1.), overBudget, budgetUs);
+    printf("heap allocations in the loop: %ld, relaxation QP failures: %d\n", loopAllocations, qpFailures);
+    printf("max floating base residual %.3e N, max friction cone violation %.3e N\n", maxResidual, maxConeViolation);
+    printf("kinematic WBC, us per call: new Jacobians median %.2f, p99 %.2f; new targets only median %.2f, p99 %.2f "
+           "(%d levels recomputed)\n", Percentile(kinUs, 0.5), Percentile(kinUs, 0.99), Percentile(kinTargetsUs, 0.5),
+           Percentile(kinTargetsUs, 0.99), cachedLevels);
+    return 0;
+}
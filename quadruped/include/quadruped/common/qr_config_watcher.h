@@ -0,0 +1,258 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_CONFIG_WATCHER_H
+#define QR_CONFIG_WATCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <yaml-cpp/yaml.h>
+
+#include "common/qr_cTypes.h"
+
+/**
+ * @brief A yaml file parsed into a typed snapshot, see qrConfig.
+ */
+class qrConfigSource {
+public:
+
+    explicit qrConfigSource(const std::string &pathIn) : path(pathIn) {}
+
+    virtual ~qrConfigSource() = default;
+
+    const std::string &GetPath() const
+    {
+        return path;
+    }
+
+protected:
+
+    friend class qrConfigWatcher;
+
+    /**
+     * @brief Parse the file into a new snapshot and queue it, runs on the watcher thread.
+     * @return false if the file is invalid, the current snapshot stays.
+     */
+    virtual bool Reload() = 0;
+
+    /**
+     * @brief Make the queued snapshot current, runs on the control thread between two ticks.
+     *        It never frees memory, the replaced snapshot is handed to Collect.
+     * @return false if a snapshot stays queued because the one replaced last time is not freed yet.
+     */
+    virtual bool Acquire() = 0;
+
+    /**
+     * @brief Free the snapshot that the last Acquire replaced, runs on the watcher thread.
+     */
+    virtual void Collect() = 0;
+
+    std::string path;
+
+    /**
+     * @brief The modification time of the file when it was parsed, in ns.
+     */
+    long long modifiedTime = 0;
+};
+
+/**
+ * @brief Watches the files of all qrConfig objects from a background thread and reparses
+ *        the ones that changed, so that parameters can be tuned while the robot runs.
+ */
+class qrConfigWatcher {
+public:
+
+    /**
+     * @brief The watcher of the process, its thread starts with the first call.
+     */
+    static qrConfigWatcher &Instance();
+
+    ~qrConfigWatcher();
+
+    void Add(qrConfigSource *source);
+
+    void Remove(qrConfigSource *source);
+
+    /**
+     * @brief Make the snapshots parsed since the last call current. Called by the control loop
+     *        at the start of a tick. It never blocks: while the watcher is parsing, the new
+     *        snapshots are taken at a later tick.
+     */
+    void Acquire();
+
+    /**
+     * @brief Set how often the files are checked for changes.
+     * @param seconds: 0.5 by default.
+     */
+    void SetPollPeriod(float seconds);
+
+    /**
+     * @brief The modification time of a file in ns, 0 if it does not exist.
+     */
+    static long long GetModifiedTime(const std::string &path);
+
+private:
+
+    qrConfigWatcher();
+
+    void Run();
+
+    std::mutex mutex;
+
+    std::condition_variable wakeUp;
+
+    std::vector<qrConfigSource *> sources;
+
+    /**
+     * @brief Set by the watcher when a snapshot was queued, so Acquire is a single load otherwise.
+     */
+    std::atomic<bool> hasPending;
+
+    int pollPeriodMs = 500;
+
+    bool stop = false;
+
+    std::thread worker;
+};
+
+/**
+ * @brief A config file parsed once into the plain struct T. T::Load(const YAML::Node &) reads
+ *        the file, T::Validate() throws std::runtime_error for invalid values. When the file
+ *        changes, the watcher thread parses it again and the control thread swaps the new
+ *        snapshot in at the next tick, so Get() never parses or touches the file and the
+ *        reference it returns stays valid for the rest of the tick. An invalid edit is
+ *        reported and ignored.
+ */
+template <typename T>
+class qrConfig : public qrConfigSource {
+public:
+
+    /**
+     * @brief Parse and validate the file.
+     * @throw std::runtime_error if the file is missing or invalid.
+     */
+    explicit qrConfig(const std::string &pathIn)
+        : qrConfigSource(pathIn), current(Parse(pathIn)), pending(nullptr), retired(nullptr)
+    {
+        modifiedTime = qrConfigWatcher::GetModifiedTime(path);
+        qrConfigWatcher::Instance().Add(this);
+    }
+
+    qrConfig(const qrConfig &) = delete;
+
+    qrConfig &operator=(const qrConfig &) = delete;
+
+    ~qrConfig() override
+    {
+        qrConfigWatcher::Instance().Remove(this);
+        delete current;
+        delete pending.load();
+        delete retired.load();
+    }
+
+    /**
+     * @brief The current snapshot, only to be used by the control thread.
+     */
+    const T &Get() const
+    {
+        return *current;
+    }
+
+    /**
+     * @brief Increases whenever a reloaded snapshot becomes current.
+     */
+    u32 GetVersion() const
+    {
+        return version;
+    }
+
+protected:
+
+    bool Reload() override
+    {
+        T *next;
+        try {
+            next = Parse(path);
+        } catch (const std::exception &e) {
+            std::cout << "[qrConfig] keeping the previous parameters, " << e.what() << std::endl;
+            return false;
+        }
+        // a snapshot the control thread has not taken yet is outdated
+        delete pending.exchange(next, std::memory_order_acq_rel);
+        return true;
+    }
+
+    bool Acquire() override
+    {
+        // only this thread fills the retired slot, so it stays empty until the store below
+        if (retired.load(std::memory_order_acquire)) {
+            return pending.load(std::memory_order_acquire) == nullptr;
+        }
+        T *next = pending.exchange(nullptr, std::memory_order_acq_rel);
+        if (!next) {
+            return true;
+        }
+        T *previous = current;
+        current = next;
+        ++version;
+        retired.store(previous, std::memory_order_release);
+        return true;
+    }
+
+    void Collect() override
+    {
+        delete retired.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+private:
+
+    static T *Parse(const std::string &path)
+    {
+        std::unique_ptr<T> config(new T);
+        try {
+            config->Load(YAML::LoadFile(path));
+            config->Validate();
+        } catch (const std::exception &e) {
+            throw std::runtime_error(path + ": " + e.what());
+        }
+        return config.release();
+    }
+
+    T *current;
+
+    std::atomic<T *> pending;
+
+    std::atomic<T *> retired;
+
+    u32 version = 0;
+};
+
+#endif // QR_CONFIG_WATCHER_H
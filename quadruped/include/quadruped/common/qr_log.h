@@ -0,0 +1,367 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_LOG_H
+#define QR_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+#include "common/qr_cTypes.h"
+
+enum qrLogLevel {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+/**
+ * @brief Messages below this level are removed at compile time, e.g. -DQR_LOG_COMPILE_LEVEL=1 drops QR_LOG_DEBUG.
+ */
+#ifndef QR_LOG_COMPILE_LEVEL
+#define QR_LOG_COMPILE_LEVEL 0
+#endif
+
+/**
+ * @brief A call site of the log macros, it keeps the state of the rate limit.
+ */
+struct qrLogSite {
+
+    /**
+     * @brief The steady time in ns before which the site stays quiet.
+     */
+    std::atomic<s64> quietUntil{0};
+
+    /**
+     * @brief How many messages the rate limit swallowed since the last one went out.
+     */
+    std::atomic<u32> suppressed{0};
+};
+
+/**
+ * @brief A C string argument, copied because the message is formatted later on another thread.
+ */
+struct qrLogText {
+    char text[48];
+};
+
+/**
+ * @brief How an argument of a log message is stored in the ring and handed to snprintf.
+ */
+template<typename T>
+struct qrLogArg {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+                  "log messages take numbers, enums, pointers and C strings");
+
+    typedef T Stored;
+
+    static Stored Store(T value)
+    {
+        return value;
+    }
+
+    static T Pass(const Stored &value)
+    {
+        return value;
+    }
+};
+
+template<>
+struct qrLogArg<const char *> {
+
+    typedef qrLogText Stored;
+
+    static Stored Store(const char *value)
+    {
+        qrLogText stored;
+        std::strncpy(stored.text, value ? value : "(null)", sizeof(stored.text) - 1);
+        stored.text[sizeof(stored.text) - 1] = '\0';
+        return stored;
+    }
+
+    static const char *Pass(const Stored &value)
+    {
+        return value.text;
+    }
+};
+
+template<>
+struct qrLogArg<char *> : qrLogArg<const char *> {};
+
+/**
+ * @brief The number of payload bytes the arguments take.
+ */
+template<typename... Args>
+struct qrLogPayloadSize {
+    static constexpr size_t value = 0;
+};
+
+template<typename T, typename... Rest>
+struct qrLogPayloadSize<T, Rest...> {
+    static constexpr size_t value = sizeof(typename qrLogArg<T>::Stored) + qrLogPayloadSize<Rest...>::value;
+};
+
+/**
+ * @brief Reads the arguments back from the payload and formats the message, runs on the sink thread.
+ */
+template<typename... Args>
+struct qrLogFormat;
+
+template<>
+struct qrLogFormat<> {
+
+    template<typename... Done>
+    static int Call(char *out, size_t size, const char *format, const unsigned char *, Done... done)
+    {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#pragma GCC diagnostic ignored "-Wformat-security"
+        return std::snprintf(out, size, format, done...);
+#pragma GCC diagnostic pop
+    }
+
+    static int Run(char *out, size_t size, const char *format, const unsigned char *payload)
+    {
+        return Call(out, size, format, payload);
+    }
+};
+
+template<typename T, typename... Rest>
+struct qrLogFormat<T, Rest...> {
+
+    template<typename... Done>
+    static int Call(char *out, size_t size, const char *format, const unsigned char *payload, Done... done)
+    {
+        typename qrLogArg<T>::Stored value;
+        std::memcpy(&value, payload, sizeof(value));
+        return qrLogFormat<Rest...>::Call(out, size, format, payload + sizeof(value), done..., qrLogArg<T>::Pass(value));
+    }
+
+    static int Run(char *out, size_t size, const char *format, const unsigned char *payload)
+    {
+        return Call(out, size, format, payload);
+    }
+};
+
+/**
+ * @brief Lets the compiler check the format string of a log message, never called.
+ */
+inline void qrLogCheckFormat(const char *, ...) __attribute__((format(printf, 1, 2)));
+
+inline void qrLogCheckFormat(const char *, ...) {}
+
+/**
+ * @brief Logging for the control loop. A message is only copied into a lock-free ring together
+ *        with its arguments; a background thread formats it and writes it out. Use the QR_LOG_*
+ *        macros, a message below the active level costs one branch.
+ */
+class qrLog {
+public:
+
+    typedef int (*FormatFunction)(char *out, size_t size, const char *format, const unsigned char *payload);
+
+    /**
+     * @brief One message waiting in the ring.
+     */
+    struct Record {
+        int level;
+        u32 suppressed;
+        s64 time;
+        const char *format;
+        FormatFunction formatFunction;
+        unsigned char payload[200];
+    };
+
+    /**
+     * @brief The logger of the process, its thread starts with the first call.
+     */
+    static qrLog &Instance();
+
+    ~qrLog();
+
+    /**
+     * @brief The lowest level that is written, LOG_LEVEL_INFO by default.
+     */
+    static int Level()
+    {
+        return level.load(std::memory_order_relaxed);
+    }
+
+    static void SetLevel(int levelIn)
+    {
+        level.store(levelIn, std::memory_order_relaxed);
+    }
+
+    static s64 Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Queue a message. It never blocks: if the ring is full the message is dropped and counted.
+     * @param site the call site, for the rate limit.
+     * @param levelIn the level of the message.
+     * @param period at most one message of this site per period in seconds, 0 for no limit.
+     * @param format a printf format that lives as long as the program, i.e. a string literal.
+     */
+    template<typename... Args>
+    void Write(qrLogSite &site, int levelIn, float period, const char *format, Args... args)
+    {
+        static_assert(qrLogPayloadSize<Args...>::value <= sizeof(Record().payload), "too many log arguments");
+        const s64 now = Now();
+        u32 suppressed = 0;
+        if (period > 0.f) {
+            s64 quietUntil = site.quietUntil.load(std::memory_order_relaxed);
+            if (now < quietUntil
+                || !site.quietUntil.compare_exchange_strong(quietUntil, now + s64(period * 1e9f))) {
+                site.suppressed.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+        }
+
+        size_t position;
+        Record *record = Claim(position);
+        if (!record) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        record->level = levelIn;
+        record->suppressed = suppressed;
+        record->time = now;
+        record->format = format;
+        record->formatFunction = &qrLogFormat<Args...>::Run;
+        Pack(record->payload, args...);
+        Publish(position);
+    }
+
+    /**
+     * @brief Wait until the sink thread wrote everything queued so far, e.g. before exit().
+     */
+    void Flush();
+
+private:
+
+    qrLog();
+
+    static const size_t capacity = 1024;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+
+    static void Pack(unsigned char *) {}
+
+    template<typename T, typename... Rest>
+    static void Pack(unsigned char *payload, T value, Rest... rest)
+    {
+        const typename qrLogArg<T>::Stored stored = qrLogArg<T>::Store(value);
+        std::memcpy(payload, &stored, sizeof(stored));
+        Pack(payload + sizeof(stored), rest...);
+    }
+
+    /**
+     * @brief Reserve a slot of the ring, null if it is full.
+     */
+    Record *Claim(size_t &position);
+
+    /**
+     * @brief Hand a filled slot to the sink thread.
+     */
+    void Publish(size_t position);
+
+    /**
+     * @brief The sink thread, it formats and writes the queued messages every few ms.
+     */
+    void Run();
+
+    /**
+     * @brief Write out all published messages, returns how many.
+     */
+    size_t Drain();
+
+    static std::atomic<int> level;
+
+    Slot slots[capacity];
+
+    alignas(64) std::atomic<size_t> head;
+
+    alignas(64) std::atomic<size_t> tail;
+
+    std::atomic<u32> dropped;
+
+    /**
+     * @brief The steady time of the first message, the printed times are relative to it.
+     */
+    s64 startTime;
+
+    std::mutex mutex;
+
+    std::condition_variable wakeUp;
+
+    std::condition_variable drained;
+
+    bool stop = false;
+
+    bool flushRequested = false;
+
+    std::thread worker;
+};
+
+#define QR_LOG(levelIn, period, ...)                                                        \
+    do {                                                                                    \
+        if ((levelIn) >= QR_LOG_COMPILE_LEVEL && (levelIn) >= qrLog::Level()) {            \
+            static qrLogSite qrLogSite_;                                                    \
+            if (false) {                                                                    \
+                qrLogCheckFormat(__VA_ARGS__);                                              \
+            }                                                                               \
+            qrLog::Instance().Write(qrLogSite_, (levelIn), (period), __VA_ARGS__);          \
+        }                                                                                   \
+    } while (0)
+
+#define QR_LOG_DEBUG(...) QR_LOG(LOG_LEVEL_DEBUG, 0.f, __VA_ARGS__)
+#define QR_LOG_INFO(...) QR_LOG(LOG_LEVEL_INFO, 0.f, __VA_ARGS__)
+#define QR_LOG_WARN(...) QR_LOG(LOG_LEVEL_WARN, 0.f, __VA_ARGS__)
+#define QR_LOG_ERROR(...) QR_LOG(LOG_LEVEL_ERROR, 0.f, __VA_ARGS__)
+
+/**
+ * @brief Rate limited variants, at most one message of the call site per period in seconds.
+ *        The next message that goes out reports how many were suppressed.
+ */
+#define QR_LOG_DEBUG_EVERY(period, ...) QR_LOG(LOG_LEVEL_DEBUG, period, __VA_ARGS__)
+#define QR_LOG_INFO_EVERY(period, ...) QR_LOG(LOG_LEVEL_INFO, period, __VA_ARGS__)
+#define QR_LOG_WARN_EVERY(period, ...) QR_LOG(LOG_LEVEL_WARN, period, __VA_ARGS__)
+#define QR_LOG_ERROR_EVERY(period, ...) QR_LOG(LOG_LEVEL_ERROR, period, __VA_ARGS__)
+
+#endif // QR_LOG_H
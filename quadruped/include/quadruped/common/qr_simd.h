@@ -0,0 +1,322 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_SIMD_H
+#define QR_SIMD_H
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QR_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QR_SIMD_NEON
+#endif
+
+/**
+ * @brief Four floats processed in one 128 bit register, one lane per leg.
+ * Uses SSE2 on x86-64 and NEON on ARM, both are part of the base instruction set, and plain arrays otherwise.
+ * Comparisons return a lane mask which is consumed by simd::select.
+ */
+struct alignas(16) qrFloat4 {
+
+#if defined(QR_SIMD_SSE2)
+    typedef __m128 Register;
+#elif defined(QR_SIMD_NEON)
+    typedef float32x4_t Register;
+#else
+    struct Register {
+        float v[4];
+    };
+#endif
+
+    Register r;
+
+    qrFloat4() = default;
+
+    qrFloat4(Register value): r(value) {}
+
+    /** @brief broadcast a scalar to all lanes */
+    qrFloat4(float value)
+    {
+#if defined(QR_SIMD_SSE2)
+        r = _mm_set1_ps(value);
+#elif defined(QR_SIMD_NEON)
+        r = vdupq_n_f32(value);
+#else
+        r.v[0] = r.v[1] = r.v[2] = r.v[3] = value;
+#endif
+    }
+
+    qrFloat4(float a, float b, float c, float d)
+    {
+#if defined(QR_SIMD_SSE2)
+        r = _mm_setr_ps(a, b, c, d);
+#elif defined(QR_SIMD_NEON)
+        const float values[4] = {a, b, c, d};
+        r = vld1q_f32(values);
+#else
+        r.v[0] = a;
+        r.v[1] = b;
+        r.v[2] = c;
+        r.v[3] = d;
+#endif
+    }
+
+    /** @brief load 4 floats, p need not be aligned */
+    static qrFloat4 Load(const float* p)
+    {
+#if defined(QR_SIMD_SSE2)
+        return _mm_loadu_ps(p);
+#elif defined(QR_SIMD_NEON)
+        return vld1q_f32(p);
+#else
+        return qrFloat4(p[0], p[1], p[2], p[3]);
+#endif
+    }
+
+    /** @brief store 4 floats, p need not be aligned */
+    void Store(float* p) const
+    {
+#if defined(QR_SIMD_SSE2)
+        _mm_storeu_ps(p, r);
+#elif defined(QR_SIMD_NEON)
+        vst1q_f32(p, r);
+#else
+        p[0] = r.v[0];
+        p[1] = r.v[1];
+        p[2] = r.v[2];
+        p[3] = r.v[3];
+#endif
+    }
+
+    /** @brief gather 4 floats that are stride apart, e.g. one joint of the 4 legs in a 12-vector */
+    static qrFloat4 Gather(const float* p, int stride)
+    {
+        return qrFloat4(p[0], p[stride], p[2 * stride], p[3 * stride]);
+    }
+
+    /** @brief scatter the 4 lanes stride apart */
+    void Scatter(float* p, int stride) const
+    {
+        alignas(16) float lanes[4];
+        Store(lanes);
+        p[0] = lanes[0];
+        p[stride] = lanes[1];
+        p[2 * stride] = lanes[2];
+        p[3 * stride] = lanes[3];
+    }
+};
+
+#if defined(QR_SIMD_SSE2)
+inline qrFloat4 operator+(qrFloat4 a, qrFloat4 b) { return _mm_add_ps(a.r, b.r); }
+inline qrFloat4 operator-(qrFloat4 a, qrFloat4 b) { return _mm_sub_ps(a.r, b.r); }
+inline qrFloat4 operator*(qrFloat4 a, qrFloat4 b) { return _mm_mul_ps(a.r, b.r); }
+inline qrFloat4 operator/(qrFloat4 a, qrFloat4 b) { return _mm_div_ps(a.r, b.r); }
+inline qrFloat4 operator-(qrFloat4 a) { return _mm_xor_ps(a.r, _mm_set1_ps(-0.f)); }
+inline qrFloat4 operator<(qrFloat4 a, qrFloat4 b) { return _mm_cmplt_ps(a.r, b.r); }
+inline qrFloat4 operator>(qrFloat4 a, qrFloat4 b) { return _mm_cmpgt_ps(a.r, b.r); }
+inline qrFloat4 operator&(qrFloat4 a, qrFloat4 b) { return _mm_and_ps(a.r, b.r); }
+inline qrFloat4 operator|(qrFloat4 a, qrFloat4 b) { return _mm_or_ps(a.r, b.r); }
+#elif defined(QR_SIMD_NEON)
+inline qrFloat4 operator+(qrFloat4 a, qrFloat4 b) { return vaddq_f32(a.r, b.r); }
+inline qrFloat4 operator-(qrFloat4 a, qrFloat4 b) { return vsubq_f32(a.r, b.r); }
+inline qrFloat4 operator*(qrFloat4 a, qrFloat4 b) { return vmulq_f32(a.r, b.r); }
+inline qrFloat4 operator/(qrFloat4 a, qrFloat4 b)
+{
+#if defined(__aarch64__)
+    return vdivq_f32(a.r, b.r);
+#else
+    // two Newton steps on the reciprocal estimate
+    float32x4_t inv = vrecpeq_f32(b.r);
+    inv = vmulq_f32(vrecpsq_f32(b.r, inv), inv);
+    inv = vmulq_f32(vrecpsq_f32(b.r, inv), inv);
+    return vmulq_f32(a.r, inv);
+#endif
+}
+inline qrFloat4 operator-(qrFloat4 a) { return vnegq_f32(a.r); }
+inline qrFloat4 operator<(qrFloat4 a, qrFloat4 b) { return vreinterpretq_f32_u32(vcltq_f32(a.r, b.r)); }
+inline qrFloat4 operator>(qrFloat4 a, qrFloat4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a.r, b.r)); }
+inline qrFloat4 operator&(qrFloat4 a, qrFloat4 b)
+{
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.r), vreinterpretq_u32_f32(b.r)));
+}
+inline qrFloat4 operator|(qrFloat4 a, qrFloat4 b)
+{
+    return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.r), vreinterpretq_u32_f32(b.r)));
+}
+#else
+#define QR_FLOAT4_LANEWISE(expr) \
+    qrFloat4 c; \
+    for (int i = 0; i < 4; ++i) { \
+        c.r.v[i] = (expr); \
+    } \
+    return c;
+inline qrFloat4 operator+(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] + b.r.v[i]) }
+inline qrFloat4 operator-(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] - b.r.v[i]) }
+inline qrFloat4 operator*(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] * b.r.v[i]) }
+inline qrFloat4 operator/(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] / b.r.v[i]) }
+inline qrFloat4 operator-(qrFloat4 a) { QR_FLOAT4_LANEWISE(-a.r.v[i]) }
+// a mask lane is 1 for true and 0 for false
+inline qrFloat4 operator<(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] < b.r.v[i] ? 1.f : 0.f) }
+inline qrFloat4 operator>(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] > b.r.v[i] ? 1.f : 0.f) }
+inline qrFloat4 operator&(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(a.r.v[i] * b.r.v[i]) }
+inline qrFloat4 operator|(qrFloat4 a, qrFloat4 b) { QR_FLOAT4_LANEWISE(std::fmax(a.r.v[i], b.r.v[i])) }
+#endif
+
+namespace simd {
+
+    /** @brief lane-wise mask ? a : b, mask is the result of a comparison */
+    inline qrFloat4 select(qrFloat4 mask, qrFloat4 a, qrFloat4 b)
+    {
+#if defined(QR_SIMD_SSE2)
+        return _mm_or_ps(_mm_and_ps(mask.r, a.r), _mm_andnot_ps(mask.r, b.r));
+#elif defined(QR_SIMD_NEON)
+        return vbslq_f32(vreinterpretq_u32_f32(mask.r), a.r, b.r);
+#else
+        QR_FLOAT4_LANEWISE(mask.r.v[i] != 0.f ? a.r.v[i] : b.r.v[i])
+#endif
+    }
+
+    inline qrFloat4 sqrt(qrFloat4 a)
+    {
+#if defined(QR_SIMD_SSE2)
+        return _mm_sqrt_ps(a.r);
+#elif defined(QR_SIMD_NEON) && defined(__aarch64__)
+        return vsqrtq_f32(a.r);
+#elif defined(QR_SIMD_NEON)
+        // a * rsqrt(a), with two Newton steps; sqrt(0) is 0
+        float32x4_t e = vrsqrteq_f32(a.r);
+        e = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a.r, e), e), e);
+        e = vmulq_f32(vrsqrtsq_f32(vmulq_f32(a.r, e), e), e);
+        return select(qrFloat4(0.f) < a, qrFloat4(vmulq_f32(a.r, e)), qrFloat4(0.f));
+#else
+        QR_FLOAT4_LANEWISE(std::sqrt(a.r.v[i]))
+#endif
+    }
+
+    inline qrFloat4 abs(qrFloat4 a)
+    {
+        return select(a < qrFloat4(0.f), -a, a);
+    }
+
+    /** @brief round down, valid for |a| < 2^31 */
+    inline qrFloat4 floor(qrFloat4 a)
+    {
+#if defined(QR_SIMD_SSE2)
+        qrFloat4 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.r));
+#elif defined(QR_SIMD_NEON)
+        qrFloat4 t = vcvtq_f32_s32(vcvtq_s32_f32(a.r));
+#else
+        qrFloat4 t;
+        for (int i = 0; i < 4; ++i) {
+            t.r.v[i] = float(int(a.r.v[i]));
+        }
+#endif
+        // truncation rounds negative numbers up
+        return select(a < t, t - qrFloat4(1.f), t);
+    }
+
+    /**
+     * @brief sine and cosine of the 4 lanes, with the polynomials of cephes sinf/cosf on [-pi/4, pi/4].
+     * The absolute error is below 1e-6 for |x| < 1e3.
+     */
+    inline void sinCos(qrFloat4 x, qrFloat4 &s, qrFloat4 &c)
+    {
+        // x = q * pi/2 + y, pi/2 split into three parts so that q * part is exact
+        const qrFloat4 q = floor(x * qrFloat4(0.636619772f) + qrFloat4(0.5f));
+        qrFloat4 y = x - q * qrFloat4(1.5703125f);
+        y = y - q * qrFloat4(4.837512969970703125e-4f);
+        y = y - q * qrFloat4(7.549789948768648e-8f);
+
+        const qrFloat4 z = y * y;
+        const qrFloat4 sinY = y + y * z * (qrFloat4(-1.6666654611e-1f)
+            + z * (qrFloat4(8.3321608736e-3f) + z * qrFloat4(-1.9515295891e-4f)));
+        const qrFloat4 cosY = qrFloat4(1.f) - qrFloat4(0.5f) * z + z * z * (qrFloat4(4.166664568298827e-2f)
+            + z * (qrFloat4(-1.388731625493765e-3f) + z * qrFloat4(2.443315711809948e-5f)));
+
+        // quadrant 0..3
+        const qrFloat4 quadrant = q - qrFloat4(4.f) * floor(q * qrFloat4(0.25f));
+        const qrFloat4 odd = quadrant - qrFloat4(2.f) * floor(quadrant * qrFloat4(0.5f));
+        const qrFloat4 swap = odd > qrFloat4(0.5f);
+        const qrFloat4 sinValue = select(swap, cosY, sinY);
+        const qrFloat4 cosValue = select(swap, sinY, cosY);
+        // sin is negative in quadrants 2, 3, cos in quadrants 1, 2
+        s = select(quadrant > qrFloat4(1.5f), -sinValue, sinValue);
+        const qrFloat4 cosNegative = (quadrant > qrFloat4(0.5f)) & (quadrant < qrFloat4(2.5f));
+        c = select(cosNegative, -cosValue, cosValue);
+    }
+
+    /** @brief asin on [-1, 1] with the cephes asinf polynomial, absolute error below 1e-6 */
+    inline qrFloat4 asin(qrFloat4 x)
+    {
+        const qrFloat4 a = abs(x);
+        // for |x| > 0.5, asin(x) = pi/2 - 2 asin(sqrt((1 - x) / 2))
+        const qrFloat4 large = a > qrFloat4(0.5f);
+        const qrFloat4 z = select(large, qrFloat4(0.5f) * (qrFloat4(1.f) - a), a * a);
+        const qrFloat4 t = select(large, sqrt(z), a);
+        const qrFloat4 p = ((((qrFloat4(4.2163199048e-2f) * z + qrFloat4(2.4181311049e-2f)) * z
+            + qrFloat4(4.5470025998e-2f)) * z + qrFloat4(7.4953002686e-2f)) * z + qrFloat4(1.6666752422e-1f)) * z * t + t;
+        const qrFloat4 result = select(large, qrFloat4(1.570796327f) - p - p, p);
+        return select(x < qrFloat4(0.f), -result, result);
+    }
+
+    /** @brief acos on [-1, 1], accurate near +-1 where pi/2 - asin(x) is not */
+    inline qrFloat4 acos(qrFloat4 x)
+    {
+        const qrFloat4 a = abs(x);
+        const qrFloat4 small = qrFloat4(1.570796327f) - asin(x);
+        // acos(|x|) = 2 asin(sqrt((1 - |x|) / 2))
+        const qrFloat4 h = asin(sqrt(qrFloat4(0.5f) * (qrFloat4(1.f) - a)));
+        const qrFloat4 large = select(x < qrFloat4(0.f), qrFloat4(3.141592654f) - h - h, h + h);
+        return select(a > qrFloat4(0.5f), large, small);
+    }
+
+    /** @brief atan2 with the cephes atanf polynomial, absolute error below 1e-6 */
+    inline qrFloat4 atan2(qrFloat4 y, qrFloat4 x)
+    {
+        const qrFloat4 zero(0.f);
+        // atan of |y / x| in [0, pi/2], the lane with x = y = 0 gives 0
+        const qrFloat4 ay = abs(y);
+        const qrFloat4 ax = abs(x);
+        const qrFloat4 swap = ay > ax;
+        const qrFloat4 num = select(swap, ax, ay);
+        const qrFloat4 den = select(swap, ay, ax);
+        qrFloat4 t = select(den > zero, num / select(den > zero, den, qrFloat4(1.f)), zero);
+        // t in [0, 1], reduce t > tan(pi/8) with atan(t) = pi/4 + atan((t - 1) / (t + 1))
+        const qrFloat4 reduce = t > qrFloat4(0.4142135624f);
+        const qrFloat4 offset = select(reduce, qrFloat4(0.7853981634f), zero);
+        t = select(reduce, (t - qrFloat4(1.f)) / (t + qrFloat4(1.f)), t);
+        const qrFloat4 z = t * t;
+        qrFloat4 angle = offset + ((((qrFloat4(8.05374449538e-2f) * z - qrFloat4(1.38776856032e-1f)) * z
+            + qrFloat4(1.99777106478e-1f)) * z - qrFloat4(3.33329491539e-1f)) * z * t + t);
+        angle = select(swap, qrFloat4(1.570796327f) - angle, angle);
+        angle = select(x < zero, qrFloat4(3.141592654f) - angle, angle);
+        return select(y < zero, -angle, angle);
+    }
+
+} // namespace simd
+
+#endif // QR_SIMD_H
@@ -0,0 +1,99 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_TRIPLE_BUFFER_H
+#define QR_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Hands the newest of a stream of T from one writer thread to one reader thread without locks.
+ *        The writer fills the back slot and publishes it, the reader holds the front slot, and the third one
+ *        waits in the middle, so neither side ever waits for the other and the reader always gets the latest
+ *        complete value. Values the reader did not pick up in time are overwritten.
+ */
+template <typename T>
+class qrTripleBuffer {
+
+public:
+
+    qrTripleBuffer() : middle(1) {}
+
+    qrTripleBuffer(const qrTripleBuffer &) = delete;
+
+    qrTripleBuffer &operator=(const qrTripleBuffer &) = delete;
+
+    /**
+     * @brief The slot to fill before the next Publish, only for the writer thread.
+     */
+    T &GetBack()
+    {
+        return slots[back];
+    }
+
+    /**
+     * @brief Hand the back slot to the reader and take the middle one as the new back slot.
+     */
+    void Publish()
+    {
+        back = middle.exchange(back | freshBit) & 3;
+    }
+
+    /**
+     * @brief The newest published value, only for the reader thread. The reference stays valid until the next call.
+     */
+    const T &GetFront()
+    {
+        if (middle.load(std::memory_order_acquire) & freshBit) {
+            front = middle.exchange(front) & 3;
+        }
+        return slots[front];
+    }
+
+    /**
+     * @brief All three slots, to size them before the threads start.
+     */
+    std::array<T, 3> &GetSlots()
+    {
+        return slots;
+    }
+
+private:
+
+    std::array<T, 3> slots;
+
+    /**
+     * @brief index of the middle slot and a bit telling whether it is newer than the front one.
+     */
+    std::atomic<int> middle;
+
+    int back = 0;
+
+    int front = 2;
+
+    static constexpr int freshBit = 4;
+};
+
+#endif // QR_TRIPLE_BUFFER_H
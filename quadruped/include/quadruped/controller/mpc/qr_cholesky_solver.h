@@ -28,6 +28,7 @@
 #include <eigen3/Eigen/LU>
 #include <eigen3/Eigen/SVD>
 #include "controller/mpc/qr_sparse_matrix.h"
+#include "controller/mpc/qr_dense_ldlt_kernels.h"
 
 template<typename T>
 using DenseMatrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
@@ -36,30 +37,54 @@ template<typename T>
 class CholeskyDenseSolver
 {
 public:
-  CholeskyDenseSolver(bool print) : _print(print) { }
+  CholeskyDenseSolver(bool print) : _print(print), _kernels(ldltKernels<T>()) { }
   ~CholeskyDenseSolver() {
     delete[] pivots;
     delete[] solve1;
     delete[] solve2;
+    free(_factor);
+    free(_panelW);
+    free(_diag);
   }
-  void setup(const DenseMatrix<T>& kktMat);
+  bool setup(const DenseMatrix<T>& kktMat);
   void solve(Eigen::Matrix<T, Eigen::Dynamic, 1>& in);
   void set_print(bool print) {
     _print = print;
   }
 
-  DenseMatrix<T>& getInternal() { return L; }
+  /*!
+   * Override the runtime selected kernels, used to compare instruction sets on one machine
+   */
+  void setIsa(LdltIsa isa) {
+    _kernels = ldltKernelsFor<T>(isa);
+  }
+  LdltIsa getIsa() const { return _kernels.isa; }
+
+  /*!
+   * Number of pivots of the last setup that vanished next to the largest diagonal entry (below epsilon^2 of it)
+   */
+  s64 getSmallPivots() const { return _smallPivots; }
+
+  Eigen::Map<DenseMatrix<T>, 0, Eigen::OuterStride<>> getInternal() {
+    return Eigen::Map<DenseMatrix<T>, 0, Eigen::OuterStride<>>(_factor, n, n, Eigen::OuterStride<>(_ld));
+  }
   DenseMatrix<T> getReconstructedPermuted();
 
 private:
-  DenseMatrix<T> L;
+  T& L(s64 r, s64 c) { return _factor[r + c * _ld]; }
+  void allocate(s64 size);
+  void swapSymmetric(s64 row, s64 pivot, s64 panelStart);
   void solveAVX(Eigen::Matrix<T, Eigen::Dynamic, 1>& in);
-  void setupAVX(T* mat, T* result, T* vec, u64 row);
   T* solve1 = nullptr, *solve2 = nullptr;
-  Eigen::Matrix<T, Eigen::Dynamic, 1> D;
+  T* _factor = nullptr;  // column major, padded leading dimension, 64 byte aligned
+  T* _panelW = nullptr;  // D_k * L(:,k) for the columns of the current panel
+  T* _diag = nullptr;    // running diagonal of the not yet factored part, used for pivoting
+  s64 _ld = 0;
   s64* pivots = nullptr;
   s64 n = 0;
+  s64 _smallPivots = 0;
   bool _print;
+  LdltKernels<T> _kernels;
 };
 
 template<typename T>
@@ -71,23 +96,22 @@ public:
   void preSetup(const DenseMatrix<T>& kktMat, bool b_print = true);
   void preSetup(const std::vector<SparseTriple<T>>& kktMat, u32 n, bool b_print = true);
   void setup(bool b_print = true);
+
+  /*!
+   * Numeric factorization of a KKT matrix with the sparsity of the last dense preSetup, reusing its AMD ordering
+   * and symbolic factorization.
+   * @return false if kktMat has a nonzero outside that pattern, preSetup and setup have to be run instead.
+   */
+  bool refactor(const DenseMatrix<T>& kktMat);
   void solve(Eigen::Matrix<T, Eigen::Dynamic, 1>& out);
   void amdOrder(MatCSC<T>& mat, u32* perm, u32* iperm);
 
   ~CholeskySparseSolver() {
-    A.freeAll();
-    L.freeAll();
-    delete[] reverseOrder;
-    delete[] nnzLCol;
-    delete[] P;
-    delete[] D;
-    delete[] rP;
-    delete[] rD;
-    delete[] parent;
-    delete[] tempSolve;
+    release();
   }
 
 private:
+  void release();
   void reorder();
   u32 symbolicFactor();
   void factor();
@@ -105,6 +129,9 @@ private:
   T*   D = nullptr;       // Diagonal
   T*   rD = nullptr;      // inverse diagonal
   s32* parent = nullptr;  // tree
+  u32* patternColPtrs = nullptr; // upper triangle pattern of the dense matrix given to preSetup
+  u32* patternRowIdx = nullptr;
+  u32* scatter = nullptr;        // position of each pattern entry in the permuted A
 };
 
 #include "qr_cholesky_solver_impl.h"
@@ -25,135 +25,183 @@
 #ifndef QR_CHOLESKY_SOLVER_IMPL_H
 #define QR_CHOLESKY_SOLVER_IMPL_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <new>
 
 #include "amd/amd.h"
 
 static constexpr s64 UNROLL_MATVEC = 8; //! Loop unroll for all inner loops, AVX2 only
 
 /*!
- * Perform initial factorization
+ * (Re)allocate storage for a size x size factorization. Storage is kept when the size does not change.
  */
 template<typename T>
-void CholeskyDenseSolver<T>::setup(const DenseMatrix<T> &kktMat)
+void CholeskyDenseSolver<T>::allocate(s64 size)
 {
+  if(size == n && _factor)
+    return;
+
+  delete[] pivots;
+  delete[] solve1;
+  delete[] solve2;
+  free(_factor);
+  free(_panelW);
+  free(_diag);
+
+  n = size;
+  _ld = ldltRoundUp(n, LDLT_PAD);
+  _factor = ldltAlignedAlloc<T>(_ld * _ld);        // padding stays zero, kernels never need remainder loops
+  _panelW = ldltAlignedAlloc<T>(_ld * LDLT_BLOCK);
+  _diag = ldltAlignedAlloc<T>(_ld);
+  if(!_factor || !_panelW || !_diag)
+    throw std::bad_alloc();
 
-//   Timer tim;
-  assert(kktMat.cols() == kktMat.rows()); // must be a square matrix
-  n = kktMat.rows();
-
-  // setup
-  L.resize(n,n); // Lower triangular
-  D.resize(n);   // Diagonal
-  L = kktMat;    // solved in place for better cache usage
-  D.setZero();
   pivots = new s64[n]; // permutations for pivoting
+  solve1 = new T[n * (n - 1)]; // elements of L ordered for first triangular solve
+  solve2 = new T[n * (n - 1)]; // elements of L ordered for second triangular solve
+}
 
-  Eigen::Matrix<T, Eigen::Dynamic, 1> temp(n); // O(n) temporary storage, used in a few places
+/*!
+ * Symmetric row/column swap of row and pivot, only the lower triangle is stored.
+ * Also swaps the running diagonal and the saved D * L rows of the current panel.
+ */
+template<typename T>
+void CholeskyDenseSolver<T>::swapSymmetric(s64 row, s64 pivot, s64 panelStart)
+{
+  assert(pivot > row);
+  // swap row
+  for(s64 i = 0; i < row; i++)
+  {
+    std::swap(L(row, i), L(pivot, i));
+  }
 
-//   if(_print)
-    // printf("CHOLDENSE SETUP %.3f ms\n", tim.getMs());
+  // swap col
+  for(s64 i = pivot + 1; i < n; i++)
+  {
+    std::swap(L(i, row), L(i, pivot));
+  }
 
-  // tim.start();
+  // swap elt
+  std::swap(L(row, row), L(pivot, pivot));
 
-  // in place dense LDLT algorithm
-  for(s64 row = 0; row < n; row++)
+  for(s64 i = row + 1; i < pivot; i++)
   {
-    // step 1: find the largest row to pivot with
-    T largestDiagValue = -std::numeric_limits<T>::infinity();
-    s64 pivot = -1;
-    for(s64 rowSel = row; rowSel < n; rowSel++)
-    {
-      T v = std::abs(L(rowSel, rowSel));
-      if(v > largestDiagValue)
-      {
-        largestDiagValue = v;
-        pivot = rowSel;
-      }
-    }
-    assert(pivot != -1);
+    std::swap(L(i, row), L(pivot, i));
+  }
 
-    // step 2: PIVOT
-    pivots[row] = pivot;
-    if(pivot != row) // but only if we need to (pivot > row)!
-    {
-      assert(pivot > row);
-      // swap row
-      for(s64 i = 0; i < row; i++)
-      {
-        std::swap(L(row, i), L(pivot, i));
-      }
+  std::swap(_diag[row], _diag[pivot]);
+  for(s64 k = 0; k < row - panelStart; k++)
+  {
+    std::swap(_panelW[row + k * _ld], _panelW[pivot + k * _ld]);
+  }
+}
 
-      // swap col
-      for(s64 i = pivot + 1; i < n; i++)
-      {
-        std::swap(L(i, row), L(i, pivot));
-      }
+/*!
+ * Perform initial factorization.
+ * Right-looking blocked LDLT with diagonal pivoting: each panel of LDLT_BLOCK columns is factored
+ * left-looking, then removed from the trailing matrix with a single rank-k update, which is where the
+ * O(n^3) work is. See qr_dense_ldlt_kernels.h for the runtime selected SIMD kernels.
+ * @return false if a pivot vanished next to the largest diagonal entry, the factor is then unreliable.
+ * A zero pivot is replaced by that level to keep the factor finite.
+ */
+template<typename T>
+bool CholeskyDenseSolver<T>::setup(const DenseMatrix<T> &kktMat)
+{
+  assert(kktMat.cols() == kktMat.rows()); // must be a square matrix
+  allocate(kktMat.rows());
 
-      // swap elt
-      std::swap(L(row, row), L(pivot, pivot));
+  // lower triangle into padded storage, solved in place for better cache usage
+  for(s64 j = 0; j < n; j++)
+  {
+    memcpy(&L(j, j), kktMat.data() + j + j * n, sizeof(T) * (n - j));
+    _diag[j] = kktMat(j, j);
+  }
 
-      for(s64 i = row + 1; i < pivot; i++)
-      {
-        std::swap(L(i, row), L(pivot, i));
-      }
-    }
+  T largestDiag = 0;
+  for(s64 j = 0; j < n; j++)
+  {
+    largestDiag = std::max(largestDiag, std::abs(_diag[j]));
+  }
+  // the KKT matrix is quasi-definite, pivots near sigma sit ~1e-11 below the -1/rho entries without any cancellation,
+  // so only pivots that vanish at the squared rounding level are counted as singular.
+  const T pivotTolerance = std::numeric_limits<T>::epsilon() * std::numeric_limits<T>::epsilon() * largestDiag;
+  _smallPivots = 0;
 
-    // step 3, FACTOR:
-    // wikipedia equation: A_ij - L_ij * D_j = sum_{k=1}^{j-1} L_ik * L_jk * D_k
-    // wikipedia eqn 2   : D_j = A_jj - sum_{k = 1}^{j-1} L_jk^2 D_k
-    // wikipedia "i" is my "row"
-    if(row > 0)
+  T wRow[LDLT_BLOCK]; // D_k * L_row,k for the panel columns left of row
+
+  for(s64 k0 = 0; k0 < n; k0 += LDLT_BLOCK)
+  {
+    s64 k1 = std::min(k0 + LDLT_BLOCK, n);
+
+    for(s64 row = k0; row < k1; row++)
     {
-      for(s64 i = 0; i < row; i++)
+      // step 1: find the largest (updated) diagonal to pivot with
+      T largestDiagValue = -std::numeric_limits<T>::infinity();
+      s64 pivot = -1;
+      for(s64 rowSel = row; rowSel < n; rowSel++)
       {
-        temp[i] = L(i, i) * L(row, i); // temp[k] = D_k * L_ik
+        T v = std::abs(_diag[rowSel]);
+        if(v > largestDiagValue)
+        {
+          largestDiagValue = v;
+          pivot = rowSel;
+        }
       }
+      assert(pivot != -1);
 
-      for(s64 i = 0; i < row; i++)
+      // step 2: PIVOT
+      pivots[row] = pivot;
+      if(pivot != row) // but only if we need to (pivot > row)!
       {
-        L(row, row) -= temp[i] * L(row, i); // D_i = A_ii - sum_k D_k * L_ik
+        swapSymmetric(row, pivot, k0);
       }
 
-      //T factor = L(row, row);
-
-      // compute ith (row-th) column of L
-      // all L's are assumed to be in the row-th column
-      // reuse the L_ik * D_k from earlier.
-      // instead of solving 1-by-1, compute contributions from columns because matrix is col-major order.
-      if(n - row - 1 > 0)
+      // step 3, FACTOR:
+      // A_ij - L_ij * D_j = sum_{k=1}^{j-1} L_ik * L_jk * D_k
+      // earlier panels are already subtracted by the trailing update, only this panel's columns are left.
+      s64 k = row - k0;
+      if(k > 0)
       {
-        T* mat = L.data() + row + 1;
-        T* result = L.data() + row + 1 + n * row;
-        T* vec = temp.data();
-        setupAVX(mat, result, vec, row); // O(n^2) inner loop
+        for(s64 i = 0; i < k; i++)
+        {
+          wRow[i] = _panelW[row + i * _ld];
+        }
+        _kernels.panel(&L(row, row), &L(row, k0), wRow, _ld, n - row, k);
       }
-    }
 
-    // step 4, divide.
-    T diag = L(row, row);
-    if(std::abs(diag) < 1e-6) {
-      printf("ERROR: LDLT fail (poorly conditioned pivot %g)\n", diag);
-      assert(false);
-    }
+      // step 4, divide.
+      T diag = L(row, row);
+      if(!(std::abs(diag) > pivotTolerance)) // also catches NaN
+      {
+        _smallPivots++;
+        if(diag == T(0))
+        {
+          diag = L(row, row) = pivotTolerance > T(0) ? pivotTolerance : std::numeric_limits<T>::min();
+        }
+      }
 
-    if(n - row - 1 > 0) {
       T mult = T(1) / diag;
+      T* wCol = _panelW + k * _ld;
       for(s64 i = row + 1; i < n; i++) {
-        L(i, row) *= mult;
+        T v = L(i, row);
+        wCol[i] = v;
+        L(i, row) = v * mult;
+        _diag[i] -= v * v * mult;
       }
     }
-  }
 
-//   if(_print)
-    // printf("CHOLDENSE FACT %.3f ms\n", tim.getMs());
-
-  // tim.start();
+    // step 5, rank-k update of the trailing matrix with this panel
+    if(k1 < n)
+    {
+      _kernels.trailing(&L(k1, k1), &L(k1, k0), _panelW + k1, _ld, n - k1, k1 - k0);
+    }
+  }
 
   // set up memory:
-  solve1 = new T[n * (n - 1)]; // elements of L ordered for first triangular solve
-  solve2 = new T[n * (n - 1)]; // elements of L ordered for second triangular solve
   s64 c = 0;
   for(s64 j = 0; j < n; j++)
   {
@@ -170,100 +218,7 @@ void CholeskyDenseSolver<T>::setup(const DenseMatrix<T> &kktMat)
       solve2[c++] = L(j, i);
     }
   }
-
-//   if(_print)
-    // printf("CHOLDENSE FIN %.3f ms\n", tim.getMs());
-}
-
-/*!
- * Inner O(n^2) loop used in factorization, written with AVX intrinsics
- */
-template<> inline
-void CholeskyDenseSolver<double>::setupAVX(double *mat, double *result, double *vec, u64 row)
-{
-  s64 R = n - row - 1;
-  s64 C = row;
-  double* matPtr;
-  double* resultPtr;
-  for(s64 c = 0; c < C; c++)
-  {
-
-#ifdef JCQP_USE_AVX2
-    __m256d vecData = _mm256_set1_pd(vec[c]); // broadcast to all
-#endif
-    resultPtr = result;
-    matPtr = mat + c * n;
-    s64 r = 0;
-#ifdef JCQP_USE_AVX2
-    s64 end = R - 4 * UNROLL_MATVEC; // gcc fails to make this optimization.
-    for(; r < end; r += 4 * UNROLL_MATVEC)
-    {
-      for(s64 u = 0; u < UNROLL_MATVEC; u++)
-      {
-        __m256d matData = _mm256_loadu_pd(matPtr);
-        __m256d resultData = _mm256_loadu_pd(resultPtr);
-        resultData = _mm256_fnmadd_pd(vecData, matData, resultData);
-        _mm256_storeu_pd(resultPtr, resultData);
-
-        matPtr += 4;
-        resultPtr += 4;
-      }
-    }
-#endif
-
-    // leftovers that don't fit in a vector.
-    for(; r < R; r++)
-    {
-      *resultPtr = *resultPtr - *matPtr * vec[c];
-      resultPtr++;
-      matPtr++;
-    }
-  }
-}
-
-/*!
- * Specialization for float, can pack 8 numbers/register
- */
-template<> inline
-void CholeskyDenseSolver<float>::setupAVX(float *mat, float *result, float *vec, u64 row)
-{
-  s64 R = n - row - 1;
-  s64 C = row;
-  float* matPtr;
-  float* resultPtr;
-  for(s64 c = 0; c < C; c++)
-  {
-#ifdef JCQP_USE_AVX2
-    __m256 vecData = _mm256_set1_ps(vec[c]); // broadcast to all
-#endif
-    resultPtr = result;
-    matPtr = mat + c * n;
-    s64 r = 0;
-
-#ifdef JCQP_USE_AVX2
-    s64 end = R - 8 * UNROLL_MATVEC; // gcc fails to make this optimization.
-    for(; r < end; r += 8 * UNROLL_MATVEC)
-    {
-      for(s64 u = 0; u < UNROLL_MATVEC; u++)
-      {
-        __m256 matData = _mm256_loadu_ps(matPtr);
-        __m256 resultData = _mm256_loadu_ps(resultPtr);
-        resultData = _mm256_fnmadd_ps(vecData, matData, resultData);
-        _mm256_storeu_ps(resultPtr, resultData);
-
-        matPtr += 8;
-        resultPtr += 8;
-      }
-    }
-#endif
-    // leftovers.
-    for(; r < R; r++)
-    {
-      *resultPtr = *resultPtr - *matPtr * vec[c];
-      resultPtr++;
-      matPtr++;
-    }
-  }
+  return _smallPivots == 0;
 }
 
 /*!
@@ -287,7 +242,7 @@ DenseMatrix<T> CholeskyDenseSolver<T>::getReconstructedPermuted()
       }
     }
   }
-  DenseMatrix<T> Reconstructed = LDebug * L.diagonal().asDiagonal() * LDebug.transpose();
+  DenseMatrix<T> Reconstructed = LDebug * getInternal().diagonal().asDiagonal() * LDebug.transpose();
   return Reconstructed;
 }
 
@@ -531,9 +486,42 @@ template class CholeskyDenseSolver<float>;
 
 // #include "amd.h"
 
+/*!
+ * Free everything allocated by a previous setup, so the solver can be set up again
+ */
+template<typename T>
+void CholeskySparseSolver<T>::release()
+{
+  A.freeAll();
+  L.freeAll();
+  delete[] reverseOrder;
+  delete[] nnzLCol;
+  delete[] P;
+  delete[] D;
+  delete[] rP;
+  delete[] rD;
+  delete[] parent;
+  delete[] tempSolve;
+  delete[] patternColPtrs;
+  delete[] patternRowIdx;
+  delete[] scatter;
+  patternColPtrs = nullptr;
+  patternRowIdx = nullptr;
+  scatter = nullptr;
+  reverseOrder = nullptr;
+  nnzLCol = nullptr;
+  P = nullptr;
+  D = nullptr;
+  rP = nullptr;
+  rD = nullptr;
+  parent = nullptr;
+  tempSolve = nullptr;
+}
+
 template<typename T>
 void CholeskySparseSolver<T>::preSetup(const DenseMatrix<T> &kktMat, bool b_print)
 {
+  release();
 //   Timer tim;
   // get sizes
   A.m = kktMat.rows();
@@ -586,6 +574,13 @@ void CholeskySparseSolver<T>::preSetup(const DenseMatrix<T> &kktMat, bool b_prin
 
   assert(i == A.nnz);
 
+  // keep the pattern, later matrices with the same one only need a numeric factorization
+  patternColPtrs = new u32[A.n + 1];
+  patternRowIdx = new u32[A.nnz];
+  scatter = new u32[A.nnz];
+  memcpy(patternColPtrs, A.colPtrs, sizeof(u32) * (A.n + 1));
+  memcpy(patternRowIdx, A.rowIdx, sizeof(u32) * A.nnz);
+
 //   if(b_print) printf("CHOLSPARSE SETUP %.3f ms\n", tim.getMs());
   // tim.start();
 
@@ -595,6 +590,7 @@ void CholeskySparseSolver<T>::preSetup(const DenseMatrix<T> &kktMat, bool b_prin
 
 template<typename T>
 void CholeskySparseSolver<T>::preSetup(const std::vector<SparseTriple<T>>& kktMat, u32 _n, bool b_print) {
+  release();
 //   Timer tim;
 
   A.m = _n;
@@ -669,6 +665,37 @@ void CholeskySparseSolver<T>::setup(bool b_print)
 #endif
 }
 
+template<typename T>
+bool CholeskySparseSolver<T>::refactor(const DenseMatrix<T>& kktMat)
+{
+  if(!scatter || !L.values || (u32)kktMat.rows() != n || (u32)kktMat.cols() != n)
+    return false;
+
+  // gather the pattern into the permuted matrix, entries that became zero are kept as explicit zeros
+  u32 patternNonzeros = 0;
+  for(u32 c = 0; c < n; c++) {
+    for(u32 p = patternColPtrs[c]; p < patternColPtrs[c + 1]; p++) {
+      T v = kktMat(patternRowIdx[p], c);
+      A.values[scatter[p]] = v;
+      patternNonzeros += v != T(0);
+    }
+  }
+  u32 nonzeros = 0;
+  for(u32 c = 0; c < n; c++) {
+    for(u32 r = 0; r <= c; r++) {
+      nonzeros += kktMat(r, c) != T(0);
+    }
+  }
+  if(nonzeros != patternNonzeros)
+    return false;
+
+  factor();
+#ifndef JCQP_USE_AVX2
+  solveOrder();
+#endif
+  return true;
+}
+
 template<typename T>
 void CholeskySparseSolver<T>::sanityCheck()
 {
@@ -727,6 +754,7 @@ void CholeskySparseSolver<T>::reorder()
       u32 s = temp[std::max(iNew, jNew)]++;
       permuted.rowIdx[s] = std::min(iNew, jNew);
       permuted.values[s] = A.values[p];
+      if(scatter) scatter[p] = s;
     }
   }
 
@@ -1084,7 +1112,7 @@ void CholeskySparseSolver<T>::solve(Eigen::Matrix<T, Eigen::Dynamic, 1>& outv) {
 template<typename T>
 void CholeskySparseSolver<T>::solveOrder()
 {
-  reverseOrder = new T[L.nnz];
+  if(!reverseOrder) reverseOrder = new T[L.nnz];
   u32 c = 0;
   for(s32 i = n - 1; i >= 0; i--) {
     u32 end = L.colPtrs[i+1];
@@ -0,0 +1,359 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_DENSE_LDLT_KERNELS_H
+#define QR_DENSE_LDLT_KERNELS_H
+
+#include <cstdlib>
+#include <cstring>
+
+#include "common/qr_cTypes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JCQP_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+/*!
+ * Compute kernels for the blocked dense LDLT in CholeskyDenseSolver.
+ * The factor is stored column major with a leading dimension padded to LDLT_PAD elements,
+ * so every panel starts on a 64 byte boundary and the trailing update never needs a remainder loop.
+ * The instruction set is picked once at runtime, so the same binary runs on any x86 machine.
+ */
+
+static constexpr s64 LDLT_PAD = 32;        //! leading dimension/panel alignment, in elements
+static constexpr s64 LDLT_BLOCK = 32;      //! panel width of the right-looking factorization, multiple of LDLT_PAD
+static constexpr s64 LDLT_TILE_COLS = 4;   //! columns per register tile of the trailing update
+
+enum class LdltIsa {
+  SCALAR,
+  AVX2,
+  AVX512
+};
+
+/*!
+ * Pick the widest instruction set supported by this cpu
+ */
+inline LdltIsa detectLdltIsa()
+{
+#ifdef JCQP_X86_DISPATCH
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    return LdltIsa::AVX512;
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return LdltIsa::AVX2;
+#endif
+  return LdltIsa::SCALAR;
+}
+
+inline const char* ldltIsaName(LdltIsa isa)
+{
+  switch(isa) {
+    case LdltIsa::AVX512: return "avx512";
+    case LdltIsa::AVX2: return "avx2";
+    default: return "scalar";
+  }
+}
+
+inline s64 ldltRoundUp(s64 x, s64 multiple)
+{
+  return ((x + multiple - 1) / multiple) * multiple;
+}
+
+/*!
+ * Zeroed, 64 byte aligned storage. Release with free().
+ */
+template<typename T>
+T* ldltAlignedAlloc(s64 count)
+{
+  void* p = nullptr;
+  if(posix_memalign(&p, 64, sizeof(T) * count) != 0)
+    return nullptr;
+  memset(p, 0, sizeof(T) * count);
+  return static_cast<T*>(p);
+}
+
+/*!
+ * Kernel table used by the factorization.
+ * panel:    col[i] -= sum_k l[i + k * ld] * w[k],  for i in [0, rows), left-looking update of one panel column
+ * trailing: a[i + c * ld] -= sum_k l[i + k * ld] * w[c + k * ld], for c in [0, m), i in [c, m),
+ *           rank-k update of the lower triangle of the trailing matrix. a and l must be LDLT_PAD aligned
+ *           and rows/cols up to the padded size must be addressable.
+ */
+template<typename T>
+struct LdltKernels {
+  void (*panel)(T* col, const T* l, const T* w, s64 ld, s64 rows, s64 k);
+  void (*trailing)(T* a, const T* l, const T* w, s64 ld, s64 m, s64 k);
+  LdltIsa isa;
+};
+
+template<typename T>
+void ldltPanelScalar(T* col, const T* l, const T* w, s64 ld, s64 rows, s64 k)
+{
+  for(s64 kk = 0; kk < k; kk++) {
+    const T* lk = l + kk * ld;
+    T wk = w[kk];
+    for(s64 i = 0; i < rows; i++)
+      col[i] -= lk[i] * wk;
+  }
+}
+
+template<typename T>
+void ldltTrailingScalar(T* a, const T* l, const T* w, s64 ld, s64 m, s64 k)
+{
+  for(s64 c = 0; c < m; c++) {
+    T* ac = a + c * ld;
+    for(s64 kk = 0; kk < k; kk++) {
+      const T* lk = l + kk * ld;
+      T wc = w[c + kk * ld];
+      for(s64 i = c; i < m; i++)
+        ac[i] -= lk[i] * wc;
+    }
+  }
+}
+
+#ifdef JCQP_X86_DISPATCH
+
+#define JCQP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define JCQP_TARGET_AVX512 __attribute__((target("avx512f")))
+
+/*!
+ * Register wrappers, one per (instruction set, scalar) pair, so the kernels below are written once per instruction set
+ */
+struct LdltAvx2d {
+  typedef double T;
+  typedef __m256d Reg;
+  static constexpr s64 W = 4;
+  JCQP_TARGET_AVX2 static inline Reg zero() { return _mm256_setzero_pd(); }
+  JCQP_TARGET_AVX2 static inline Reg set1(T x) { return _mm256_set1_pd(x); }
+  JCQP_TARGET_AVX2 static inline Reg load(const T* p) { return _mm256_load_pd(p); }
+  JCQP_TARGET_AVX2 static inline Reg loadu(const T* p) { return _mm256_loadu_pd(p); }
+  JCQP_TARGET_AVX2 static inline void store(T* p, Reg x) { _mm256_store_pd(p, x); }
+  JCQP_TARGET_AVX2 static inline void storeu(T* p, Reg x) { _mm256_storeu_pd(p, x); }
+  JCQP_TARGET_AVX2 static inline Reg fmadd(Reg a, Reg b, Reg c) { return _mm256_fmadd_pd(a, b, c); }
+  JCQP_TARGET_AVX2 static inline Reg fnmadd(Reg a, Reg b, Reg c) { return _mm256_fnmadd_pd(a, b, c); }
+  JCQP_TARGET_AVX2 static inline Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+};
+
+struct LdltAvx2f {
+  typedef float T;
+  typedef __m256 Reg;
+  static constexpr s64 W = 8;
+  JCQP_TARGET_AVX2 static inline Reg zero() { return _mm256_setzero_ps(); }
+  JCQP_TARGET_AVX2 static inline Reg set1(T x) { return _mm256_set1_ps(x); }
+  JCQP_TARGET_AVX2 static inline Reg load(const T* p) { return _mm256_load_ps(p); }
+  JCQP_TARGET_AVX2 static inline Reg loadu(const T* p) { return _mm256_loadu_ps(p); }
+  JCQP_TARGET_AVX2 static inline void store(T* p, Reg x) { _mm256_store_ps(p, x); }
+  JCQP_TARGET_AVX2 static inline void storeu(T* p, Reg x) { _mm256_storeu_ps(p, x); }
+  JCQP_TARGET_AVX2 static inline Reg fmadd(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+  JCQP_TARGET_AVX2 static inline Reg fnmadd(Reg a, Reg b, Reg c) { return _mm256_fnmadd_ps(a, b, c); }
+  JCQP_TARGET_AVX2 static inline Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+};
+
+struct LdltAvx512d {
+  typedef double T;
+  typedef __m512d Reg;
+  static constexpr s64 W = 8;
+  JCQP_TARGET_AVX512 static inline Reg zero() { return _mm512_setzero_pd(); }
+  JCQP_TARGET_AVX512 static inline Reg set1(T x) { return _mm512_set1_pd(x); }
+  JCQP_TARGET_AVX512 static inline Reg load(const T* p) { return _mm512_load_pd(p); }
+  JCQP_TARGET_AVX512 static inline Reg loadu(const T* p) { return _mm512_loadu_pd(p); }
+  JCQP_TARGET_AVX512 static inline void store(T* p, Reg x) { _mm512_store_pd(p, x); }
+  JCQP_TARGET_AVX512 static inline void storeu(T* p, Reg x) { _mm512_storeu_pd(p, x); }
+  JCQP_TARGET_AVX512 static inline Reg fmadd(Reg a, Reg b, Reg c) { return _mm512_fmadd_pd(a, b, c); }
+  JCQP_TARGET_AVX512 static inline Reg fnmadd(Reg a, Reg b, Reg c) { return _mm512_fnmadd_pd(a, b, c); }
+  JCQP_TARGET_AVX512 static inline Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+};
+
+struct LdltAvx512f {
+  typedef float T;
+  typedef __m512 Reg;
+  static constexpr s64 W = 16;
+  JCQP_TARGET_AVX512 static inline Reg zero() { return _mm512_setzero_ps(); }
+  JCQP_TARGET_AVX512 static inline Reg set1(T x) { return _mm512_set1_ps(x); }
+  JCQP_TARGET_AVX512 static inline Reg load(const T* p) { return _mm512_load_ps(p); }
+  JCQP_TARGET_AVX512 static inline Reg loadu(const T* p) { return _mm512_loadu_ps(p); }
+  JCQP_TARGET_AVX512 static inline void store(T* p, Reg x) { _mm512_store_ps(p, x); }
+  JCQP_TARGET_AVX512 static inline void storeu(T* p, Reg x) { _mm512_storeu_ps(p, x); }
+  JCQP_TARGET_AVX512 static inline Reg fmadd(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+  JCQP_TARGET_AVX512 static inline Reg fnmadd(Reg a, Reg b, Reg c) { return _mm512_fnmadd_ps(a, b, c); }
+  JCQP_TARGET_AVX512 static inline Reg sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+};
+
+// The kernel bodies are identical for AVX2 and AVX-512, but the target attribute has to be spelled out on each.
+#define JCQP_LDLT_PANEL_BODY                                            \
+  typedef typename V::T T;                                              \
+  typedef typename V::Reg Reg;                                          \
+  constexpr s64 W = V::W;                                               \
+  s64 i = 0;                                                            \
+  for(; i + 2 * W <= rows; i += 2 * W) {                                \
+    Reg acc0 = V::loadu(col + i);                                       \
+    Reg acc1 = V::loadu(col + i + W);                                   \
+    for(s64 kk = 0; kk < k; kk++) {                                     \
+      Reg wk = V::set1(w[kk]);                                          \
+      const T* lk = l + kk * ld + i;                                    \
+      acc0 = V::fnmadd(V::loadu(lk), wk, acc0);                         \
+      acc1 = V::fnmadd(V::loadu(lk + W), wk, acc1);                     \
+    }                                                                   \
+    V::storeu(col + i, acc0);                                           \
+    V::storeu(col + i + W, acc1);                                       \
+  }                                                                     \
+  for(; i < rows; i++) {                                                \
+    T acc = col[i];                                                     \
+    for(s64 kk = 0; kk < k; kk++)                                       \
+      acc -= l[i + kk * ld] * w[kk];                                    \
+    col[i] = acc;                                                       \
+  }
+
+// 2 x LDLT_TILE_COLS register tile, accumulated over k and subtracted from a once.
+// Tiles start on a 2W row boundary at or above the diagonal; the few upper triangle entries
+// this touches are never read. Rows past m land in the LDLT_PAD padding.
+#define JCQP_LDLT_TRAILING_BODY                                         \
+  typedef typename V::T T;                                              \
+  typedef typename V::Reg Reg;                                          \
+  constexpr s64 W = V::W;                                               \
+  constexpr s64 MR = 2 * W;                                             \
+  s64 mPad = ldltRoundUp(m, MR);                                        \
+  for(s64 c = 0; c < m; c += LDLT_TILE_COLS) {                          \
+    for(s64 i = (c / MR) * MR; i < mPad; i += MR) {                     \
+      Reg acc00 = V::zero(), acc01 = V::zero();                         \
+      Reg acc10 = V::zero(), acc11 = V::zero();                         \
+      Reg acc20 = V::zero(), acc21 = V::zero();                         \
+      Reg acc30 = V::zero(), acc31 = V::zero();                         \
+      const T* lPtr = l + i;                                            \
+      const T* wPtr = w + c;                                            \
+      for(s64 kk = 0; kk < k; kk++) {                                   \
+        Reg l0 = V::load(lPtr);                                         \
+        Reg l1 = V::load(lPtr + W);                                     \
+        Reg b = V::set1(wPtr[0]);                                       \
+        acc00 = V::fmadd(l0, b, acc00);                                 \
+        acc01 = V::fmadd(l1, b, acc01);                                 \
+        b = V::set1(wPtr[1]);                                           \
+        acc10 = V::fmadd(l0, b, acc10);                                 \
+        acc11 = V::fmadd(l1, b, acc11);                                 \
+        b = V::set1(wPtr[2]);                                           \
+        acc20 = V::fmadd(l0, b, acc20);                                 \
+        acc21 = V::fmadd(l1, b, acc21);                                 \
+        b = V::set1(wPtr[3]);                                           \
+        acc30 = V::fmadd(l0, b, acc30);                                 \
+        acc31 = V::fmadd(l1, b, acc31);                                 \
+        lPtr += ld;                                                     \
+        wPtr += ld;                                                     \
+      }                                                                 \
+      T* aPtr = a + i + c * ld;                                         \
+      V::store(aPtr, V::sub(V::load(aPtr), acc00));                     \
+      V::store(aPtr + W, V::sub(V::load(aPtr + W), acc01));             \
+      aPtr += ld;                                                       \
+      V::store(aPtr, V::sub(V::load(aPtr), acc10));                     \
+      V::store(aPtr + W, V::sub(V::load(aPtr + W), acc11));             \
+      aPtr += ld;                                                       \
+      V::store(aPtr, V::sub(V::load(aPtr), acc20));                     \
+      V::store(aPtr + W, V::sub(V::load(aPtr + W), acc21));             \
+      aPtr += ld;                                                       \
+      V::store(aPtr, V::sub(V::load(aPtr), acc30));                     \
+      V::store(aPtr + W, V::sub(V::load(aPtr + W), acc31));             \
+    }                                                                   \
+  }
+
+template<typename V>
+JCQP_TARGET_AVX2 void ldltPanelAvx2(typename V::T* col, const typename V::T* l, const typename V::T* w, s64 ld, s64 rows, s64 k)
+{
+  JCQP_LDLT_PANEL_BODY
+}
+
+template<typename V>
+JCQP_TARGET_AVX2 void ldltTrailingAvx2(typename V::T* a, const typename V::T* l, const typename V::T* w, s64 ld, s64 m, s64 k)
+{
+  JCQP_LDLT_TRAILING_BODY
+}
+
+template<typename V>
+JCQP_TARGET_AVX512 void ldltPanelAvx512(typename V::T* col, const typename V::T* l, const typename V::T* w, s64 ld, s64 rows, s64 k)
+{
+  JCQP_LDLT_PANEL_BODY
+}
+
+template<typename V>
+JCQP_TARGET_AVX512 void ldltTrailingAvx512(typename V::T* a, const typename V::T* l, const typename V::T* w, s64 ld, s64 m, s64 k)
+{
+  JCQP_LDLT_TRAILING_BODY
+}
+
+#undef JCQP_LDLT_PANEL_BODY
+#undef JCQP_LDLT_TRAILING_BODY
+
+template<typename T>
+struct LdltSimd;
+
+template<>
+struct LdltSimd<double> {
+  typedef LdltAvx2d Avx2;
+  typedef LdltAvx512d Avx512;
+};
+
+template<>
+struct LdltSimd<float> {
+  typedef LdltAvx2f Avx2;
+  typedef LdltAvx512f Avx512;
+};
+
+#endif // JCQP_X86_DISPATCH
+
+/*!
+ * Kernel table for a given instruction set. Falls back to scalar if isa is not available in this build.
+ */
+template<typename T>
+LdltKernels<T> ldltKernelsFor(LdltIsa isa)
+{
+  LdltKernels<T> k;
+  k.panel = &ldltPanelScalar<T>;
+  k.trailing = &ldltTrailingScalar<T>;
+  k.isa = LdltIsa::SCALAR;
+#ifdef JCQP_X86_DISPATCH
+  if(isa == LdltIsa::AVX512) {
+    k.panel = &ldltPanelAvx512<typename LdltSimd<T>::Avx512>;
+    k.trailing = &ldltTrailingAvx512<typename LdltSimd<T>::Avx512>;
+    k.isa = isa;
+  } else if(isa == LdltIsa::AVX2) {
+    k.panel = &ldltPanelAvx2<typename LdltSimd<T>::Avx2>;
+    k.trailing = &ldltTrailingAvx2<typename LdltSimd<T>::Avx2>;
+    k.isa = isa;
+  }
+#else
+  (void)isa;
+#endif
+  return k;
+}
+
+/*!
+ * Kernel table for this cpu, detected on first use
+ */
+template<typename T>
+const LdltKernels<T>& ldltKernels()
+{
+  static const LdltKernels<T> kernels = ldltKernelsFor<T>(detectLdltIsa());
+  return kernels;
+}
+
+#endif // QR_DENSE_LDLT_KERNELS_H
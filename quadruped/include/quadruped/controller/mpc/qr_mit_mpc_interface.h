@@ -69,6 +69,7 @@ struct update_data_t
 EXTERNC void setup_problem(double dt, int horizon, double mu, double f_max, double total_mass);
 EXTERNC void update_problem_data(double* p, double* v, double* q, double* w, double* r, double yaw, double* weights, double* state_trajectory, double alpha, int* gait);
 EXTERNC double get_solution(int index);
+// use_jcqp: 0 qpOASES dense, 2 JCQP, 3 JCQP in single precision, 4 qpOASES sparse with hot start
 EXTERNC void update_solver_settings(int max_iter, double rho, double sigma, double solver_alpha, double terminate, double use_jcqp);
 EXTERNC void update_problem_data_floats(fpt* p, fpt* v, fpt* q, fpt* w,
                                         fpt* r, fpt yaw, fpt* weights,
@@ -76,6 +77,11 @@ EXTERNC void update_problem_data_floats(fpt* p, fpt* v, fpt* q, fpt* w,
 
 void update_x_drag(fpt x_drag);
 
+/**
+ * @brief ADMM iterations used by the last JCQP solve.
+ */
+int get_solver_iterations();
+
 template <class T>
 void print_array(T* array, u16 rows, u16 cols)
 {
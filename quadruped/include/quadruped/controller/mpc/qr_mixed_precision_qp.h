@@ -0,0 +1,151 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_MIXED_PRECISION_QP_H
+#define QR_MIXED_PRECISION_QP_H
+
+#include <algorithm>
+
+#include "controller/mpc/qr_qp_problem.h"
+
+/*!
+ * JCQP problem held and solved in single precision, with a double precision check of the result.
+ * Data is only kept in float, which halves the memory traffic of the factorization and of every ADMM step.
+ * After the float solve, the primal infeasibility ||Ax - proj_[l,u](Ax)|| and the dual residual
+ * ||Px + q + A'y|| are evaluated with double accumulation. If (primal + dual) / 4, the criterion ADMM stops on,
+ * is above residualTolerance the problem is solved again in double, warm started from the float solution,
+ * which usually needs few iterations.
+ */
+class MixedPrecisionQpProblem
+{
+  QpProblem<float> _single;
+  QpProblem<double> _double;
+
+public:
+  MixedPrecisionQpProblem(s64 n_, s64 m_)
+    : _single(n_, m_, false), _double(n_, m_, false),
+      A(_single.A), P(_single.P), l(_single.l), u(_single.u), q(_single.q),
+      n(n_), m(m_),
+      _x(n_), _z(m_), _y(m_), _ax(m_), _dual(n_)
+  {
+  }
+
+  void setWarmStart(const Eigen::Matrix<double, Eigen::Dynamic, 1>& x,
+                    const Eigen::Matrix<double, Eigen::Dynamic, 1>& z,
+                    const Eigen::Matrix<double, Eigen::Dynamic, 1>& y)
+  {
+    _single.setWarmStart(x.cast<float>(), z.cast<float>(), y.cast<float>());
+  }
+
+  /*!
+   * Solve in float, refine in double if the residual check fails
+   */
+  void run(s64 nIterations = -1, bool sparse = false)
+  {
+    _single.settings.maxIterations = settings.maxIterations;
+    _single.settings.rho = settings.rho;
+    _single.settings.sigma = settings.sigma;
+    _single.settings.alpha = settings.alpha;
+    _single.settings.terminate = settings.terminate;
+    _single.runFromDense(nIterations, sparse, false);
+
+    _x = _single.getSolution().cast<double>();
+    _z = _single.getConstraintValues().cast<double>();
+    _y = _single.getDual().cast<double>();
+    computeResiduals();
+
+    _refined = !(getResidual() <= residualTolerance); // also catches NaN
+    if(!_refined)
+      return;
+
+    _double.settings = settings;
+    _double.A = A.cast<double>();
+    _double.P = P.cast<double>();
+    _double.q = q.cast<double>();
+    _double.l = l.cast<double>();
+    _double.u = u.cast<double>();
+    _double.setWarmStart(_x, _z, _y);
+    _double.runFromDense(nIterations, sparse, false);
+
+    _x = _double.getSolution();
+    _z = _double.getConstraintValues();
+    _y = _double.getDual();
+    computeResiduals();
+  }
+
+  Eigen::Matrix<double, Eigen::Dynamic, 1>& getSolution() { return _x; }
+  Eigen::Matrix<double, Eigen::Dynamic, 1>& getConstraintValues() { return _z; }
+  Eigen::Matrix<double, Eigen::Dynamic, 1>& getDual() { return _y; }
+  s64 getIterations() const { return _single.getIterations() + (_refined ? _double.getIterations() : 0); }
+  bool refined() const { return _refined; }
+  double getPrimalResidual() const { return _primalResidual; }
+  double getDualResidual() const { return _dualResidual; }
+  double getResidual() const { return (_primalResidual + _dualResidual) / 4; } //! scaled as the ADMM termination check
+
+  // public data, single precision
+  DenseMatrix<float>& A;
+  DenseMatrix<float>& P;
+  Eigen::Matrix<float, Eigen::Dynamic, 1>& l;
+  Eigen::Matrix<float, Eigen::Dynamic, 1>& u;
+  Eigen::Matrix<float, Eigen::Dynamic, 1>& q;
+  QpProblemSettings<double> settings;
+  double residualTolerance = 1e-2;
+  s64 n, m;
+
+private:
+  /*!
+   * Residuals of _x, _y against the float data, accumulated in double
+   */
+  void computeResiduals()
+  {
+    _ax.setZero();
+    for(s64 c = 0; c < n; c++) {
+      double xc = _x[c];
+      for(s64 r = 0; r < m; r++)
+        _ax[r] += (double)A(r, c) * xc;
+    }
+
+    _primalResidual = 0;
+    for(s64 r = 0; r < m; r++) {
+      double proj = std::min(std::max(_ax[r], (double)l[r]), (double)u[r]);
+      _primalResidual = std::max(_primalResidual, std::abs(_ax[r] - proj));
+    }
+
+    for(s64 c = 0; c < n; c++) {
+      double d = q[c];
+      for(s64 r = 0; r < n; r++)
+        d += (double)P(r, c) * _x[r]; // P is symmetric, walk it by column
+      for(s64 r = 0; r < m; r++)
+        d += (double)A(r, c) * _y[r];
+      _dual[c] = d;
+    }
+    _dualResidual = _dual.cwiseAbs().maxCoeff();
+  }
+
+  Eigen::Matrix<double, Eigen::Dynamic, 1> _x, _z, _y, _ax, _dual;
+  double _primalResidual = 0, _dualResidual = 0;
+  bool _refined = false;
+};
+
+#endif // QR_MIXED_PRECISION_QP_H
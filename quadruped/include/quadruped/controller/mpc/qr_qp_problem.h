@@ -31,6 +31,7 @@
 
 #include "common/qr_cTypes.h"
 #include "common/qr_algebra.h"
+#include "common/qr_log.h"
 #include "qr_cholesky_solver.h"
 
 // 0.5 * x'Px + q'x
@@ -102,7 +103,18 @@ public:
     void runFromDense(s64 nIterations = -1, bool sparse = false, bool b_print = true);
     void runFromTriples(s64 nIterations = -1, bool b_print = true);
 
+    void hotStart();
+    void setWarmStart(const Eigen::Matrix<T, Eigen::Dynamic, 1>& x,
+                      const Eigen::Matrix<T, Eigen::Dynamic, 1>& z,
+                      const Eigen::Matrix<T, Eigen::Dynamic, 1>& y);
+
     Eigen::Matrix<T, Eigen::Dynamic, 1>& getSolution() { return *_x; }
+    Eigen::Matrix<T, Eigen::Dynamic, 1>& getConstraintValues() { return *_z; }
+    Eigen::Matrix<T, Eigen::Dynamic, 1>& getDual() { return _y; }
+    s64 getIterations() const { return _iterations; }
+    bool lastSolveRefactored() const { return _refactored; }
+    bool lastSolveReusedSymbolic() const { return _symbolicReused; } //! the sparse refactorization kept ordering and pattern
+    bool poorlyConditioned() const { return _poorlyConditioned; } //! the dense factorization hit a vanishing pivot
 
 
 
@@ -120,7 +132,7 @@ public:
 private:
   void coldStart();
   void computeConstraintInfos();
-  void setupLinearSolverCommon();
+  bool setupLinearSolverCommon();
   void stepSetup();
   void solveLinearSystem();
   void stepX();
@@ -146,6 +158,12 @@ private:
   std::vector<ConstraintInfo<T>> _constraintInfos;
 
   bool _hotStarted = false, _sparse = false;
+  bool _kktValid = false;   // _kkt holds P/A/rho of the last run, blocks are only rewritten when they change
+  bool _factored = false;   // a factorization of _kkt is held by the linear solver selected by _sparse
+  bool _refactored = false;
+  bool _symbolicReused = false;
+  bool _poorlyConditioned = false;
+  s64 _iterations = 0;
 
 };
 
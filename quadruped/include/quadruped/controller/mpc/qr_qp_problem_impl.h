@@ -44,6 +44,39 @@ void QpProblem<T>::coldStart()
   _y.setZero();
 }
 
+/*!
+ * Start the next run from the iterates of the previous one
+ */
+template<typename T>
+void QpProblem<T>::hotStart()
+{
+  _hotStarted = true;
+}
+
+/*!
+ * Start the next run from a given primal, constraint and dual guess,
+ * e.g. the previous MPC solution shifted by one step
+ */
+template<typename T>
+void QpProblem<T>::setWarmStart(const Eigen::Matrix<T, Eigen::Dynamic, 1>& x,
+                                const Eigen::Matrix<T, Eigen::Dynamic, 1>& z,
+                                const Eigen::Matrix<T, Eigen::Dynamic, 1>& y)
+{
+  assert(x.rows() == n && z.rows() == m && y.rows() == m);
+  _x = &_x0;
+  _z = &_z0;
+  _xPrev = &_x1;
+  _zPrev = &_z1;
+
+  *_x = x;
+  *_xPrev = x;
+  *_z = z;
+  *_zPrev = z;
+  _y = y;
+
+  _hotStarted = true;
+}
+
 /*!
  * Build KKT matrix with triples.
  * @param T
@@ -102,8 +135,12 @@ void QpProblem<T>::runFromTriples(s64 nIterations, bool b_print) {
   // setup x/z/xprev/zprev/y
   if(!_hotStarted)
     coldStart();
+  _hotStarted = false;
 
   computeConstraintInfos();
+  _kktValid = false;
+  _factored = false;
+  _refactored = true;
 
   if(b_print) {
     // printf("QP Init Time: %.3f ms\n", timer.getMs());
@@ -156,9 +193,11 @@ void QpProblem<T>::runFromTriples(s64 nIterations, bool b_print) {
   _sparse = true;
 
   // double setupTime = setupTimer.getMs();
+  _iterations = 0;
   for(s64 iteration = 0; iteration < settings.maxIterations; iteration++) {
 
     // Timer iterationTimer;
+    _iterations = iteration + 1;
     stepSetup();
 
     solveLinearSystem();
@@ -200,7 +239,6 @@ template<typename T>
 void QpProblem<T>::runFromDense(s64 nIterations, bool sparse, bool b_print)
 {
     if(nIterations <0) {nIterations = settings.maxIterations; }
-  _sparse = sparse;
   // print info
   if(b_print) {
     printf("n: %ld\nm: %ld\n, sz %ld", n, m, sizeof(T));
@@ -210,33 +248,48 @@ void QpProblem<T>::runFromDense(s64 nIterations, bool sparse, bool b_print)
   // init variables
   if(!_hotStarted)
     coldStart();
+  _hotStarted = false;
 
-  // setup constraints and KKT
+  // setup constraints and KKT, only refactor if the KKT matrix or the solver changed
   computeConstraintInfos();
-  setupLinearSolverCommon(); // do not include setup time to build sparse matrix to be consistent
+  bool kktChanged = setupLinearSolverCommon(); // do not include setup time to build sparse matrix to be consistent
+  _refactored = kktChanged || !_factored || sparse != _sparse;
+  const bool sparseFactored = _factored && _sparse;
+  _sparse = sparse;
 
-  if(sparse){
-    Asparse = A.sparseView();
-    Psparse = P.sparseView();
-  }
+  if(_refactored) {
+    if(sparse){
+      Asparse = A.sparseView();
+      Psparse = P.sparseView();
+    }
 
+    // the KKT pattern is fixed while the problem size is, so usually only the numeric factorization is redone
+    _symbolicReused = sparse && sparseFactored && _cholSparseSolver.refactor(_kkt);
 
-  // Timer preSetupTimer;
-  if(sparse) // don't include time to build sparse matrices
-    _cholSparseSolver.preSetup(_kkt, b_print);
+    // Timer preSetupTimer;
+    if(sparse && !_symbolicReused) // don't include time to build sparse matrices
+      _cholSparseSolver.preSetup(_kkt, b_print);
 
 
-  // if(b_print) printf("Pre-setup in %.3f ms\n", preSetupTimer.getMs());
+    // if(b_print) printf("Pre-setup in %.3f ms\n", preSetupTimer.getMs());
 
-  // Timer totalTimer;
-  // Timer setupTimer;
+    // Timer totalTimer;
+    // Timer setupTimer;
 
-  if(sparse)
-    _cholSparseSolver.setup(b_print); // set up this one first.
-  else
-  {
-    _cholDenseSolver.set_print(b_print);
-    _cholDenseSolver.setup(_kkt);
+    _poorlyConditioned = false;
+    if(sparse) {
+      if(!_symbolicReused)
+        _cholSparseSolver.setup(b_print); // set up this one first.
+    }
+    else
+    {
+      _cholDenseSolver.set_print(b_print);
+      _poorlyConditioned = !_cholDenseSolver.setup(_kkt);
+      if(_poorlyConditioned)
+        QR_LOG_WARN_EVERY(1.f, "JCQP: %ld vanishing KKT pivots next to the largest diagonal entry in %s",
+                          (long) _cholDenseSolver.getSmallPivots(), sizeof(T) == sizeof(float) ? "float" : "double");
+    }
+    _factored = true;
   }
 
 
@@ -246,9 +299,11 @@ void QpProblem<T>::runFromDense(s64 nIterations, bool sparse, bool b_print)
   std::vector<Eigen::Matrix<T, Eigen::Dynamic, 1>> solutionLog;
   double totalResidTime = 0;
 
+  _iterations = 0;
   for(s64 iteration = 0; iteration < nIterations; iteration++) {
 
     // Timer iterationTimer;
+    _iterations = iteration + 1;
     stepSetup();
 
     solveLinearSystem();
@@ -312,19 +367,53 @@ void QpProblem<T>::computeConstraintInfos()
   }
 }
 
+/*!
+ * Build the KKT matrix. Blocks that did not change since the last call are left alone.
+ * @return true if the KKT matrix changed and has to be factored again
+ */
 template<typename T>
-void QpProblem<T>::setupLinearSolverCommon()
+bool QpProblem<T>::setupLinearSolverCommon()
 {
-  // first, build KKT matrix
-  _kkt.topLeftCorner(n,n) = P;
-  _kkt.topRightCorner(n,m) = A.transpose();
-  _kkt.bottomLeftCorner(m,n) = A;
-  _kkt.bottomRightCorner(m,m).setZero();
-  for(s64 i = 0; i < n; i++)
-    _kkt(i,i) += settings.sigma;
+  bool changed = !_kktValid;
+
+  // upper left P + sigma * I
+  bool pChanged = changed;
+  for(s64 c = 0; c < n && !pChanged; c++) {
+    for(s64 r = 0; r < n; r++) {
+      T v = P(r, c);
+      if(r == c) v += settings.sigma;
+      if(_kkt(r, c) != v) {
+        pChanged = true;
+        break;
+      }
+    }
+  }
+  if(pChanged) {
+    _kkt.topLeftCorner(n,n) = P;
+    for(s64 i = 0; i < n; i++)
+      _kkt(i,i) += settings.sigma;
+    changed = true;
+  }
 
-  for(s64 i = 0; i < m; i++)
-    _kkt(i + n, i + n) -= _constraintInfos[i].invRho;
+  // A and A transpose
+  if(changed || _kkt.bottomLeftCorner(m,n) != A) {
+    _kkt.topRightCorner(n,m) = A.transpose();
+    _kkt.bottomLeftCorner(m,n) = A;
+    changed = true;
+  }
+
+  // bottom right -1/rho
+  if(!_kktValid)
+    _kkt.bottomRightCorner(m,m).setZero();
+  for(s64 i = 0; i < m; i++) {
+    if(_kkt(i + n, i + n) != -_constraintInfos[i].invRho) {
+      _kkt(i + n, i + n) = -_constraintInfos[i].invRho;
+      changed = true;
+    }
+  }
+
+  _kktValid = true;
+  return changed;
 }
 
 template<typename T>
@@ -116,6 +116,7 @@ private:
   void addLinearStateCost();
   void addQuadraticControlCost();
 
+  void recordSnapshot();
   void runSolver();
   void runSolverOSQP();
 
@@ -48,6 +48,9 @@ struct MatCSC {
     delete[] values;
     delete[] colPtrs;
     delete[] rowIdx;
+    values = nullptr;
+    colPtrs = nullptr;
+    rowIdx = nullptr;
   }
 };
 
@@ -0,0 +1,492 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_ACTIVE_SET_QP_H
+#define QR_ACTIVE_SET_QP_H
+
+#include <cmath>
+#include <limits>
+
+#include <Eigen/Dense>
+
+/**
+ * @brief Goldfarb-Idnani dual active set solver for small dense QPs of fixed size,
+ *     min 0.5 x'Gx + a'x   s.t.   C'x >= b,
+ * with N variables and M inequality constraints (the columns of C). It is the algorithm of quadprog++,
+ * but all storage is fixed size on the stack and the slack and step computations are Eigen products.
+ * The solve is warm started from the active set of the last one: its constraints are made active first, each by a
+ * full step along the manifold of the ones before, which gives the minimum on their intersection and its multipliers.
+ * If all multipliers are nonnegative this is a dual feasible start and the dual iterations continue from it, so an
+ * unchanged active set needs no iteration at all. Otherwise, or if the constraints are dependent, the solve restarts
+ * cold from the unconstrained minimum.
+ */
+template<int N, int M>
+class qrActiveSetQp {
+
+public:
+
+    typedef Eigen::Matrix<double, N, N> MatNN;
+
+    typedef Eigen::Matrix<double, N, 1> VecN;
+
+    typedef Eigen::Matrix<double, N, M> MatNM;
+
+    typedef Eigen::Matrix<double, M, 1> VecM;
+
+    qrActiveSetQp()
+    {
+        ResetWarmStart();
+    }
+
+    /**
+     * @brief Solve the QP. G must be positive definite.
+     * @param x: the solution. On failure the last iterate, and the warm start is reset.
+     * @return false if the problem is infeasible, G is not positive definite
+     * or the solve did not converge within 10 * (N + M) iterations.
+     */
+    bool Solve(const MatNN& G, const VecN& a, const MatNM& C, const VecM& b, VecN& x);
+
+    /**
+     * @brief Forget the active set of the previous solve, the next solve starts cold.
+     */
+    void ResetWarmStart()
+    {
+        previousSize = 0;
+    }
+
+    /**
+     * @brief Whether the last solve started from the active set of the one before.
+     */
+    bool IsWarmStarted() const
+    {
+        return warmStarted;
+    }
+
+    /**
+     * @brief Number of constraints added to the active set in the last solve, the warm started ones included.
+     */
+    int GetIterations() const
+    {
+        return iterations;
+    }
+
+    int GetActiveSetSize() const
+    {
+        return activeSize;
+    }
+
+    /**
+     * @brief index of the i-th active constraint.
+     */
+    int GetActiveConstraint(int i) const
+    {
+        return active[i];
+    }
+
+    /**
+     * @brief Lagrange multiplier of the i-th active constraint.
+     */
+    double GetMultiplier(int i) const
+    {
+        return u[i];
+    }
+
+private:
+
+    bool AddConstraint();
+
+    /**
+     * @brief Make the constraints of the previous active set active, starting from the unconstrained minimum x.
+     * @return false if they are dependent or a multiplier is negative, the state then has to be reset.
+     */
+    bool WarmStart(const MatNM& C, const VecM& b, VecN& x);
+
+    /**
+     * @brief Primal step direction z and dual step direction r for adding the constraint with normal np.
+     */
+    void ComputeStep();
+
+    void DeleteConstraint(int constraint);
+
+    void FinishWarmStart();
+
+    static double Distance(double a, double b)
+    {
+        double a1 = std::fabs(a), b1 = std::fabs(b);
+        if (a1 > b1) {
+            double t = b1 / a1;
+            return a1 * std::sqrt(1.0 + t * t);
+        } else if (b1 > a1) {
+            double t = a1 / b1;
+            return b1 * std::sqrt(1.0 + t * t);
+        }
+        return a1 * std::sqrt(2.0);
+    }
+
+    /**
+     * @brief J = L^-T Q, R: upper triangular factor of the active constraints in the basis J.
+     */
+    MatNN J, R;
+
+    VecN d, z, np;
+
+    /**
+     * @brief multipliers and dual step of the active constraints, one extra slot for the candidate.
+     */
+    Eigen::Matrix<double, N + 1, 1> u, r, uOld;
+
+    VecM s;
+
+    int active[N + 1], activeOld[N + 1];
+
+    int activeSize = 0;
+
+    bool inActiveSet[M], excluded[M];
+
+    int previous[N];
+
+    int previousSize;
+
+    int iterations = 0;
+
+    bool warmStarted = false;
+
+    double rNorm = 1;
+};
+
+template<int N, int M>
+bool qrActiveSetQp<N, M>::Solve(const MatNN& G, const VecN& a, const MatNM& C, const VecM& b, VecN& x)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    const double eps = std::numeric_limits<double>::epsilon();
+    const int maxIterations = 10 * (N + M);
+
+    Eigen::LLT<MatNN> llt(G);
+    if (llt.info() != Eigen::Success) {
+        return false;
+    }
+    // G^-1 = J J'
+    J = llt.matrixU().solve(MatNN::Identity());
+    // c1 * c2 estimates cond(G)
+    const double c1 = G.trace();
+    const double c2 = J.trace();
+    const double feasibilityTolerance = M * eps * c1 * c2 * 100.0;
+
+    x = -llt.solve(a);
+    R.setZero();
+    rNorm = 1;
+    activeSize = 0;
+    iterations = 0;
+    for (int i = 0; i < M; ++i) {
+        inActiveSet[i] = false;
+    }
+    if (previousSize > 0) {
+        const MatNN coldJ = J;
+        const VecN coldX = x;
+        warmStarted = WarmStart(C, b, x);
+        if (!warmStarted) {
+            J = coldJ;
+            x = coldX;
+            R.setZero();
+            rNorm = 1;
+            activeSize = 0;
+            iterations = 0;
+            for (int i = 0; i < M; ++i) {
+                inActiveSet[i] = false;
+            }
+        }
+    } else {
+        warmStarted = false;
+    }
+
+    VecN xOld;
+    while (iterations < maxIterations) {
+        // step 1: slacks of all constraints
+        s.noalias() = C.transpose() * x - b;
+        double psi = s.cwiseMin(0.0).sum();
+        if (std::fabs(psi) <= feasibilityTolerance) {
+            FinishWarmStart();
+            return true;
+        }
+        for (int i = 0; i < activeSize; ++i) {
+            uOld[i] = u[i];
+            activeOld[i] = active[i];
+        }
+        xOld = x;
+        for (int i = 0; i < M; ++i) {
+            excluded[i] = false;
+        }
+
+        bool added = false;
+        while (!added) {
+            // step 2: choose the most violated constraint
+            int ip = -1;
+            double ss = 0.0;
+            for (int i = 0; i < M; ++i) {
+                if (inActiveSet[i] || excluded[i]) {
+                    continue;
+                }
+                if (s[i] < ss) {
+                    ss = s[i];
+                    ip = i;
+                }
+            }
+            if (ip < 0) {
+                FinishWarmStart();
+                return true;
+            }
+            ++iterations;
+
+            np = C.col(ip);
+            u[activeSize] = 0.0;
+            active[activeSize] = ip;
+
+            while (true) {
+                // step 2a: step direction in the primal (z) and dual (-r) space
+                ComputeStep();
+
+                // step 2b: partial step length t1 (dual feasibility) and full step length t2
+                int l = -1;
+                double t1 = inf;
+                for (int k = 0; k < activeSize; ++k) {
+                    if (r[k] > 0.0 && u[k] / r[k] < t1) {
+                        t1 = u[k] / r[k];
+                        l = active[k];
+                    }
+                }
+                double t2 = inf;
+                if (z.squaredNorm() > eps) {
+                    t2 = -s[ip] / z.dot(np);
+                    if (t2 < 0) {
+                        t2 = inf;
+                    }
+                }
+                double t = std::min(t1, t2);
+
+                if (t >= inf) {
+                    // infeasible, x is left at the last iterate as quadprog++ does
+                    ResetWarmStart();
+                    return false;
+                }
+                if (t2 >= inf) {
+                    // step in dual space only, drop constraint l
+                    u.head(activeSize) -= t * r.head(activeSize);
+                    u[activeSize] += t;
+                    DeleteConstraint(l);
+                    continue;
+                }
+
+                // step in primal and dual space
+                x += t * z;
+                u.head(activeSize) -= t * r.head(activeSize);
+                u[activeSize] += t;
+
+                if (std::fabs(t - t2) < eps) {
+                    // full step, ip becomes active
+                    if (AddConstraint()) {
+                        inActiveSet[ip] = true;
+                        added = true;
+                    } else {
+                        // degenerate, restore the previous active set and try another constraint
+                        excluded[ip] = true;
+                        DeleteConstraint(ip);
+                        for (int i = 0; i < M; ++i) {
+                            inActiveSet[i] = false;
+                        }
+                        for (int i = 0; i < activeSize; ++i) {
+                            active[i] = activeOld[i];
+                            u[i] = uOld[i];
+                            inActiveSet[active[i]] = true;
+                        }
+                        x = xOld;
+                    }
+                    break;
+                }
+
+                // partial step, drop constraint l
+                DeleteConstraint(l);
+                s[ip] = C.col(ip).dot(x) - b[ip];
+            }
+        }
+    }
+    // not converged, x may still violate constraints
+    ResetWarmStart();
+    return false;
+}
+
+template<int N, int M>
+void qrActiveSetQp<N, M>::ComputeStep()
+{
+    d.noalias() = J.transpose() * np;
+    z.noalias() = J.rightCols(N - activeSize) * d.tail(N - activeSize);
+    for (int i = activeSize - 1; i >= 0; --i) {
+        double sum = 0.0;
+        for (int j = i + 1; j < activeSize; ++j) {
+            sum += R(i, j) * r[j];
+        }
+        r[i] = (d[i] - sum) / R(i, i);
+    }
+}
+
+template<int N, int M>
+bool qrActiveSetQp<N, M>::WarmStart(const MatNM& C, const VecM& b, VecN& x)
+{
+    const double eps = std::numeric_limits<double>::epsilon();
+    for (int k = 0; k < previousSize; ++k) {
+        const int ip = previous[k];
+        np = C.col(ip);
+        ComputeStep();
+        const double curvature = z.dot(np);
+        if (z.squaredNorm() <= eps || std::fabs(curvature) <= eps) {
+            return false;
+        }
+        // full step onto the constraint, t < 0 if it is inactive at x
+        const double t = -(np.dot(x) - b[ip]) / curvature;
+        x += t * z;
+        u.head(activeSize) -= t * r.head(activeSize);
+        u[activeSize] = t;
+        active[activeSize] = ip;
+        if (!AddConstraint()) {
+            return false;
+        }
+        inActiveSet[ip] = true;
+        ++iterations;
+    }
+    // the minimum on the active constraints is a dual feasible start only with nonnegative multipliers
+    const double tolerance = eps * std::max(1.0, u.head(activeSize).cwiseAbs().maxCoeff()) * 100.0;
+    for (int i = 0; i < activeSize; ++i) {
+        if (u[i] < -tolerance) {
+            return false;
+        }
+        u[i] = std::max(u[i], 0.0);
+    }
+    return true;
+}
+
+template<int N, int M>
+bool qrActiveSetQp<N, M>::AddConstraint()
+{
+    // Givens rotations reducing d[activeSize + 1 ... N - 1] to zero, applied to the columns of J
+    for (int j = N - 1; j >= activeSize + 1; --j) {
+        double cc = d[j - 1];
+        double ss = d[j];
+        double h = Distance(cc, ss);
+        if (std::fabs(h) < std::numeric_limits<double>::epsilon()) {
+            continue;
+        }
+        d[j] = 0.0;
+        ss = ss / h;
+        cc = cc / h;
+        if (cc < 0.0) {
+            cc = -cc;
+            ss = -ss;
+            d[j - 1] = -h;
+        } else {
+            d[j - 1] = h;
+        }
+        double xny = ss / (1.0 + cc);
+        VecN t1 = J.col(j - 1);
+        J.col(j - 1) = cc * t1 + ss * J.col(j);
+        J.col(j) = xny * (t1 + J.col(j - 1)) - J.col(j);
+    }
+    ++activeSize;
+    R.col(activeSize - 1).head(activeSize) = d.head(activeSize);
+
+    if (std::fabs(d[activeSize - 1]) <= std::numeric_limits<double>::epsilon() * rNorm) {
+        // linearly dependent on the active constraints
+        return false;
+    }
+    rNorm = std::max(rNorm, std::fabs(d[activeSize - 1]));
+    return true;
+}
+
+template<int N, int M>
+void qrActiveSetQp<N, M>::DeleteConstraint(int constraint)
+{
+    int qq = -1;
+    for (int i = 0; i < activeSize; ++i) {
+        if (active[i] == constraint) {
+            qq = i;
+            break;
+        }
+    }
+    if (qq < 0) {
+        return;
+    }
+    inActiveSet[constraint] = false;
+
+    for (int i = qq; i < activeSize - 1; ++i) {
+        active[i] = active[i + 1];
+        u[i] = u[i + 1];
+        R.col(i) = R.col(i + 1);
+    }
+    // the candidate constraint moves down as well
+    active[activeSize - 1] = active[activeSize];
+    u[activeSize - 1] = u[activeSize];
+    active[activeSize] = 0;
+    u[activeSize] = 0.0;
+    R.col(activeSize - 1).head(activeSize).setZero();
+    --activeSize;
+
+    // restore the triangular form of R
+    for (int j = qq; j < activeSize; ++j) {
+        double cc = R(j, j);
+        double ss = R(j + 1, j);
+        double h = Distance(cc, ss);
+        if (std::fabs(h) < std::numeric_limits<double>::epsilon()) {
+            continue;
+        }
+        cc = cc / h;
+        ss = ss / h;
+        R(j + 1, j) = 0.0;
+        if (cc < 0.0) {
+            R(j, j) = -h;
+            cc = -cc;
+            ss = -ss;
+        } else {
+            R(j, j) = h;
+        }
+        double xny = ss / (1.0 + cc);
+        for (int k = j + 1; k < activeSize; ++k) {
+            double t1 = R(j, k);
+            double t2 = R(j + 1, k);
+            R(j, k) = t1 * cc + t2 * ss;
+            R(j + 1, k) = xny * (t1 + R(j, k)) - t2;
+        }
+        VecN t1 = J.col(j);
+        J.col(j) = cc * t1 + ss * J.col(j + 1);
+        J.col(j + 1) = xny * (J.col(j) + t1) - J.col(j + 1);
+    }
+}
+
+template<int N, int M>
+void qrActiveSetQp<N, M>::FinishWarmStart()
+{
+    previousSize = activeSize;
+    for (int i = 0; i < activeSize; ++i) {
+        previous[i] = active[i];
+    }
+}
+
+#endif // QR_ACTIVE_SET_QP_H
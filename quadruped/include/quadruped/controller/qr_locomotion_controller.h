@@ -30,8 +30,6 @@
 #include <Eigen/Dense>
 
 #include <ros/ros.h>
-#include <gazebo_msgs/GetLinkState.h>
-#include <geometry_msgs/Pose.h>
 
 #include "robots/qr_timer.h"
 #include "common/qr_eigen_types.h"
@@ -43,6 +41,10 @@
 #include "planner/qr_com_planner.h"
 #include "state_estimator/qr_robot_estimator.h"
 #include "state_estimator/qr_ground_estimator.h"
+#include "state_estimator/qr_ground_truth.h"
+#include "state_estimator/qr_state_history.h"
+#include "state_estimator/qr_latency_estimator.h"
+#include "state_estimator/qr_state_predictor.h"
 
 /** 
  * @brief Universe Controller that combines planners and estimators.
@@ -80,10 +82,24 @@ public:
     void Reset();
 
     /**
-     * @brief Update the pose of the robot's COM.
-     * @param baseStateClient The service client which is used to receive the link state from gazebo.
+     * @brief Follow the ground truth pose in simulation. From then on every Update() first copies the latest
+     * measurement into the robot and, after the estimators ran, compares them with it.
+     * @param groundTruthIn The ground truth, read only by the control thread. nullptr stops following it.
      */
-    void GetComPositionInWorldFrame(ros::ServiceClient& baseStateClient);
+    void SetGroundTruth(qrGroundTruth *groundTruthIn);
+
+    /**
+     * @brief Update the pose of the robot's COM from the latest ground truth measurement, without waiting for a new one.
+     */
+    void GetComPositionInWorldFrame();
+
+    /**
+     * @brief Get the state estimator's error against the ground truth since the last reset.
+     */
+    inline qrGroundTruthErrorMetrics &GetGroundTruthErrorMetrics()
+    {
+        return groundTruthErrorMetrics;
+    }
 
     /** 
      * @brief Update the planners, estimatiors and controllers.
@@ -132,6 +148,15 @@ public:
         return stateEstimator;
     }
 
+    /**
+     * @brief Get the online estimate of the loop latency.
+     *  @return latencyEstimator.
+     */
+    inline const qrLatencyEstimator &GetLatencyEstimator() const
+    {
+        return latencyEstimator;
+    }
+
     /** 
      * @brief Get ground estimator object.
      *  @return groundEstimator.
@@ -205,6 +230,42 @@ private:
      * @brief the time has passed after last call Reset() function.
      */
     double timeSinceReset;
+
+    /**
+     * @brief the ground truth in simulation, or nullptr.
+     */
+    qrGroundTruth *groundTruth = nullptr;
+
+    /**
+     * @brief the state estimator's error against the ground truth.
+     */
+    qrGroundTruthErrorMetrics groundTruthErrorMetrics;
+
+    /**
+     * @brief the observations of the last ticks and the commands sent in reply.
+     */
+    qrStateHistory stateHistory;
+
+    /**
+     * @brief measures the loop latency from the history.
+     */
+    qrLatencyEstimator latencyEstimator;
+
+    /**
+     * @brief predicts the state over the loop latency when the config enables it.
+     */
+    qrStatePredictor statePredictor;
+
+    /**
+     * @brief the output of the state predictor.
+     */
+    qrStateSample predictedState;
+
+    /**
+     * @brief Record the observation of this tick and, when the config enables it, replace the state
+     * the controllers plan with by the one predicted over the loop latency.
+     */
+    void CompensateLatency();
 };
 
 #endif //QR_LOCOMOTION_CONTROLLER_H
@@ -0,0 +1,271 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_QP_SNAPSHOT_H
+#define QR_QP_SNAPSHOT_H
+
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "common/qr_cTypes.h"
+#include "controller/mpc/qr_sparse_matrix.h"
+
+/**
+ * @brief Which solver call site produced a snapshot. Values are bit flags so that
+ * several sources can be enabled in the recorder at once.
+ */
+enum QpSnapshotSource {
+    QP_SNAPSHOT_DENSE_MPC = 1,      // solve_mpc, condensed MPC
+    QP_SNAPSHOT_SPARSE_CMPC = 2,    // SparseCMPC, sparse MPC over states and forces
+    QP_SNAPSHOT_CONTACT_FORCE = 4,  // ComputeContactForce, single stance force QP
+    QP_SNAPSHOT_ALL = 7
+};
+
+/**
+ * @brief Solver independent copy of one QP
+ *     min 0.5 x'Hx + g'x   s.t.   lb <= Ax <= ub,
+ * together with the contact schedule it was built for.
+ * Matrices are kept as triplets, duplicated entries are summed. H is stored by its upper triangle.
+ * Unbounded sides of a constraint are +-infinity.
+ */
+struct qrQpSnapshot {
+
+    u32 source = 0;
+
+    /**
+     * @brief running index of the snapshot in its file, set by the recorder.
+     */
+    u64 sequence = 0;
+
+    /**
+     * @brief seconds since epoch when the snapshot was recorded.
+     */
+    double timestamp = 0;
+
+    u32 n = 0;
+
+    u32 m = 0;
+
+    std::vector<SparseTriple<double>> H;
+
+    std::vector<double> g;
+
+    std::vector<SparseTriple<double>> A;
+
+    std::vector<double> lb;
+
+    std::vector<double> ub;
+
+    /**
+     * @brief contact flags, 4 legs per step, gaitSteps steps.
+     */
+    u32 gaitSteps = 0;
+
+    std::vector<u8> gait;
+
+    /**
+     * @brief Copy the nonzeros of the upper triangle of a dense Hessian.
+     */
+    template<typename Derived>
+    void SetHessian(const Eigen::MatrixBase<Derived>& hessian)
+    {
+        n = hessian.rows();
+        H.clear();
+        AppendDense(H, hessian, true);
+    }
+
+    /**
+     * @brief Copy the upper triangle of a symmetric Hessian given by triplets of both triangles.
+     */
+    void SetHessian(const std::vector<SparseTriple<double>>& triples, u32 size);
+
+    /**
+     * @brief Copy the nonzeros of a dense constraint matrix.
+     */
+    template<typename Derived>
+    void SetConstraintMatrix(const Eigen::MatrixBase<Derived>& constraint)
+    {
+        m = constraint.rows();
+        A.clear();
+        AppendDense(A, constraint, false);
+    }
+
+    template<typename Derived>
+    void SetGradient(const Eigen::MatrixBase<Derived>& gradient)
+    {
+        g.resize(gradient.size());
+        for (u32 i = 0; i < g.size(); ++i) {
+            g[i] = double(gradient(i));
+        }
+    }
+
+    template<typename DerivedL, typename DerivedU>
+    void SetBounds(const Eigen::MatrixBase<DerivedL>& lower, const Eigen::MatrixBase<DerivedU>& upper)
+    {
+        lb.resize(lower.size());
+        ub.resize(upper.size());
+        for (u32 i = 0; i < lb.size(); ++i) {
+            lb[i] = double(lower(i));
+            ub[i] = double(upper(i));
+        }
+    }
+
+    /**
+     * @brief Set the contact schedule, steps x 4 flags, nonzero means stance.
+     */
+    template<typename T>
+    void SetGait(const T* flags, u32 steps)
+    {
+        gaitSteps = steps;
+        gait.resize(4 * steps);
+        for (u32 i = 0; i < gait.size(); ++i) {
+            gait[i] = flags[i] ? 1 : 0;
+        }
+    }
+
+    /**
+     * @brief Dense copies of the problem data, used by the dense solver backends.
+     */
+    Eigen::MatrixXd DenseHessian() const;
+
+    /**
+     * @brief Triplets of both triangles of H.
+     */
+    std::vector<SparseTriple<double>> FullHessianTriples() const;
+
+    Eigen::MatrixXd DenseConstraintMatrix() const;
+
+    /**
+     * @brief 0.5 x'Hx + g'x
+     */
+    double Objective(const Eigen::VectorXd& x) const;
+
+    /**
+     * @brief max over rows of the distance of Ax to [lb, ub].
+     */
+    double ConstraintViolation(const Eigen::VectorXd& x) const;
+
+private:
+
+    template<typename Derived>
+    static void AppendDense(std::vector<SparseTriple<double>>& triples, const Eigen::MatrixBase<Derived>& mat, bool upper)
+    {
+        for (u32 c = 0; c < (u32)mat.cols(); ++c) {
+            u32 rows = upper ? c + 1 : (u32)mat.rows();
+            for (u32 r = 0; r < rows; ++r) {
+                if (mat(r, c) != 0) {
+                    triples.push_back({double(mat(r, c)), r, c});
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Append one snapshot to a binary stream.
+ * Layout, host byte order: magic "QPSN", version, source, sequence, timestamp, n, m, nnz(H), nnz(A), gaitSteps,
+ * then H triplets, g, A triplets, lb, ub and the gait flags. Triplets are {f64 value, u32 row, u32 col}.
+ * @return false if the stream failed.
+ */
+bool WriteQpSnapshot(std::ostream& out, const qrQpSnapshot& snapshot);
+
+/**
+ * @brief Read the next snapshot of a binary stream.
+ * Counts and dimensions are checked against the bytes left in the stream before anything is allocated.
+ * @return false at the end of the stream or on a malformed record.
+ */
+bool ReadQpSnapshot(std::istream& in, qrQpSnapshot& snapshot);
+
+/**
+ * @brief Process wide sink for QP snapshots. The solver call sites check IsEnabled() first,
+ * so that a disabled recorder costs one atomic load per solve.
+ * Recording starts with the first use if the environment variable QR_QP_SNAPSHOT names a file.
+ * QR_QP_SNAPSHOT_SOURCES (a QpSnapshotSource mask, default all) and QR_QP_SNAPSHOT_DECIMATION (default 1)
+ * give the other arguments of Open().
+ */
+class qrQpSnapshotRecorder {
+
+public:
+
+    static qrQpSnapshotRecorder& Instance();
+
+    /**
+     * @brief Start recording into a file, truncating it.
+     * @param path snapshot file.
+     * @param sources bit mask of QpSnapshotSource.
+     * @param decimation record one in every decimation solves of each source.
+     * @return false if the file could not be opened.
+     */
+    bool Open(const std::string& path, u32 sources = QP_SNAPSHOT_ALL, u32 decimation = 1);
+
+    void Close();
+
+    /**
+     * @brief Whether the next solve of this source should be recorded. Counts the solve for decimation.
+     */
+    bool IsEnabled(QpSnapshotSource source);
+
+    /**
+     * @brief Write a snapshot, thread safe.
+     */
+    void Record(qrQpSnapshot& snapshot);
+
+    /**
+     * @brief number of snapshots written since Open().
+     */
+    u64 GetCount() const
+    {
+        return count;
+    }
+
+private:
+
+    /**
+     * @brief Opens the file named by QR_QP_SNAPSHOT, if set.
+     */
+    qrQpSnapshotRecorder();
+
+    ~qrQpSnapshotRecorder();
+
+    std::mutex fileMutex;
+
+    std::ofstream file;
+
+    std::atomic<u32> sourceMask{0};
+
+    u32 decimation = 1;
+
+    std::atomic<u32> solveCounters[3] = {{0}, {0}, {0}};
+
+    u64 count = 0;
+};
+
+#endif // QR_QP_SNAPSHOT_H
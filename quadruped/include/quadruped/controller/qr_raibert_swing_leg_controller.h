@@ -25,12 +25,48 @@
 #ifndef QR_SWING_LEG_CONTROLLER_H
 #define QR_SWING_LEG_CONTROLLER_H
 
+#include <memory>
+#include "common/qr_config_watcher.h"
 #include "robots/qr_motor.h"
 #include "planner/qr_gait_generator.h"
 #include "state_estimator/qr_robot_estimator.h"
 #include "state_estimator/qr_ground_estimator.h"
 #include "planner/qr_foothold_planner.h"
 #include "controller/qr_foot_trajectory_generator.h"
+#include "controller/qr_swing_trajectory.h"
+
+/**
+ * @brief swing_leg_controller.yaml, parsed once and reloaded by qrConfigWatcher.
+ */
+struct qrSwingLegParams {
+
+    /**
+     * @brief the initial footholds in position mode.
+     */
+    Eigen::Matrix<float, 3, 4> footInWorld;
+
+    /**
+     * @brief how far FR and RR start behind foot_in_world in position mode.
+     */
+    float footOffset;
+
+    /**
+     * @brief effective mass of the leg at the foot (foot_mass, optional), scales the
+     * Jacobian-transpose feedforward torque of the swing acceleration and gravity. 0 disables it.
+     */
+    float footMass = 0.2f;
+
+    /**
+     * @brief height of the swing apex above the higher of the liftoff and touchdown points (foot_clearance, optional).
+     */
+    float footClearance = 0.1f;
+
+    void Load(const YAML::Node &node);
+
+    void Validate() const;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
 
 /**
  * @brief Control swing leg of robot
@@ -68,45 +104,20 @@ public:
     ~qrSwingLegController() = default;
 
     /**
-     * @brief Quadratic interpolation function, used to generate polygon curve.
-     * @param phase specifies the given phase in [0, 1] to compute the trajectory.
-     * @param start specifies the foot's position at the beginning of swing cycle.
-     * @param mid
-     * @param end specifies the foot's desired position at the end of swing cycle.
-     * @return a float value with phase
-     */
-    float GenParabola(float phase, float start, float mid, float end);
-
-    /**
-     * @brief Generating the trajectory of the swing leg
-     * @param inputPhase
-     * @param startPos
-     * @param endPos
-     * @return foot position like (x,y,z)
-     */
-    Eigen::Matrix<float, 3, 1> GenSwingFootTrajectory(float inputPhase,
-                                                        Eigen::Matrix<float, 3, 1> startPos,
-                                                        Eigen::Matrix<float, 3, 1> endPos);
-
-    /**
-     * @brief The process of velocity locomotion.
+     * @brief The process of velocity locomotion, moves the touchdown point of the swing
+     * to Raibert's foothold in base frame. At liftoff Raibert's foothold is the nominal of the
+     * foothold optimizer, the swing then keeps the optimizer's correction on top of Raibert's feedback.
      * @param dR Represent base frame in control frame.
-     * @param footPositionInBaseFrame The the foot position in base frame.
      * @param legId The id of processing leg.
      */
-    void VelocityLocomotionProcess(const Eigen::Matrix<float, 3, 3> &dR, 
-                                    Eigen::Matrix<float, 3, 1> &footPositionInBaseFrame, 
-                                    int legId);
+    void VelocityLocomotionProcess(const Eigen::Matrix<float, 3, 3> &dR, int legId);
 
     /**
-     * @brief The process of position locomotion.
-     * @param footPositionInWorldFrame The the foot position in world frame.
-     * @param footPositionInBaseFrame The the foot position in base frame.
+     * @brief The process of position locomotion, moves the touchdown point of the swing
+     * to the planned foothold in world frame.
      * @param legId The id of processing leg.
      */
-    void PositionLocomotionProcess(Eigen::Matrix<float, 3, 1> &footPositionInWorldFrame, 
-                                    Eigen::Matrix<float, 3, 1> &footPositionInBaseFrame, 
-                                    int legId);
+    void PositionLocomotionProcess(int legId);
 
 
     /**
@@ -199,26 +210,37 @@ public:
      */
     Eigen::Matrix<float, 3, 4> footHoldInWorldFrame;
 
+    /**
+     * @brief Velocity mode: whether the foothold of the leg is still to be optimized, set at liftoff.
+     */
+    bool footholdPending[4];
+
+    /**
+     * @brief Velocity mode: the optimized foothold minus Raibert's foothold at liftoff, in world frame.
+     */
+    Eigen::Matrix<float, 3, 4> footholdCorrection;
+
     /**
      * @brief The trajectories of each leg.
      */
     qrSwingFootTrajectory swingFootTrajectories[4];
 
-
     /**
-     * @brief The config file path of swing_leg_controller.yaml.
+     * @brief The swing trajectories of all legs, started at liftoff and evaluated together.
+     * They are in base frame in velocity mode and in world frame in position mode.
      */
-    YAML::Node swingLegConfig;
+    qrSwingTrajectories swingTrajectories;
 
     /**
-     * @brief the initial foot pose in position mode.
+     * @brief The feedforward torques of the swing legs, by motor id.
      */
-    std::vector<std::vector<float>> footInitPose;
+    Eigen::Matrix<float, 12, 1> swingFeedforwardTorques;
+
 
     /**
-     * @brief the foot offset.
+     * @brief swing_leg_controller.yaml parsed at construction.
      */
-    float footOffset;
+    std::unique_ptr<qrConfig<qrSwingLegParams>> params;
 };
 
 #endif //QR_SWING_LEG_CONTROLLER_H
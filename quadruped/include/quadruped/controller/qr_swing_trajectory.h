@@ -0,0 +1,92 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_SWING_TRAJECTORY_H
+#define QR_SWING_TRAJECTORY_H
+
+#include "common/qr_eigen_types.h"
+#include "common/qr_simd.h"
+
+/**
+ * @brief Swing foot trajectories of the four legs, evaluated together with one leg per SIMD lane.
+ * The foot moves in xy from the liftoff point to the target along the timing law
+ * s(phase) = 38.6 phase^3 - 119.6 phase^4 + 148.2 phase^5 - 85 phase^6 + 18.8 phase^7, which covers
+ * 80% of the step in the first half of the swing without overshooting the target. It starts and ends
+ * with zero velocity and acceleration, so the acceleration is continuous at liftoff and touchdown.
+ * z follows the parabola in s through the liftoff height, the apex and the target height.
+ * Position, velocity and acceleration are closed-form; the coefficients change only at liftoff
+ * and when the target moves.
+ */
+class qrSwingTrajectories {
+public:
+
+    qrSwingTrajectories();
+
+    /**
+     * @brief Start the swing of a leg.
+     * @param legId the leg that lifts off.
+     * @param start the foot position at liftoff.
+     * @param target the foot position at touchdown.
+     * @param duration the swing duration in seconds.
+     */
+    void Start(int legId, const Vec3<float> &start, const Vec3<float> &target, float duration);
+
+    /**
+     * @brief Move the touchdown point of a swinging leg, e.g. Raibert's foothold recomputed every tick.
+     */
+    void SetTarget(int legId, const Vec3<float> &target);
+
+    /**
+     * @brief Evaluate the trajectories of all legs, in the frame of the start and target points.
+     * @param phase the normalized swing phase of each leg, clamped to [0, 1].
+     * @param position output, one column per leg.
+     * @param velocity output, the time derivative of position.
+     * @param acceleration output, the second time derivative of position.
+     */
+    void Evaluate(const Vec4<float> &phase,
+                  Eigen::Matrix<float, 3, 4> &position,
+                  Eigen::Matrix<float, 3, 4> &velocity,
+                  Eigen::Matrix<float, 3, 4> &acceleration) const;
+
+    /**
+     * @brief How high the apex is above the higher of the liftoff and touchdown points.
+     */
+    float clearance = 0.1f;
+
+private:
+
+    /**
+     * @brief xy of the liftoff point and the step, one lane per leg.
+     */
+    Vec4<float> startX, startY, stepX, stepY;
+
+    /**
+     * @brief z = zC + s * (zB + s * zA).
+     */
+    Vec4<float> zA, zB, zC;
+
+    Vec4<float> inverseDuration;
+};
+
+#endif // QR_SWING_TRAJECTORY_H
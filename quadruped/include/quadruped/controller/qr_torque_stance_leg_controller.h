@@ -25,6 +25,8 @@
 #ifndef QR_STANCE_LEG_CONTROLLER_H
 #define QR_STANCE_LEG_CONTROLLER_H
 
+#include <memory>
+#include "common/qr_config_watcher.h"
 #include "common/qr_se3.h"
 #include "robots/qr_robot.h"
 #include "planner/qr_gait_generator.h"
@@ -34,6 +36,49 @@
 #include "planner/qr_foothold_planner.h"
 
 
+/**
+ * @brief The gains of one locomotion mode in stance_leg_controller.yaml.
+ */
+struct qrStanceModeParams {
+
+    /**
+     * @brief false if the file has no entry for the mode.
+     */
+    bool loaded = false;
+
+    Eigen::Matrix<float, 6, 1> KP;
+
+    Eigen::Matrix<float, 6, 1> KD;
+
+    Eigen::Matrix<float, 6, 1> maxDdq;
+
+    Eigen::Matrix<float, 6, 1> minDdq;
+
+    Eigen::Matrix<float, 6, 1> accWeight;
+
+    /**
+     * @brief The state weights of the MPC, empty if the mode has none.
+     */
+    std::vector<float> Q;
+};
+
+/**
+ * @brief stance_leg_controller.yaml, parsed once and reloaded by qrConfigWatcher.
+ */
+struct qrStanceLegParams {
+
+    int forceDim;
+
+    /**
+     * @brief indexed by LocomotionMode.
+     */
+    qrStanceModeParams modes[4];
+
+    void Load(const YAML::Node &node);
+
+    void Validate() const;
+};
+
 /**
  * @brief Control stance leg of robot
  */
@@ -96,9 +141,16 @@ public:
     /**
      * @brief Reset the parameters of the qrStanceLegController.
      * @param currentTime Current run time
+     * @throw std::runtime_error if the config has no gains for the locomotion mode.
      */
     void Reset(float currentTime);
 
+    /**
+     * @brief Copy the gains of the current locomotion mode from the config snapshot.
+     * @return false if the snapshot has no gains for the mode, the previous ones stay.
+     */
+    bool ApplyParams();
+
     /**
      * @brief update the ratio of the friction force to robot gravity
      * @param contacts Vec4<bool>&,  descripte the contact status of four feet
@@ -108,7 +160,7 @@ public:
     void UpdateFRatio(Vec4<bool> &contacts, int &N, float &normalizedPhase);
 
     /**
-     * @brief Update the parameters of the qrStanceLegController.
+     * @brief Update the parameters of the qrStanceLegController, takes over reloaded gains.
      * @param currentTime Current run time
      */
     void Update(float currentTime);
@@ -224,6 +276,16 @@ public:
      */
     std::string configFilepath;
 
+    /**
+     * @brief stance_leg_controller.yaml parsed at construction.
+     */
+    std::unique_ptr<qrConfig<qrStanceLegParams>> params;
+
+    /**
+     * @brief The version of params the gains below were copied from.
+     */
+    u32 paramsVersion = 0;
+
     /**
      * @brief The dimension of force.
      */
@@ -25,66 +25,178 @@
 #ifndef QR_WHOLE_BODY_CONTROL_HPP
 #define QR_WHOLE_BODY_CONTROL_HPP
 
-#include "controller/wbc/qr_contact_spec.hpp"
-#include "controller/wbc/qr_task.hpp"
-
-// Assume first 6 (or 3 in 2D case) joints are for the representation of
-// a floating base.
-
-// #define WB WBC<T>
-
-// template <typename T>
-// class WBC {
-// public:
-//     WBC(size_t num_qdot) : num_act_joint_(num_qdot - 6), num_qdot_(num_qdot) {
-//         Sa_ = DMat<T>::Zero(num_act_joint_, num_qdot_);
-//         Sv_ = DMat<T>::Zero(6, num_qdot_);
-
-//         Sa_.block(0, 6, num_act_joint_, num_act_joint_).setIdentity();
-//         Sv_.block(0, 0, 6, 6).setIdentity();
-//     }
-//     virtual ~WBC() {}
-
-//     /**
-//      * @brief UpdateSetting interface method
-//      */
-//     virtual void UpdateSetting(const DMat<T>& A, const DMat<T>& Ainv,
-//                                 const DVec<T>& cori, const DVec<T>& grav,
-//                                 void* extra_setting = NULL) = 0;
-
-//     /**
-//      * @brief MakeTorque interface method
-//      */
-//     virtual void MakeTorque(DVec<T>& cmd, void* extra_input = NULL, 
-//         ControlFSMData<T>* controlFSMData=NULL) {printf("not implement!\n");}
-
-// protected:
-
-//     /**
-//      * @brief full rank fat matrix only
-//      */
-//     void _WeightedInverse(const DMat<T>& J, const DMat<T>& Winv, DMat<T>& Jinv,
-//                             double threshold = 0.0001) {
-//         DMat<T> temp(Winv * J.transpose());
-//         DMat<T> lambda(J * temp);
-//         DMat<T> lambda_inv;
-//         pseudoInverse(lambda, threshold, lambda_inv);
-//         Jinv.noalias() = temp * lambda_inv;
-//     }
-
-//     size_t num_act_joint_; // 12
-//     size_t num_qdot_; // 18
-
-//     DMat<T> Sa_;  // Actuated joint
-//     DMat<T> Sv_;  // Virtual joint
-
-//     DMat<T> A_;
-//     DMat<T> Ainv_;
-//     DVec<T> cori_;
-//     DVec<T> grav_;
-
-//     bool b_updatesetting_;
-//     bool b_internal_constraint_;
-// };
-
-#endif // QR_WHOLE_BODY_CONTROL_HPP
\ No newline at end of file
+#include <Eigen/Dense>
+
+#include "common/qr_se3.h"
+#include "dynamics/qr_fixed_floating_base_model.hpp"
+
+/**
+ * @brief A task of the whole body controllers: Dim rows of a task Jacobian on the generalized velocity
+ *        [body angular velocity, body linear velocity, joint velocities] of the floating base model
+ *        and the targets of these rows. The storage has MaxDim rows, so changing the dimension of a
+ *        task never allocates.
+ */
+template<typename T, int NDof = 18, int MaxDim = NDof - 6>
+class qrWbcTask {
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef Eigen::Matrix<T, Eigen::Dynamic, NDof, 0, MaxDim, NDof> Jacobian;
+
+    typedef Eigen::Matrix<T, Eigen::Dynamic, 1, 0, MaxDim, 1> Vector;
+
+    qrWbcTask() : dim(0) {}
+
+    /**
+     * @brief Set the number of rows, must not exceed MaxDim.
+     */
+    void Resize(int taskDim)
+    {
+        dim = taskDim;
+        Jt.resize(dim, NDof);
+        JtDotQdot.resize(dim);
+        posErr.resize(dim);
+        velDes.resize(dim);
+        accCmd.resize(dim);
+    }
+
+    /**
+     * @brief Orientation of the body in the world frame. The error is the so(3) vector of oriDes * ori^-1
+     *        and the velocities are angular velocities in the world frame.
+     * @attention the kinematics of the model must be up to date, as for all task updates.
+     */
+    template<int NJoints, int NContacts>
+    void UpdateBodyOri(const FixedFloatingBaseModel<T, NJoints, NContacts>& model, const Quat<T>& oriDes,
+                       const Vec3<T>& omegaDes, const Vec3<T>& accDes, T kp, T kd)
+    {
+        const Quat<T>& ori = model._state.bodyOrientation;
+        Mat3<T> Rot = math::quaternionToRotationMatrix(ori);
+        Resize(3);
+        Jt.setZero();
+        Jt.template block<3, 3>(0, 0) = Rot.transpose();
+        // the world angular velocity R' * omega has no bias acceleration
+        JtDotQdot.setZero();
+
+        Quat<T> oriErr = math::quatProduct(oriDes, math::quatInverse(ori));
+        if (oriErr[0] < 0) {
+            oriErr *= T(-1);
+        }
+        Vec3<T> omega = Rot.transpose() * model._state.bodyVelocity.template head<3>();
+        posErr = math::quatToso3(oriErr);
+        velDes = omegaDes;
+        accCmd = accDes + kp * posErr + kd * (omegaDes - omega);
+    }
+
+    /**
+     * @brief Position of the body origin in the world frame.
+     */
+    template<int NJoints, int NContacts>
+    void UpdateBodyPos(const FixedFloatingBaseModel<T, NJoints, NContacts>& model, const Vec3<T>& pDes,
+                       const Vec3<T>& vDes, const Vec3<T>& accDes, T kp, T kd)
+    {
+        Mat3<T> Rot = math::quaternionToRotationMatrix(model._state.bodyOrientation);
+        const SVec<T>& vBody = model._state.bodyVelocity;
+        Resize(3);
+        Jt.setZero();
+        Jt.template block<3, 3>(0, 3) = Rot.transpose();
+        // the body velocity is spatial, the classical acceleration adds omega x v
+        Vec3<T> omega = vBody.template head<3>();
+        Vec3<T> v = vBody.template tail<3>();
+        JtDotQdot = Rot.transpose() * omega.cross(v);
+
+        Vec3<T> vel = Rot.transpose() * v;
+        posErr = pDes - model._state.bodyPosition;
+        velDes = vDes;
+        accCmd = accDes + kp * posErr + kd * (vDes - vel);
+    }
+
+    /**
+     * @brief Position of a ground contact point (a foot) in the world frame.
+     * @attention contactJacobians() of the model must be up to date.
+     */
+    template<int NJoints, int NContacts>
+    void UpdateLinkPos(const FixedFloatingBaseModel<T, NJoints, NContacts>& model, int contactId,
+                       const Vec3<T>& pDes, const Vec3<T>& vDes, const Vec3<T>& accDes, T kp, T kd)
+    {
+        Resize(3);
+        Jt = model._Jc[contactId];
+        JtDotQdot = model._Jcdqd[contactId];
+        posErr = pDes - model._pGC[contactId];
+        velDes = vDes;
+        accCmd = accDes + kp * posErr + kd * (vDes - model._vGC[contactId]);
+    }
+
+    /**
+     * @brief Positions of all joints.
+     */
+    template<int NJoints, int NContacts>
+    void UpdateJPos(const FixedFloatingBaseModel<T, NJoints, NContacts>& model,
+                    const Eigen::Matrix<T, NJoints, 1>& qDes, const Eigen::Matrix<T, NJoints, 1>& qdDes,
+                    const Eigen::Matrix<T, NJoints, 1>& qddDes, T kp, T kd)
+    {
+        Resize(NJoints);
+        Jt.setZero();
+        Jt.template rightCols<NJoints>().setIdentity();
+        JtDotQdot.setZero();
+        posErr = qDes - model._state.q;
+        velDes = qdDes;
+        accCmd = qddDes + kp * posErr + kd * (qdDes - model._state.qd);
+    }
+
+    /**
+     * @brief Rows set at the current update.
+     */
+    int dim;
+
+    /**
+     * @brief the task Jacobian and its time derivative times the generalized velocity.
+     */
+    Jacobian Jt;
+    Vector JtDotQdot;
+
+    /**
+     * @brief position error and desired velocity, used by the kinematic WBC.
+     */
+    Vector posErr;
+    Vector velDes;
+
+    /**
+     * @brief commanded task acceleration, accDes + Kp * posErr + Kd * velErr, used by the WBIC.
+     */
+    Vector accCmd;
+};
+
+namespace wbc {
+
+/**
+ * @brief Dynamically consistent pseudo inverse Jbar = Winv J' (J Winv J')^+. The inverse of the symmetric
+ *        J Winv J' drops eigenvalues below threshold, so a rank deficient J gives a minimum norm solution.
+ *        All matrices have fixed maximum sizes, so there is no heap allocation.
+ */
+template<typename T, int NDof, int MaxDim>
+void WeightedInverse(const Eigen::Matrix<T, Eigen::Dynamic, NDof, 0, MaxDim, NDof>& J,
+                     const Eigen::Matrix<T, NDof, NDof>& Winv,
+                     Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, MaxDim>& Jbar,
+                     T threshold = T(0.0001))
+{
+    typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, 0, MaxDim, MaxDim> Lambda;
+    Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, MaxDim> WinvJt;
+    WinvJt.noalias() = Winv * J.transpose();
+    Lambda lambda;
+    lambda.noalias() = J * WinvJt;
+
+    Eigen::SelfAdjointEigenSolver<Lambda> eigen(lambda);
+    Eigen::Matrix<T, Eigen::Dynamic, 1, 0, MaxDim, 1> inverseValues(lambda.rows());
+    for (int i = 0; i < lambda.rows(); ++i) {
+        T value = eigen.eigenvalues()[i];
+        inverseValues[i] = value > threshold ? T(1) / value : T(0);
+    }
+    Lambda lambdaInv;
+    lambdaInv.noalias() = eigen.eigenvectors() * inverseValues.asDiagonal() * eigen.eigenvectors().transpose();
+    Jbar.noalias() = WinvJt * lambdaInv;
+}
+
+} // namespace wbc
+
+#endif // QR_WHOLE_BODY_CONTROL_HPP
@@ -25,95 +25,178 @@
 #ifndef QR_WHOLE_BODY_IMPLUSE_CONTROL_HPP
 #define QR_WHOLE_BODY_IMPLUSE_CONTROL_HPP
 
-#include "quadprogpp/QuadProg++.hh"
-#include "quadprogpp/Array.hh"
-
+#include "controller/qr_active_set_qp.h"
 #include "controller/wbc/qr_WBC.hpp"
 
+/**
+ * @brief Whole body impulse control (Kim et al., 2019). The reaction forces of the MPC are the
+ *        reference of the contact forces; the task accelerations are resolved by null-space projection
+ *        in the order of priority, starting in the null space of the stance contacts, and a relaxation
+ *        QP changes the floating base acceleration and the reaction forces as little as possible to
+ *        make the floating base dynamics consistent and the forces stay in the friction cones:
+ *            min 0.5 delta' Wf delta + 0.5 df' Wr df
+ *            s.t. A_fb (qdd + delta) + b_fb + g_fb = Jc_fb' (Fr + df),   Uf (Fr + df) >= ieq
+ *        The 6 equalities are eliminated with the (invertible) base block of the mass matrix, leaving a
+ *        QP in the 3 * NContacts force deltas, solved by qrActiveSetQp. The forces of swing legs are kept
+ *        at zero by the cost and their constraints are inactive, so the QP has the same size every tick.
+ *        All storage is fixed size: MakeTorque does not allocate.
+ */
+template<typename T, int NJoints = 12, int NContacts = 4>
+class qrWBIC {
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    static constexpr int NDof = NJoints + 6;
+
+    static constexpr int NForces = 3 * NContacts;
+
+    typedef FixedFloatingBaseModel<T, NJoints, NContacts> Model;
+
+    typedef qrWbcTask<T, NDof> Task;
+
+    typedef Eigen::Matrix<T, NDof, NDof> MassMatrix;
+
+    typedef Eigen::Matrix<T, NDof, 1> GeneralizedForce;
+
+    typedef Eigen::Matrix<T, NJoints, 1> JointVector;
+
+    typedef Eigen::Matrix<T, 3, NContacts> ForceMatrix;
+
+    /**
+     * @brief constructor
+     * @param model: the floating base model with NContacts ground contact points, the feet.
+     */
+    qrWBIC(Model& model);
+
+    /**
+     * @brief Compute the joint torques of one tick.
+     *        The state of the model must be set; the task Jacobians must be computed on this state.
+     * @param contactState: whether each contact point is in stance.
+     * @param forcesDes: the desired reaction forces of the ground on the feet in the world frame,
+     *                   e.g. the MPC solution. Columns of swing legs are ignored.
+     * @param tasks: the tasks in the order of priority, the highest first.
+     * @param taskCount: the number of tasks.
+     * @return false if the relaxation QP has no solution; the torques are then those of the
+     *         projected accelerations without relaxation.
+     */
+    bool MakeTorque(const Eigen::Matrix<bool, NContacts, 1>& contactState, const ForceMatrix& forcesDes,
+                    const Task* tasks, int taskCount);
+
+    /**
+     * @brief Feedforward torques of the joints computed by the last MakeTorque.
+     */
+    const JointVector& GetTorque() const
+    {
+        return tau;
+    }
+
+    /**
+     * @brief Generalized accelerations after the relaxation.
+     */
+    const GeneralizedForce& GetQdd() const
+    {
+        return qdd;
+    }
+
+    /**
+     * @brief Reaction forces after the relaxation, in the world frame.
+     */
+    const ForceMatrix& GetReactionForces() const
+    {
+        return forces;
+    }
+
+    void SetFloatingBaseWeight(T weight)
+    {
+        wFloating.setConstant(weight);
+    }
+
+    void SetReactionForceWeight(T weight)
+    {
+        wForce.setConstant(weight);
+    }
+
+    void SetFrictionCoefficient(T mu)
+    {
+        frictionCoeff = mu;
+    }
+
+    void SetMaxNormalForce(T fz)
+    {
+        maxFz = fz;
+    }
+
+private:
+
+    typedef Eigen::Matrix<T, Eigen::Dynamic, NDof, 0, NForces, NDof> ContactJacobian;
+
+    typedef Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, NForces> ContactJacobianInverse;
+
+    typedef Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, NDof - 6> TaskJacobianInverse;
+
+    typedef qrActiveSetQp<NForces, 6 * NContacts> Qp;
+
+    /**
+     * @brief Stack the Jacobians of the stance contacts and project into their null space.
+     */
+    void ContactBuilding(const Eigen::Matrix<bool, NContacts, 1>& contactState);
+
+    /**
+     * @brief Build and solve the relaxation QP, then add its solution to qdd and forces.
+     */
+    bool SolveRelaxation(const Eigen::Matrix<bool, NContacts, 1>& contactState, const ForceMatrix& forcesDes);
+
+    Model& model;
+
+    T frictionCoeff;
+
+    T maxFz;
 
-// template <typename T>
-// class WBIC_ExtraData {
-// public:
-//     // Output
-//     DVec<T> _opt_result;
-//     DVec<T> _qddot;
-//     DVec<T> _Fr;
+    Eigen::Matrix<T, 6, 1> wFloating;
 
-//     // Input
-//     DVec<T> _W_floating;
-//     DVec<T> _W_rf;
+    Eigen::Matrix<T, NForces, 1> wForce;
 
-//     WBIC_ExtraData() {}
-//     ~WBIC_ExtraData() {}
-//     };
+    MassMatrix Ainv;
 
-//     template <typename T>
-//     class WBIC : public WBC<T> {
-//     public:
-//     WBIC(size_t num_qdot, const std::vector<qrContactSpec<T>*>* contact_list,
-//         const std::vector<Task<T>*>* task_list);
-//     virtual ~WBIC() {}
+    Eigen::LLT<MassMatrix> llt;
 
-//     virtual void UpdateSetting(const DMat<T>& A, const DMat<T>& Ainv,
-//                                 const DVec<T>& cori, const DVec<T>& grav,
-//                                 void* extra_setting = NULL);
+    /**
+     * @brief projector into the null space of the contacts and of the tasks processed so far.
+     */
+    MassMatrix Npre;
 
-//     virtual void MakeTorque(DVec<T>& cmd, void* extra_input = NULL);
+    ContactJacobian Jc;
 
-// private:
-//     const std::vector<qrContactSpec<T>*>* _contact_list;
-//     const std::vector<Task<T>*>* _task_list;
+    Eigen::Matrix<T, Eigen::Dynamic, 1, 0, NForces, 1> JcDotQdot;
 
-//     void _SetEqualityConstraint(const DVec<T>& qddot);
-//     void _SetInEqualityConstraint();
-//     void _ContactBuilding();
+    ContactJacobianInverse JcBar;
 
-//     void _GetSolution(const DVec<T>& qddot, DVec<T>& cmd);
-//     void _SetCost();
-//     void _SetOptimizationSize();
+    typename Task::Jacobian JtPre;
 
-//     size_t _dim_opt;      // Contact pt delta, First task delta, reaction force
-//     size_t _dim_eq_cstr;  // equality constraints
+    TaskJacobianInverse JtBar;
 
-//     size_t _dim_rf;  // inequality constraints
-//     size_t _dim_Uf;
+    typename Task::Vector taskErr;
 
-//     size_t _dim_floating;
+    GeneralizedForce qdd;
 
-//     WBIC_ExtraData<T>* _data;
+    ForceMatrix forces;
 
-//     quadprogpp::Vector<double> z;
-//     // Cost
-//     quadprogpp::Matrix<double> G;
-//     quadprogpp::Vector<double> g0;
+    JointVector tau;
 
-//     // Equality
-//     quadprogpp::Matrix<double> CE;
-//     quadprogpp::Vector<double> ce0;
+    Qp qp;
 
-//     // Inequality
-//     quadprogpp::Matrix<double> CI;
-//     quadprogpp::Vector<double> ci0;
+    typename Qp::MatNN G;
 
-//     DMat<T> _dyn_CE;
-//     DVec<T> _dyn_ce0;
-//     DMat<T> _dyn_CI;
-//     DVec<T> _dyn_ci0;
+    typename Qp::VecN a;
 
-//     DMat<T> _eye;
-//     DMat<T> _eye_floating;
+    typename Qp::MatNM C;
 
-//     DMat<T> _S_delta;
-//     DMat<T> _Uf;
-//     DVec<T> _Uf_ieq_vec;
+    typename Qp::VecM b;
 
-//     DMat<T> _Jc;
-//     DVec<T> _JcDotQdot;
-//     DVec<T> _Fr_des;
+    typename Qp::VecN df;
+};
 
-//     DMat<T> _B;
-//     DVec<T> _c;
-//     DVec<T> task_cmd_;
-// };
+typedef qrWBIC<float> qrQuadrupedWBIC;
 
-#endif //QR_WHOLE_BODY_IMPLUSE_CONTROL_HPP
\ No newline at end of file
+#endif //QR_WHOLE_BODY_IMPLUSE_CONTROL_HPP
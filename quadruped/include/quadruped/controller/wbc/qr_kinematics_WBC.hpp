@@ -25,41 +25,124 @@
 #ifndef QR_KINEMATICS_WHOLE_BODY_CONTROL_HPP
 #define QR_KINEMATICS_WHOLE_BODY_CONTROL_HPP
 
-// #include "controller/wbc/qr_contact_spec.hpp"
-// #include "controller/wbc/qr_task.hpp"
-
-// template <typename T>
-// class KinWBC {
-// public:
-//     KinWBC(size_t num_qdot);
-//     ~KinWBC() {}
-
-//     /**
-//      * @brief 
-//      */
-//     bool FindConfiguration(const DVec<T>& curr_config,
-//                             const std::vector<Task<T>*>& task_list,
-//                             const std::vector<qrContactSpec<T>*>& contact_list,
-//                             DVec<T>& jpos_cmd, DVec<T>& jvel_cmd, ControlFSMData<T>* controlFSMData);
-
-//     DMat<T> Ainv_;
-
-// private:
-
-//     /**
-//      * @brief 
-//      */
-//     void _PseudoInverse(const DMat<T>& J, DMat<T>& Jinv);
-    
-//     /**
-//      * @brief 
-//      */
-//     void _BuildProjectionMatrix(const DMat<T>& J, DMat<T>& N);
-
-//     double threshold_;
-//     size_t num_qdot_;
-//     size_t num_act_joint_;
-//     DMat<T> I_mtx;
-// };
-
-#endif // QR_KINEMATICS_WHOLE_BODY_CONTROL_HPP
\ No newline at end of file
+#include <array>
+
+#include "controller/wbc/qr_WBC.hpp"
+
+/**
+ * @brief Kinematic whole body control: resolves the position errors and desired velocities of a task stack
+ *        into joint position and velocity commands by successive null-space projection, starting in the
+ *        null space of the stance contacts.
+ *        The projectors and the pseudo inverses of every priority level are cached with the Jacobians they
+ *        were computed from. A call recomputes them from the first level whose Jacobian (or contact set)
+ *        changed; when only the targets of the tasks change, a call is a few matrix-vector products.
+ *        All storage is fixed size.
+ * @tparam MaxTasks the capacity of the task stack.
+ */
+template<typename T, int NJoints = 12, int NContacts = 4, int MaxTasks = 6>
+class qrKinWBC {
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    static constexpr int NDof = NJoints + 6;
+
+    typedef FixedFloatingBaseModel<T, NJoints, NContacts> Model;
+
+    typedef qrWbcTask<T, NDof> Task;
+
+    typedef Eigen::Matrix<T, NDof, NDof> MassMatrix;
+
+    typedef Eigen::Matrix<T, NJoints, 1> JointVector;
+
+    /**
+     * @brief constructor
+     * @param model: the floating base model, its contact Jacobians must be up to date when a
+     *               configuration is computed.
+     */
+    qrKinWBC(Model& model);
+
+    /**
+     * @brief Set the weight of the pseudo inverses. The identity (default) gives the minimum norm
+     *        solutions, the inverse of the mass matrix the dynamically consistent ones.
+     */
+    void SetWeight(const MassMatrix& weightInverse);
+
+    /**
+     * @brief Compute the joint commands of the task stack.
+     * @param contactState: whether each contact point is in stance.
+     * @param tasks: the tasks in the order of priority, the highest first.
+     * @param taskCount: the number of tasks, at most MaxTasks.
+     * @param jposCmd: the joint positions, the current ones plus the joint part of the correction.
+     * @param jvelCmd: the joint velocities.
+     * @return false if there are more than MaxTasks tasks.
+     */
+    bool FindConfiguration(const Eigen::Matrix<bool, NContacts, 1>& contactState, const Task* tasks, int taskCount,
+                           JointVector& jposCmd, JointVector& jvelCmd);
+
+    /**
+     * @brief Number of priority levels (the contacts count as one) recomputed by the last call.
+     */
+    int GetRecomputedLevels() const
+    {
+        return recomputedLevels;
+    }
+
+private:
+
+    typedef Eigen::Matrix<T, Eigen::Dynamic, NDof, 0, 3 * NContacts, NDof> ContactJacobian;
+
+    typedef Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, 3 * NContacts> ContactJacobianInverse;
+
+    typedef Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, NDof - 6> TaskJacobianInverse;
+
+    /**
+     * @brief Update the contact projector if the contact Jacobian changed.
+     * @return whether it was recomputed.
+     */
+    bool UpdateContactProjector(const Eigen::Matrix<bool, NContacts, 1>& contactState);
+
+    /**
+     * @brief The projector into the null space of the contacts and the tasks before level i.
+     */
+    const MassMatrix& ProjectorBefore(int i) const
+    {
+        return i == 0 ? Nc : N[i - 1];
+    }
+
+    Model& model;
+
+    MassMatrix Winv;
+
+    ContactJacobian Jc;
+
+    Eigen::Matrix<bool, NContacts, 1> cachedContactState;
+
+    bool contactValid;
+
+    MassMatrix Nc;
+
+    /**
+     * @brief per priority level: the Jacobian of the cache, the projected Jacobian Jt Npre and its
+     *        pseudo inverse, and the projector into the null space of this level and the levels before.
+     */
+    std::array<typename Task::Jacobian, MaxTasks> cachedJt;
+
+    std::array<typename Task::Jacobian, MaxTasks> JtPre;
+
+    std::array<TaskJacobianInverse, MaxTasks> JtPreBar;
+
+    std::array<MassMatrix, MaxTasks> N;
+
+    int validLevels;
+
+    int recomputedLevels;
+
+    Eigen::Matrix<T, NDof, 1> deltaQ, qdot;
+
+    typename Task::Vector error;
+};
+
+typedef qrKinWBC<float> qrQuadrupedKinWBC;
+
+#endif // QR_KINEMATICS_WHOLE_BODY_CONTROL_HPP
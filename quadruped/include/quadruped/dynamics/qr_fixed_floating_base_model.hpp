@@ -0,0 +1,293 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/**
+ *  @file qr_fixed_floating_base_model.hpp
+ *  @brief Floating base rigid body model whose size is a compile time constant.
+ *
+ * The same tree, rotor model and algorithms as FloatingBaseModel, but the number of bodies is a
+ * template parameter. All per-body quantities are std::array members and all system matrices
+ * (mass matrix, bias forces, contact Jacobians) are fixed size Eigen matrices, so adding bodies is
+ * the only operation that touches the bookkeeping and no algorithm allocates memory. The loops run
+ * over compile time bounds, which lets the compiler unroll them. Spatial transforms are kept as
+ * PluckerTransform, a rotation and a translation, so the sweeps never multiply generic 6x6 matrices.
+ *
+ * As in FloatingBaseModel, bodies 0 to 4 are placeholders, body 5 is the floating base and the
+ * NJoints bodies connected by 1 DoF joints follow, so body indices and generalized coordinates of
+ * the two models are the same.
+ */
+
+#ifndef QR_FIXED_FLOATING_BASE_MODEL_HPP
+#define QR_FIXED_FLOATING_BASE_MODEL_HPP
+
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#include "dynamics/qr_spatial.hpp"
+
+/**
+ * @brief The state of a fixed size floating base model (base and joints)
+ */
+template <typename T, int NJoints>
+struct FixedFBModelState {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Quat<T> bodyOrientation;
+    Vec3<T> bodyPosition;
+    SVec<T> bodyVelocity;  // body coordinates
+    Eigen::Matrix<T, NJoints, 1> q;
+    Eigen::Matrix<T, NJoints, 1> qd;
+};
+
+/**
+ * @brief The result of running the articulated body algorithm on a fixed size model
+ */
+template <typename T, int NJoints>
+struct FixedFBModelStateDerivative {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Vec3<T> dBodyPosition;
+    SVec<T> dBodyVelocity;
+    Eigen::Matrix<T, NJoints, 1> qdd;
+};
+
+/**
+ * @brief Floating base rigid body model with rotors and NContacts ground contact points, whose
+ *        sizes are compile time constants. No concept of state.
+ * @tparam NJoints number of bodies connected by a joint, 12 for a quadruped
+ * @tparam NContacts capacity of ground contact points
+ */
+template <typename T, int NJoints, int NContacts = 4>
+class FixedFloatingBaseModel {
+
+    public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    /**
+     * @brief number of generalized coordinates, the 6 of the floating base and one per joint
+     */
+    static constexpr int NDof = NJoints + 6;
+
+    typedef FixedFBModelState<T, NJoints> State;
+
+    typedef FixedFBModelStateDerivative<T, NJoints> StateDerivative;
+
+    typedef Eigen::Matrix<T, NDof, NDof> MassMatrix;
+
+    typedef Eigen::Matrix<T, NDof, 1> GeneralizedForce;
+
+    typedef Eigen::Matrix<T, NJoints, 1> JointVector;
+
+    typedef Eigen::Matrix<T, 3, NDof> ContactJacobian;
+
+    /**
+     * @brief Initialize a floating base model with default gravity
+     */
+    FixedFloatingBaseModel() : _gravity(0, 0, -9.81) {}
+
+    /**
+     * @brief Create the floating body, must be called once before any body is added
+     * @param inertia Spatial inertia of the floating body
+     */
+    void addBase(const SpatialInertia<T>& inertia);
+
+    /**
+     * @brief Create the floating body
+     * @param mass Mass of the floating body
+     * @param com  Center of mass of the floating body
+     * @param I    Rotational inertia of the floating body
+     */
+    void addBase(T mass, const Vec3<T>& com, const Mat3<T>& I);
+
+    /**
+     * @brief Add a body, see FloatingBaseModel::addBody. Bodies must be added after their parent.
+     * @return The body's ID (can be used as the parent)
+     */
+    int addBody(const SpatialInertia<T>& inertia,
+                const SpatialInertia<T>& rotorInertia, T gearRatio, int parent,
+                JointType jointType, CoordinateAxis jointAxis,
+                const Mat6<T>& Xtree, const Mat6<T>& Xrot);
+
+    /**
+     * @brief Add a ground contact point to a model
+     * @param bodyID The ID of the body containing the contact point
+     * @param location The location (in body coordinate) of the contact point
+     * @return The ID of the ground contact point
+     */
+    int addGroundContactPoint(int bodyID, const Vec3<T>& location);
+
+    /**
+     * @brief Throw if fewer than NJoints bodies have been added
+     */
+    void check() const;
+
+    /**
+     * @brief Set the gravity
+     */
+    void setGravity(const Vec3<T>& g) { _gravity = g; }
+
+    /**
+     * @brief Update the state, invalidating previous results
+     * @param state : the new state
+     */
+    void setState(const State& state) {
+        _state = state;
+        _biasAccelerationsUpToDate = false;
+        _compositeInertiasUpToDate = false;
+        _articulatedBodiesUpToDate = false;
+        _kinematicsUpToDate = false;
+        _accelerationsUpToDate = false;
+    }
+
+    /**
+     * @brief Update the state derivative, invalidating previous results.
+     * @param dState : the new state derivative
+     */
+    void setDState(const StateDerivative& dState) {
+        _dState = dState;
+        _accelerationsUpToDate = false;
+    }
+
+    /**
+     * @brief Forward kinematics of all bodies, see FloatingBaseModel::forwardKinematics
+     */
+    void forwardKinematics();
+
+    /**
+     * @brief Velocity product accelerations of each link and rotor _avp, and _avprot
+     */
+    void biasAccelerations();
+
+    /**
+     * @brief Composite rigid body inertia of each subtree _IC
+     */
+    void compositeInertias();
+
+    void forwardAccelerationKinematics();
+
+    /**
+     * @brief Contact Jacobians (3 x NDof) for the velocity of each contact point in absolute coordinates
+     */
+    void contactJacobians();
+
+    /**
+     * @brief Generalized gravitational force (G) in the inverse dynamics, a tip to base sweep that
+     *        does not need the composite inertias
+     */
+    const GeneralizedForce& generalizedGravityForce();
+
+    /**
+     * @brief Generalized coriolis forces (Cqd) in the inverse dynamics
+     */
+    const GeneralizedForce& generalizedCoriolisForce();
+
+    /**
+     * @brief Mass Matrix (H) in the inverse dynamics formulation
+     */
+    const MassMatrix& massMatrix();
+
+    /**
+     * @brief Inverse dynamics of the system. The first six entries give the external wrench on the
+     *        base, the remaining ones the joint torques
+     */
+    const GeneralizedForce& inverseDynamics(const StateDerivative& dState);
+
+    /**
+     * @brief Articulated body algorithm, forward dynamics with joint torques tau
+     */
+    void runABA(const JointVector& tau, StateDerivative& dstate);
+
+    Vec3<T> getPosition(const int link_idx, const Vec3<T>& local_pos);
+    Vec3<T> getPosition(const int link_idx);
+    Mat3<T> getOrientation(const int link_idx);
+    Vec3<T> getLinearVelocity(const int link_idx, const Vec3<T>& point);
+    Vec3<T> getLinearVelocity(const int link_idx);
+
+    const MassMatrix& getMassMatrix() const { return _H; }
+    const GeneralizedForce& getGravityForce() const { return _G; }
+    const GeneralizedForce& getCoriolisForce() const { return _Cqd; }
+
+    /**
+     * @brief Set all external forces to zero
+     */
+    void resetExternalForces() {
+        for (int i = 0; i < NDof; i++) {
+            _externalForces[i] = SVec<T>::Zero();
+        }
+    }
+
+    int _nDof = 0;
+    int _nGroundContact = 0;
+    Vec3<T> _gravity;
+
+    std::array<int, NDof> _parents;
+    std::array<T, NDof> _gearRatios;
+    std::array<T, NDof> _d, _u;
+    std::array<JointType, NDof> _jointTypes;
+    std::array<CoordinateAxis, NDof> _jointAxes;
+    std::array<PluckerTransform<T>, NDof> _Xtree, _Xrot;
+    std::array<SpatialInertia<T>, NDof> _Ibody, _Irot;
+
+    std::array<int, NContacts> _gcParent;
+    std::array<Vec3<T>, NContacts> _gcLocation;
+    std::array<Vec3<T>, NContacts> _pGC;
+    std::array<Vec3<T>, NContacts> _vGC;
+
+    State _state;
+    StateDerivative _dState;
+
+    std::array<SVec<T>, NDof> _v, _vrot, _a, _arot, _avp, _avprot, _c, _crot, _S,
+        _Srot, _fvp, _fvprot, _ag, _agrot, _f, _frot;
+    std::array<SVec<T>, NDof> _U, _Urot, _Utot, _pA, _pArot;
+    std::array<SVec<T>, NDof> _externalForces;
+    std::array<SpatialInertia<T>, NDof> _IC;
+    std::array<PluckerTransform<T>, NDof> _Xup, _Xa, _Xuprot;
+    std::array<Mat6<T>, NDof> _IA;
+
+    MassMatrix _H;
+    GeneralizedForce _Cqd, _G, _genForce;
+
+    std::array<ContactJacobian, NContacts> _Jc;
+    std::array<Vec3<T>, NContacts> _Jcdqd;
+
+    bool _kinematicsUpToDate = false;
+    bool _biasAccelerationsUpToDate = false;
+    bool _accelerationsUpToDate = false;
+    bool _compositeInertiasUpToDate = false;
+    bool _articulatedBodiesUpToDate = false;
+
+    /**
+     * @brief Support function for the ABA
+     */
+    void updateArticulatedBodies();
+
+    Eigen::LDLT<Mat6<T>> _invIA5;
+};
+
+/**
+ * @brief The fixed size model of a quadruped with 3 joints per leg and a contact point per foot
+ */
+template <typename T>
+using FixedQuadrupedModel = FixedFloatingBaseModel<T, 12, 4>;
+
+#endif // QR_FIXED_FLOATING_BASE_MODEL_HPP
@@ -379,6 +379,31 @@ class FloatingBaseModel {
     DVec<T> inverseDynamics(const FBModelStateDerivative<T>& dState);
     void runABA(const DVec<T>& tau, FBModelStateDerivative<T>& dstate);
 
+    /**
+     * @brief Computes the partial derivatives of inverseDynamics(dState) at the current state.
+     * The derivative with respect to each coordinate is propagated through the RNEA recursion,
+     * a joint coordinate only changes its subtree and the path back to the base.
+     * Columns of dtau_dq are the tangent [base rotation; base translation; q], both base
+     * parts in body coordinates, columns of dtau_dv are [bodyVelocity; qd]. The derivative
+     * with respect to [dBodyVelocity; qdd] is the mass matrix. External forces are ignored.
+     * @param dtau_dq : output, _nDof x _nDof
+     * @param dtau_dv : output, _nDof x _nDof
+     */
+    void inverseDynamicsDerivatives(const FBModelStateDerivative<T>& dState,
+                                    DMat<T>& dtau_dq, DMat<T>& dtau_dv);
+
+    /**
+     * @brief Computes the partial derivatives of the accelerations [dBodyVelocity; qdd] of
+     * runABA(tau), -H^{-1} times the inverse dynamics derivatives at the resulting accelerations.
+     * External forces are ignored.
+     * @param dstate : output, the result of runABA(tau)
+     * @param dqdd_dq : output, _nDof x _nDof, columns as in inverseDynamicsDerivatives
+     * @param dqdd_dv : output, _nDof x _nDof
+     * @param dqdd_dtau : output, _nDof x (_nDof - 6)
+     */
+    void forwardDynamicsDerivatives(const DVec<T>& tau, FBModelStateDerivative<T>& dstate,
+                                    DMat<T>& dqdd_dq, DMat<T>& dqdd_dv, DMat<T>& dqdd_dtau);
+
     size_t _nDof = 0;
     Vec3<T> _gravity;
     std::vector<int> _parents;
@@ -451,6 +476,17 @@ class FloatingBaseModel {
      */
     void updateArticulatedBodies();
 
+    /**
+     * @brief Support function for inverseDynamicsDerivatives. Propagates the derivatives of the
+     * velocity and acceleration of body j and its rotor through the subtree of j, and the
+     * resulting force derivatives back to the base, into column col of out.
+     * @param dF : derivative of the force body j transmits to its parent, not caused by the
+     *             derivatives of its subtree (the derivative of the joint transform)
+     */
+    void propagateDynamicsDerivative(size_t j, const SVec<T>& dv, const SVec<T>& dvrot,
+                                     const SVec<T>& da, const SVec<T>& darot, const SVec<T>& dF,
+                                     DMat<T>& out, size_t col);
+
     /**
      * @brief Support function for contact inertia algorithms
      *        Comptues force propagators across each joint
@@ -494,6 +530,9 @@ class FloatingBaseModel {
      */
     bool _qddEffectsUpToDate = false;
 
+    vectorAligned<SVec<T>> _dv, _dvrot, _da, _darot, _df, _dfrot;
+    std::vector<char> _inSubtree;
+
     DMat<T> _qdd_from_base_accel;
     DMat<T> _qdd_from_subqdd;
     Eigen::ColPivHouseholderQR<Mat6<T>> _invIA5;
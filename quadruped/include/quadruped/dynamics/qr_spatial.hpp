@@ -223,6 +223,103 @@ SXform<typename T::Scalar> invertSXform(const Eigen::MatrixBase<T> &X)
     return Xinv;
 }
 
+/**
+* @brief The spatial transform createSXform(E, r) kept as its rotation E and translation r.
+* Applying it to a spatial vector takes 24 multiplications instead of 36, composing two
+* transforms 36 instead of 216 and transforming an inertia about half of the 432 of X^T I X.
+*/
+template<typename T>
+struct PluckerTransform {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Mat3<T> E;
+    Vec3<T> r;
+
+    PluckerTransform() : E(Mat3<T>::Identity()), r(Vec3<T>::Zero()) {}
+
+    PluckerTransform(const Mat3<T> &E_, const Vec3<T> &r_) : E(E_), r(r_) {}
+
+    /**
+    * @brief From a 6x6 spatial transform
+    */
+    explicit PluckerTransform(const Mat6<T> &X)
+        : E(X.template topLeftCorner<3, 3>()),
+          r(-matToSkewVec(E.transpose() * X.template bottomLeftCorner<3, 3>())) {}
+
+    Mat6<T> toMatrix() const { return createSXform(E, r); }
+
+    /**
+    * @brief X * v for a motion vector v
+    */
+    SVec<T> apply(const SVec<T> &v) const
+    {
+        SVec<T> Xv;
+        Xv.template head<3>() = E * v.template head<3>();
+        Xv.template tail<3>() = E * (v.template tail<3>() - r.cross(v.template head<3>()));
+        return Xv;
+    }
+
+    /**
+    * @brief X^T * f for a force vector f
+    */
+    SVec<T> applyTranspose(const SVec<T> &f) const
+    {
+        SVec<T> XTf;
+        XTf.template tail<3>() = E.transpose() * f.template tail<3>();
+        XTf.template head<3>() = E.transpose() * f.template head<3>() + r.cross(XTf.template tail<3>());
+        return XTf;
+    }
+
+    /**
+    * @brief The transform this * X, X is applied first
+    */
+    PluckerTransform operator*(const PluckerTransform &X) const
+    {
+        return PluckerTransform(E * X.E, X.r + X.E.transpose() * r);
+    }
+
+    PluckerTransform inverse() const { return PluckerTransform(E.transpose(), -E * r); }
+
+    /**
+    * @brief X^T * I * X for a symmetric 6x6 inertia I
+    */
+    Mat6<T> congruence(const Mat6<T> &I) const
+    {
+        // rotate the blocks, then shift by r: A - B rx - (B rx)^T - rx C rx, B + rx C, C
+        const Mat3<T> A = E.transpose() * I.template topLeftCorner<3, 3>() * E;
+        const Mat3<T> B = E.transpose() * I.template topRightCorner<3, 3>() * E;
+        const Mat3<T> C = E.transpose() * I.template bottomRightCorner<3, 3>() * E;
+        const Mat3<T> rx = vectorToSkewMat(r);
+        const Mat3<T> Brx = B * rx;
+        const Mat3<T> rxC = rx * C;
+        Mat6<T> XTIX;
+        XTIX.template topLeftCorner<3, 3>() = A - Brx - Brx.transpose() - rxC * rx;
+        XTIX.template topRightCorner<3, 3>() = B + rxC;
+        XTIX.template bottomLeftCorner<3, 3>() = (B + rxC).transpose();
+        XTIX.template bottomRightCorner<3, 3>() = C;
+        return XTIX;
+    }
+
+    /**
+    * @brief X^T * I * X for a rigid body inertia I = [Ibar skew(h); skew(h)^T m*1], as congruence
+    * but only Ibar is rotated as a matrix
+    */
+    Mat6<T> rigidCongruence(const Mat6<T> &I) const
+    {
+        const T m = I(5, 5);
+        const Vec3<T> h = E.transpose() * matToSkewVec(I.template topRightCorner<3, 3>());
+        const Mat3<T> hr = h * r.transpose();
+        Mat3<T> Ibar = E.transpose() * I.template topLeftCorner<3, 3>() * E - hr - hr.transpose() -
+                       m * r * r.transpose();
+        Ibar.diagonal().array() += 2 * h.dot(r) + m * r.squaredNorm();
+        Mat6<T> XTIX;
+        XTIX.template topLeftCorner<3, 3>() = Ibar;
+        XTIX.template topRightCorner<3, 3>() = vectorToSkewMat(Vec3<T>(h + m * r));
+        XTIX.template bottomLeftCorner<3, 3>() = XTIX.template topRightCorner<3, 3>().transpose();
+        XTIX.template bottomRightCorner<3, 3>() = m * Mat3<T>::Identity();
+        return XTIX;
+    }
+};
+
 /**
 * @brief Compute joint motion subspace vector
 */
@@ -36,6 +36,8 @@
 #include "planner/qr_foothold_planner.h"
 #include "action/qr_action.h"
 #include "ros/qr_vel_param_receiver.h"
+#include "ros/qr_point_cloud_receiver.h"
+#include "ros/qr_ground_truth_receiver.h"
 #include "robots/qr_robot_sim.h"
 #include "state_estimator/qr_robot_estimator.h"
 
@@ -0,0 +1,119 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_FOOTHOLD_OPTIMIZER_H_
+#define QR_FOOTHOLD_OPTIMIZER_H_
+
+#include <yaml-cpp/yaml.h>
+
+#include "common/qr_eigen_types.h"
+#include "state_estimator/qr_elevation_map.h"
+
+/**
+ * @brief The weights and limits of the foothold cost. The weights turn every term into
+ *        the same unit, a candidate 1/sqrt(stepWeight) metres off the nominal costs 1.
+ */
+struct qrFootholdOptimizerParameters {
+
+    /**
+     * @brief the candidates are the cells at most this many cells away from the nominal cell.
+     */
+    int searchRadius = 5;
+
+    /**
+     * @brief weight of the squared horizontal distance to the nominal foothold, in 1/m^2.
+     */
+    float stepWeight = 400.f;
+
+    /**
+     * @brief weight of the squared terrain gradient.
+     */
+    float slopeWeight = 4.f;
+
+    /**
+     * @brief weight of the largest height jump within two cells, in 1/m.
+     */
+    float edgeWeight = 20.f;
+
+    /**
+     * @brief weight of the squared deviation of the hip to foot distance from the nominal one, in 1/m^2.
+     */
+    float reachWeight = 100.f;
+
+    /**
+     * @brief cells next to a height jump larger than this are too close to an edge, in m.
+     */
+    float maxEdge = 0.04f;
+
+    /**
+     * @brief cells with a steeper gradient are infeasible.
+     */
+    float maxSlope = 0.6f;
+
+    /**
+     * @brief the feasible hip to foot distances, in m.
+     */
+    float minLegLength = 0.12f;
+    float maxLegLength = 0.36f;
+
+    /**
+     * @brief Overwrite the parameters that the node contains.
+     * @param node: e.g. the foothold_optimizer node of terrain.yaml.
+     */
+    void Load(const YAML::Node &node);
+};
+
+/**
+ * @brief Chooses the foothold of a swing leg on the elevation map. Every cell around the nominal
+ *        foothold is scored by its distance to the nominal, the terrain slope, the height jumps
+ *        near it and the hip to foot distance, four cells at a time, and the cheapest feasible
+ *        cell wins. Unknown cells and cells next to unknown ones are infeasible.
+ */
+class qrFootholdOptimizer {
+
+public:
+
+    qrFootholdOptimizer() = default;
+
+    explicit qrFootholdOptimizer(const qrFootholdOptimizerParameters &parametersIn);
+
+    /**
+     * @brief Find the best foothold of one leg, does not allocate.
+     * @param map: the elevation map snapshot in world frame.
+     * @param nominal: the nominal foothold in world frame, e.g. from the Raibert heuristic.
+     * @param hip: the position of the hip at touchdown in world frame.
+     * @param nominalLegLength: the preferred hip to foot distance.
+     * @param foothold: the best foothold with the map height as z, untouched if none is feasible.
+     * @return whether a feasible cell was found.
+     */
+    bool Optimize(const qrElevationMapSnapshot &map,
+                  const Vec3<float> &nominal,
+                  const Vec3<float> &hip,
+                  float nominalLegLength,
+                  Vec3<float> &foothold) const;
+
+    qrFootholdOptimizerParameters parameters;
+};
+
+#endif // QR_FOOTHOLD_OPTIMIZER_H_
@@ -28,6 +28,7 @@
 
 
 #include "planner/qr_foot_stepper.h"
+#include "planner/qr_foothold_optimizer.h"
 
 /**
  * @brief plan the foothold fpr next swing stage.
@@ -53,9 +54,32 @@ public:
 
     /**
     * @brief only be called at the moment right before lift up legs.
+    *        The footholds are chosen on the elevation map, the scripted foot stepper
+    *        is only used while the map knows nothing around the legs.
     */
     void UpdateOnce(Eigen::Matrix<float, 3, 4> currentFootholds, std::vector<int> legIds={});
 
+    /**
+     * @brief choose the footholds of legIds on the elevation map of the ground estimator,
+     *        around the nominal footholds one default step ahead of the current ones.
+     * @param currentFootholds current foot-end position of all the leg in world frame
+     * @param legIds the legs to plan for
+     * @return whether any leg found a feasible foothold, the others keep the nominal one
+     */
+    bool ComputeOptimizedFootholds(const Eigen::Matrix<float, 3, 4>& currentFootholds,
+                                   const std::vector<int>& legIds);
+
+    /**
+     * @brief choose the foothold of one leg on the elevation map around a given nominal foothold.
+     * @param legId the leg to plan for
+     * @param nominal the nominal foothold in world frame, e.g. Raibert's foothold
+     * @param baseDisplacement how far the base moves in world frame until touchdown
+     * @param foothold output, the best foothold in world frame, the nominal one if none is feasible
+     * @return whether a feasible foothold was found
+     */
+    bool OptimizeFoothold(int legId, const Vec3<float>& nominal, const Vec3<float>& baseDisplacement,
+                          Vec3<float>& foothold);
+
     /**
      * @brief compute desired foot-end position in walk mode
      * @param currentFootholds current foot-end position of all the leg
@@ -126,6 +150,11 @@ public:
      */
     qrFootStepper *footstepper;
 
+    /**
+     * @brief scores the candidate footholds on the elevation map.
+     */
+    qrFootholdOptimizer footholdOptimizer;
+
     /**
      * @brief current time from robot when call the reset fuction
      * 
@@ -171,4 +200,4 @@ public:
     Eigen::Matrix<float, 3, 4> desiredFootholds;
 };
 
-#endif //QR_FOOTHOLD_PLANNER_H_
\ No newline at end of file
+#endif //QR_FOOTHOLD_PLANNER_H_
\ No newline at end of file
@@ -26,13 +26,56 @@
 #define QR_GAIT_GENERATOR_H
 
 #include <math.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <vector>
+#include "common/qr_config_watcher.h"
 #include "common/qr_enums.h"
+#include "planner/qr_gait_library.h"
 #include "robots/qr_robot.h"
 
+/**
+ * @brief One gait of openloop_gait_generator.yaml.
+ */
+struct qrGaitParam {
+
+    Eigen::Matrix<float, 4, 1> stanceDuration;
+
+    Eigen::Matrix<float, 4, 1> dutyFactor;
+
+    Eigen::Matrix<int, 4, 1> initialLegState;
+
+    Eigen::Matrix<float, 4, 1> initialLegPhase;
+
+    float contactDetectionPhaseThreshold;
+};
+
+/**
+ * @brief openloop_gait_generator.yaml, parsed once and reloaded by qrConfigWatcher.
+ */
+struct qrGaitParams {
+
+    /**
+     * @brief The gait to start with.
+     */
+    std::string gait;
+
+    std::map<std::string, qrGaitParam, std::less<std::string>,
+             Eigen::aligned_allocator<std::pair<const std::string, qrGaitParam>>> gaits;
+
+    void Load(const YAML::Node &node);
+
+    void Validate() const;
+};
+
 /**
  * @brief The qrGaitGenerator class generates the corresponding gait 
  * uisng the defined gait parameters. This class also resets and updates these parameters regularly.
+ * All gaits are compiled into a qrGaitLibrary when they are loaded or received,
+ * a gait switch then waits for an instant where the new gait continues the phases of the legs
+ * and only copies a descriptor.
  */
 
 class qrGaitGenerator {
@@ -81,16 +124,39 @@ public:
     virtual void Update(float currentTime);
 
     /**
-    * @brief Use gait type to create gait.
-    * @param gaitType
+    * @brief Switch to a gait of the library at once, without waiting for a phase-consistent instant.
+    * This is meant for the start, in the control loop set nextGaitType or call RequestGait instead.
+    * @param gaitType, an unknown gait is reported and the current one kept.
     */
     virtual void CreateGait(std::string gaitType);
 
     /**
-    * @brief change gait
+    * @brief Hand a change of nextGaitType to the transition engine.
     */
     virtual void ModifyGait();
 
+    /**
+    * @brief Ask for a switch to a gait of the library. It happens in a later Update,
+    * at the first instant where no leg jumps in its stance or swing.
+    * @param index index of the gait in gaitLibrary, indices stay valid so any thread may call this.
+    */
+    void RequestGait(int index);
+
+    /**
+    * @brief Hand a gait compiled on another thread to the control loop, it enters the library in the next Update.
+    * A gait posted before the previous one was taken replaces it, a gait that does not fit into the library is dropped.
+    * @param gait the compiled gait, a gait with the name of a gait in the library replaces it.
+    * @param switchTo whether to switch to the gait once it is in the library.
+    */
+    void PostGait(const qrGaitDescriptor &gait, bool switchTo);
+
+    /**
+    * @brief Compile all gaits of the gait file into the library, called at start and after the file was edited.
+    * An edit of the running gait is applied through a transition as well.
+    * @param params the parsed gait file.
+    */
+    void LoadGaits(const qrGaitParams &params);
+
     /** 
      * @brief qrRobot object.
      */
@@ -102,9 +168,9 @@ public:
     std::string configFilePath;
 
     /**
-    * @brief The yaml object for loading a yaml config file.
+    * @brief The gait parameters parsed from the config file, null if the gait was given directly.
     */
-    YAML::Node config;
+    std::shared_ptr<qrConfig<qrGaitParams>> config;
 
     /**
     * @brief the amount of stance time for each leg in a gait cycle.
@@ -196,12 +262,76 @@ public:
     std::string curGaitType;
 
     /**
-    * @brief next gait type
-    *
+    * @brief next gait type, set it to request a gait switch by name.
+    * @note ModifyGait hands the request over and sets it back to curGaitType until the switch happened.
     */
     std::string nextGaitType;
 
     Eigen::Matrix<float, 4, 1> phaseInFullCycle;
+
+    /**
+    * @brief All gaits that can be switched to.
+    * @note Only the control loop modifies the library, other threads use PostGait.
+    */
+    qrGaitLibrary gaitLibrary;
+
+    /**
+    * @brief How far a leg may jump within its stance or swing when the gait switches,
+    * as a fraction of the stance or swing.
+    */
+    float switchTolerance = 0.1f;
+
+private:
+    /**
+    * @brief Take the gaits of a reloaded gait file or of PostGait into the library, never blocks.
+    */
+    void TakeGaits();
+
+    /**
+    * @brief Switch to the requested gait if this is an instant where it continues the running gait.
+    * @param currentTime the given time.
+    */
+    void Transition(float currentTime);
+
+    /**
+    * @brief Copy a gait of the library into the generator.
+    * @param index index of the gait in gaitLibrary.
+    * @param timeShift the gait time is currentTime + timeShift.
+    */
+    void ApplyGait(int index, float timeShift);
+
+    /**
+    * @brief A copy of the running gait, so the library may replace it while it runs.
+    */
+    qrGaitDescriptor activeGait;
+
+    int gaitIndex = -1;
+
+    float gaitTimeShift = 0.f;
+
+    /**
+    * @brief Whether the library holds a newer version of the running gait.
+    */
+    bool activeGaitOutdated = false;
+
+    std::atomic<int> requestedGait{-1};
+
+    /**
+    * @brief The gait the transition engine waits to switch to, and since when it waits.
+    */
+    int transitionTarget = -1;
+
+    float transitionStart = 0.f;
+
+    u32 configVersion = 0;
+
+    std::mutex postMutex;
+
+    std::atomic<bool> hasPostedGait{false};
+
+    qrGaitDescriptor postedGait;
+
+    bool switchToPostedGait = false;
 };
 
 #endif //QR_GAIT_GENERATOR_H
@@ -0,0 +1,149 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_GAIT_LIBRARY_H
+#define QR_GAIT_LIBRARY_H
+
+#include <array>
+#include <string>
+#include "common/qr_eigen_types.h"
+#include "common/qr_enums.h"
+
+/**
+ * @brief A gait with everything the gait generator derives from its parameters computed in advance.
+ * It has a fixed size, so switching to it is a copy and never allocates.
+ */
+struct qrGaitDescriptor {
+
+    static constexpr int nameLength = 32;
+
+    /**
+     * @brief How often one gait cycle is sampled when looking for an instant to switch into the gait.
+     */
+    static constexpr int phaseSamples = 64;
+
+    char name[nameLength];
+
+    Vec4<float> stanceDuration;
+
+    Vec4<float> swingDuration;
+
+    Vec4<float> dutyFactor;
+
+    Vec4<float> initialLegPhase;
+
+    Vec4<float> fullCyclePeriod;
+
+    Vec4<float> initStateRadioInCycle;
+
+    /**
+     * @brief The initial state of each leg, USERDEFINED_SWING for legs with a duty factor of about 0.
+     */
+    Vec4<int> initialLegState;
+
+    Vec4<int> nextLegState;
+
+    float contactDetectionPhaseThreshold;
+
+    /**
+     * @brief The longest cycle of the legs, the gait time of the samples runs over it.
+     */
+    float referencePeriod;
+
+    /**
+     * @brief Leg state and normalized phase at the gait time k * referencePeriod / phaseSamples.
+     */
+    int sampleState[phaseSamples][4];
+
+    float samplePhase[phaseSamples][4];
+
+    /**
+     * @brief Fill in the descriptor from the gait parameters.
+     * @return false if the name is too long, a stance duration is not positive, a duty factor is outside [0, 1]
+     * or an initial state is neither SWING nor STANCE.
+     */
+    bool Compile(const std::string &gaitName,
+                 const Vec4<float> &stanceDuration,
+                 const Vec4<float> &dutyFactor,
+                 const Vec4<int> &initialLegState,
+                 const Vec4<float> &initialLegPhase,
+                 float contactDetectionPhaseThreshold);
+
+    /**
+     * @brief The desired state of a leg at a gait time.
+     * @param legId the leg to evaluate.
+     * @param gaitTime time since the gait started.
+     * @param phaseInFullCycle output, the fraction of the leg's cycle that passed.
+     * @param normalizedPhase output, the fraction of the current stance or swing that passed.
+     * @return the desired leg state.
+     */
+    int Evaluate(int legId, float gaitTime, float &phaseInFullCycle, float &normalizedPhase) const;
+
+    /**
+     * @brief Find the sample of this gait that continues the legs of a running gait without a jump.
+     * A leg in stance may stay in stance or just start a swing, a swing leg keeps its swing phase
+     * or touches down only when its swing is nearly over.
+     * @param legState the desired leg states of the running gait at this instant.
+     * @param normalizedPhase the normalized phases of the running gait at this instant.
+     * @param tolerance how far a phase may jump, as a fraction of a stance or swing.
+     * @param force return the closest sample even if it is beyond the tolerance.
+     * @return the sample index, or -1 if no sample is within the tolerance.
+     */
+    int FindSwitchSample(const Vec4<int> &legState, const Vec4<float> &normalizedPhase,
+                         float tolerance, bool force) const;
+};
+
+/**
+ * @brief A fixed-size table of compiled gaits, looked up by name off the control loop and used by index in it.
+ */
+class qrGaitLibrary {
+public:
+    static constexpr int capacity = 32;
+
+    /**
+     * @brief Add a gait, or replace the gait with the same name in place.
+     * @return the index of the gait, -1 if the library is full.
+     */
+    int Set(const qrGaitDescriptor &gait);
+
+    /**
+     * @brief The index of a gait, -1 if there is no gait with this name.
+     */
+    int Find(const std::string &name) const;
+
+    const qrGaitDescriptor &Get(int index) const {
+        return gaits[index];
+    };
+
+    int Size() const {
+        return count;
+    };
+
+private:
+    std::array<qrGaitDescriptor, capacity> gaits;
+
+    int count = 0;
+};
+
+#endif // QR_GAIT_LIBRARY_H
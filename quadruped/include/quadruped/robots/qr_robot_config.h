@@ -25,6 +25,7 @@
 #ifndef QR_ROBOT_CONFIG_H
 #define QR_ROBOT_CONFIG_H
 
+#include <array>
 #include <iostream>
 #include <unordered_map>
 #include <yaml-cpp/yaml.h>
@@ -136,6 +137,31 @@ public:
      */
     bool isSim;
 
+    /**
+     * @brief cutoff frequencies of the sensor filter (unit: Hz), 0 leaves the sensor unfiltered
+     */
+    float jointVelocityCutoff = 0.f;
+
+    float imuCutoff = 0.f;
+
+    float footForceCutoff = 0.f;
+
+    /**
+     * @brief whether the state is predicted over the loop latency before the controllers run
+     */
+    bool latencyCompensation = false;
+
+    /**
+     * @brief the latency to predict over (unit: s), a negative value uses the online estimate once it has
+     *        converged and predicts nothing before
+     */
+    float fixedLatency = -1.f;
+
+    /**
+     * @brief upper bound of the prediction horizon (unit: s)
+     */
+    float maxLatency = 0.02f;
+
     /**
      * @brief convert foot position in hip frame to joint angles
      * @param footPosition: position of foot in hip frame
@@ -164,11 +190,19 @@ public:
     AnalyticalLegJacobian(Eigen::Matrix<float, 3, 1> &legAngles, int legId);
 
     /**
-     * @brief calculate foot position in base frame of robot
+     * @brief calculate Jacobians of all 4 legs at once, one leg per SIMD lane
+     * @param motorAngles: angles of 12 motors
+     * @param jacobians: Jacobians of the 4 legs
+     */
+    void AnalyticalLegJacobians(const Eigen::Matrix<float, 12, 1> &motorAngles,
+                                std::array<Eigen::Matrix<float, 3, 3>, 4> &jacobians);
+
+    /**
+     * @brief calculate foot position in base frame of robot, all 4 legs at once, one leg per SIMD lane
      * @param footAngles: joint angles
      * @return foot position in base frame
      */
-    Eigen::Matrix<float, 3, 4> FootPositionsInBaseFrame(Eigen::Matrix<float, 12, 1> footAngles);
+    Eigen::Matrix<float, 3, 4> FootPositionsInBaseFrame(const Eigen::Matrix<float, 12, 1> &footAngles);
 
     /**
      * @brief convert foot position to joint angles
@@ -183,6 +217,13 @@ public:
                                                  Eigen::Matrix<int, 3, 1> &jointIdx,
                                                  Eigen::Matrix<float, 3, 1> &jointAngles);
 
+    /**
+     * @brief convert foot positions of all 4 legs to joint angles at once, one leg per SIMD lane
+     * @param footLocalPositions: foot positions in base frame
+     * @return angles of 12 motors, NaN for a leg whose foot position is out of reach
+     */
+    Eigen::Matrix<float, 12, 1> ComputeMotorAnglesFromFootLocalPositions(const Eigen::Matrix<float, 3, 4> &footLocalPositions);
+
     /**
      * @brief ComputeMotorVelocityFromFootLocalVelocity
      * @param legId: id of leg to compute
@@ -232,5 +273,15 @@ private:
      */
     void LoadHipPosition();
 
+    /**
+     * @brief auxiliary function for loading the cutoff frequencies of the sensor filter
+     */
+    void LoadSensorFilter();
+
+    /**
+     * @brief auxiliary function for loading the latency compensation
+     */
+    void LoadLatencyCompensation();
+
 };
 #endif // QR_ROBOT_CONFIG_H
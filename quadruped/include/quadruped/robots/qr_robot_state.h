@@ -28,6 +28,7 @@
 #include <Eigen/Dense>
 #include "common/qr_se3.h"
 #include "qr_robot_config.h"
+#include "state_estimator/qr_filter.h"
 
 
 /**
@@ -135,6 +136,11 @@ public:
      */
     Eigen::Matrix<float, 12, 1> motorVelocities;
 
+    /**
+     * @brief accelerometer reading in base frame (unit: m/(s2)), filtered by the sensor filter
+     */
+    Eigen::Matrix<float, 3, 1> baseAcceleration;
+
     /**
      * @brief force on foot
      */
@@ -167,7 +173,7 @@ public:
     std::array<qrMotorState, 12> motorState;
 
     /**
-     * @brief update current robot states
+     * @brief update current robot states, the kinematic quantities of the last tick are invalidated
      */
     void Update();
 
@@ -178,24 +184,49 @@ public:
     void SetRobotConfig(qrRobotConfig* config);
 
     /**
-     * @brief get foot positions in base frame
+     * @brief set up the sensor filter with the cutoff frequencies of the config
+     * @param sampleFrequency: frequency of Update (unit: Hz)
+     */
+    void SetSensorFilter(float sampleFrequency);
+
+    /**
+     * @brief replace the observed joint and base states with the ones predicted over the loop latency,
+     *        the kinematic quantities are invalidated
+     * @param predictedMotorAngles: predicted 12 motor angles
+     * @param predictedMotorVelocities: predicted 12 motor velocities
+     * @param predictedOrientation: predicted base orientation in world frame
+     * @param predictedAngularVelocity: predicted angular velocity in base frame
+     */
+    void SetPredictedState(const Eigen::Matrix<float, 12, 1> &predictedMotorAngles,
+                           const Eigen::Matrix<float, 12, 1> &predictedMotorVelocities,
+                           const Eigen::Matrix<float, 4, 1> &predictedOrientation,
+                           const Eigen::Matrix<float, 3, 1> &predictedAngularVelocity);
+
+    /**
+     * @brief get foot positions in base frame, computed once per tick
      * @return foot positions in base frame
      */
-    Eigen::Matrix<float, 3, 4> GetFootPositionsInBaseFrame();
+    const Eigen::Matrix<float, 3, 4>& GetFootPositionsInBaseFrame() const;
 
     /**
      * @brief get foot positions in world frame
      * @return foot positions in world frame
      */
     Eigen::Matrix<float, 3, 4> GetFootPositionsInWorldFrame(
-            bool useInput=false, Vec3<float> basePositionIn={0.f,0.f,0.f}, Quat<float> baseOrientationIn={1.f,0.f,0.f,0.f});
+            bool useInput=false, Vec3<float> basePositionIn={0.f,0.f,0.f}, Quat<float> baseOrientationIn={1.f,0.f,0.f,0.f}) const;
 
     /**
-     * @brief get current jacobian of leg legId
+     * @brief get rotation matrix of the base orientation, from base frame to world frame, computed once per tick
+     * @return the same as math::quaternionToRotationMatrix(baseOrientation).transpose()
+     */
+    const Mat3<float>& GetBaseRotationMatrix() const;
+
+    /**
+     * @brief get current jacobian of leg legId, computed once per tick
      * @param legId: which leg to calculate
      * @return current Jacobian
      */
-    Eigen::Matrix<float, 3, 3> ComputeJacobian(int legId);
+    const Eigen::Matrix<float, 3, 3>& ComputeJacobian(int legId) const;
 
     /**
      * @brief convert contact force of one leg to joint torque
@@ -212,6 +243,44 @@ private:
      * @return calibrated yaw
      */
     float CalibrateYaw();
+
+    /**
+     * @brief filter the joint velocities, the IMU and the foot forces in one call
+     * @param filteredFootForce: foot forces after the filter
+     */
+    void FilterSensors(Eigen::Matrix<float, 4, 1> &filteredFootForce);
+
+    /**
+     * @brief channels of the sensor filter: 12 joint velocities, gyroscope, accelerometer and 4 foot forces
+     */
+    enum SensorChannel {
+        JOINT_VELOCITY = 0,
+        GYROSCOPE = 12,
+        ACCELEROMETER = 15,
+        FOOT_FORCE = 18,
+        SENSOR_CHANNELS = 22
+    };
+
+    qrIIRFilterBank<SENSOR_CHANNELS> sensorFilter;
+
+    bool sensorFilterEnabled = false;
+
+    /**
+     * @brief bits of the kinematic quantities below that are valid for the current motor angles and orientation
+     */
+    enum KinematicsCache {
+        FOOT_POSITIONS = 1,
+        BASE_ROTATION = 2,
+        LEG_JACOBIANS = 4
+    };
+
+    mutable unsigned int validKinematics = 0;
+
+    mutable Eigen::Matrix<float, 3, 4> footPositionsInBaseFrame;
+
+    mutable Mat3<float> baseRotationMatrix;
+
+    mutable std::array<Eigen::Matrix<float, 3, 3>, 4> legJacobians;
 };
 
 #endif // QR_ROBOT_STATE_H
@@ -25,6 +25,7 @@
 #ifndef QR_GAIT_PARAM_RECEIVER_H
 #define QR_GAIT_PARAM_RECEIVER_H
 
+#include <atomic>
 #include <iostream>
 #include <string>
 
@@ -32,6 +33,7 @@
 #include <ros/ros.h>
 #include <unitree_legged_msgs/GaitParameter.h>
 #include "common/qr_eigen_types.h"
+#include "planner/qr_gait_generator.h"
 /**
  * @brief  A qrGaitParamReceiver object receives the gait parameters from ROS topic when a gait updates.
  */
@@ -40,8 +42,10 @@ class qrGaitParamReceiver {
         /**
          * @brief Construct a qrGaitParamReceiver object using a given ROS nodeHandle.
          * @param nhIn specifies the ROS node to communicate
+         * @param gaitGeneratorIn if given, every received gait is compiled on the ROS thread
+         * and handed to this gait generator, which switches to it at a phase-consistent instant.
          */
-        qrGaitParamReceiver(ros::NodeHandle &nhIn);
+        qrGaitParamReceiver(ros::NodeHandle &nhIn, qrGaitGenerator *gaitGeneratorIn = nullptr);
 
         /**
          * @brief Deconstruct a qrGaitParamReceiver object.
@@ -110,7 +114,9 @@ class qrGaitParamReceiver {
         /**
          * @brief Whether the flag parameter has changed
          */
-        bool flag = false;
+        std::atomic<bool> flag{false};
+
+        qrGaitGenerator *gaitGenerator;
 
         std::string gaitName;
         Vec4<float>  stanceDuration;
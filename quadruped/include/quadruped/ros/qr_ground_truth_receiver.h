@@ -0,0 +1,82 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_GROUND_TRUTH_RECEIVER_H
+#define QR_GROUND_TRUTH_RECEIVER_H
+
+#include <string>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <gazebo_msgs/LinkStates.h>
+
+#include "state_estimator/qr_ground_truth.h"
+
+/**
+ * @brief A qrGroundTruthReceiver object follows the base link in the /gazebo/link_states topic
+ *        and publishes its pose to a qrGroundTruth. The subscription has its own callback queue
+ *        and spinner thread, so the measurements keep arriving however busy the other callbacks are
+ *        and the control thread never waits on ROS.
+ */
+class qrGroundTruthReceiver {
+
+public:
+
+    /**
+     * @brief Construct a qrGroundTruthReceiver object and start its spinner thread.
+     * @param nhIn: the ROS node to subscribe with.
+     * @param groundTruthIn: where the measurements go, it must outlive the receiver.
+     * @param linkNameIn: the gazebo name of the base link.
+     */
+    qrGroundTruthReceiver(ros::NodeHandle &nhIn, qrGroundTruth *groundTruthIn, std::string linkNameIn="a1_gazebo::base");
+
+    ~qrGroundTruthReceiver();
+
+    /**
+     * @brief Pick the base link out of the link states and publish it.
+     * @param msg: the link states in world frame.
+     */
+    void LinkStatesCallback(const gazebo_msgs::LinkStates::ConstPtr &msg);
+
+private:
+
+    ros::NodeHandle &nh;
+
+    qrGroundTruth *groundTruth;
+
+    std::string linkName;
+
+    /**
+     * @brief index of the base link in the last message, checked before use since gazebo may reorder the links.
+     */
+    size_t linkIndex = 0;
+
+    ros::CallbackQueue queue;
+
+    ros::Subscriber linkStatesSub;
+
+    ros::AsyncSpinner spinner;
+};
+
+#endif // QR_GROUND_TRUTH_RECEIVER_H
@@ -0,0 +1,89 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_POINT_CLOUD_RECEIVER_H
+#define QR_POINT_CLOUD_RECEIVER_H
+
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf/transform_listener.h>
+
+#include "state_estimator/qr_elevation_map.h"
+
+/**
+ * @brief A qrPointCloudReceiver object hands the depth point clouds of the ROS topics
+ *        listed in the parameter point_cloud_topics to an elevation map. The subscriptions have their own
+ *        callback queue and spinner thread, so copying a cloud never delays the joint state and IMU callbacks.
+ */
+class qrPointCloudReceiver {
+
+public:
+
+    /**
+     * @brief Construct a qrPointCloudReceiver object and start its spinner thread.
+     * @param nhIn: the ROS node to subscribe with.
+     * @param mapIn: the elevation map to fill, it must outlive the receiver.
+     * @param worldFrameIn: the tf frame the elevation map lives in.
+     */
+    qrPointCloudReceiver(ros::NodeHandle &nhIn, qrElevationMap *mapIn, std::string worldFrameIn="odom");
+
+    ~qrPointCloudReceiver();
+
+    /**
+     * @brief Transform a cloud into the world frame and pass its finite points on to the map.
+     * @param msg: the point cloud, x, y and z have to be FLOAT32 fields.
+     */
+    void PointCloudCallback(const sensor_msgs::PointCloud2::ConstPtr &msg);
+
+private:
+
+    ros::NodeHandle &nh;
+
+    qrElevationMap *map;
+
+    std::string worldFrame;
+
+    /**
+     * @brief how long to wait for the transform at the stamp of a cloud, in seconds, the parameter point_cloud_tf_timeout.
+     */
+    double transformTimeout;
+
+    ros::CallbackQueue queue;
+
+    std::vector<ros::Subscriber> pointCloudSubs;
+
+    ros::AsyncSpinner spinner;
+
+    tf::TransformListener tfListener;
+
+    /**
+     * @brief The finite points of the last cloud, packed as x, y, z.
+     */
+    std::vector<float> points;
+};
+
+#endif // QR_POINT_CLOUD_RECEIVER_H
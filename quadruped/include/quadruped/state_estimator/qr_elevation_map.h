@@ -0,0 +1,272 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_ELEVATION_MAP_H
+#define QR_ELEVATION_MAP_H
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/qr_cTypes.h"
+#include "common/qr_eigen_types.h"
+#include "common/qr_triple_buffer.h"
+
+/**
+ * @brief A copy of the elevation map for planners, cells ordered from the corner at origin:
+ *        cell (ix, iy) covers [origin + (ix, iy) * resolution, origin + (ix + 1, iy + 1) * resolution)
+ *        and is stored at ix * size + iy. Unknown cells are NaN.
+ */
+struct qrElevationMapSnapshot {
+
+    int size = 0;
+
+    float resolution = 0.f;
+
+    /**
+     * @brief world frame (x, y) of the corner of cell (0, 0).
+     */
+    Vec2<float> origin = Vec2<float>::Zero();
+
+    std::vector<float> height;
+
+    /**
+     * @brief variance of the height of each cell.
+     */
+    std::vector<float> variance;
+
+    /**
+     * @brief number of the map updates published so far.
+     */
+    u64 sequence = 0;
+
+    /**
+     * @brief index of the cell of a world frame point.
+     * @return false outside of the map.
+     */
+    inline bool GetIndex(float x, float y, int &ix, int &iy) const
+    {
+        ix = int(std::floor((x - origin[0]) / resolution));
+        iy = int(std::floor((y - origin[1]) / resolution));
+        return ix >= 0 && iy >= 0 && ix < size && iy < size;
+    }
+
+    /**
+     * @brief height of the cell of a world frame point, NaN if unknown or outside of the map.
+     */
+    float GetHeight(float x, float y) const;
+};
+
+/**
+ * @brief Robot centric 2.5D elevation map in the world frame.
+ *        The grid is a fixed size ring buffer that scrolls with the base: moving the map only clears the
+ *        rows and columns that leave it, nothing is copied. Cells are fused as one dimensional Kalman
+ *        filters of the height from foot touchdowns and depth point clouds.
+ *
+ *        One background thread owns the grid. The control thread hands over footholds and the base
+ *        position without locking, point clouds are copied in under a mutex by the thread that received
+ *        them, and every update is published into a triple buffer that a single planner thread reads
+ *        without locking.
+ */
+class qrElevationMap {
+
+public:
+    /**
+     * @param size: cells per side.
+     * @param resolution: side of a cell (unit: m).
+     * @param maxPoints: capacity of the point cloud buffer, larger clouds are truncated.
+     */
+    qrElevationMap(int size = 128, float resolution = 0.04f, int maxPoints = 1 << 16);
+
+    ~qrElevationMap();
+
+    /**
+     * @brief Center the map on the base, from the control thread. Does not block.
+     */
+    void SetCenter(const Vec3<float> &basePosition);
+
+    /**
+     * @brief A foot touched down at a world frame position, from the control thread. Does not block,
+     *        footholds beyond the queue capacity are dropped.
+     */
+    void AddFoothold(const Vec3<float> &footPosition);
+
+    /**
+     * @brief Insert a point cloud given in the sensor frame.
+     * @param xyz: count points, 3 floats each.
+     * @param rotation, translation: pose of the sensor in the world frame.
+     * @param variance: variance of the height of one point.
+     */
+    void AddPointCloud(const float *xyz, int count, const Mat3<float> &rotation, const Vec3<float> &translation,
+                       float variance = 4e-4f);
+
+    /**
+     * @brief The newest published map, for one reader thread. The reference stays valid until the next call.
+     */
+    const qrElevationMapSnapshot &GetSnapshot();
+
+    inline int GetSize() const
+    {
+        return size;
+    }
+
+    inline float GetResolution() const
+    {
+        return resolution;
+    }
+
+private:
+    struct Cell {
+        float height;
+        float variance;
+    };
+
+    void Run();
+
+    /**
+     * @brief Move the window to start at global cell (cornerX, cornerY), clearing the cells that leave it.
+     */
+    void Scroll(int cornerX, int cornerY);
+
+    void ClearColumns(int firstGlobalX, int lastGlobalX);
+
+    void ClearRows(int firstGlobalY, int lastGlobalY);
+
+    inline Cell &At(int globalX, int globalY)
+    {
+        return grid[Wrap(globalX) * size + Wrap(globalY)];
+    }
+
+    inline int Wrap(int index) const
+    {
+        const int r = index % size;
+        return r < 0 ? r + size : r;
+    }
+
+    void Fuse(Cell &cell, float height, float variance);
+
+    /**
+     * @brief Transform the pending cloud to the world frame four points at a time, keep the highest point
+     *        of every cell and fuse it.
+     */
+    void InsertPendingCloud();
+
+    void Publish();
+
+    const int size;
+
+    const float resolution;
+
+    const int maxPoints;
+
+    /**
+     * @brief variance of the height under a foot that touched down.
+     */
+    const float footholdVariance = 1e-4f;
+
+    /**
+     * @brief variances never drop below this, so the map keeps following the terrain.
+     */
+    const float minVariance = 1e-5f;
+
+    /**
+     * @brief global index of the corner cell of the window, owned by the worker.
+     */
+    int cornerX = 0;
+
+    int cornerY = 0;
+
+    std::vector<Cell> grid;
+
+    /**
+     * @brief highest point of each cell in the cloud being inserted, and the cells it touched.
+     */
+    std::vector<float> cloudMax;
+
+    std::vector<int> touchedCells;
+
+    /**
+     * @brief target corner from the control thread.
+     */
+    std::atomic<int> targetCornerX;
+
+    std::atomic<int> targetCornerY;
+
+    /**
+     * @brief single producer single consumer queue of footholds.
+     */
+    static constexpr unsigned int footholdCapacity = 64;
+
+    std::array<Vec3<float>, footholdCapacity> footholds;
+
+    std::atomic<unsigned int> footholdHead;
+
+    std::atomic<unsigned int> footholdTail;
+
+    /**
+     * @brief cloud waiting for the worker, and the one it is inserting.
+     */
+    std::mutex cloudMutex;
+
+    std::condition_variable cloudReady;
+
+    std::vector<float> pendingPoints;
+
+    std::vector<float> workingPoints;
+
+    int pendingCount = 0;
+
+    int workingCount = 0;
+
+    Mat3<float> pendingRotation;
+
+    Vec3<float> pendingTranslation;
+
+    float pendingVariance = 4e-4f;
+
+    Mat3<float> workingRotation;
+
+    Vec3<float> workingTranslation;
+
+    float workingVariance = 4e-4f;
+
+    bool hasPendingCloud = false;
+
+    bool stopWorker = false;
+
+    /**
+     * @brief filled by the worker, read by GetSnapshot.
+     */
+    qrTripleBuffer<qrElevationMapSnapshot> snapshots;
+
+    u64 sequence = 0;
+
+    std::thread worker;
+};
+
+#endif // QR_ELEVATION_MAP_H
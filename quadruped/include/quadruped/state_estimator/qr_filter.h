@@ -10,9 +10,11 @@
 #ifndef ASCEND_QUADRUPED_CPP_FILTER_H
 #define ASCEND_QUADRUPED_CPP_FILTER_H
 
-#include <deque>
 #include <cmath>
+#include <vector>
+#include <Eigen/Dense>
 #include "config.h"
+#include "common/qr_simd.h"
 #define Nsta 3 // dimension of state
 #define Mobs 3 // dimension of observation
 
@@ -23,6 +25,9 @@ public:
 
     qrMovingWindowFilter(unsigned int windowSize);
 
+    /** @brief empty the window, the buffer allocated at construction is kept. */
+    void Reset();
+
     /**
      * @brief Update the moving window sum using Neumaier's algorithm.
      *        For more details please refer to:
@@ -44,7 +49,230 @@ private:
     double sum; // The moving window sum.
     // The correction term to compensate numerical precision loss during calculation.
     double correction;
-    std::deque<double> valueDeque;
+    // ring buffer of the window, allocated once
+    std::vector<double> values;
+    unsigned int head;
+    unsigned int count;
+};
+
+/**
+ * @brief Moving window average of N channels that are filtered in lockstep, e.g. the three axes of
+ *        a velocity. The window lives in a ring buffer of capacity Window inside the object, channels
+ *        are padded to a multiple of four and the Neumaier compensated sums run four channels per
+ *        SIMD instruction, so an update costs about the same for one channel as for four and never
+ *        allocates.
+ */
+template<int N, int Window>
+class qrFilterBank {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef Eigen::Matrix<float, N, 1> Vector;
+
+    /**
+     * @param windowSize: number of samples averaged, at most Window.
+     */
+    explicit qrFilterBank(int windowSize = Window)
+    {
+        SetWindowSize(windowSize);
+    }
+
+    void SetWindowSize(int windowSize)
+    {
+        size = windowSize < 1 ? 1 : (windowSize > Window ? Window : windowSize);
+        Reset();
+    }
+
+    void Reset()
+    {
+        for (int i = 0; i < NPadded; ++i) {
+            sum[i] = 0.f;
+            correction[i] = 0.f;
+        }
+        head = 0;
+        count = 0;
+    }
+
+    /**
+     * @brief Push one sample of every channel and compute the averages in O(1) time.
+     * @return the averages, divided by the window size also while the window fills up.
+     */
+    const Vector &CalculateAverage(const Vector &newValue)
+    {
+        alignas(16) float input[NPadded] = {};
+        for (int i = 0; i < N; ++i) {
+            input[i] = newValue[i];
+        }
+        float *slot = buffer[head];
+        const bool full = count >= size;
+        const qrFloat4 scale(1.f / size);
+        alignas(16) float result[NPadded];
+        for (int i = 0; i < NPadded; i += 4) {
+            qrFloat4 s = qrFloat4::Load(sum + i);
+            qrFloat4 c = qrFloat4::Load(correction + i);
+            const qrFloat4 value = qrFloat4::Load(input + i);
+            if (full) {
+                // the oldest value leaves the window
+                NeumaierSum(s, c, -qrFloat4::Load(slot + i));
+            }
+            NeumaierSum(s, c, value);
+            s.Store(sum + i);
+            c.Store(correction + i);
+            value.Store(slot + i);
+            ((s + c) * scale).Store(result + i);
+        }
+        head = head + 1 == size ? 0 : head + 1;
+        count += !full;
+        for (int i = 0; i < N; ++i) {
+            average[i] = result[i];
+        }
+        return average;
+    }
+
+    inline const Vector &GetAverage() const
+    {
+        return average;
+    }
+
+private:
+    static constexpr int NPadded = (N + 3) / 4 * 4;
+
+    /**
+     * @brief Neumaier's step on four channels: the low-order digits lost by the larger of sum and
+     *        value are added to the correction.
+     */
+    static inline void NeumaierSum(qrFloat4 &s, qrFloat4 &c, qrFloat4 value)
+    {
+        const qrFloat4 newSum = s + value;
+        const qrFloat4 valueLarger = simd::abs(s) < simd::abs(value);
+        c = c + simd::select(valueLarger, (value - newSum) + s, (s - newSum) + value);
+        s = newSum;
+    }
+
+    alignas(16) float buffer[Window][NPadded];
+    alignas(16) float sum[NPadded];
+    alignas(16) float correction[NPadded];
+    Vector average = Vector::Zero();
+    int size;
+    int head;
+    int count;
+};
+
+/**
+ * @brief Second order IIR sections on N channels filtered in lockstep, in transposed direct form II:
+ *        y = b0 x + z1, z1 = b1 x - a1 y + z2, z2 = b2 x - a2 y.
+ *        Every channel has its own coefficients, so one bank can hold the joint velocities, the IMU axes
+ *        and the foot forces with a cutoff each, and filter all of them in one call four channels per
+ *        SIMD instruction. First order filters are sections with b2 = a2 = 0. A new bank passes its
+ *        input through unchanged.
+ */
+template<int N>
+class qrIIRFilterBank {
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    typedef Eigen::Matrix<float, N, 1> Vector;
+
+    qrIIRFilterBank()
+    {
+        for (int i = 0; i < NPadded; ++i) {
+            SetCoefficients(i, 1.f, 0.f, 0.f, 0.f, 0.f);
+            z1[i] = 0.f;
+            z2[i] = 0.f;
+        }
+    }
+
+    /** @brief channels [first, first + count) are not filtered. */
+    void SetPassThrough(int first, int count)
+    {
+        for (int i = first; i < first + count; ++i) {
+            SetCoefficients(i, 1.f, 0.f, 0.f, 0.f, 0.f);
+        }
+    }
+
+    /** @brief first order low pass, bilinear transform with the cutoff prewarped. */
+    void SetFirstOrderLowPass(int first, int count, float cutoffFrequency, float sampleFrequency)
+    {
+        const float k = std::tan(float(M_PI) * cutoffFrequency / sampleFrequency);
+        for (int i = first; i < first + count; ++i) {
+            SetCoefficients(i, k / (1.f + k), k / (1.f + k), 0.f, (k - 1.f) / (k + 1.f), 0.f);
+        }
+    }
+
+    /** @brief second order low pass with quality factor q, bilinear transform with the cutoff prewarped. */
+    void SetSecondOrderLowPass(int first, int count, float cutoffFrequency, float sampleFrequency, float q)
+    {
+        const float k = std::tan(float(M_PI) * cutoffFrequency / sampleFrequency);
+        const float norm = 1.f / (1.f + k / q + k * k);
+        const float b0 = k * k * norm;
+        for (int i = first; i < first + count; ++i) {
+            SetCoefficients(i, b0, 2.f * b0, b0, 2.f * (k * k - 1.f) * norm, (1.f - k / q + k * k) * norm);
+        }
+    }
+
+    /** @brief second order Butterworth low pass, maximally flat in the pass band. */
+    void SetButterworthLowPass(int first, int count, float cutoffFrequency, float sampleFrequency)
+    {
+        SetSecondOrderLowPass(first, count, cutoffFrequency, sampleFrequency, float(M_SQRT1_2));
+    }
+
+    /** @brief start every channel in the steady state of a constant input. */
+    void Reset(const Vector &value)
+    {
+        for (int i = 0; i < N; ++i) {
+            const float dcGain = (b0[i] + b1[i] + b2[i]) / (1.f + a1[i] + a2[i]);
+            const float y = dcGain * value[i];
+            z1[i] = y - b0[i] * value[i];
+            z2[i] = b2[i] * value[i] - a2[i] * y;
+        }
+    }
+
+    /** @brief filter one sample of every channel. */
+    const Vector &Filter(const Vector &newValue)
+    {
+        alignas(16) float input[NPadded] = {};
+        alignas(16) float result[NPadded];
+        for (int i = 0; i < N; ++i) {
+            input[i] = newValue[i];
+        }
+        for (int i = 0; i < NPadded; i += 4) {
+            const qrFloat4 x = qrFloat4::Load(input + i);
+            const qrFloat4 y = qrFloat4::Load(b0 + i) * x + qrFloat4::Load(z1 + i);
+            (qrFloat4::Load(b1 + i) * x - qrFloat4::Load(a1 + i) * y + qrFloat4::Load(z2 + i)).Store(z1 + i);
+            (qrFloat4::Load(b2 + i) * x - qrFloat4::Load(a2 + i) * y).Store(z2 + i);
+            y.Store(result + i);
+        }
+        for (int i = 0; i < N; ++i) {
+            output[i] = result[i];
+        }
+        return output;
+    }
+
+    inline const Vector &GetOutput() const
+    {
+        return output;
+    }
+
+private:
+    static constexpr int NPadded = (N + 3) / 4 * 4;
+
+    void SetCoefficients(int i, float b0In, float b1In, float b2In, float a1In, float a2In)
+    {
+        b0[i] = b0In;
+        b1[i] = b1In;
+        b2[i] = b2In;
+        a1[i] = a1In;
+        a2[i] = a2In;
+    }
+
+    alignas(16) float b0[NPadded];
+    alignas(16) float b1[NPadded];
+    alignas(16) float b2[NPadded];
+    alignas(16) float a1[NPadded];
+    alignas(16) float a2[NPadded];
+    alignas(16) float z1[NPadded];
+    alignas(16) float z2[NPadded];
+    Vector output = Vector::Zero();
 };
 
 #endif // ASCEND_QUADRUPED_CPP_FILTER_H
@@ -27,6 +27,7 @@
 
 #include "common/qr_se3.h"
 #include "robots/qr_robot.h"
+#include "state_estimator/qr_elevation_map.h"
 
 
 struct qrGap {
@@ -128,6 +129,8 @@ struct qrTerrain {
 /**
  * @brief As descriped in MIT CHEETAH3 paper the 3D plane is z(x,y) = a0+ a1*x +a2*y
  * @param a  Vec3<float>, coefficients for ground surface plane, z= a0+a1*x+a2*y
+ * The plane lives in the world frame and is fitted by recursive least squares: every foot that touches
+ * down is folded in with a rank-1 update, and older footholds are forgotten exponentially.
  */
 class qrGroundSurfaceEstimator {
 
@@ -154,7 +157,7 @@ public:
     void Reset(float currentTime);
 
     /**
-     * @brief Compute the plane equation when four feet are all in contact with ground.
+     * @brief Fold the feet that touched down since the last call into the plane.
      */
     void Update(float currentTime);
 
@@ -174,7 +177,7 @@ public:
     Eigen::Matrix<double, 4, 4> ComputeControlFrame();
 
     /** 
-     * @brief Get the distance of Z axis from point (x,y) 
+     * @brief Get the height of the plane at point (x,y) of the world frame
      * @param x The x position.
      * @param y The y position.
      */
@@ -226,22 +229,28 @@ public:
     qrTerrain terrain;
     
     /**
-     * @brief The coeffcient of plane equation
+     * @brief The coeffcient of plane equation, x and y are taken relative to planeOrigin
      */
     Vec3<double> a;
     
     /**
-     * @brief Compute the plane equation when four feet are all in contact with ground.
+     * @brief The covariance of a in the recursive least squares, up to the noise variance.
      */
-    Eigen::Matrix<double, 4, 3> W;
+    Mat3<double> planeCovariance;
     
     /**
-     * @brief The z position.
+     * @brief The world frame (x, y) about which a is expressed, moved along with the base
+     *        so that the regressors stay small.
      */
-    Vec4<double> pZ;
+    Vec2<double> planeOrigin;
     
     /**
-     * @brief The normal vector of plane equation
+     * @brief The weight of a foothold is multiplied by this factor for every newer foothold.
+     */
+    double forgettingFactor;
+    
+    /**
+     * @brief The normal vector of plane equation in world frame
      */
     Vec3<double> n;
 
@@ -260,14 +269,25 @@ public:
      */
     YAML::Node footStepperConfig;
 
+    /**
+     * @brief The rolling elevation map around the base, built from the footholds and from
+     *        the point clouds handed to it, e.g. by qrPointCloudReceiver.
+     */
+    qrElevationMap elevationMap;
+
 private:
 
     /**
-     * @brief whether the plane should update
-     * @param contactState: contact state of foot
-     * @return whether to update
+     * @brief Express the plane about a new origin, a and its covariance are transformed exactly.
+     * @param origin: the new origin in world frame
+     */
+    void MovePlaneOrigin(const Vec2<double>& origin);
+    
+    /**
+     * @brief Rank-1 recursive least squares update with one foothold.
+     * @param footPosition: the foothold in world frame
      */
-    bool ShouldUpdate(const Eigen::Matrix<bool, 4, 1>& contactState);
+    void FoldFoothold(const Vec3<double>& footPosition);
 };
 
 #endif // QR_GROUND_ESTIMATOR_H
@@ -0,0 +1,183 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_GROUND_TRUTH_H
+#define QR_GROUND_TRUTH_H
+
+#include "common/qr_cTypes.h"
+#include "common/qr_eigen_types.h"
+#include "common/qr_triple_buffer.h"
+
+/**
+ * @brief The pose and twist of the robot base measured by the simulator, all in world frame.
+ */
+struct qrGroundTruthPose {
+
+    /**
+     * @brief ROS time in seconds when the receiver got the measurement, the simulation clock under use_sim_time.
+     *        /gazebo/link_states carries no stamp of its own.
+     */
+    double stamp = 0.;
+
+    /**
+     * @brief steady clock time in seconds when the measurement arrived, to tell how old it is.
+     */
+    double receiveTime = 0.;
+
+    /**
+     * @brief number of the measurements published so far, 0 before the first one.
+     */
+    u64 sequence = 0;
+
+    Vec3<float> position = Vec3<float>::Zero();
+
+    /**
+     * @brief orientation quaternion as (w, x, y, z).
+     */
+    Vec4<float> orientation = Vec4<float>(1.f, 0.f, 0.f, 0.f);
+
+    Vec3<float> linearVelocity = Vec3<float>::Zero();
+
+    Vec3<float> angularVelocity = Vec3<float>::Zero();
+};
+
+/**
+ * @brief The latest ground truth pose, written by the thread that receives it from the simulator and read
+ *        by the control thread without locks: every measurement is published into a triple buffer,
+ *        so neither side ever waits for the other.
+ */
+class qrGroundTruth {
+
+public:
+
+    /**
+     * @brief Publish a new measurement, from one writer thread. Its sequence and receive time are filled in here.
+     */
+    void Publish(const qrGroundTruthPose &pose);
+
+    /**
+     * @brief The newest published measurement, for one reader thread. The reference stays valid until the next call.
+     */
+    const qrGroundTruthPose &GetLatest();
+
+    /**
+     * @brief seconds on the steady clock, the time base of qrGroundTruthPose::receiveTime.
+     */
+    static double Now();
+
+private:
+
+    qrTripleBuffer<qrGroundTruthPose> poses;
+
+    u64 sequence = 0;
+};
+
+/**
+ * @brief Running statistics of the state estimator's error against the ground truth, one sample per measurement.
+ */
+class qrGroundTruthErrorMetrics {
+
+public:
+
+    /**
+     * @brief Compare an estimate with a measurement. A measurement is counted once however often it is passed in.
+     * @param truth: the ground truth.
+     * @param position: the estimated base position in world frame.
+     * @param velocity: the estimated base velocity in world frame.
+     * @param yaw: the estimated yaw.
+     * @param now: steady clock time in seconds, to track the age of the measurement.
+     */
+    void Add(const qrGroundTruthPose &truth, const Vec3<float> &position, const Vec3<float> &velocity, float yaw, double now);
+
+    void Reset();
+
+    u64 Count() const
+    {
+        return count;
+    }
+
+    /**
+     * @brief root mean square of the position error of each axis.
+     */
+    Vec3<float> PositionRms() const;
+
+    /**
+     * @brief root mean square of the velocity error of each axis.
+     */
+    Vec3<float> VelocityRms() const;
+
+    float YawRms() const;
+
+    float MaxPositionError() const
+    {
+        return maxPositionError;
+    }
+
+    float MaxVelocityError() const
+    {
+        return maxVelocityError;
+    }
+
+    float MaxYawError() const
+    {
+        return maxYawError;
+    }
+
+    /**
+     * @brief age of the measurements when they were compared, in seconds.
+     */
+    float MeanAge() const
+    {
+        return count ? float(ageSum / count) : 0.f;
+    }
+
+    float MaxAge() const
+    {
+        return maxAge;
+    }
+
+private:
+
+    u64 count = 0;
+
+    u64 lastSequence = 0;
+
+    Vec3<double> positionSquaredSum = Vec3<double>::Zero();
+
+    Vec3<double> velocitySquaredSum = Vec3<double>::Zero();
+
+    double yawSquaredSum = 0.;
+
+    double ageSum = 0.;
+
+    float maxPositionError = 0.f;
+
+    float maxVelocityError = 0.f;
+
+    float maxYawError = 0.f;
+
+    float maxAge = 0.f;
+};
+
+#endif // QR_GROUND_TRUTH_H
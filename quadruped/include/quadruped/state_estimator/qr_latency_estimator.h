@@ -0,0 +1,152 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_LATENCY_ESTIMATOR_H
+#define QR_LATENCY_ESTIMATOR_H
+
+#include "common/qr_eigen_types.h"
+#include "state_estimator/qr_state_history.h"
+
+/**
+ * @brief Measures online how long a motor command takes to show up in the observations, from the joints
+ *        of the legs in the air: the torque each past command makes a swing joint produce and the acceleration
+ *        the joint was observed with are correlated over a range of delays, and the best fitting delay is the
+ *        latency. Only legs that stayed in the air over all the delays looked at take part, so that
+ *        every delay is judged on the same ticks and contact forces do not blur the fit.
+ *        The fit at that delay also gives each joint's acceleration per unit torque, which the state
+ *        predictor uses. The statistics forget with a time constant of a few seconds.
+ */
+class qrLatencyEstimator {
+
+public:
+
+    /**
+     * @brief the longest delay looked for, in control ticks.
+     */
+    static constexpr int maxLag = 32;
+
+    /**
+     * @brief Construct a qrLatencyEstimator object.
+     * @param timeWindowIn: time constant in seconds of forgetting old ticks.
+     * @param minCorrelationIn: the correlation the best delay needs to be trusted.
+     */
+    qrLatencyEstimator(float timeWindowIn = 3.f, float minCorrelationIn = 0.3f);
+
+    void Reset();
+
+    /**
+     * @brief Learn from the newest tick, once per tick after its observation was pushed to the history.
+     * @param history: the control ticks, the older ones with their commands.
+     * @param dt: the control period in seconds.
+     */
+    void Update(const qrStateHistory &history, float dt);
+
+    /**
+     * @brief The delay from sending a command to the observation in which it starts to act, beyond the one
+     *        control period that even an instant transport takes. It is what the state predictor has to bridge.
+     * @return seconds, 0 until IsConverged().
+     */
+    float GetLatency() const
+    {
+        return converged ? latency : 0.f;
+    }
+
+    /**
+     * @brief the correlation of command and response at the best delay, in [-1, 1].
+     */
+    float GetCorrelation() const
+    {
+        return correlation;
+    }
+
+    bool IsConverged() const
+    {
+        return converged;
+    }
+
+    /**
+     * @brief joint acceleration per commanded torque for each motor at the best delay, in rad/s^2 per N.m,
+     *        0 for the joints not seen swinging yet.
+     */
+    const Eigen::Matrix<float, 12, 1> &GetJointResponse() const
+    {
+        return jointResponse;
+    }
+
+    /**
+     * @brief Track the time from an observation to the command sent in reply.
+     */
+    void AddComputeTime(float seconds);
+
+    float GetMeanComputeTime() const
+    {
+        return computeTimeWeight > 0.f ? computeTimeSum / computeTimeWeight : 0.f;
+    }
+
+    float GetMaxComputeTime() const
+    {
+        return maxComputeTime;
+    }
+
+private:
+
+    float timeWindow;
+
+    float minCorrelation;
+
+    /**
+     * @brief exponentially weighted sums over the ticks, per motor and for x per delay of 1 to maxLag ticks,
+     *        where x is the torque of the command and y the observed acceleration.
+     */
+    Eigen::Matrix<float, 12, maxLag> sumX;
+
+    Eigen::Matrix<float, 12, maxLag> sumXY;
+
+    Eigen::Matrix<float, 12, maxLag> sumXX;
+
+    Eigen::Matrix<float, 12, 1> sumY;
+
+    Eigen::Matrix<float, 12, 1> sumYY;
+
+    /**
+     * @brief the weight of the ticks each motor contributed, a tick counting less the older it is.
+     */
+    Eigen::Matrix<float, 12, 1> sumWeight;
+
+    float latency;
+
+    float correlation;
+
+    bool converged;
+
+    Eigen::Matrix<float, 12, 1> jointResponse;
+
+    float computeTimeSum;
+
+    float computeTimeWeight;
+
+    float maxComputeTime;
+};
+
+#endif // QR_LATENCY_ESTIMATOR_H
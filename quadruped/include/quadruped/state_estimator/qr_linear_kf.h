@@ -0,0 +1,145 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_LINEAR_KF_H
+#define QR_LINEAR_KF_H
+
+#include <Eigen/Dense>
+
+#include "common/qr_eigen_types.h"
+
+/**
+ * @brief Linear Kalman filter of the base position, the base velocity and the four foot positions,
+ *        all in the world frame (18 states), in the style of the MIT Cheetah estimator.
+ *        The process integrates the world frame acceleration of the IMU and keeps the feet still;
+ *        the measurements are, per leg, the base position relative to the foot, the base velocity
+ *        from the leg odometry and the foot height above flat ground; the four leg velocities are
+ *        fused into one, which leaves 19 rows. Legs out of contact get a large noise, so their feet
+ *        move freely and are anchored again at touch down.
+ *
+ *        A and C are never formed: the prediction only touches the position rows and columns of P,
+ *        C P and S = C P C' + R are built by adding and subtracting rows and columns of P, and
+ *        Q and R are diagonal vectors computed once and scaled per tick. The covariance update uses
+ *        the Joseph form (I - K C) P (I - K C)' + K R K', which keeps P symmetric positive in float.
+ */
+class qrLinearKF {
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    static constexpr int NState = 18;
+
+    static constexpr int NMeasure = 19;
+
+    typedef Eigen::Matrix<float, NState, 1> StateVector;
+
+    typedef Eigen::Matrix<float, NState, NState> StateMatrix;
+
+    /**
+     * @brief constructor, the defaults are the variances of the MIT Cheetah estimator.
+     */
+    qrLinearKF(float processNoisePosition = 0.02f,
+               float processNoiseVelocity = 0.02f,
+               float processNoiseFoot = 0.002f,
+               float sensorNoiseFootPosition = 0.001f,
+               float sensorNoiseFootVelocity = 0.1f,
+               float sensorNoiseFootHeight = 0.001f,
+               float initialVariance = 0.1f);
+
+    /**
+     * @brief Restart the filter.
+     * @param footPositions: the feet in the world frame.
+     */
+    void Reset(const Vec3<float> &position, const Vec3<float> &velocity,
+               const Eigen::Matrix<float, 3, 4> &footPositions);
+
+    /**
+     * @brief Propagate the state with the acceleration of the base in the world frame, gravity removed.
+     */
+    void Predict(float deltaTime, const Vec3<float> &acceleration);
+
+    /**
+     * @brief Correct the state with the leg kinematics.
+     * @param footPositions: foot positions relative to the base, in the world frame.
+     * @param footVelocities: foot velocities relative to the base, in the world frame.
+     * @param trust: per leg, 1 in stance and 0 in swing; values in between blend the two.
+     */
+    void Update(const Eigen::Matrix<float, 3, 4> &footPositions, const Eigen::Matrix<float, 3, 4> &footVelocities,
+                const Vec4<float> &trust);
+
+    inline Vec3<float> GetPosition() const
+    {
+        return x.head<3>();
+    }
+
+    inline Vec3<float> GetVelocity() const
+    {
+        return x.segment<3>(3);
+    }
+
+    inline Vec3<float> GetFootPosition(int legId) const
+    {
+        return x.segment<3>(6 + 3 * legId);
+    }
+
+    inline const StateMatrix &GetCovariance() const
+    {
+        return P;
+    }
+
+private:
+    /**
+     * @brief noise variance for legs in swing is multiplied by (1 + highSuspectNumber)
+     */
+    static constexpr float highSuspectNumber = 100.f;
+
+    StateVector x;
+
+    StateMatrix P;
+
+    float initialVariance;
+
+    float lastDeltaTime;
+
+    /**
+     * @brief diagonal of Q per unit time, and diagonal of R
+     */
+    StateVector processNoise;
+
+    Eigen::Matrix<float, NMeasure, 1> sensorNoise;
+
+    Eigen::Matrix<float, NMeasure, NState> CP;
+
+    Eigen::Matrix<float, NMeasure, NMeasure> S;
+
+    Eigen::LLT<Eigen::Matrix<float, NMeasure, NMeasure>> llt;
+
+    Eigen::Matrix<float, NState, NMeasure> K;
+
+    Eigen::Matrix<float, NState, NMeasure> KR;
+
+    StateMatrix IKC;
+};
+
+#endif // QR_LINEAR_KF_H
@@ -13,18 +13,18 @@
 #include "common/qr_se3.h"
 #include "robots/qr_robot.h"
 // #include "inekf_cpp_interface.h"
-#include "state_estimator/qr_robot_pose_estimator.h"
-#include "state_estimator/qr_robot_velocity_estimator.h"
 #include "state_estimator/qr_ground_estimator.h"
+#include "state_estimator/qr_linear_kf.h"
 
 /**
- * @brief estimate robot state including pose and velocity
+ * @brief estimate robot pose and velocity with a single linear Kalman filter over
+ *        the base and the four feet, fed by the IMU and the leg kinematics.
  */
 class qrRobotEstimator {
 public:
-    qrRobotEstimator(qrRobot *robotIn,
-                    qrGaitGenerator *gaitGeneratorIn,
-                    qrGroundSurfaceEstimator *groundEstimatorIn);
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    qrRobotEstimator(qrRobot *robotIn, qrGroundSurfaceEstimator *groundEstimatorIn);
 
     void Reset(float currentTime);
 
@@ -32,6 +32,14 @@ public:
 
     void Update(float currentTime);
 
+    /**
+     * @brief replace the estimate with the state predicted over the loop latency, after the robot state is predicted.
+     *        The filter keeps integrating the observed state.
+     * @param predictedPosition: predicted com position in world frame
+     * @param predictedVelocity: predicted com velocity in world frame
+     */
+    void SetPredictedState(const Vec3<float> &predictedPosition, const Vec3<float> &predictedVelocity);
+
     /** @brief get com velocity expressed in base frame. */
     inline const Vec3<float> &GetEstimatedVelocity() const
     {
@@ -48,6 +56,18 @@ public:
         return estimatedPosition;
     }
 
+    /** @brief get the filter's com position in world frame, which in simulation the ground truth overrides in x and y. */
+    inline Vec3<float> GetFilteredPosition() const
+    {
+        return filter.GetPosition();
+    }
+
+    /** @brief get the filter's com velocity in world frame. */
+    inline Vec3<float> GetFilteredVelocity() const
+    {
+        return filter.GetVelocity();
+    }
+
     inline const Vec3<float> &GetEstimatedRPY()
     {
         // return inekf_.getRotation().cast<float>();
@@ -55,9 +75,11 @@ public:
     }
 
 private:
+    void UpdateHeightInControlFrame(const Eigen::Matrix<float, 3, 4> &footPositionsWorldFrame);
+
     qrRobot *robot;
-    qrRobotVelocityEstimator velocityEstimator;
-    qrRobotPoseEstimator poseEstimator;
+    qrGroundSurfaceEstimator *groundEstimator;
+    qrLinearKF filter;
 
     float timeSinceReset;
     Vec3<float> estimatedPosition;
@@ -0,0 +1,140 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_STATE_HISTORY_H
+#define QR_STATE_HISTORY_H
+
+#include <array>
+
+#include "common/qr_eigen_types.h"
+
+/**
+ * @brief One control tick: the state the controllers saw and the command they sent in reply.
+ */
+struct qrStateSample {
+
+    /**
+     * @brief robot time of the observation in seconds.
+     */
+    double time = 0.;
+
+    Eigen::Matrix<float, 12, 1> motorAngles = Eigen::Matrix<float, 12, 1>::Zero();
+
+    Eigen::Matrix<float, 12, 1> motorVelocities = Eigen::Matrix<float, 12, 1>::Zero();
+
+    /**
+     * @brief base position in world frame.
+     */
+    Vec3<float> basePosition = Vec3<float>::Zero();
+
+    /**
+     * @brief base orientation quaternion (w, x, y, z), from base frame to world frame.
+     */
+    Vec4<float> baseOrientation = Vec4<float>(1.f, 0.f, 0.f, 0.f);
+
+    /**
+     * @brief base velocity in world frame.
+     */
+    Vec3<float> baseVelocity = Vec3<float>::Zero();
+
+    /**
+     * @brief base angular velocity in base frame.
+     */
+    Vec3<float> baseAngularVelocity = Vec3<float>::Zero();
+
+    Eigen::Matrix<bool, 4, 1> footContact = Eigen::Matrix<bool, 4, 1>::Constant(true);
+
+    /**
+     * @brief whether command and contactForces were recorded for this tick.
+     */
+    bool hasCommand = false;
+
+    /**
+     * @brief the motor commands sent after the observation, one column (p, Kp, d, Kd, tau) per motor.
+     */
+    Eigen::Matrix<float, 5, 12> command = Eigen::Matrix<float, 5, 12>::Zero();
+
+    /**
+     * @brief the forces the stance legs were told to push on the ground with, in base frame.
+     */
+    Eigen::Matrix<float, 3, 4> contactForces = Eigen::Matrix<float, 3, 4>::Zero();
+
+    /**
+     * @brief the torque the motors produce for this tick's command at the given joint state.
+     */
+    float Effort(int motorId, float q, float dq) const
+    {
+        return command(1, motorId) * (command(0, motorId) - q) + command(3, motorId) * (command(2, motorId) - dq)
+               + command(4, motorId);
+    }
+};
+
+/**
+ * @brief The last ticks of the control loop in a fixed ring, so that the loop never allocates.
+ */
+class qrStateHistory {
+
+public:
+
+    static constexpr int capacity = 64;
+
+    /**
+     * @brief Start a new tick. Its observation is to be filled in through the returned reference.
+     */
+    qrStateSample &Push(double time);
+
+    /**
+     * @brief Record the reply to the newest observation.
+     */
+    void RecordCommand(const Eigen::Matrix<float, 5, 12> &command, const Eigen::Matrix<float, 3, 4> &contactForces);
+
+    void Clear()
+    {
+        size = 0;
+    }
+
+    int Size() const
+    {
+        return size;
+    }
+
+    /**
+     * @brief a past tick.
+     * @param age: 0 for the newest tick, up to Size() - 1.
+     */
+    const qrStateSample &Get(int age) const
+    {
+        return samples[(newest - age + capacity) % capacity];
+    }
+
+private:
+
+    std::array<qrStateSample, capacity> samples;
+
+    int newest = capacity - 1;
+
+    int size = 0;
+};
+
+#endif // QR_STATE_HISTORY_H
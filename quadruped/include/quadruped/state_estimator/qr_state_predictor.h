@@ -0,0 +1,78 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef QR_STATE_PREDICTOR_H
+#define QR_STATE_PREDICTOR_H
+
+#include "common/qr_eigen_types.h"
+#include "robots/qr_robot_config.h"
+#include "state_estimator/qr_state_history.h"
+
+/**
+ * @brief Predicts the state the robot will be in when a command sent now starts to act, so that the
+ *        controllers can plan for that instead of for the delayed observation. From the newest tick it
+ *        integrates, one control period at a time, the commands already sent but not yet visible:
+ *        the joints of the legs in the air under their PD commands with the response measured by
+ *        qrLatencyEstimator, the base under the commanded contact forces with the single rigid body
+ *        model. The joints of the stance legs and, without commanded forces, the base keep their velocity.
+ */
+class qrStatePredictor {
+
+public:
+
+    /**
+     * @brief Construct a qrStatePredictor object.
+     * @param configIn: the robot config, for the body mass and inertia and the leg kinematics.
+     */
+    qrStatePredictor(qrRobotConfig *configIn);
+
+    /**
+     * @brief Predict the state after the newest tick of the history.
+     * @param history: the control ticks, with their commands except for the newest one.
+     * @param jointResponse: joint acceleration per commanded torque of each motor, 0 keeps the joint's velocity.
+     * @param horizon: how far ahead to predict in seconds, the latency beyond one control period.
+     * @param dt: the control period in seconds.
+     * @param predicted: output, the newest tick moved ahead by horizon; time, contacts and command stay as they were.
+     */
+    void Predict(const qrStateHistory &history,
+                 const Eigen::Matrix<float, 12, 1> &jointResponse,
+                 float horizon,
+                 float dt,
+                 qrStateSample &predicted) const;
+
+private:
+
+    /**
+     * @brief Advance the state by one step under the command of a past tick.
+     */
+    void Step(const qrStateSample &commandSample,
+              const Eigen::Matrix<float, 12, 1> &jointResponse,
+              const Eigen::Matrix<float, 3, 4> &footPositions,
+              float step,
+              qrStateSample &state) const;
+
+    qrRobotConfig *config;
+};
+
+#endif // QR_STATE_PREDICTOR_H
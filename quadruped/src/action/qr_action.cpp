@@ -94,21 +94,9 @@ namespace Action {
         std::cout << "motorAnglesBeforeWalk: \n" << motorAnglesBeforeWalk.transpose() << std::endl;
         Eigen::Matrix<float, 12, 1> action;
         
-        Vec3<int> jointIdx;
-        Vec3<float> jointAngles;
-        Vec3<float> footTargetPosition;
-
-        Eigen::Matrix<float, 3, 4> hipPositions = robot->config->defaultHipPosition;
-    
-        for (int legId=0; legId < 4; ++legId) {
-            Vec3<float> hipOffset = hipPositions.col(legId);
-            
-            footTargetPosition << hipOffset[0], hipOffset[1], -robot->config->bodyHeight;
-            robot->config->ComputeMotorAnglesFromFootLocalPosition(legId, footTargetPosition, jointIdx, jointAngles);
-            for (int i = 0; i < 3; ++i) {
-                action[jointIdx[i]] = jointAngles[i];
-            }
-        }
+        Eigen::Matrix<float, 3, 4> footTargetPositions = robot->config->defaultHipPosition;
+        footTargetPositions.row(2).setConstant(-robot->config->bodyHeight);
+        action = robot->config->ComputeMotorAnglesFromFootLocalPositions(footTargetPositions);
         
         while (currentTime - startTime < walkTime) {
             startTimeWall = robot->GetTimeSinceReset();
@@ -125,4 +113,4 @@ namespace Action {
             while (robot->GetTimeSinceReset() - startTimeWall < robot->timeStep) {}
         }
     }
-} // Action
\ No newline at end of file
+} // Action
\ No newline at end of file
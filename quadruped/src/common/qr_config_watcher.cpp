@@ -0,0 +1,126 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "common/qr_config_watcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+
+qrConfigWatcher &qrConfigWatcher::Instance()
+{
+    static qrConfigWatcher watcher;
+    return watcher;
+}
+
+qrConfigWatcher::qrConfigWatcher() : hasPending(false)
+{
+    worker = std::thread(&qrConfigWatcher::Run, this);
+}
+
+qrConfigWatcher::~qrConfigWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+void qrConfigWatcher::Add(qrConfigSource *source)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    sources.push_back(source);
+}
+
+void qrConfigWatcher::Remove(qrConfigSource *source)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    sources.erase(std::remove(sources.begin(), sources.end(), source), sources.end());
+}
+
+void qrConfigWatcher::Acquire()
+{
+    if (!hasPending.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    hasPending.store(false, std::memory_order_relaxed);
+    bool deferred = false;
+    for (qrConfigSource *source : sources) {
+        deferred |= !source->Acquire();
+    }
+    if (deferred) {
+        // taken once the watcher has collected the replaced snapshots
+        hasPending.store(true, std::memory_order_relaxed);
+    }
+}
+
+void qrConfigWatcher::SetPollPeriod(float seconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pollPeriodMs = std::max(1, int(seconds * 1000.f));
+    }
+    wakeUp.notify_one();
+}
+
+long long qrConfigWatcher::GetModifiedTime(const std::string &path)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) {
+        return 0;
+    }
+    return status.st_mtim.tv_sec * 1000000000LL + status.st_mtim.tv_nsec;
+}
+
+void qrConfigWatcher::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        // an early wake up only means an early check
+        wakeUp.wait_for(lock, std::chrono::milliseconds(pollPeriodMs));
+        if (stop) {
+            break;
+        }
+        for (qrConfigSource *source : sources) {
+            source->Collect();
+            const long long modifiedTime = GetModifiedTime(source->path);
+            if (modifiedTime == 0 || modifiedTime == source->modifiedTime) {
+                continue;
+            }
+            // an editor may still be writing, a half written file fails to parse and is retried
+            // when its modification time changes again
+            source->modifiedTime = modifiedTime;
+            if (source->Reload()) {
+                std::cout << "[qrConfigWatcher] reloaded " << source->path << std::endl;
+                hasPending.store(true, std::memory_order_release);
+            }
+        }
+    }
+}
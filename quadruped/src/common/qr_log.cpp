@@ -0,0 +1,142 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "common/qr_log.h"
+
+#include <algorithm>
+
+std::atomic<int> qrLog::level(LOG_LEVEL_INFO);
+
+qrLog &qrLog::Instance()
+{
+    static qrLog log;
+    return log;
+}
+
+qrLog::qrLog() : head(0), tail(0), dropped(0), startTime(Now())
+{
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    worker = std::thread(&qrLog::Run, this);
+}
+
+qrLog::~qrLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeUp.notify_one();
+    worker.join();
+}
+
+qrLog::Record *qrLog::Claim(size_t &position)
+{
+    // a bounded multi-producer queue: a slot is free for the producer whose position equals its sequence
+    position = head.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot &slot = slots[position % capacity];
+        const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const long difference = long(sequence) - long(position);
+        if (difference == 0) {
+            if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return &slot.record;
+            }
+        } else if (difference < 0) {
+            return nullptr;
+        } else {
+            position = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void qrLog::Publish(size_t position)
+{
+    slots[position % capacity].sequence.store(position + 1, std::memory_order_release);
+}
+
+void qrLog::Flush()
+{
+    const size_t target = head.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex);
+    wakeUp.notify_one();
+    drained.wait(lock, [&] { return tail.load(std::memory_order_acquire) >= target; });
+}
+
+size_t qrLog::Drain()
+{
+    static const char tags[] = {'D', 'I', 'W', 'E'};
+    char message[512];
+    size_t count = 0;
+    for (;;) {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        Slot &slot = slots[position % capacity];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            break;
+        }
+        const Record &record = slot.record;
+        int length = record.formatFunction(message, sizeof(message), record.format, record.payload);
+        length = std::min(std::max(length, 0), int(sizeof(message)) - 1);
+        while (length > 0 && message[length - 1] == '\n') {
+            message[--length] = '\0';
+        }
+
+        FILE *stream = record.level >= LOG_LEVEL_WARN ? stderr : stdout;
+        std::fprintf(stream, "[%c %.6f] %s", tags[std::min(std::max(record.level, 0), 3)],
+                     (record.time - startTime) * 1e-9, message);
+        if (record.suppressed > 0) {
+            std::fprintf(stream, " (%u suppressed)", record.suppressed);
+        }
+        std::fputc('\n', stream);
+
+        slot.sequence.store(position + capacity, std::memory_order_release);
+        tail.store(position + 1, std::memory_order_release);
+        ++count;
+    }
+
+    const u32 lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0) {
+        std::fprintf(stderr, "[qrLog] %u messages dropped, the ring was full\n", lost);
+    }
+    if (count > 0 || lost > 0) {
+        std::fflush(stdout);
+        std::fflush(stderr);
+    }
+    return count;
+}
+
+void qrLog::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop) {
+        wakeUp.wait_for(lock, std::chrono::milliseconds(5));
+        lock.unlock();
+        Drain();
+        lock.lock();
+        drained.notify_all();
+    }
+    lock.unlock();
+    Drain();
+}
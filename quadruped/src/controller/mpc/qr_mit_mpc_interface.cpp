@@ -1,4 +1,11 @@
 #include "controller/mpc/qr_mit_mpc_interface.h"
+#include "controller/mpc/qr_mixed_precision_qp.h"
+#include "controller/qr_qp_snapshot.h"
+#include "common/qr_log.h"
+
+#include <map>
+#include <memory>
+#include <vector>
 
 #include "qpOASES.hpp"
 
@@ -170,7 +177,11 @@ void update_solver_settings(int max_iter, double rho, double sigma, double solve
     update.sigma = sigma;
     update.solver_alpha = solver_alpha;
     update.terminate = terminate;
-    if (use_jcqp > 1.5)
+    if (use_jcqp > 3.5)
+        update.use_jcqp = 4;
+    else if (use_jcqp > 2.5)
+        update.use_jcqp = 3;
+    else if (use_jcqp > 1.5)
         update.use_jcqp = 2;
     else if (use_jcqp > 0.5)
         update.use_jcqp = 1;
@@ -242,6 +253,81 @@ void update_x_drag(float x_drag)
     update.x_drag = x_drag;
 }
 
+// JCQP problems live across solves, one per reduced problem size (it changes with the contact pattern),
+// so ADMM is warm started from the previous solution. The KKT factorization is only reused when qH and the
+// constraints are bitwise unchanged, i.e. while the state, the foot positions and the weights stay the same;
+// during locomotion qH changes every solve, and the sparse path then keeps the AMD ordering and the symbolic
+// factorization of the problem size and only refactors numerically.
+std::map<std::pair<int, int>, std::unique_ptr<QpProblem<double>>> jcqp_problems;
+std::map<std::pair<int, int>, std::unique_ptr<MixedPrecisionQpProblem>> jcqp_float_problems;
+Matrix<double, Dynamic, 1> jcqp_z_full, jcqp_y_full; // previous constraint values and duals over the full horizon
+Matrix<double, Dynamic, 1> jcqp_x_ws, jcqp_z_ws, jcqp_y_ws;
+int jcqp_last_iterations = 0;
+long jcqp_float_solves = 0, jcqp_float_refinements = 0; // over all reduced problem sizes
+bool jcqp_has_solution = false;
+
+#if defined(SOLVER_MA27) || defined(SOLVER_MA57)
+// Schur complement updates of a sparse KKT factorization, only available with an HSL solver
+typedef qpOASES::SQProblemSchur qpoases_sparse_qp;
+typedef qpOASES::SymSparseMat qpoases_sparse_hessian;
+#else
+typedef qpOASES::SQProblem qpoases_sparse_qp;
+typedef qpOASES::SymDenseMat qpoases_sparse_hessian;
+#endif
+
+// qpOASES fed with a compressed column friction cone matrix, one problem per reduced problem size,
+// hot started across solves. qpOASES keeps pointers to the matrices of the last solve,
+// so the matrix data is double buffered.
+struct qpoases_sparse_buffer {
+    std::vector<qpOASES::sparse_int_t> a_row, a_col, h_row, h_col;
+    std::vector<qpOASES::real_t> a_val, h_val;
+    std::unique_ptr<qpOASES::SparseMatrix> A;
+    std::unique_ptr<qpoases_sparse_hessian> H;
+};
+
+struct qpoases_sparse_problem {
+    std::unique_ptr<qpoases_sparse_qp> qp;
+    qpoases_sparse_buffer buffers[2];
+    int active = 0;
+};
+
+std::map<std::pair<int, int>, std::unique_ptr<qpoases_sparse_problem>> qpoases_sparse_problems;
+
+int get_solver_iterations()
+{
+    return jcqp_last_iterations;
+}
+
+// gather the previous full horizon solution into the reduced problem. It is not shifted along the horizon:
+// the MPC solves every half MPC step, and the unshifted solution matches the contact pattern more often.
+void build_warm_start(const int *var_ind, int new_vars, const int *con_ind, int new_cons, const double *x_full)
+{
+    jcqp_x_ws.resize(new_vars);
+    jcqp_z_ws.resize(new_cons);
+    jcqp_y_ws.resize(new_cons);
+    for (int i = 0; i < new_vars; ++i) {
+        jcqp_x_ws[i] = x_full[var_ind[i]];
+    }
+    for (int i = 0; i < new_cons; ++i) {
+        jcqp_z_ws[i] = jcqp_z_full[con_ind[i]];
+        jcqp_y_ws[i] = jcqp_y_full[con_ind[i]];
+    }
+}
+
+// scatter the reduced constraint values and duals over the full horizon for the next warm start
+template <class Problem>
+void store_warm_start(Problem &problem, const int *con_ind, int new_cons)
+{
+    jcqp_z_full.setZero();
+    jcqp_y_full.setZero();
+    for (int i = 0; i < new_cons; ++i) {
+        jcqp_z_full[con_ind[i]] = problem.getConstraintValues()[i];
+        jcqp_y_full[con_ind[i]] = problem.getDual()[i];
+    }
+    jcqp_last_iterations = problem.getIterations();
+    jcqp_has_solution = true;
+}
+
 double get_solution(int index)
 {
     if (!has_solved) return 0.f;
@@ -412,6 +498,13 @@ void resize_qp_mats(s16 horizon)
     qH.setZero();
     eye_12h.setIdentity();
 
+    jcqp_problems.clear();
+    jcqp_float_problems.clear();
+    qpoases_sparse_problems.clear();
+    jcqp_z_full.setZero(20 * horizon);
+    jcqp_y_full.setZero(20 * horizon);
+    jcqp_has_solution = false;
+
     s16 k = 0;
     for (s16 i = 0; i < problem_configuration.horizon; i++) {
         for (s16 j = 0; j < 4; j++) {
@@ -559,6 +652,89 @@ int numm = 0;
 // int last_new_vars = 0;
 // int last_new_cons = 0;
 
+/**
+ * @brief Solve the reduced problem with qpOASES on a sparse constraint matrix, hot started from the
+ * previous solve of the same size. Reads H_red, g_red, lb_red, ub_red and the friction cone blocks
+ * of A_qpoases, writes q_red.
+ */
+bool solve_qpoases_sparse(int new_vars, int new_cons, const int *var_ind, const int *con_ind, int num_variables, qpOASES::int_t nWSR)
+{
+    std::unique_ptr<qpoases_sparse_problem> &entry = qpoases_sparse_problems[std::make_pair(new_vars, new_cons)];
+    if (!entry) {
+        entry.reset(new qpoases_sparse_problem());
+    }
+    qpoases_sparse_problem &problem = *entry;
+    qpoases_sparse_buffer &buffer = problem.buffers[problem.active ^ 1];
+
+    // fmat is block diagonal, 5 friction cone rows per 3 force components, so every column has 5 candidates
+    int num_constraints = 5 * num_variables / 3;
+    int con_map[num_constraints];
+    for (int i = 0; i < num_constraints; ++i)
+        con_map[i] = -1;
+    for (int i = 0; i < new_cons; ++i)
+        con_map[con_ind[i]] = i;
+
+    buffer.a_row.clear();
+    buffer.a_val.clear();
+    buffer.a_col.resize(new_vars + 1);
+    buffer.a_col[0] = 0;
+    for (int c = 0; c < new_vars; ++c) {
+        int var = var_ind[c];
+        for (int row = 5 * (var / 3); row < 5 * (var / 3) + 5; ++row) {
+            qpOASES::real_t value = A_qpoases[row * num_variables + var];
+            if (con_map[row] >= 0 && value != 0) {
+                buffer.a_row.push_back(con_map[row]);
+                buffer.a_val.push_back(value);
+            }
+        }
+        buffer.a_col[c + 1] = buffer.a_row.size();
+    }
+    buffer.A.reset(new qpOASES::SparseMatrix(new_cons, new_vars, buffer.a_row.data(), buffer.a_col.data(), buffer.a_val.data()));
+
+#if defined(SOLVER_MA27) || defined(SOLVER_MA57)
+    buffer.h_row.clear();
+    buffer.h_val.clear();
+    buffer.h_col.resize(new_vars + 1);
+    buffer.h_col[0] = 0;
+    for (int c = 0; c < new_vars; ++c) {
+        for (int r = 0; r < new_vars; ++r) {
+            if (H_red[r * new_vars + c] != 0) {
+                buffer.h_row.push_back(r);
+                buffer.h_val.push_back(H_red[r * new_vars + c]);
+            }
+        }
+        buffer.h_col[c + 1] = buffer.h_row.size();
+    }
+    buffer.H.reset(new qpOASES::SymSparseMat(new_vars, new_vars, buffer.h_row.data(), buffer.h_col.data(), buffer.h_val.data()));
+    buffer.H->createDiagInfo();
+#else
+    buffer.h_val.assign(H_red, H_red + new_vars * new_vars);
+    buffer.H.reset(new qpOASES::SymDenseMat(new_vars, new_vars, new_vars, buffer.h_val.data()));
+#endif
+
+    qpOASES::returnValue rval = qpOASES::RET_HOTSTART_FAILED;
+    qpOASES::int_t nWSR_hot = nWSR;
+    if (problem.qp) {
+        rval = problem.qp->hotstart(buffer.H.get(), g_red, buffer.A.get(), NULL, NULL, lb_red, ub_red, nWSR_hot);
+    }
+    if (rval != qpOASES::SUCCESSFUL_RETURN) {
+        problem.qp.reset(new qpoases_sparse_qp(new_vars, new_cons));
+        qpOASES::Options op;
+        op.setToMPC();
+        op.printLevel = qpOASES::PL_NONE;
+        problem.qp->setOptions(op);
+        rval = problem.qp->init(buffer.H.get(), g_red, buffer.A.get(), NULL, NULL, lb_red, ub_red, nWSR);
+    }
+    // the other buffer is no longer referenced by qpOASES
+    problem.active ^= 1;
+
+    if (rval != qpOASES::SUCCESSFUL_RETURN) {
+        problem.qp.reset();
+        return false;
+    }
+    return problem.qp->getPrimalSolution(q_red) == qpOASES::SUCCESSFUL_RETURN;
+}
+
 void solve_mpc(update_data_t *update, problem_setup *setup)
 {
     // MITTimer t1;
@@ -668,6 +844,17 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
     s16 num_constraints = 20 * setup->horizon;
     s16 num_variables = 12 * setup->horizon;
 
+    if (qrQpSnapshotRecorder::Instance().IsEnabled(QP_SNAPSHOT_DENSE_MPC)) {
+        qrQpSnapshot snapshot;
+        snapshot.source = QP_SNAPSHOT_DENSE_MPC;
+        snapshot.SetHessian(qH);
+        snapshot.SetGradient(qg);
+        snapshot.SetConstraintMatrix(fmat);
+        snapshot.SetBounds(Eigen::VectorXf::Zero(num_constraints), U_b);
+        snapshot.SetGait(update->gait, setup->horizon);
+        qrQpSnapshotRecorder::Instance().Record(snapshot);
+    }
+
     // QpProblem<double> jcqp(num_variables, num_constraints); // 0.06ms
 
     // tt += T2.getMs();
@@ -690,8 +877,10 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
         // jcqp.runFromDense(update->max_iterations, true, false);
     } else {
         // MITTimer solve_timer1;
-        matrix_to_real(H_qpoases, qH, num_variables, num_variables);
-        matrix_to_real(g_qpoases, qg, num_variables, 1);
+        if (update->use_jcqp != 3) { // the float path reads qH/qg directly
+            matrix_to_real(H_qpoases, qH, num_variables, num_variables);
+            matrix_to_real(g_qpoases, qg, num_variables, 1);
+        }
         matrix_to_real(A_qpoases, fmat, num_constraints, num_variables);
         matrix_to_real(ub_qpoases, U_b, num_constraints, 1);
 
@@ -742,7 +931,7 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
             for (int i = 0; i < num_variables; ++i) {
                 if (!var_elim[i]) {
                     if (!(vc < new_vars)) {
-                        printf("BAD ERROR 1\n");
+                        QR_LOG_ERROR_EVERY(1.f, "BAD ERROR 1");
                     }
                     var_ind[vc] = i;
                     vc++;
@@ -752,7 +941,7 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
             for (int i = 0; i < num_constraints; ++i) {
                 if (!con_elim[i]) {
                     if (!(vc < new_cons)) {
-                        printf("BAD ERROR 1\n");
+                        QR_LOG_ERROR_EVERY(1.f, "BAD ERROR 1");
                     }
                     con_ind[vc] = i;
                     vc++;
@@ -837,10 +1026,10 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
                         solver.updateUpperBound(upperBound);
                     }
                 }
-                printf("set probelm time %f ms\n", T1.getMs());
+                QR_LOG_DEBUG("set probelm time %f ms", T1.getMs());
 
                 solver.solveProblem();
-                printf("solveProblem Solve time %f ms\n", T1.getMs());
+                QR_LOG_DEBUG("solveProblem Solve time %f ms", T1.getMs());
 
                 Eigen::VectorXd QPSolution = solver.getSolution();
                 vc = 0;
@@ -856,6 +1045,60 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
             }
             */
 
+            // single precision JCQP, refined in double only if the residual check fails
+            if (update->use_jcqp == 3) {
+                std::unique_ptr<MixedPrecisionQpProblem> &jcqp = jcqp_float_problems[std::make_pair(new_vars, new_cons)];
+                if (!jcqp) {
+                    jcqp.reset(new MixedPrecisionQpProblem(new_vars, new_cons));
+                }
+                MixedPrecisionQpProblem &reducedProblem = *jcqp;
+
+                for (int c = 0; c < new_vars; ++c) {
+                    for (int r = 0; r < new_vars; ++r) {
+                        reducedProblem.P(r, c) = qH(var_ind[r], var_ind[c]);
+                    }
+                    for (int r = 0; r < new_cons; ++r) {
+                        reducedProblem.A(r, c) = fmat(con_ind[r], var_ind[c]);
+                    }
+                    reducedProblem.q[c] = qg[var_ind[c]];
+                }
+                for (int r = 0; r < new_cons; ++r) {
+                    reducedProblem.u[r] = U_b[con_ind[r]];
+                    reducedProblem.l[r] = 0.f;
+                }
+
+                reducedProblem.settings.sigma = update->sigma;
+                reducedProblem.settings.alpha = update->solver_alpha;
+                reducedProblem.settings.terminate = update->terminate;
+                reducedProblem.settings.rho = update->rho;
+                reducedProblem.settings.maxIterations = update->max_iterations;
+                reducedProblem.residualTolerance = update->terminate;
+
+                if (jcqp_has_solution) {
+                    build_warm_start(var_ind, new_vars, con_ind, new_cons, q_soln);
+                    reducedProblem.setWarmStart(jcqp_x_ws, jcqp_z_ws, jcqp_y_ws);
+                }
+
+                // the sparse LDLT beats the dense float kernels at the reduced MPC size
+                reducedProblem.run(update->max_iterations, true);
+                jcqp_float_solves++;
+                jcqp_float_refinements += reducedProblem.refined();
+                QR_LOG_INFO_EVERY(10.f, "float JCQP: %ld of %ld solves refined in double, last residual %.2e",
+                                  jcqp_float_refinements, jcqp_float_solves, reducedProblem.getResidual());
+
+                vc = 0;
+                for (int kk = 0; kk < num_variables; kk++) {
+                    if (var_elim[kk]) {
+                        q_soln[kk] = 0.0f;
+                    } else {
+                        q_soln[kk] = reducedProblem.getSolution()[vc];
+                        vc++;
+                    }
+                }
+                store_warm_start(reducedProblem, con_ind, new_cons);
+                return;
+            }
+
             for (int i = 0; i < new_vars; ++i) {
                 int olda = var_ind[i];
                 g_red[i] = g_qpoases[olda];
@@ -865,10 +1108,12 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
                 }
             }
 
-            for (int con = 0; con < new_cons; ++con) {
-                for (int st = 0; st < new_vars; ++st) {
-                    float cval = A_qpoases[(num_variables * con_ind[con]) + var_ind[st]];
-                    A_red[con * new_vars + st] = cval;
+            if (update->use_jcqp != 4) {
+                for (int con = 0; con < new_cons; ++con) {
+                    for (int st = 0; st < new_vars; ++st) {
+                        float cval = A_qpoases[(num_variables * con_ind[con]) + var_ind[st]];
+                        A_red[con * new_vars + st] = cval;
+                    }
                 }
             }
             for (int i = 0; i < new_cons; ++i) {
@@ -892,7 +1137,7 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
                 (void)rval;
                 int rval2 = problem_red.getPrimalSolution(q_red);
                 if (rval2 != qpOASES::SUCCESSFUL_RETURN)
-                    printf("failed to solve!\n");
+                    QR_LOG_WARN_EVERY(1.f, "failed to solve!");
                 // printf("qp2 solve time: %.3f ms, size %d, %d\n", solve_timer.getMs(), new_vars, new_cons);
 
                 vc = 0;
@@ -904,39 +1149,34 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
                         vc++;
                     }
                 }
-            } else {// use jcqp == 2
-                QpProblem<double> reducedProblem(new_vars, new_cons);
-
-                reducedProblem.A = DenseMatrix<double>(new_cons, new_vars);
-                int i = 0;
-                for (int r = 0; r < new_cons; r++) {
-                    for (int c = 0; c < new_vars; c++) {
-                        reducedProblem.A(r, c) = A_red[i++];
-                    }
-                }
+                jcqp_has_solution = false;
+            } else if (update->use_jcqp == 4) {
+                if (!solve_qpoases_sparse(new_vars, new_cons, var_ind, con_ind, num_variables, nWSR))
+                    QR_LOG_WARN_EVERY(1.f, "failed to solve!");
 
-                reducedProblem.P = DenseMatrix<double>(new_vars, new_vars);
-                i = 0;
-                for (int r = 0; r < new_vars; r++) {
-                    for (int c = 0; c < new_vars; c++) {
-                        reducedProblem.P(r, c) = H_red[i++];
+                vc = 0;
+                for (int i = 0; i < num_variables; ++i) {
+                    if (var_elim[i]) {
+                        q_soln[i] = 0.0f;
+                    } else {
+                        q_soln[i] = q_red[vc];
+                        vc++;
                     }
                 }
-
-                reducedProblem.q = Eigen::Matrix<double, Eigen::Dynamic, 1>(new_vars);
-                for (int r = 0; r < new_vars; r++) {
-                    reducedProblem.q[r] = g_red[r];
-                }
-
-                reducedProblem.u = Eigen::Matrix<double, Eigen::Dynamic, 1>(new_cons);
-                for (int r = 0; r < new_cons; r++) {
-                    reducedProblem.u[r] = ub_red[r];
+                jcqp_has_solution = false;
+            } else {// use jcqp == 2
+                std::unique_ptr<QpProblem<double>> &jcqp = jcqp_problems[std::make_pair(new_vars, new_cons)];
+                if (!jcqp) {
+                    jcqp.reset(new QpProblem<double>(new_vars, new_cons, false));
                 }
+                QpProblem<double> &reducedProblem = *jcqp;
 
-                reducedProblem.l = Eigen::Matrix<double, Eigen::Dynamic, 1>(new_cons);
-                for (int r = 0; r < new_cons; r++) {
-                    reducedProblem.l[r] = lb_red[r];
-                }
+                typedef Eigen::Map<Matrix<double, Dynamic, Dynamic, Eigen::RowMajor>> RowMajorMap;
+                reducedProblem.A = RowMajorMap(A_red, new_cons, new_vars);
+                reducedProblem.P = RowMajorMap(H_red, new_vars, new_vars);
+                reducedProblem.q = Eigen::Map<Matrix<double, Dynamic, 1>>(g_red, new_vars);
+                reducedProblem.u = Eigen::Map<Matrix<double, Dynamic, 1>>(ub_red, new_cons);
+                reducedProblem.l = Eigen::Map<Matrix<double, Dynamic, 1>>(lb_red, new_cons);
 
                 //        jcqp.A = fmat.cast<double>();
                 //        jcqp.P = qH.cast<double>();
@@ -950,6 +1190,13 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
                 reducedProblem.settings.terminate = update->terminate;
                 reducedProblem.settings.rho = update->rho;
                 reducedProblem.settings.maxIterations = update->max_iterations;
+
+                // warm start from the previous solution, see build_warm_start
+                if (jcqp_has_solution) {
+                    build_warm_start(var_ind, new_vars, con_ind, new_cons, q_soln);
+                    reducedProblem.setWarmStart(jcqp_x_ws, jcqp_z_ws, jcqp_y_ws);
+                }
+
                 reducedProblem.runFromDense(update->max_iterations, true, false);
 
                 vc = 0;
@@ -961,6 +1208,7 @@ void solve_mpc(update_data_t *update, problem_setup *setup)
                         vc++;
                     }
                 }
+                store_warm_start(reducedProblem, con_ind, new_cons);
             }
         }
     }
@@ -1,4 +1,5 @@
 #include "controller/mpc/qr_mit_mpc_stance_leg_controller.h"
+#include "common/qr_log.h"
 
 #define M_2PI 6.28318530718 // 2 * PI
 
@@ -45,9 +46,10 @@ qrMITConvexMPCStanceLegController::qrMITConvexMPCStanceLegController(
     //std::cout << "controlModeStr " << controlModeStr <<  param["stance_leg_params"][controlModeStr]["Q"] << std::endl;
     // if use advanced trot, use Q matrix
     std::cout << "MPC path:" << configFilepath << std::endl;
-    YAML::Node param = YAML::LoadFile(configFilepath);
-    std::vector<float> QIN =
-        param["stance_leg_params"][modeMap[LocomotionMode::ADVANCED_TROT_LOCOMOTION]]["Q"].as<std::vector<float>>();
+    const std::vector<float> &QIN = params->Get().modes[LocomotionMode::ADVANCED_TROT_LOCOMOTION].Q;
+    if (QIN.size() != 12) {
+        throw std::runtime_error(configFilepath + ": the MPC needs the Q of advanced_trot");
+    }
     // float Q[12] = {2.5, 2.5, 2.5, 30, 30, 50, 0.1, 0.1, 0.5, 0.1, 0.1, 0.1};
     // float Q[12] = {2.5, 2.5, 10, 50, 50, 100, 0, 0, 0.5, 0.2, 0.2, 0.1}; // origin
     // float Q[12] = {3, 3, 5, 40, 40, 50, 0., 0., 0.5, 5, 5, 1};
@@ -194,8 +196,8 @@ void qrMITConvexMPCStanceLegController::run(std::map<int, qrMotorCommand>& legCo
     Vec3<float> rpy = robot->GetBaseRollPitchYaw();
     // integrate position setpoint
     Vec3<float> v_des_robot(_x_vel_des, _y_vel_des, 0); // 身体坐标系下的期望线速度
-    v_des_world = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * v_des_robot;  //世界坐标系下的期望线速度
-    Vec3<float> v_robot = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * robot->GetBaseVelocity();    //世界坐标系下的机器人实际速度
+    v_des_world = robot->state.GetBaseRotationMatrix() * v_des_robot;  //世界坐标系下的期望线速度
+    Vec3<float> v_robot = robot->state.GetBaseRotationMatrix() * robot->GetBaseVelocity();    //世界坐标系下的机器人实际速度
 
     // Integral-esque pitche and roll compensation
     // 积分达到补偿值*******************************
@@ -504,15 +506,15 @@ void qrMITConvexMPCStanceLegController::solveDenseMPC(qrRobot *_quadruped)
     float alpha = 4e-6;// make setting eventually
     // float alpha = 4e-7; // make setting eventually: DH
     float *p = pos.data();
-    Eigen::Matrix<float, 3, 1> vBase = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * robot->GetBaseVelocity();
-    Eigen::Matrix<float, 3, 1> wBase = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * robot->GetBaseRollPitchYawRate();
+    Eigen::Matrix<float, 3, 1> vBase = robot->state.GetBaseRotationMatrix() * robot->GetBaseVelocity();
+    Eigen::Matrix<float, 3, 1> wBase = robot->state.GetBaseRotationMatrix() * robot->GetBaseRollPitchYawRate();
 
     float *v = vBase.data();
     float *w = wBase.data();
     float *q = quat.data();
 
     // float r[12];
-    Eigen::Matrix<float, 3, 4> foot2ComInWorldFrame = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * (footPosInBaseFrame.colwise() - _quadruped->config->comOffset);
+    Eigen::Matrix<float, 3, 4> foot2ComInWorldFrame = robot->state.GetBaseRotationMatrix() * (footPosInBaseFrame.colwise() - _quadruped->config->comOffset);
     float *r = foot2ComInWorldFrame.data(); // colMajor
     // for (int i = 0; i < 12; i++)
     //     r[i] = pFoot(i / 4, i % 4) - pos[i/4];
@@ -547,7 +549,7 @@ void qrMITConvexMPCStanceLegController::solveDenseMPC(qrRobot *_quadruped)
         for (int axis = 0; axis < 3; ++axis) {
             f(axis, leg) = get_solution(leg * 3 + axis);
         }
-        f_ff.col(leg) = -math::quaternionToRotationMatrix(robot->GetBaseOrientation()) * f.col(leg);
+        f_ff.col(leg) = -robot->state.GetBaseRotationMatrix().transpose() * f.col(leg);
         //seResult.wbcData.Fr_des[leg] = f.col(leg);
     }
 }
@@ -578,8 +580,8 @@ void qrMITConvexMPCStanceLegController::solveSparseMPC(qrRobot *_quadruped)
         }
     }
 
-    Vec3<float> vWorld = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * robot->GetBaseVelocity();
-    Vec3<float> wWorld = math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose() * robot->GetBaseRollPitchYawRate();
+    Vec3<float> vWorld = robot->state.GetBaseRotationMatrix() * robot->GetBaseVelocity();
+    Vec3<float> wWorld = robot->state.GetBaseRotationMatrix() * robot->GetBaseRollPitchYawRate();
     _sparseCMPC.setX0(pos,  vWorld, quat, wWorld);
     _sparseCMPC.setContactTrajectory(contactStates.data(), contactStates.size());
     _sparseCMPC.setStateTrajectory(_sparseTrajectory);
@@ -587,7 +589,7 @@ void qrMITConvexMPCStanceLegController::solveSparseMPC(qrRobot *_quadruped)
     _sparseCMPC.run();
 
     Vec12<float> resultForce = _sparseCMPC.getResult();
-    Mat3<float> baseRMat =  math::quaternionToRotationMatrix(robot->GetBaseOrientation()).transpose();
+    Mat3<float> baseRMat =  robot->state.GetBaseRotationMatrix();
     for (u32 foot = 0; foot < 4; foot++) {
         Vec3<float> force(resultForce[foot * 3], resultForce[foot * 3 + 1], resultForce[foot * 3 + 2]);
         // printf("[%d] %7.3f %7.3f %7.3f\n", foot, force[0], force[1], force[2]);
@@ -778,8 +780,12 @@ void qrMITConvexMPCStanceLegController::UpdateDesCommand()
 
     stateCur << robotQ, robotDq;
 
-    std::cout << "[MPC desired state] " << stateDes.transpose() << std::endl;
-    std::cout << "[MPC current state] " << stateCur.transpose() << std::endl;
+    QR_LOG_DEBUG("[MPC desired state] %f %f %f %f %f %f %f %f %f %f %f %f",
+                 stateDes(0), stateDes(1), stateDes(2), stateDes(3), stateDes(4), stateDes(5),
+                 stateDes(6), stateDes(7), stateDes(8), stateDes(9), stateDes(10), stateDes(11));
+    QR_LOG_DEBUG("[MPC current state] %f %f %f %f %f %f %f %f %f %f %f %f",
+                 stateCur(0), stateCur(1), stateCur(2), stateCur(3), stateCur(4), stateCur(5),
+                 stateCur(6), stateCur(7), stateCur(8), stateCur(9), stateCur(10), stateCur(11));
     //ddqDes.head(6) = desiredDdq;
     // std::cout << "contact for force compute " << contacts.transpose() << std::endl;
 }
@@ -1,6 +1,7 @@
 #include <eigen3/unsupported/Eigen/MatrixFunctions>
 
 #include "controller/mpc/qr_sparse_cmpc.h"
+#include "controller/qr_qp_snapshot.h"
 #include "osqp/osqp.h"
 
 // X0 != x[0]
@@ -111,6 +112,9 @@ void SparseCMPC::run() {
   addQuadraticControlCost();
   //printf("t2: %.3f\n", timer.getMs());
 
+  if(qrQpSnapshotRecorder::Instance().IsEnabled(QP_SNAPSHOT_SPARSE_CMPC))
+    recordSnapshot();
+
   // Solve!
   //runSolver();
   runSolverOSQP();
@@ -382,6 +386,25 @@ void SparseCMPC::addLinearStateCost() {
 
 }
 
+void SparseCMPC::recordSnapshot() {
+  qrQpSnapshot snapshot;
+  snapshot.source = QP_SNAPSHOT_SPARSE_CMPC;
+  snapshot.SetHessian(_costTriples, 12 * _trajectoryLength + 3 * _bBlockCount);
+  snapshot.m = _constraintCount;
+  snapshot.g = _linearCost;
+  snapshot.A = _constraintTriples;
+  snapshot.lb = _lb;
+  snapshot.ub = _ub;
+  std::vector<u8> contacts(4 * _trajectoryLength);
+  for(u32 i = 0; i < _trajectoryLength; i++) {
+    for(u32 j = 0; j < 4; j++) {
+      contacts[4 * i + j] = _contactTrajectory[i][j];
+    }
+  }
+  snapshot.SetGait(contacts.data(), _trajectoryLength);
+  qrQpSnapshotRecorder::Instance().Record(snapshot);
+}
+
 void SparseCMPC::runSolver() {
   u32 varCount = 12 * _trajectoryLength + 3 * _bBlockCount;
   //printf("[SparseCMPC] Run %d, %d\n", varCount, _constraintCount);
@@ -23,6 +23,7 @@
 // SOFTWARE. 
 
 #include "controller/qr_foot_trajectory_generator.h"
+#include "common/qr_log.h"
 
 
 qrFootBSplinePatternGenerator::qrFootBSplinePatternGenerator(qrSplineInfo &splineInfo) {
@@ -60,7 +61,7 @@ void qrFootBSplinePatternGenerator::SetParameters(const float initial_time,
     float step2d_dist = fabs(step_delta.head<2>().norm());
     float step_theta;
     if (step2d_dist < 1e-3) {
-        printf("[warning] no xy-plane movement, set foot hight default value!\n");
+        QR_LOG_WARN_EVERY(1.f, "no xy-plane movement, set foot hight default value!");
         step_theta = 0.f;
     } else {
         step_theta = atan(height_dist / step2d_dist);
@@ -160,7 +161,7 @@ void qrFootSplinePatternGenerator::SetParameters(const float initial_time,
     float step2d_dist = fabs(step_delta.head<2>().norm());
     float step_theta;
     if (step2d_dist < 1e-3) {
-        printf("[warning] no xy-plane movement, set foot hight default value!\n");
+        QR_LOG_WARN_EVERY(1.f, "no xy-plane movement, set foot hight default value!");
         step_theta = 0.f;
     } else {
         step_theta = atan(height_dist / step2d_dist);
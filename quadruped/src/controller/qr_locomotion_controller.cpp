@@ -24,6 +24,10 @@
 
 #include "controller/qr_locomotion_controller.h"
 
+#include <algorithm>
+
+#include "common/qr_log.h"
+
 qrLocomotionController::qrLocomotionController(qrRobot *robotIn,
                                             qrGaitGenerator *gaitGeneratorIn,
                                             qrRobotEstimator *stateEstimatorIn,
@@ -33,7 +37,8 @@ qrLocomotionController::qrLocomotionController(qrRobot *robotIn,
                                             qrStanceLegController *stanceLegControllerIn)
 :
     robot(robotIn), gaitGenerator(gaitGeneratorIn), stateEstimator(stateEstimatorIn), groundEstimator(groundEstimatorIn), comPlanner(comPlannerIn),
-    swingLegController(swingLegControllerIn), stanceLegController(stanceLegControllerIn)
+    swingLegController(swingLegControllerIn), stanceLegController(stanceLegControllerIn),
+    statePredictor(robotIn->config)
 {
     resetTime = robot->GetTimeSinceReset();
     timeSinceReset = 0.;
@@ -43,6 +48,7 @@ void qrLocomotionController::Reset()
 {
     resetTime = robot->GetTimeSinceReset();
     timeSinceReset = 0.;
+    stateHistory.Clear();
     gaitGenerator->Reset(timeSinceReset);
     stateEstimator->Reset(timeSinceReset);
     groundEstimator->Reset(timeSinceReset);
@@ -51,29 +57,32 @@ void qrLocomotionController::Reset()
     stanceLegController->Reset(timeSinceReset);
 }
 
-void qrLocomotionController::GetComPositionInWorldFrame(ros::ServiceClient& baseStateClient)
+void qrLocomotionController::SetGroundTruth(qrGroundTruth *groundTruthIn)
 {
-    gazebo_msgs::GetLinkState gls_request;
-    if (baseStateClient.exists()) { 
-        gls_request.request.link_name = std::string("a1_gazebo::base");
-        gls_request.request.reference_frame=std::string("world"); 
-        baseStateClient.call(gls_request);
-        if (!gls_request.response.success) {
-                ROS_INFO("Get Gazebo link state not success!\n");      
-        }
-    } else { 
-        ROS_INFO("Get Gazebo link state goes wrong!\n"); 
+    groundTruth = groundTruthIn;
+    groundTruthErrorMetrics.Reset();
+}
+
+void qrLocomotionController::GetComPositionInWorldFrame()
+{
+    if (!groundTruth) {
+        return;
     }
-    
-    const auto & pose_ = gls_request.response.link_state.pose; 
-    Vec3<double> posIn = {pose_.position.x, pose_.position.y, pose_.position.z};
-    Quat<double> OrientationIn = {pose_.orientation.w,pose_.orientation.x,pose_.orientation.y,pose_.orientation.z};
-    robot->gazeboBasePosition = posIn.cast<float>(); 
-    robot->gazeboBaseOrientation = OrientationIn.cast<float>();
+    const qrGroundTruthPose &truth = groundTruth->GetLatest();
+    if (truth.sequence == 0) {
+        QR_LOG_WARN_EVERY(1.f, "no ground truth pose received yet");
+        return;
+    }
+    robot->gazeboBasePosition = truth.position;
+    robot->gazeboBaseOrientation = truth.orientation;
 }
 
 void qrLocomotionController::Update()
 {
+    // config files edited since the last tick take effect from here on
+    qrConfigWatcher::Instance().Acquire();
+    GetComPositionInWorldFrame();
+
     // robot is running means swingSemaphore not 0 or swingSemaphore is 0 but not robot are not switching to swing. 
     if (!robot->stop) { 
         timeSinceReset = robot->GetTimeSinceReset() - resetTime;
@@ -82,6 +91,22 @@ void qrLocomotionController::Update()
     gaitGenerator->Update(timeSinceReset);
     groundEstimator->Update(timeSinceReset);
     stateEstimator->Update(timeSinceReset);
+    if (groundTruth) {
+        // the filter's own estimate, before the ground truth overrides it in simulation
+        groundTruthErrorMetrics.Add(groundTruth->GetLatest(),
+                                    stateEstimator->GetFilteredPosition(),
+                                    stateEstimator->GetFilteredVelocity(),
+                                    stateEstimator->GetEstimatedRPY()[2],
+                                    qrGroundTruth::Now());
+        const qrGroundTruthErrorMetrics &metrics = groundTruthErrorMetrics;
+        QR_LOG_INFO_EVERY(5.f, "estimator vs ground truth over %llu samples: position rms %.3f %.3f %.3f m, "
+                          "velocity rms %.3f %.3f %.3f m/s, yaw rms %.4f rad, max age %.1f ms",
+                          (unsigned long long) metrics.Count(),
+                          metrics.PositionRms()[0], metrics.PositionRms()[1], metrics.PositionRms()[2],
+                          metrics.VelocityRms()[0], metrics.VelocityRms()[1], metrics.VelocityRms()[2],
+                          metrics.YawRms(), 1e3f * metrics.MaxAge());
+    }
+    CompensateLatency();
 
     // only in position mode
     comPlanner->Update(timeSinceReset);
@@ -89,6 +114,46 @@ void qrLocomotionController::Update()
     stanceLegController->Update(robot->GetTimeSinceReset() - resetTime);
 }
 
+void qrLocomotionController::CompensateLatency()
+{
+    qrRobotState &state = robot->state;
+    qrStateSample &sample = stateHistory.Push(robot->GetTimeSinceReset());
+    sample.motorAngles = state.motorAngles;
+    sample.motorVelocities = state.motorVelocities;
+    sample.basePosition = state.basePosition;
+    sample.baseOrientation = state.baseOrientation;
+    sample.baseVelocity = state.GetBaseRotationMatrix() * stateEstimator->GetEstimatedVelocity();
+    sample.baseAngularVelocity = state.baseRollPitchYawRate;
+    sample.footContact = state.footContact;
+    latencyEstimator.Update(stateHistory, robot->GetTimeStep());
+    QR_LOG_INFO_EVERY(5.f, "loop latency %.1f ms (correlation %.2f, converged %d), compute time mean %.2f ms, max %.2f ms",
+                      1e3f * latencyEstimator.GetLatency(), latencyEstimator.GetCorrelation(),
+                      (int) latencyEstimator.IsConverged(), 1e3f * latencyEstimator.GetMeanComputeTime(),
+                      1e3f * latencyEstimator.GetMaxComputeTime());
+
+    const qrRobotConfig *config = robot->config;
+    if (!config->latencyCompensation) {
+        return;
+    }
+    // until the estimator has converged its lag and joint response are noise: predict only over a fixed
+    // latency then, with every joint keeping its velocity
+    static const Eigen::Matrix<float, 12, 1> noJointResponse = Eigen::Matrix<float, 12, 1>::Zero();
+    const bool converged = latencyEstimator.IsConverged();
+    if (!converged && config->fixedLatency < 0.f) {
+        return;
+    }
+    float horizon = config->fixedLatency >= 0.f ? config->fixedLatency : latencyEstimator.GetLatency();
+    horizon = std::min(horizon, config->maxLatency);
+    if (horizon <= 0.f) {
+        return;
+    }
+    const Eigen::Matrix<float, 12, 1> &jointResponse = converged ? latencyEstimator.GetJointResponse() : noJointResponse;
+    statePredictor.Predict(stateHistory, jointResponse, horizon, robot->GetTimeStep(), predictedState);
+    state.SetPredictedState(predictedState.motorAngles, predictedState.motorVelocities,
+                            predictedState.baseOrientation, predictedState.baseAngularVelocity);
+    stateEstimator->SetPredictedState(predictedState.basePosition, predictedState.baseVelocity);
+}
+
 std::tuple<std::vector<qrMotorCommand>, Eigen::Matrix<float, 3, 4>> qrLocomotionController::GetAction()
 {
     action.clear();
@@ -105,5 +170,9 @@ std::tuple<std::vector<qrMotorCommand>, Eigen::Matrix<float, 3, 4>> qrLocomotion
             action.push_back(stanceAction[joint_id]);
         }
     }
+    if (stateHistory.Size() > 0) {
+        stateHistory.RecordCommand(qrMotorCommand::convertToMatix(action), qpSol);
+        latencyEstimator.AddComputeTime(robot->GetTimeSinceReset() - stateHistory.Get(0).time);
+    }
     return {action, qpSol};
 }
\ No newline at end of file
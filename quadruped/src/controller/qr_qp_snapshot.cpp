@@ -0,0 +1,308 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "controller/qr_qp_snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+namespace {
+
+const u32 kSnapshotMagic = 0x4e535051; // "QPSN"
+const u32 kSnapshotVersion = 1;
+
+static_assert(sizeof(SparseTriple<double>) == 16, "snapshot triplets are written as raw 16 byte records");
+
+template<typename T>
+void WritePod(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void WriteArray(std::ostream& out, const std::vector<T>& values)
+{
+    if (!values.empty()) {
+        out.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+    }
+}
+
+template<typename T>
+bool ReadPod(std::istream& in, T& value)
+{
+    return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+template<typename T>
+bool ReadArray(std::istream& in, std::vector<T>& values, u64 size)
+{
+    values.resize(size);
+    if (size == 0) {
+        return true;
+    }
+    return bool(in.read(reinterpret_cast<char*>(values.data()), sizeof(T) * size));
+}
+
+/**
+ * @brief Bytes left between the read position and the end of the stream,
+ * or the largest u64 if the stream cannot seek.
+ */
+u64 RemainingBytes(std::istream& in)
+{
+    std::istream::pos_type position = in.tellg();
+    if (position == std::istream::pos_type(-1)) {
+        return std::numeric_limits<u64>::max();
+    }
+    in.seekg(0, std::ios::end);
+    std::istream::pos_type end = in.tellg();
+    in.seekg(position);
+    if (end == std::istream::pos_type(-1) || end < position) {
+        return std::numeric_limits<u64>::max();
+    }
+    return u64(end - position);
+}
+
+bool TriplesInRange(const std::vector<SparseTriple<double>>& triples, u32 rows, u32 cols)
+{
+    for (const auto& tri : triples) {
+        if (tri.r >= rows || tri.c >= cols) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void qrQpSnapshot::SetHessian(const std::vector<SparseTriple<double>>& triples, u32 size)
+{
+    n = size;
+    H.clear();
+    for (const auto& tri : triples) {
+        if (tri.r <= tri.c) {
+            H.push_back(tri);
+        }
+    }
+}
+
+Eigen::MatrixXd qrQpSnapshot::DenseHessian() const
+{
+    Eigen::MatrixXd dense = Eigen::MatrixXd::Zero(n, n);
+    for (const auto& tri : H) {
+        dense(tri.r, tri.c) += tri.value;
+        if (tri.r != tri.c) {
+            dense(tri.c, tri.r) += tri.value;
+        }
+    }
+    return dense;
+}
+
+std::vector<SparseTriple<double>> qrQpSnapshot::FullHessianTriples() const
+{
+    std::vector<SparseTriple<double>> triples;
+    triples.reserve(2 * H.size());
+    for (const auto& tri : H) {
+        triples.push_back(tri);
+        if (tri.r != tri.c) {
+            triples.push_back({tri.value, tri.c, tri.r});
+        }
+    }
+    return triples;
+}
+
+Eigen::MatrixXd qrQpSnapshot::DenseConstraintMatrix() const
+{
+    Eigen::MatrixXd dense = Eigen::MatrixXd::Zero(m, n);
+    for (const auto& tri : A) {
+        dense(tri.r, tri.c) += tri.value;
+    }
+    return dense;
+}
+
+double qrQpSnapshot::Objective(const Eigen::VectorXd& x) const
+{
+    double value = 0;
+    for (const auto& tri : H) {
+        value += (tri.r == tri.c ? 0.5 : 1.0) * x[tri.r] * tri.value * x[tri.c];
+    }
+    for (u32 i = 0; i < n; ++i) {
+        value += g[i] * x[i];
+    }
+    return value;
+}
+
+double qrQpSnapshot::ConstraintViolation(const Eigen::VectorXd& x) const
+{
+    Eigen::VectorXd ax = Eigen::VectorXd::Zero(m);
+    for (const auto& tri : A) {
+        ax[tri.r] += tri.value * x[tri.c];
+    }
+    double violation = 0;
+    for (u32 i = 0; i < m; ++i) {
+        violation = std::max(violation, std::max(lb[i] - ax[i], ax[i] - ub[i]));
+    }
+    return violation;
+}
+
+bool WriteQpSnapshot(std::ostream& out, const qrQpSnapshot& snapshot)
+{
+    WritePod(out, kSnapshotMagic);
+    WritePod(out, kSnapshotVersion);
+    WritePod(out, snapshot.source);
+    WritePod(out, snapshot.sequence);
+    WritePod(out, snapshot.timestamp);
+    WritePod(out, snapshot.n);
+    WritePod(out, snapshot.m);
+    WritePod(out, u32(snapshot.H.size()));
+    WritePod(out, u32(snapshot.A.size()));
+    WritePod(out, snapshot.gaitSteps);
+    WriteArray(out, snapshot.H);
+    WriteArray(out, snapshot.g);
+    WriteArray(out, snapshot.A);
+    WriteArray(out, snapshot.lb);
+    WriteArray(out, snapshot.ub);
+    WriteArray(out, snapshot.gait);
+    return bool(out);
+}
+
+bool ReadQpSnapshot(std::istream& in, qrQpSnapshot& snapshot)
+{
+    u32 magic, version, nnzH, nnzA;
+    if (!ReadPod(in, magic)) {
+        return false;
+    }
+    if (magic != kSnapshotMagic || !ReadPod(in, version) || version != kSnapshotVersion) {
+        std::cerr << "[QP snapshot] bad record header" << std::endl;
+        return false;
+    }
+    bool ok = ReadPod(in, snapshot.source) && ReadPod(in, snapshot.sequence) && ReadPod(in, snapshot.timestamp)
+              && ReadPod(in, snapshot.n) && ReadPod(in, snapshot.m) && ReadPod(in, nnzH) && ReadPod(in, nnzA)
+              && ReadPod(in, snapshot.gaitSteps);
+    if (!ok) {
+        std::cerr << "[QP snapshot] truncated record" << std::endl;
+        return false;
+    }
+    // check the sizes against the file before allocating, a corrupt count must not turn into a huge resize
+    u64 payload = sizeof(SparseTriple<double>) * (u64(nnzH) + u64(nnzA)) + sizeof(double) * (u64(snapshot.n) + 2 * u64(snapshot.m))
+                  + 4 * u64(snapshot.gaitSteps);
+    if (payload > RemainingBytes(in)) {
+        std::cerr << "[QP snapshot] record sizes exceed the file, n = " << snapshot.n << ", m = " << snapshot.m
+                  << ", nnz(H) = " << nnzH << ", nnz(A) = " << nnzA << std::endl;
+        in.setstate(std::ios::failbit);
+        return false;
+    }
+    ok = ReadArray(in, snapshot.H, nnzH) && ReadArray(in, snapshot.g, snapshot.n)
+         && ReadArray(in, snapshot.A, nnzA) && ReadArray(in, snapshot.lb, snapshot.m)
+         && ReadArray(in, snapshot.ub, snapshot.m) && ReadArray(in, snapshot.gait, 4 * u64(snapshot.gaitSteps));
+    if (!ok) {
+        std::cerr << "[QP snapshot] truncated record" << std::endl;
+        return false;
+    }
+    if (!TriplesInRange(snapshot.H, snapshot.n, snapshot.n) || !TriplesInRange(snapshot.A, snapshot.m, snapshot.n)) {
+        std::cerr << "[QP snapshot] triplet index out of range in record " << snapshot.sequence << std::endl;
+        in.setstate(std::ios::failbit);
+        return false;
+    }
+    return true;
+}
+
+qrQpSnapshotRecorder& qrQpSnapshotRecorder::Instance()
+{
+    static qrQpSnapshotRecorder recorder;
+    return recorder;
+}
+
+qrQpSnapshotRecorder::qrQpSnapshotRecorder()
+{
+    const char* path = std::getenv("QR_QP_SNAPSHOT");
+    if (path == nullptr || *path == '\0') {
+        return;
+    }
+    const char* sources = std::getenv("QR_QP_SNAPSHOT_SOURCES");
+    const char* decimation_ = std::getenv("QR_QP_SNAPSHOT_DECIMATION");
+    u32 mask = sources ? u32(std::strtoul(sources, nullptr, 0)) : u32(QP_SNAPSHOT_ALL);
+    if (Open(path, mask, decimation_ ? u32(std::strtoul(decimation_, nullptr, 10)) : 1)) {
+        std::cout << "[QP snapshot] recording sources 0x" << std::hex << mask << std::dec << " into " << path << std::endl;
+    }
+}
+
+qrQpSnapshotRecorder::~qrQpSnapshotRecorder()
+{
+    Close();
+}
+
+bool qrQpSnapshotRecorder::Open(const std::string& path, u32 sources, u32 decimation_)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (file.is_open()) {
+        file.close();
+    }
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "[QP snapshot] cannot open " << path << std::endl;
+        sourceMask = 0;
+        return false;
+    }
+    decimation = std::max<u32>(decimation_, 1);
+    count = 0;
+    for (auto& counter : solveCounters) {
+        counter = 0;
+    }
+    sourceMask = sources;
+    return true;
+}
+
+void qrQpSnapshotRecorder::Close()
+{
+    sourceMask = 0;
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+bool qrQpSnapshotRecorder::IsEnabled(QpSnapshotSource source)
+{
+    if (!(sourceMask.load(std::memory_order_relaxed) & source)) {
+        return false;
+    }
+    int index = source == QP_SNAPSHOT_DENSE_MPC ? 0 : (source == QP_SNAPSHOT_SPARSE_CMPC ? 1 : 2);
+    return solveCounters[index]++ % decimation == 0;
+}
+
+void qrQpSnapshotRecorder::Record(qrQpSnapshot& snapshot)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (!file.is_open()) {
+        return;
+    }
+    snapshot.sequence = count++;
+    snapshot.timestamp = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    if (!WriteQpSnapshot(file, snapshot)) {
+        std::cerr << "[QP snapshot] write failed, recording stopped" << std::endl;
+        sourceMask = 0;
+        file.close();
+    }
+}
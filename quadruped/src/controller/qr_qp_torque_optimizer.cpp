@@ -23,9 +23,150 @@
 // SOFTWARE.
 
 #include "controller/qr_qp_torque_optimizer.h"
+#include "controller/qr_qp_snapshot.h"
+#include "controller/qr_active_set_qp.h"
+#include "common/qr_log.h"
 #include "quadprogpp/QuadProg++.hh"
 #include "quadprogpp/Array.hh"
 
+/** @brief Record the stance force QP  min 0.5 x'Gx - a'x  s.t.  Ci'x >= b  if snapshots are enabled. */
+static void RecordContactForceSnapshot(const Eigen::Matrix<float, 12, 12>& G,
+                                       const Eigen::Matrix<float, 12, 1>& a,
+                                       const Eigen::Matrix<float, 12, 24>& Ci,
+                                       const Eigen::Matrix<float, 24, 1>& b,
+                                       const Eigen::Matrix<bool, 4, 1>& contacts)
+{
+    if (!qrQpSnapshotRecorder::Instance().IsEnabled(QP_SNAPSHOT_CONTACT_FORCE)) {
+        return;
+    }
+    qrQpSnapshot snapshot;
+    snapshot.source = QP_SNAPSHOT_CONTACT_FORCE;
+    snapshot.SetHessian(G);
+    snapshot.SetGradient(-a);
+    snapshot.SetConstraintMatrix(Ci.transpose());
+    snapshot.SetBounds(b, Eigen::Matrix<float, 24, 1>::Constant(std::numeric_limits<float>::infinity()));
+    snapshot.SetGait(contacts.data(), 1);
+    qrQpSnapshotRecorder::Instance().Record(snapshot);
+}
+
+/** @brief
+ * Solve the stance force QP  min 0.5 x'Gx - a'x  s.t.  Ci'x >= b  over the forces of the N stance legs only.
+ * Swing legs are pinned to zero force by their constraints, so their variables and the 6 constraints of each
+ * swing leg are dropped. If the unconstrained weighted least squares solution lies inside every friction
+ * pyramid it is the optimum, otherwise the active set solver of this contact count is called, which is warm
+ * started from the active set of its last solve.
+ * @param stanceLegs : ids of the N stance legs.
+ * @param x : the solution of all 12 variables, zero for the swing legs.
+ * @return false if the QP is infeasible or the active set solver did not converge.
+ */
+template<int N>
+static bool SolveStanceForces(const Eigen::Matrix<float, 12, 12>& G,
+                              const Eigen::Matrix<float, 12, 1>& a,
+                              const Eigen::Matrix<float, 12, 24>& Ci,
+                              const Eigen::Matrix<float, 24, 1>& b,
+                              const int* stanceLegs,
+                              Eigen::Matrix<double, 12, 1>& x)
+{
+    static qrActiveSetQp<3 * N, 6 * N> qp;
+    Eigen::Matrix<double, 3 * N, 3 * N> Gr;
+    Eigen::Matrix<double, 3 * N, 1> ar;
+    Eigen::Matrix<double, 3 * N, 6 * N> Cr = Eigen::Matrix<double, 3 * N, 6 * N>::Zero();
+    Eigen::Matrix<double, 6 * N, 1> br;
+    for (int i = 0; i < N; ++i) {
+        const int legId = stanceLegs[i];
+        for (int j = 0; j < N; ++j) {
+            Gr.template block<3, 3>(3 * i, 3 * j) = G.block<3, 3>(3 * legId, 3 * stanceLegs[j]).cast<double>();
+        }
+        ar.template segment<3>(3 * i) = -a.segment<3>(3 * legId).cast<double>();
+        // the normal force bounds and the friction pyramid of this leg
+        const int columns[6] = {2 * legId, 2 * legId + 1, 8 + 4 * legId, 9 + 4 * legId, 10 + 4 * legId, 11 + 4 * legId};
+        for (int k = 0; k < 6; ++k) {
+            Cr.template block<3, 1>(3 * i, 6 * i + k) = Ci.block<3, 1>(3 * legId, columns[k]).cast<double>();
+            br[6 * i + k] = b[columns[k]];
+        }
+    }
+
+    Eigen::Matrix<double, 3 * N, 1> xr = Gr.llt().solve(-ar);
+    bool feasible = true;
+    if ((Cr.transpose() * xr - br).minCoeff() < 0.0) {
+        feasible = qp.Solve(Gr, ar, Cr, br, xr);
+    } else {
+        // no constraint is active
+        qp.ResetWarmStart();
+    }
+
+    x.setZero();
+    for (int i = 0; i < N; ++i) {
+        x.segment<3>(3 * stanceLegs[i]) = xr.template segment<3>(3 * i);
+    }
+    return feasible;
+}
+
+/** @brief Dispatch the stance force QP to the solver specialized for the number of stance legs. */
+static bool SolveContactForceQp(const Eigen::Matrix<float, 12, 12>& G,
+                                const Eigen::Matrix<float, 12, 1>& a,
+                                const Eigen::Matrix<float, 12, 24>& Ci,
+                                const Eigen::Matrix<float, 24, 1>& b,
+                                const Eigen::Matrix<bool, 4, 1>& contacts,
+                                Eigen::Matrix<double, 12, 1>& x)
+{
+    int stanceLegs[4];
+    int stanceNum = 0;
+    for (int legId = 0; legId < 4; ++legId) {
+        if (contacts[legId]) {
+            stanceLegs[stanceNum++] = legId;
+        }
+    }
+    switch (stanceNum) {
+        case 1: return SolveStanceForces<1>(G, a, Ci, b, stanceLegs, x);
+        case 2: return SolveStanceForces<2>(G, a, Ci, b, stanceLegs, x);
+        case 3: return SolveStanceForces<3>(G, a, Ci, b, stanceLegs, x);
+        case 4: return SolveStanceForces<4>(G, a, Ci, b, stanceLegs, x);
+        default:
+            x.setZero();
+            return true;
+    }
+}
+
+/** @brief
+ * Fallback for a failed active set solve: the full 12 variable QP with quadprog++, which allocates.
+ * If the QP is infeasible, x is quadprog++'s last iterate.
+ */
+static void SolveContactForceQuadProg(const Eigen::Matrix<float, 12, 12>& G,
+                                      const Eigen::Matrix<float, 12, 1>& a,
+                                      const Eigen::Matrix<float, 12, 24>& Ci,
+                                      const Eigen::Matrix<float, 24, 1>& b,
+                                      Eigen::Matrix<double, 12, 1>& x)
+{
+    quadprogpp::Matrix<double> GG(12, 12);
+    for (int i = 0; i < 12; i++) {
+        for (int j = 0; j < 12; j++) {
+            GG[i][j] = double(G(j, i));
+        }
+    }
+    quadprogpp::Vector<double> aa(12);
+    for (int i = 0; i < 12; i++) {
+        aa[i] = double(-a(i, 0));
+    }
+    quadprogpp::Matrix<double> CICI(12, 24);
+    for (int i = 0; i < 12; i++) {
+        for (int j = 0; j < 24; j++) {
+            CICI[i][j] = double(Ci(i, j));
+        }
+    }
+    quadprogpp::Vector<double> bb(24);
+    for (int i = 0; i < 24; i++) {
+        bb[i] = double(-b(i, 0));
+    }
+    quadprogpp::Matrix<double> CECE(12, 0);
+    quadprogpp::Vector<double> ee(0);
+    quadprogpp::Vector<double> xx(12);
+    quadprogpp::solve_quadprog(GG, aa, CECE, ee, CICI, bb, xx);
+    for (int i = 0; i < 12; i++) {
+        x[i] = xx[i];
+    }
+}
+
 /** @brief
  * @param robotMass : float, ture mass of robot.
  * @param robotInertia : Eigen::Matrix<float, 3, 3>, should expressed in control frame.
@@ -79,8 +220,9 @@ std::tuple<Eigen::Matrix<float, 12, 24>, Eigen::Matrix<float, 24, 1>> ComputeCon
             lb(legId * 2, 0) = fMin;
             lb(legId * 2 + 1, 0) = -fMax;
         } else {
-            lb(legId * 2, 0) = 1e-7;
-            lb(legId * 2 + 1, 0) = 1e-7;
+            // fz >= 0 and -fz >= 0, a swing leg carries no force
+            lb(legId * 2, 0) = 0;
+            lb(legId * 2 + 1, 0) = 0;
         }
     }
     // Friction cone constraints
@@ -137,7 +279,6 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
                                                 float fMaxRatio)
 {
     
-    Quat<float> quat = robot->GetBaseOrientation();
     Vec3<float> controlFrameRPY = groundEstimator->GetControlFrameRPY();
     Mat3<float> rotMatControlFrame = groundEstimator->GetAlignedDirections();
     Eigen::Matrix<float, 6, 1> g = Eigen::Matrix<float, 6, 1>::Zero();
@@ -148,7 +289,7 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
         rotMat = Mat3<float>::Identity(); // control in base frame
     } else {
         // convert inertia in base frame to confrol frame
-        rotMat = rotMatControlFrame.transpose() * math::quaternionToRotationMatrix(quat).transpose();
+        rotMat = rotMatControlFrame.transpose() * robot->state.GetBaseRotationMatrix();
         // convert g from world frame to control frame
         g.head(3) = rotMatControlFrame.transpose() * g.head(3);
         fMaxRatio = fMaxRatio * cos(-controlFrameRPY[1]);
@@ -171,31 +312,13 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
     CI = ComputeConstraintMatrix(robot->config->bodyMass, contacts, frictionCoef, fMinRatio, fMaxRatio);
     Ci = std::get<0>(CI);
     b = std::get<1>(CI);
+    RecordContactForceSnapshot(G, a, Ci, b, contacts);
 
-    quadprogpp::Matrix<double> GG(12, 12);
-    for (int i = 0; i < 12; i++) {
-        for (int j = 0; j < 12; j++) {
-            GG[i][j] = double(G(j, i));
-        }
-    }
-    quadprogpp::Vector<double> aa(12);
-    for (int i = 0; i < 12; i++) {
-        aa[i] = double(-a(i, 0));
-    }
-    quadprogpp::Matrix<double> CICI(12, 24);
-    for (int i = 0; i < 12; i++) {
-        for (int j = 0; j < 24; j++) {
-            CICI[i][j] = double(Ci(i, j));
-        }
-    }
-    quadprogpp::Vector<double> bb(24);
-    for (int i = 0; i < 24; i++) {
-        bb[i] = double(-b(i, 0));
+    Eigen::Matrix<double, 12, 1> x;
+    if (!SolveContactForceQp(G, a, Ci, b, contacts, x)) {
+        QR_LOG_WARN_EVERY(1.f, "[QP solver] active set solve failed, falling back to quadprog++");
+        SolveContactForceQuadProg(G, a, Ci, b, x);
     }
-    quadprogpp::Matrix<double> CECE(12, 0);
-    quadprogpp::Vector<double> ee(0);
-    quadprogpp::Vector<double> x(12);
-    quadprogpp::solve_quadprog(GG, aa, CECE, ee, CICI, bb, x);
     //reshape x from (12,) to (4,3)
     Eigen::Matrix<float, 4, 3> X;
     int invalidResNum = 0;
@@ -210,7 +333,7 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
                 X(i, j) = 0.f;
             }
         }
-        std::cout << "[QP solver] No solution :" << invalidResNum << std::endl;
+        QR_LOG_WARN_EVERY(1.f, "[QP solver] No solution: %d", invalidResNum);
     } else {
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 3; ++j) {
@@ -237,8 +360,8 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
 {
     Quat<float> quat = robot->GetBaseOrientation();
     Eigen::Matrix<float,3,4> footPositionsInBaseFrame = robot->state.GetFootPositionsInBaseFrame();
-    Mat3<float> rotMat = math::quaternionToRotationMatrix(quat).transpose();
-    Eigen::Matrix<float, 3, 4> footPositionsInCOMWorldFrame = math::invertRigidTransform<float,4>({0.f,0.f,0.f},quat, footPositionsInBaseFrame);
+    Mat3<float> rotMat = robot->state.GetBaseRotationMatrix();
+    Eigen::Matrix<float, 3, 4> footPositionsInCOMWorldFrame = rotMat * footPositionsInBaseFrame;
     Eigen::Matrix<float, 6, 12> massMatrix = ComputeMassMatrix(robot->config->bodyMass,
                                                                 robot->config->bodyInertia,
                                                                 footPositionsInCOMWorldFrame.transpose(),
@@ -258,31 +381,13 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
     CI = ComputeConstraintMatrix(robot->config->bodyMass, contacts, frictionCoef, fMinRatio, fMaxRatio, normal, tangent1, tangent2);
     Ci = std::get<0>(CI);
     b = std::get<1>(CI);
+    RecordContactForceSnapshot(G, a, Ci, b, contacts);
 
-    quadprogpp::Matrix<double> GG(12, 12);
-    for (int i = 0; i < 12; i++) {
-        for (int j = 0; j < 12; j++) {
-            GG[i][j] = double(G(j, i));
-        }
-    }
-    quadprogpp::Vector<double> aa(12);
-    for (int i = 0; i < 12; i++) {
-        aa[i] = double(-a(i, 0));
+    Eigen::Matrix<double, 12, 1> x;
+    if (!SolveContactForceQp(G, a, Ci, b, contacts, x)) {
+        QR_LOG_WARN_EVERY(1.f, "[QP solver] active set solve failed, falling back to quadprog++");
+        SolveContactForceQuadProg(G, a, Ci, b, x);
     }
-    quadprogpp::Matrix<double> CICI(12, 24);
-    for (int i = 0; i < 12; i++) {
-        for (int j = 0; j < 24; j++) {
-            CICI[i][j] = double(Ci(i, j));
-        }
-    }
-    quadprogpp::Vector<double> bb(24);
-    for (int i = 0; i < 24; i++) {
-        bb[i] = double(-b(i, 0));
-    }
-    quadprogpp::Matrix<double> CECE(12, 0);
-    quadprogpp::Vector<double> ee(0);
-    quadprogpp::Vector<double> x(12);
-    quadprogpp::solve_quadprog(GG, aa, CECE, ee, CICI, bb, x);
     //reshape x from (12,) to (4,3)
     Eigen::Matrix<float, 4, 3> X;
     int invalidResNum = 0;
@@ -297,7 +402,7 @@ Eigen::Matrix<float, 3, 4> ComputeContactForce(qrRobot *robot,
                 X(i, j) = 0.f;
             }
         }
-        std::cerr << "[QP solver] No solution :" << invalidResNum << std::endl;
+        QR_LOG_ERROR_EVERY(1.f, "[QP solver] No solution: %d", invalidResNum);
         throw std::domain_error("qp torque");
     } else {
         for (int i = 0; i < 4; ++i) {
@@ -360,8 +465,9 @@ std::tuple<Eigen::Matrix<float, 12, 24>, Eigen::Matrix<float, 24, 1>> ComputeCon
             lb(legId * 2, 0) = fMinRatio[legId] * mpcBodyMass * 9.8;
             lb(legId * 2 + 1, 0) = -fMaxRatio[legId] * mpcBodyMass * 9.8;
         } else {
-            lb(legId * 2, 0) = 1e-7;
-            lb(legId * 2 + 1, 0) = 1e-7;
+            // fz >= 0 and -fz >= 0, a swing leg carries no force
+            lb(legId * 2, 0) = 0;
+            lb(legId * 2 + 1, 0) = 0;
         }
     }
     // Friction cone constraints not parallel with world frame.
@@ -30,36 +30,35 @@ using namespace std;
 // The position correction coefficients in Raibert's formula.
 const Matrix<float, 3, 1> swingKp(0.03, 0.03, 0.03);
 
-float qrSwingLegController::GenParabola(float phase, float start, float mid, float end)
+void qrSwingLegParams::Load(const YAML::Node &node)
 {
-    float mid_phase = 0.5;
-    float deltaOne, deltaTwo, deltaThree, coefa, coefb, coefc;
-    deltaOne = mid - start;
-    deltaTwo = end - start;
-    deltaThree = pow(mid_phase, 2) - mid_phase;
-    coefa = (deltaOne - deltaTwo * mid_phase) / deltaThree;
-    coefb = (deltaTwo * pow(mid_phase, 2) - deltaOne) / deltaThree;
-    coefc = start;
-    return coefa * pow(phase, 2) + coefb * phase + coefc;
+    std::vector<std::vector<float>> footList = node["swing_leg_params"]["foot_in_world"].as<std::vector<std::vector<float>>>();
+    if (footList.size() != 3 || footList[0].size() != 4 || footList[1].size() != 4 || footList[2].size() != 4) {
+        throw std::runtime_error("foot_in_world needs 3 rows of 4 values");
+    }
+    for (int i = 0; i < 3; ++i) {
+        footInWorld.row(i) = Eigen::Matrix<float, 1, 4>::Map(footList[i].data());
+    }
+    footOffset = node["swing_leg_params"]["foot_offset"].as<float>();
+    if (node["swing_leg_params"]["foot_mass"]) {
+        footMass = node["swing_leg_params"]["foot_mass"].as<float>();
+    }
+    if (node["swing_leg_params"]["foot_clearance"]) {
+        footClearance = node["swing_leg_params"]["foot_clearance"].as<float>();
+    }
 }
 
-Matrix<float, 3, 1> qrSwingLegController::GenSwingFootTrajectory(float inputPhase,
-                                                                        Matrix<float, 3, 1> startPos,
-                                                                        Matrix<float, 3, 1> endPos)
+void qrSwingLegParams::Validate() const
 {
-    float phase = inputPhase;
-    if (inputPhase <= 0.5) {
-        phase = 0.8 * sin(inputPhase * M_PI);
-    } else {
-        phase = 0.8 + (inputPhase - 0.5) * 0.4;
+    if (footOffset < 0.f || footOffset > 0.2f) {
+        throw std::runtime_error("foot_offset must be in [0, 0.2]");
+    }
+    if (footMass < 0.f || footMass > 2.f) {
+        throw std::runtime_error("foot_mass must be in [0, 2]");
+    }
+    if (footClearance < 0.f || footClearance > 0.3f) {
+        throw std::runtime_error("foot_clearance must be in [0, 0.3]");
     }
-    float x, y, maxClearance, mid, z;
-    x = (1 - phase) * startPos(0, 0) + phase * endPos(0, 0);
-    y = (1 - phase) * startPos(1, 0) + phase * endPos(1, 0);
-    maxClearance = 0.1;
-    mid = max(endPos(2, 0), startPos(2, 0)) + maxClearance;
-    z = GenParabola(phase, startPos(2, 0), mid, endPos(2, 0));
-    return Matrix<float, 3, 1>(x, y, z);
 }
 
 qrSwingLegController::qrSwingLegController(qrRobot *robot,
@@ -81,25 +80,29 @@ qrSwingLegController::qrSwingLegController(qrRobot *robot,
     this->desiredSpeed = desiredSpeed;
     this->desiredTwistingSpeed = desiredTwistingSpeed;
     this->desiredHeight = Matrix<float, 3, 1>(0, 0, desiredHeight - footClearance);
-    swingLegConfig = YAML::LoadFile(configPath);
-    footInitPose = swingLegConfig["swing_leg_params"]["foot_in_world"].as<std::vector<std::vector<float>>>();
-    footOffset = swingLegConfig["swing_leg_params"]["foot_offset"].as<float>();
+    this->params.reset(new qrConfig<qrSwingLegParams>(configPath));
 }
 
 void qrSwingLegController::Reset(float currentTime)
 { 
     phaseSwitchFootLocalPos = robot->state.GetFootPositionsInBaseFrame();
     phaseSwitchFootGlobalPos = robot->state.GetFootPositionsInWorldFrame();
-    Matrix<float, 1, 4> footX = MatrixXf::Map(&footInitPose[0][0], 1, 4);
-    Matrix<float, 1, 4> footY = MatrixXf::Map(&footInitPose[1][0], 1, 4);
-    Matrix<float, 1, 4> footZ = MatrixXf::Map(&footInitPose[2][0], 1, 4);       
-    
-    footHoldInWorldFrame.row(0) << 0.185f, 0.185f, -0.175f, -0.175f;
-    footHoldInWorldFrame.row(1) << -0.145f, 0.145f, -0.145f, 0.145f;
-    footHoldInWorldFrame.row(2) << 0.f, 0.f, 0.f, 0.f;
-    footHoldInWorldFrame(0, 0) -= 0.05;
-    footHoldInWorldFrame(0, 3) -= 0.05;
+    const qrSwingLegParams &param = params->Get();
+    footHoldInWorldFrame = param.footInWorld;
+    footHoldInWorldFrame(0, 0) -= param.footOffset;
+    footHoldInWorldFrame(0, 3) -= param.footOffset;
+    swingTrajectories.clearance = param.footClearance;
     swingJointAnglesVelocities.clear();
+    swingFeedforwardTorques.setZero();
+    footholdCorrection.setZero();
+    for (int legId = 0; legId < NumLeg; ++legId) {
+        footholdPending[legId] = false;
+    }
+    const Eigen::Matrix<float, 3, 4> &startPos =
+        robot->locomotionMode == LocomotionMode::POSITION_LOCOMOTION ? phaseSwitchFootGlobalPos : phaseSwitchFootLocalPos;
+    for (int legId = 0; legId < NumLeg; ++legId) {
+        swingTrajectories.Start(legId, startPos.col(legId), startPos.col(legId), gaitGenerator->swingDuration[legId]);
+    }
 }
 
 void qrSwingLegController::Update(float currentTime)
@@ -108,6 +111,8 @@ void qrSwingLegController::Update(float currentTime)
     const Vec4<int>& curLegState = gaitGenerator->curLegState;
     // the footHoldOffset is first initialized at qr_robot.h, then update it at qr_ground_estimator.cpp 
     Eigen::Matrix<float, 3, 1> constOffset = {robot->config->footHoldOffset, 0.f, 0.f};
+    // picks up a reloaded foot_clearance, the apex moves with the next Start or SetTarget
+    swingTrajectories.clearance = params->Get().footClearance;
     
     /* 
         detects phase switch for each leg so we can remember the feet position at
@@ -118,6 +123,11 @@ void qrSwingLegController::Update(float currentTime)
                 for (int legId = 0; legId < NumLeg; ++legId) {
                     if (newLegState(legId) == LegState::SWING && newLegState(legId) != gaitGenerator->lastLegState(legId)) {
                         phaseSwitchFootLocalPos.col(legId) = robot->state.GetFootPositionsInBaseFrame().col(legId);
+                        // the target follows Raibert's foothold every tick
+                        swingTrajectories.Start(legId, phaseSwitchFootLocalPos.col(legId), phaseSwitchFootLocalPos.col(legId),
+                                                gaitGenerator->swingDuration[legId]);
+                        footholdPending[legId] = true;
+                        footholdCorrection.col(legId).setZero();
                     }
                 }
             }break;
@@ -135,6 +145,8 @@ void qrSwingLegController::Update(float currentTime)
                             footholdPlanner->UpdateOnce(footHoldInWorldFrame); 
                         }
                         footHoldInWorldFrame.col(legId) += footholdPlanner->GetFootholdsOffset().col(legId);
+                        swingTrajectories.Start(legId, phaseSwitchFootGlobalPos.col(legId), footHoldInWorldFrame.col(legId),
+                                                gaitGenerator->swingDuration[legId]);
                     }
                 }
             }break;
@@ -150,9 +162,7 @@ void qrSwingLegController::Update(float currentTime)
 // The key idea is to stablize the swing foot's location based onthe CoM moving speed.
 // see the following paper for details:https://ieeexplore.ieee.org/document/8593885
 
-void qrSwingLegController::VelocityLocomotionProcess(const Eigen::Matrix<float, 3, 3> &dR, 
-                                                    Matrix<float, 3, 1> &footPositionInBaseFrame, 
-                                                    int legId)
+void qrSwingLegController::VelocityLocomotionProcess(const Eigen::Matrix<float, 3, 3> &dR, int legId)
 {
     Matrix<float, 3, 1> comVelocity;
     Matrix<float, 3, 1> hipOffset;
@@ -181,23 +191,27 @@ void qrSwingLegController::VelocityLocomotionProcess(const Eigen::Matrix<float,
         swingKp.cwiseProduct(targetHipHorizontalVelocity - hipHorizontalVelocity))
             + Matrix<float, 3, 1>(hipOffset[0], hipOffset[1], 0)
             - math::TransformVecByQuat(math::quatInverse(robot->state.baseOrientation), desiredHeight);
-    footPositionInBaseFrame = GenSwingFootTrajectory(gaitGenerator->normalizedPhase[legId],
-                                                    phaseSwitchFootLocalPos.col(legId),
-                                                    footTargetPosition);
+
+    const Mat3<float> &baseR = robot->state.GetBaseRotationMatrix();
+    if (footholdPending[legId]) {
+        // at liftoff, Raibert's foothold at touchdown in world frame is the nominal of the optimizer
+        footholdPending[legId] = false;
+        const Vec3<float> baseDisplacement = baseR * comVelocity * gaitGenerator->swingDuration[legId];
+        const Vec3<float> nominal = baseR * footTargetPosition + robot->state.basePosition + baseDisplacement;
+        Vec3<float> foothold;
+        if (footholdPlanner->OptimizeFoothold(legId, nominal, baseDisplacement, foothold)) {
+            footholdCorrection.col(legId) = foothold - nominal;
+        }
+    }
+    // Raibert's feedback keeps acting during the swing, shifted onto the optimized foothold
+    footTargetPosition += baseR.transpose() * footholdCorrection.col(legId);
+    swingTrajectories.SetTarget(legId, footTargetPosition);
 }
 
-void qrSwingLegController::PositionLocomotionProcess(Matrix<float, 3, 1> &footPositionInWorldFrame, 
-                                                    Matrix<float, 3, 1> &footPositionInBaseFrame, 
-                                                    int legId)
+void qrSwingLegController::PositionLocomotionProcess(int legId)
 {
     // interpolation in world frame
-    footPositionInWorldFrame = GenSwingFootTrajectory(gaitGenerator->normalizedPhase[legId],
-                                                    phaseSwitchFootGlobalPos.col(legId),
-                                                    footHoldInWorldFrame.col(legId)); 
-    // transfer foot position to base frame
-    footPositionInBaseFrame = math::RigidTransform(robot->state.basePosition,
-                                                    robot->state.baseOrientation,
-                                                   footPositionInWorldFrame);
+    swingTrajectories.SetTarget(legId, footHoldInWorldFrame.col(legId));
 }
 
 void qrSwingLegController::UpdateControlParameters(const Vector3f& linSpeed, const float& angSpeed)
@@ -208,55 +222,104 @@ void qrSwingLegController::UpdateControlParameters(const Vector3f& linSpeed, con
 
 map<int, Matrix<float, 5, 1>> qrSwingLegController::GetAction()
 {
-    Matrix<float, 3, 1> footPositionInBaseFrame, footVelocityInBaseFrame, footAccInBaseFrame;
-    Matrix<float, 3, 1> footPositionInWorldFrame, footVelocityInWorldFrame, footAccInWorldFrame;
-    Matrix<float, 3, 1> footPositionInControlFrame, footVelocityInControlFrame, footAccInControlFrame;
     Matrix<int, 3, 1> jointIdx;
     Matrix<float, 3, 1> jointAngles;
-    Matrix<float, 3, 4> hipPositions;
     Matrix<float, 12, 1> currentJointAngles = robot->GetMotorAngles();
+    Matrix<float, 3, 4> footPositionsInBaseFrame = robot->state.GetFootPositionsInBaseFrame();
+    Matrix<float, 3, 4> footVelocitiesInBaseFrame = Matrix<float, 3, 4>::Zero();
+    Matrix<float, 3, 4> footAccsInBaseFrame = Matrix<float, 3, 4>::Zero();
+
+    Quat<float> robotComOrientation = robot->GetBaseOrientation();
+    Mat3<float> robotBaseR = math::quaternionToRotationMatrix(robotComOrientation).transpose();
+    Quat<float> controlFrameOrientation = groundEstimator->GetControlFrameOrientation();
+    // represent base frame in control frame
+    Mat3<float> dR; 
+    if (groundEstimator->terrain.terrainType < 2) {
+        dR = Mat3<float>::Identity();
+        robotBaseR = Mat3<float>::Identity();
+    } else {
+        dR = math::quaternionToRotationMatrix(controlFrameOrientation) * robotBaseR;
+    }
+
+    bool isSwing[NumLeg];
     for (int legId = 0; legId < NumLeg; ++legId) { 
         int tempState = gaitGenerator->legState[legId];
-        if (tempState == LegState::STANCE || tempState == LegState::EARLY_CONTACT) {
+        isSwing[legId] = !(tempState == LegState::STANCE || tempState == LegState::EARLY_CONTACT);
+        if (!isSwing[legId]) {
             continue;
         }
+        switch (robot->locomotionMode) {
+            case LocomotionMode::VELOCITY_LOCOMOTION:
+                VelocityLocomotionProcess(dR, legId);
+                break;
+            case LocomotionMode::POSITION_LOCOMOTION:
+                PositionLocomotionProcess(legId);
+                break;
+            default:
+                break;
+        }
+    }
 
-        footVelocityInBaseFrame = Vec3<float>::Zero();
-        footVelocityInWorldFrame = Vec3<float>::Zero();
-        footVelocityInControlFrame = Vec3<float>::Zero();
-        Quat<float> robotComOrientation = robot->GetBaseOrientation();
-        Mat3<float> robotBaseR = math::quaternionToRotationMatrix(robotComOrientation).transpose();
-        Quat<float> controlFrameOrientation = groundEstimator->GetControlFrameOrientation();
-        // represent base frame in control frame
-        Mat3<float> dR; 
-        if (groundEstimator->terrain.terrainType < 2) {
-            dR = Mat3<float>::Identity();
-            robotBaseR = Mat3<float>::Identity();
-        } else {
-            dR = math::quaternionToRotationMatrix(controlFrameOrientation) * robotBaseR;
+    // evaluate the trajectories of all legs at once
+    Matrix<float, 3, 4> footPositions, footVelocities, footAccs;
+    swingTrajectories.Evaluate(gaitGenerator->normalizedPhase, footPositions, footVelocities, footAccs);
+    const Mat3<float> &baseR = robot->state.GetBaseRotationMatrix();
+    for (int legId = 0; legId < NumLeg; ++legId) {
+        if (!isSwing[legId]) {
+            continue;
         }
         switch (robot->locomotionMode) {
             case LocomotionMode::VELOCITY_LOCOMOTION:
-                VelocityLocomotionProcess(dR, footPositionInBaseFrame, legId);
+                footPositionsInBaseFrame.col(legId) = footPositions.col(legId);
+                footVelocitiesInBaseFrame.col(legId) = footVelocities.col(legId);
+                footAccsInBaseFrame.col(legId) = footAccs.col(legId);
                 break;
             case LocomotionMode::POSITION_LOCOMOTION:
-                PositionLocomotionProcess(footPositionInWorldFrame, footPositionInBaseFrame, legId);
+                // transfer the foot trajectory to base frame
+                footPositionsInBaseFrame.col(legId) = math::RigidTransform(robot->state.basePosition,
+                                                                           robot->state.baseOrientation,
+                                                                           Vec3<float>(footPositions.col(legId)));
+                footVelocitiesInBaseFrame.col(legId) = baseR.transpose() * footVelocities.col(legId)
+                                                       - stateEstimator->GetEstimatedVelocity();
+                footAccsInBaseFrame.col(legId) = baseR.transpose() * footAccs.col(legId);
                 break;
             default:
                 break;
         }
-        // compute joint position & joint velocity
-        robot->config->ComputeMotorAnglesFromFootLocalPosition(legId, footPositionInBaseFrame, jointIdx, jointAngles);
-        Vec3<float> motorVelocity = robot->config->ComputeMotorVelocityFromFootLocalVelocity(
-            legId, jointAngles, footVelocityInBaseFrame);
+    }
+
+    // compute joint position of all legs at once & joint velocity
+    Matrix<float, 12, 1> targetJointAngles = robot->config->ComputeMotorAnglesFromFootLocalPositions(footPositionsInBaseFrame);
+    for (int legId = 0; legId < NumLeg; ++legId) {
         // check nan value
-        int invalidAngleNum = 0;
         for (int i = 0; i < numMotorOfOneLeg; ++i) {
-            if(isnan(jointAngles[i])) {
-                invalidAngleNum++;
-                jointAngles[i] = currentJointAngles[numMotorOfOneLeg* legId + i];
+            if (isnan(targetJointAngles[numMotorOfOneLeg * legId + i])) {
+                targetJointAngles[numMotorOfOneLeg * legId + i] = currentJointAngles[numMotorOfOneLeg * legId + i];
             }
+        }
+    }
+    std::array<Mat3<float>, 4> jacobians;
+    robot->config->AnalyticalLegJacobians(targetJointAngles, jacobians);
+    const float footMass = params->Get().footMass;
+    const Vec3<float> gravityInBaseFrame = baseR.transpose() * Vec3<float>(0.f, 0.f, -9.81f);
+    for (int legId = 0; legId < NumLeg; ++legId) {
+        if (!isSwing[legId]) {
+            continue;
+        }
+        jointIdx << numMotorOfOneLeg * legId, numMotorOfOneLeg * legId + 1, numMotorOfOneLeg * legId + 2;
+        jointAngles = targetJointAngles.segment<3>(numMotorOfOneLeg * legId);
+        const Mat3<float> &jacobian = jacobians[legId];
+        Vec3<float> motorVelocity = Vec3<float>::Zero();
+        // a stretched leg cannot follow a foot velocity
+        if (std::abs(jacobian.determinant()) > 1e-6f) {
+            motorVelocity = jacobian.inverse() * footVelocitiesInBaseFrame.col(legId);
+        }
+        // the force that accelerates the leg along the trajectory and holds it against gravity
+        const Vec3<float> torque =
+            jacobian.transpose() * (footMass * (footAccsInBaseFrame.col(legId) - gravityInBaseFrame));
+        for (int i = 0; i < numMotorOfOneLeg; ++i) {
             swingJointAnglesVelocities[jointIdx[i]] = {jointAngles[i], motorVelocity[i], legId};
+            swingFeedforwardTorques[jointIdx[i]] = torque[i];
         }
     }
     map<int, Matrix<float, 5, 1>> actions;
@@ -270,7 +333,8 @@ map<int, Matrix<float, 5, 1>> qrSwingLegController::GetAction()
         bool flag;
         flag = (gaitGenerator->desiredLegState[singleLegId] == LegState::SWING);
         if (flag) {
-            actions[it->first] << std::get<0>(posVelId), kps[it->first], std::get<1>(posVelId), kds[it->first], 0.f;
+            actions[it->first] << std::get<0>(posVelId), kps[it->first], std::get<1>(posVelId), kds[it->first],
+                                  swingFeedforwardTorques[it->first];
         }
     } 
     return actions;
@@ -0,0 +1,99 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "controller/qr_swing_trajectory.h"
+
+#include <algorithm>
+
+qrSwingTrajectories::qrSwingTrajectories()
+{
+    startX.setZero();
+    startY.setZero();
+    stepX.setZero();
+    stepY.setZero();
+    zA.setZero();
+    zB.setZero();
+    zC.setZero();
+    inverseDuration.setOnes();
+}
+
+void qrSwingTrajectories::Start(int legId, const Vec3<float> &start, const Vec3<float> &target, float duration)
+{
+    startX[legId] = start[0];
+    startY[legId] = start[1];
+    zC[legId] = start[2];
+    inverseDuration[legId] = 1.f / std::max(duration, 1e-3f);
+    SetTarget(legId, target);
+}
+
+void qrSwingTrajectories::SetTarget(int legId, const Vec3<float> &target)
+{
+    stepX[legId] = target[0] - startX[legId];
+    stepY[legId] = target[1] - startY[legId];
+    // the parabola through (0, start), (0.5, apex) and (1, target)
+    const float start = zC[legId];
+    const float apex = std::max(start, target[2]) + clearance;
+    zA[legId] = 2.f * start - 4.f * apex + 2.f * target[2];
+    zB[legId] = -3.f * start + 4.f * apex - target[2];
+}
+
+void qrSwingTrajectories::Evaluate(const Vec4<float> &phase,
+                                   Eigen::Matrix<float, 3, 4> &position,
+                                   Eigen::Matrix<float, 3, 4> &velocity,
+                                   Eigen::Matrix<float, 3, 4> &acceleration) const
+{
+    qrFloat4 p = qrFloat4::Load(phase.data());
+    p = simd::select(p < qrFloat4(0.f), qrFloat4(0.f), p);
+    p = simd::select(p > qrFloat4(1.f), qrFloat4(1.f), p);
+
+    // the timing law and its derivatives with respect to the phase
+    const qrFloat4 p2 = p * p;
+    const qrFloat4 s = p2 * p * (qrFloat4(38.6f) + p * (qrFloat4(-119.6f) + p * (qrFloat4(148.2f)
+                       + p * (qrFloat4(-85.f) + qrFloat4(18.8f) * p))));
+    const qrFloat4 ds = p2 * (qrFloat4(115.8f) + p * (qrFloat4(-478.4f) + p * (qrFloat4(741.f)
+                        + p * (qrFloat4(-510.f) + qrFloat4(131.6f) * p))));
+    const qrFloat4 dds = p * (qrFloat4(231.6f) + p * (qrFloat4(-1435.2f) + p * (qrFloat4(2964.f)
+                         + p * (qrFloat4(-2550.f) + qrFloat4(789.6f) * p))));
+
+    // chain rule to time, d(phase)/dt = 1 / duration
+    const qrFloat4 rate = qrFloat4::Load(inverseDuration.data());
+    const qrFloat4 sDot = ds * rate;
+    const qrFloat4 sDdot = dds * rate * rate;
+
+    const qrFloat4 stepX4 = qrFloat4::Load(stepX.data());
+    const qrFloat4 stepY4 = qrFloat4::Load(stepY.data());
+    (qrFloat4::Load(startX.data()) + stepX4 * s).Scatter(position.data(), 3);
+    (qrFloat4::Load(startY.data()) + stepY4 * s).Scatter(position.data() + 1, 3);
+    (stepX4 * sDot).Scatter(velocity.data(), 3);
+    (stepY4 * sDot).Scatter(velocity.data() + 1, 3);
+    (stepX4 * sDdot).Scatter(acceleration.data(), 3);
+    (stepY4 * sDdot).Scatter(acceleration.data() + 1, 3);
+
+    const qrFloat4 a = qrFloat4::Load(zA.data());
+    const qrFloat4 b = qrFloat4::Load(zB.data());
+    const qrFloat4 dz = b + qrFloat4(2.f) * a * s;
+    (qrFloat4::Load(zC.data()) + s * (b + s * a)).Scatter(position.data() + 2, 3);
+    (dz * sDot).Scatter(velocity.data() + 2, 3);
+    (qrFloat4(2.f) * a * sDot * sDot + dz * sDdot).Scatter(acceleration.data() + 2, 3);
+}
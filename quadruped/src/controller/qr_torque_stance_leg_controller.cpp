@@ -25,11 +25,69 @@
 #include "controller/qr_torque_stance_leg_controller.h"
 #include "controller/qr_qp_torque_optimizer.h"
 #include "controller/mpc/qr_mit_mpc_stance_leg_controller.h"
+#include "common/qr_log.h"
 
 using namespace std;
 
 extern std::unordered_map<int, std::string> modeMap;
 
+namespace {
+
+Eigen::Matrix<float, 6, 1> LoadVector6(const YAML::Node &node, const char *key)
+{
+    vector<float> v = node[key].as<vector<float>>();
+    if (v.size() != 6) {
+        throw std::runtime_error(std::string(key) + " needs 6 values");
+    }
+    return Eigen::Matrix<float, 6, 1>::Map(v.data());
+}
+
+} // namespace
+
+void qrStanceLegParams::Load(const YAML::Node &node)
+{
+    const YAML::Node stanceNode = node["stance_leg_params"];
+    forceDim = stanceNode["force_dim"].as<int>();
+    for (int mode = 0; mode < 4; ++mode) {
+        const YAML::Node modeNode = stanceNode[modeMap[mode]];
+        qrStanceModeParams &gains = modes[mode];
+        gains.loaded = bool(modeNode);
+        if (!gains.loaded) {
+            continue;
+        }
+        gains.KP = LoadVector6(modeNode, "KP");
+        gains.KD = LoadVector6(modeNode, "KD");
+        gains.maxDdq = LoadVector6(modeNode, "max_ddq");
+        gains.minDdq = LoadVector6(modeNode, "min_ddq");
+        gains.accWeight = LoadVector6(modeNode, "acc_weight");
+        if (modeNode["Q"]) {
+            gains.Q = modeNode["Q"].as<vector<float>>();
+        }
+    }
+}
+
+void qrStanceLegParams::Validate() const
+{
+    if (forceDim != 3 && forceDim != 6) {
+        throw std::runtime_error("force_dim must be 3 or 6");
+    }
+    for (int mode = 0; mode < 4; ++mode) {
+        const qrStanceModeParams &gains = modes[mode];
+        if (!gains.loaded) {
+            continue;
+        }
+        if ((gains.KP.array() < 0.f).any() || (gains.KD.array() < 0.f).any() || (gains.accWeight.array() < 0.f).any()) {
+            throw std::runtime_error(modeMap[mode] + ": KP, KD and acc_weight must not be negative");
+        }
+        if ((gains.minDdq.array() > gains.maxDdq.array()).any()) {
+            throw std::runtime_error(modeMap[mode] + ": min_ddq must not exceed max_ddq");
+        }
+        if (!gains.Q.empty() && gains.Q.size() != 12) {
+            throw std::runtime_error(modeMap[mode] + ": Q needs 12 values");
+        }
+    }
+}
+
 qrStanceLegController::qrStanceLegController(qrRobot *robot,
                                             qrGaitGenerator *gaitGenerator,
                                             qrRobotEstimator *robotEstimator,
@@ -55,7 +113,8 @@ qrStanceLegController::qrStanceLegController(qrRobot *robot,
     this->desiredBodyHeight = desiredBodyHeight;
     this->numLegs = numLegs;
     this->frictionCoeffs = frictionCoeffs;
-  Reset(0.f);
+    this->params.reset(new qrConfig<qrStanceLegParams>(configFilepath));
+    Reset(0.f);
 }
 
 qrStanceLegController *qrStanceLegController::createStanceController(qrRobot *robot,
@@ -91,23 +150,35 @@ void qrStanceLegController::Reset(float currentTime_)
         controlModeStr = modeMap[robot->locomotionMode];
     }
     std::cout << "locomotion mode: " + controlModeStr << std::endl;
-    YAML::Node param = YAML::LoadFile(configFilepath);
-    this->force_dim = param["stance_leg_params"]["force_dim"].as<int>();        
-    vector<float> v = param["stance_leg_params"][controlModeStr]["KD"].as<vector<float>>();
-    this->KD = Eigen::MatrixXf::Map(&v[0], 6, 1);
-    v = param["stance_leg_params"][controlModeStr]["KP"].as<vector<float>>();
-    this->KP = Eigen::MatrixXf::Map(&v[0], 6, 1);
-    v = param["stance_leg_params"][controlModeStr]["max_ddq"].as<vector<float>>();
-    this->maxDdq = Eigen::MatrixXf::Map(&v[0], 6, 1);
-    v = param["stance_leg_params"][controlModeStr]["min_ddq"].as<vector<float>>();
-    this->minDdq = Eigen::MatrixXf::Map(&v[0], 6, 1);
-    v = param["stance_leg_params"][controlModeStr]["acc_weight"].as<vector<float>>();
-    this->accWeight = Eigen::MatrixXf::Map(&v[0], 6, 1);        
+    if (!ApplyParams()) {
+        throw std::runtime_error(configFilepath + ": no stance_leg_params for " + controlModeStr);
+    }
     currentTime = currentTime_;
 }
 
+bool qrStanceLegController::ApplyParams()
+{
+    const qrStanceLegParams &param = params->Get();
+    paramsVersion = params->GetVersion();
+    const qrStanceModeParams &gains = param.modes[robot->locomotionMode];
+    if (!gains.loaded) {
+        return false;
+    }
+    this->force_dim = param.forceDim;
+    this->KP = gains.KP;
+    this->KD = gains.KD;
+    this->maxDdq = gains.maxDdq;
+    this->minDdq = gains.minDdq;
+    this->accWeight = gains.accWeight;
+    return true;
+}
+
 void qrStanceLegController::Update(float currentTime_)
 {
+    // tuned gains take effect at the start of a tick
+    if (params->GetVersion() != paramsVersion) {
+        ApplyParams();
+    }
     currentTime = currentTime_;
 }
 
@@ -115,7 +186,7 @@ void qrStanceLegController::UpdateFRatio(Vec4<bool> &contacts, int &N, float &mo
 {
     // leg contact status
     if (robot->stop) {
-        printf("robot->stop");
+        QR_LOG_INFO_EVERY(1.f, "robot->stop");
         fMaxRatio << 10., 10., 10., 10.;
         fMinRatio << 0.01, 0.01, 0.01, 0.01;
         contacts << true, true, true, true;
@@ -0,0 +1,176 @@
+// The MIT License
+
+// Copyright (c) 2022 
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact:  tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "controller/wbc/qr_WBIC.hpp"
+
+template<typename T, int NJoints, int NContacts>
+qrWBIC<T, NJoints, NContacts>::qrWBIC(Model& model)
+    : model(model), frictionCoeff(0.4), maxFz(1000.)
+{
+    wFloating.setConstant(0.1);
+    wForce.setConstant(1.);
+    qdd.setZero();
+    forces.setZero();
+    tau.setZero();
+}
+
+template<typename T, int NJoints, int NContacts>
+bool qrWBIC<T, NJoints, NContacts>::MakeTorque(const Eigen::Matrix<bool, NContacts, 1>& contactState,
+                                               const ForceMatrix& forcesDes, const Task* tasks, int taskCount)
+{
+    model.contactJacobians();
+    const MassMatrix& A = model.massMatrix();
+    const GeneralizedForce& grav = model.generalizedGravityForce();
+    const GeneralizedForce& cori = model.generalizedCoriolisForce();
+    llt.compute(A);
+    Ainv.setIdentity();
+    llt.solveInPlace(Ainv);
+
+    ContactBuilding(contactState);
+
+    for (int i = 0; i < taskCount; ++i) {
+        const Task& task = tasks[i];
+        JtPre.noalias() = task.Jt * Npre;
+        wbc::WeightedInverse(JtPre, Ainv, JtBar);
+
+        taskErr = task.accCmd - task.JtDotQdot;
+        taskErr.noalias() -= task.Jt * qdd;
+        qdd.noalias() += JtBar * taskErr;
+        // Npre = Npre * (I - JtBar * JtPre)
+        Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, NDof - 6> NpreJtBar;
+        NpreJtBar.noalias() = Npre * JtBar;
+        Npre.noalias() -= NpreJtBar * JtPre;
+    }
+
+    bool solved = SolveRelaxation(contactState, forcesDes);
+
+    GeneralizedForce genForce = cori + grav;
+    genForce.noalias() += A * qdd;
+    for (int leg = 0; leg < NContacts; ++leg) {
+        if (contactState[leg]) {
+            genForce.noalias() -= model._Jc[leg].transpose() * forces.col(leg);
+        }
+    }
+    tau = genForce.template tail<NJoints>();
+    return solved;
+}
+
+template<typename T, int NJoints, int NContacts>
+void qrWBIC<T, NJoints, NContacts>::ContactBuilding(const Eigen::Matrix<bool, NContacts, 1>& contactState)
+{
+    int rows = 3 * contactState.count();
+    Jc.resize(rows, NDof);
+    JcDotQdot.resize(rows);
+    int row = 0;
+    for (int leg = 0; leg < NContacts; ++leg) {
+        if (contactState[leg]) {
+            Jc.template middleRows<3>(row) = model._Jc[leg];
+            JcDotQdot.template segment<3>(row) = model._Jcdqd[leg];
+            row += 3;
+        }
+    }
+
+    Npre.setIdentity();
+    if (rows > 0) {
+        wbc::WeightedInverse(Jc, Ainv, JcBar);
+        qdd.noalias() = -JcBar * JcDotQdot;
+        Npre.noalias() -= JcBar * Jc;
+    } else {
+        qdd.setZero();
+    }
+}
+
+template<typename T, int NJoints, int NContacts>
+bool qrWBIC<T, NJoints, NContacts>::SolveRelaxation(const Eigen::Matrix<bool, NContacts, 1>& contactState,
+                                                    const ForceMatrix& forcesDes)
+{
+    const MassMatrix& A = model.getMassMatrix();
+    // residual of the floating base dynamics with the reference forces
+    Eigen::Matrix<T, 6, 1> ce = (model.getCoriolisForce() + model.getGravityForce()).template head<6>();
+    ce.noalias() += A.template topRows<6>() * qdd;
+    // base columns of the contact Jacobians, transposed
+    Eigen::Matrix<T, 6, NForces> JcFbT = Eigen::Matrix<T, 6, NForces>::Zero();
+    for (int leg = 0; leg < NContacts; ++leg) {
+        forces.col(leg).setZero();
+        if (contactState[leg]) {
+            JcFbT.template middleCols<3>(3 * leg) = model._Jc[leg].template leftCols<6>().transpose();
+            forces.col(leg) = forcesDes.col(leg);
+            ce.noalias() -= JcFbT.template middleCols<3>(3 * leg) * forces.col(leg);
+        }
+    }
+
+    // delta = P df + p0
+    Eigen::LLT<Mat6<T>> baseLlt(A.template topLeftCorner<6, 6>());
+    Eigen::Matrix<T, 6, NForces> P = baseLlt.solve(JcFbT);
+    Eigen::Matrix<T, 6, 1> p0 = -baseLlt.solve(ce);
+    if (contactState.count() == 0) {
+        qdd.template head<6>() += p0;
+        return true;
+    }
+
+    Eigen::Matrix<T, NForces, 6> PtWf = P.transpose() * wFloating.asDiagonal();
+    G = (PtWf * P).template cast<double>();
+    G.diagonal() += wForce.template cast<double>();
+    a = (PtWf * p0).template cast<double>();
+
+    C.setZero();
+    b.setConstant(-1.);
+    const double mu = frictionCoeff;
+    for (int leg = 0; leg < NContacts; ++leg) {
+        if (!contactState[leg]) {
+            continue;
+        }
+        const int x = 3 * leg, y = x + 1, z = x + 2, c = 6 * leg;
+        // fz >= 0, |fx| <= mu fz, |fy| <= mu fz, fz <= maxFz on the forces Fr + df
+        C(z, c) = 1.;
+        C(x, c + 1) = 1.;
+        C(z, c + 1) = mu;
+        C(x, c + 2) = -1.;
+        C(z, c + 2) = mu;
+        C(y, c + 3) = 1.;
+        C(z, c + 3) = mu;
+        C(y, c + 4) = -1.;
+        C(z, c + 4) = mu;
+        C(z, c + 5) = -1.;
+        Eigen::Matrix<double, 3, 1> fr = forcesDes.col(leg).template cast<double>();
+        b.template segment<6>(c) = -C.template block<3, 6>(x, c).transpose() * fr;
+        b[c + 5] -= maxFz;
+    }
+
+    bool solved = qp.Solve(G, a, C, b, df);
+    if (!solved) {
+        df.setZero();
+    }
+    Eigen::Matrix<T, NForces, 1> dfT = df.template cast<T>();
+    qdd.template head<6>() += P * dfT + p0;
+    for (int leg = 0; leg < NContacts; ++leg) {
+        if (contactState[leg]) {
+            forces.col(leg) += dfT.template segment<3>(3 * leg);
+        }
+    }
+    return solved;
+}
+
+template class qrWBIC<float, 12, 4>;
+template class qrWBIC<double, 12, 4>;
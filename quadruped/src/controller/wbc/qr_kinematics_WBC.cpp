@@ -0,0 +1,118 @@
+// The MIT License
+
+// Copyright (c) 2022 
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact:  tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "controller/wbc/qr_kinematics_WBC.hpp"
+
+template<typename T, int NJoints, int NContacts, int MaxTasks>
+qrKinWBC<T, NJoints, NContacts, MaxTasks>::qrKinWBC(Model& model)
+    : model(model), contactValid(false), validLevels(0), recomputedLevels(0)
+{
+    Winv.setIdentity();
+    cachedContactState.setConstant(false);
+}
+
+template<typename T, int NJoints, int NContacts, int MaxTasks>
+void qrKinWBC<T, NJoints, NContacts, MaxTasks>::SetWeight(const MassMatrix& weightInverse)
+{
+    Winv = weightInverse;
+    contactValid = false;
+    validLevels = 0;
+}
+
+template<typename T, int NJoints, int NContacts, int MaxTasks>
+bool qrKinWBC<T, NJoints, NContacts, MaxTasks>::FindConfiguration(
+    const Eigen::Matrix<bool, NContacts, 1>& contactState, const Task* tasks, int taskCount,
+    JointVector& jposCmd, JointVector& jvelCmd)
+{
+    if (taskCount > MaxTasks) {
+        return false;
+    }
+    recomputedLevels = 0;
+    if (UpdateContactProjector(contactState)) {
+        validLevels = 0;
+        ++recomputedLevels;
+    }
+
+    deltaQ.setZero();
+    qdot.setZero();
+    for (int i = 0; i < taskCount; ++i) {
+        const Task& task = tasks[i];
+        // a level is reused while its Jacobian and all the levels before it are unchanged
+        if (i >= validLevels || task.Jt.rows() != cachedJt[i].rows() || task.Jt != cachedJt[i]) {
+            const MassMatrix& Npre = ProjectorBefore(i);
+            cachedJt[i] = task.Jt;
+            JtPre[i].noalias() = task.Jt * Npre;
+            wbc::WeightedInverse(JtPre[i], Winv, JtPreBar[i]);
+            Eigen::Matrix<T, NDof, Eigen::Dynamic, 0, NDof, NDof - 6> NpreJtBar;
+            NpreJtBar.noalias() = Npre * JtPreBar[i];
+            N[i] = Npre;
+            N[i].noalias() -= NpreJtBar * JtPre[i];
+            validLevels = i + 1;
+            ++recomputedLevels;
+        }
+
+        error = task.posErr;
+        error.noalias() -= task.Jt * deltaQ;
+        deltaQ.noalias() += JtPreBar[i] * error;
+
+        error = task.velDes;
+        error.noalias() -= task.Jt * qdot;
+        qdot.noalias() += JtPreBar[i] * error;
+    }
+
+    jposCmd = model._state.q + deltaQ.template tail<NJoints>();
+    jvelCmd = qdot.template tail<NJoints>();
+    return true;
+}
+
+template<typename T, int NJoints, int NContacts, int MaxTasks>
+bool qrKinWBC<T, NJoints, NContacts, MaxTasks>::UpdateContactProjector(
+    const Eigen::Matrix<bool, NContacts, 1>& contactState)
+{
+    ContactJacobian jc(3 * contactState.count(), NDof);
+    int row = 0;
+    for (int leg = 0; leg < NContacts; ++leg) {
+        if (contactState[leg]) {
+            jc.template middleRows<3>(row) = model._Jc[leg];
+            row += 3;
+        }
+    }
+    if (contactValid && contactState == cachedContactState && jc == Jc) {
+        return false;
+    }
+
+    Jc = jc;
+    cachedContactState = contactState;
+    contactValid = true;
+    Nc.setIdentity();
+    if (Jc.rows() > 0) {
+        ContactJacobianInverse JcBar;
+        wbc::WeightedInverse(Jc, Winv, JcBar);
+        Nc.noalias() -= JcBar * Jc;
+    }
+    return true;
+}
+
+template class qrKinWBC<float, 12, 4, 6>;
+template class qrKinWBC<double, 12, 4, 6>;
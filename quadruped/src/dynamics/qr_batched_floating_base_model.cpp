@@ -0,0 +1,768 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "dynamics/qr_batched_floating_base_model.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A spatial vector [angular; linear] of a pack, one lane per state
+ */
+struct SVecX4 {
+    qrFloat4 v[6];
+};
+
+/**
+ * @brief A 6x6 spatial matrix of a pack, row major
+ */
+struct Mat6X4 {
+    qrFloat4 m[6][6];
+};
+
+static inline SVecX4 ZeroSVec()
+{
+    SVecX4 x;
+    for (int k = 0; k < 6; k++) {
+        x.v[k] = qrFloat4(0.f);
+    }
+    return x;
+}
+
+static inline Mat6X4 Broadcast(const Mat6<float>& A)
+{
+    Mat6X4 B;
+    for (int r = 0; r < 6; r++) {
+        for (int c = 0; c < 6; c++) {
+            B.m[r][c] = qrFloat4(A(r, c));
+        }
+    }
+    return B;
+}
+
+static inline SVecX4 operator+(const SVecX4& a, const SVecX4& b)
+{
+    SVecX4 x;
+    for (int k = 0; k < 6; k++) {
+        x.v[k] = a.v[k] + b.v[k];
+    }
+    return x;
+}
+
+/** @brief A * x */
+static inline SVecX4 Mul(const Mat6X4& A, const SVecX4& x)
+{
+    SVecX4 y;
+    for (int r = 0; r < 6; r++) {
+        qrFloat4 sum = A.m[r][0] * x.v[0];
+        for (int k = 1; k < 6; k++) {
+            sum = sum + A.m[r][k] * x.v[k];
+        }
+        y.v[r] = sum;
+    }
+    return y;
+}
+
+/** @brief A * x, A is the same for all lanes */
+static inline SVecX4 Mul(const Mat6<float>& A, const SVecX4& x)
+{
+    SVecX4 y;
+    for (int r = 0; r < 6; r++) {
+        qrFloat4 sum = qrFloat4(A(r, 0)) * x.v[0];
+        for (int k = 1; k < 6; k++) {
+            sum = sum + qrFloat4(A(r, k)) * x.v[k];
+        }
+        y.v[r] = sum;
+    }
+    return y;
+}
+
+/** @brief A^T * x */
+static inline SVecX4 MulTranspose(const Mat6X4& A, const SVecX4& x)
+{
+    SVecX4 y;
+    for (int c = 0; c < 6; c++) {
+        qrFloat4 sum = A.m[0][c] * x.v[0];
+        for (int k = 1; k < 6; k++) {
+            sum = sum + A.m[k][c] * x.v[k];
+        }
+        y.v[c] = sum;
+    }
+    return y;
+}
+
+/** @brief A * s, s is the same for all lanes and usually a joint axis, so zero entries are skipped */
+static inline SVecX4 Mul(const Mat6X4& A, const SVec<float>& s)
+{
+    SVecX4 y = ZeroSVec();
+    for (int k = 0; k < 6; k++) {
+        if (s[k] == 0.f) continue;
+        const qrFloat4 sk(s[k]);
+        for (int r = 0; r < 6; r++) {
+            y.v[r] = y.v[r] + A.m[r][k] * sk;
+        }
+    }
+    return y;
+}
+
+/** @brief s * x for the motion subspace s and the joint velocity x */
+static inline SVecX4 Mul(const SVec<float>& s, qrFloat4 x)
+{
+    SVecX4 y;
+    for (int k = 0; k < 6; k++) {
+        y.v[k] = qrFloat4(s[k]) * x;
+    }
+    return y;
+}
+
+static inline qrFloat4 Dot(const SVecX4& a, const SVecX4& b)
+{
+    qrFloat4 sum = a.v[0] * b.v[0];
+    for (int k = 1; k < 6; k++) {
+        sum = sum + a.v[k] * b.v[k];
+    }
+    return sum;
+}
+
+static inline qrFloat4 Dot(const SVec<float>& s, const SVecX4& x)
+{
+    qrFloat4 sum(0.f);
+    for (int k = 0; k < 6; k++) {
+        if (s[k] != 0.f) {
+            sum = sum + qrFloat4(s[k]) * x.v[k];
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief A spatial transform of a pack kept as rotation E and translation r, see PluckerTransform
+ */
+struct XformX4 {
+    qrFloat4 E[3][3];
+    qrFloat4 r[3];
+};
+
+/** @brief a x b */
+static inline void Cross(const qrFloat4 a[3], const qrFloat4 b[3], qrFloat4 axb[3])
+{
+    axb[0] = a[1] * b[2] - a[2] * b[1];
+    axb[1] = a[2] * b[0] - a[0] * b[2];
+    axb[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/** @brief X * v for a motion vector v */
+static inline SVecX4 Apply(const XformX4& X, const SVecX4& v)
+{
+    qrFloat4 rw[3], t[3];
+    Cross(X.r, v.v, rw);
+    for (int k = 0; k < 3; k++) {
+        t[k] = v.v[k + 3] - rw[k];
+    }
+    SVecX4 y;
+    for (int i = 0; i < 3; i++) {
+        y.v[i] = X.E[i][0] * v.v[0] + X.E[i][1] * v.v[1] + X.E[i][2] * v.v[2];
+        y.v[i + 3] = X.E[i][0] * t[0] + X.E[i][1] * t[1] + X.E[i][2] * t[2];
+    }
+    return y;
+}
+
+/** @brief X^T * f for a force vector f */
+static inline SVecX4 ApplyTranspose(const XformX4& X, const SVecX4& f)
+{
+    SVecX4 y;
+    for (int i = 0; i < 3; i++) {
+        y.v[i] = X.E[0][i] * f.v[0] + X.E[1][i] * f.v[1] + X.E[2][i] * f.v[2];
+        y.v[i + 3] = X.E[0][i] * f.v[3] + X.E[1][i] * f.v[4] + X.E[2][i] * f.v[5];
+    }
+    qrFloat4 rf[3];
+    Cross(X.r, y.v + 3, rf);
+    for (int i = 0; i < 3; i++) {
+        y.v[i] = y.v[i] + rf[i];
+    }
+    return y;
+}
+
+/** @brief E^T * M * E for the 3x3 block of M at (row, col) */
+static inline void RotateBlock(const XformX4& X, const Mat6X4& M, int row, int col, qrFloat4 out[3][3])
+{
+    qrFloat4 ME[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            ME[i][j] = M.m[row + i][col] * X.E[0][j] + M.m[row + i][col + 1] * X.E[1][j] +
+                       M.m[row + i][col + 2] * X.E[2][j];
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            out[i][j] = X.E[0][i] * ME[0][j] + X.E[1][i] * ME[1][j] + X.E[2][i] * ME[2][j];
+        }
+    }
+}
+
+/**
+ * @brief out += X^T * M * X for a symmetric M, the inertia M expressed in the parent frame.
+ * See PluckerTransform::congruence: A - B rx - (B rx)^T - rx C rx, B + rx C, C of the rotated blocks.
+ */
+static inline void AddCongruence(const XformX4& X, const Mat6X4& M, Mat6X4& out)
+{
+    qrFloat4 A[3][3], B[3][3], C[3][3];
+    RotateBlock(X, M, 0, 0, A);
+    RotateBlock(X, M, 0, 3, B);
+    RotateBlock(X, M, 3, 3, C);
+
+    // rows of B rx are B_i x r, columns of rx C are r x C_j, rows of rx C rx are (rx C)_i x r
+    qrFloat4 Brx[3][3], rxC[3][3], rxCrx[3][3];
+    for (int i = 0; i < 3; i++) {
+        const qrFloat4 Bi[3] = {B[i][0], B[i][1], B[i][2]};
+        const qrFloat4 Cj[3] = {C[0][i], C[1][i], C[2][i]};
+        qrFloat4 rxCj[3];
+        Cross(Bi, X.r, Brx[i]);
+        Cross(X.r, Cj, rxCj);
+        for (int k = 0; k < 3; k++) {
+            rxC[k][i] = rxCj[k];
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        Cross(rxC[i], X.r, rxCrx[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            out.m[i][j] = out.m[i][j] + A[i][j] - Brx[i][j] - Brx[j][i] - rxCrx[i][j];
+            const qrFloat4 b = B[i][j] + rxC[i][j];
+            out.m[i][j + 3] = out.m[i][j + 3] + b;
+            out.m[j + 3][i] = out.m[j + 3][i] + b;
+            out.m[i + 3][j + 3] = out.m[i + 3][j + 3] + C[i][j];
+        }
+    }
+}
+
+/**
+ * @brief out += X^T * I * X for a rigid body inertia I = [Ibar skew(h); skew(h)^T m*1], see
+ * PluckerTransform::rigidCongruence
+ */
+static inline void AddRigidCongruence(const XformX4& X, const Mat6X4& I, Mat6X4& out)
+{
+    qrFloat4 Ibar[3][3];
+    RotateBlock(X, I, 0, 0, Ibar);
+    const qrFloat4 m = I.m[5][5];
+    const qrFloat4 h0[3] = {I.m[2][4], I.m[0][5], I.m[1][3]};
+    qrFloat4 h[3], mr[3];
+    for (int i = 0; i < 3; i++) {
+        h[i] = X.E[0][i] * h0[0] + X.E[1][i] * h0[1] + X.E[2][i] * h0[2];
+        mr[i] = m * X.r[i];
+    }
+    const qrFloat4 diagonal = (h[0] + h[0] + mr[0]) * X.r[0] + (h[1] + h[1] + mr[1]) * X.r[1] +
+                              (h[2] + h[2] + mr[2]) * X.r[2];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            out.m[i][j] = out.m[i][j] + Ibar[i][j] - h[i] * X.r[j] - X.r[i] * h[j] - mr[i] * X.r[j];
+        }
+        out.m[i][i] = out.m[i][i] + diagonal;
+        out.m[i + 3][i + 3] = out.m[i + 3][i + 3] + m;
+    }
+    // skew(h + m r) and its transpose
+    qrFloat4 s[3];
+    for (int i = 0; i < 3; i++) {
+        s[i] = h[i] + mr[i];
+    }
+    out.m[0][4] = out.m[0][4] - s[2];
+    out.m[0][5] = out.m[0][5] + s[1];
+    out.m[1][3] = out.m[1][3] + s[2];
+    out.m[1][5] = out.m[1][5] - s[0];
+    out.m[2][3] = out.m[2][3] - s[1];
+    out.m[2][4] = out.m[2][4] + s[0];
+    out.m[4][0] = out.m[4][0] - s[2];
+    out.m[5][0] = out.m[5][0] + s[1];
+    out.m[3][1] = out.m[3][1] + s[2];
+    out.m[5][1] = out.m[5][1] - s[0];
+    out.m[3][2] = out.m[3][2] - s[1];
+    out.m[4][2] = out.m[4][2] + s[0];
+}
+
+/** @brief see motionCrossProduct */
+static inline SVecX4 MotionCross(const SVecX4& A, const SVecX4& B)
+{
+    const qrFloat4* a = A.v;
+    const qrFloat4* b = B.v;
+    SVecX4 mv;
+    mv.v[0] = a[1] * b[2] - a[2] * b[1];
+    mv.v[1] = a[2] * b[0] - a[0] * b[2];
+    mv.v[2] = a[0] * b[1] - a[1] * b[0];
+    mv.v[3] = a[1] * b[5] - a[2] * b[4] + a[4] * b[2] - a[5] * b[1];
+    mv.v[4] = a[2] * b[3] - a[0] * b[5] - a[3] * b[2] + a[5] * b[0];
+    mv.v[5] = a[0] * b[4] - a[1] * b[3] + a[3] * b[1] - a[4] * b[0];
+    return mv;
+}
+
+/** @brief see forceCrossProduct */
+static inline SVecX4 ForceCross(const SVecX4& A, const SVecX4& B)
+{
+    const qrFloat4* a = A.v;
+    const qrFloat4* b = B.v;
+    SVecX4 mv;
+    mv.v[0] = b[2] * a[1] - b[1] * a[2] - b[4] * a[5] + b[5] * a[4];
+    mv.v[1] = b[0] * a[2] - b[2] * a[0] + b[3] * a[5] - b[5] * a[3];
+    mv.v[2] = b[1] * a[0] - b[0] * a[1] - b[3] * a[4] + b[4] * a[3];
+    mv.v[3] = b[5] * a[1] - b[4] * a[2];
+    mv.v[4] = b[3] * a[2] - b[5] * a[0];
+    mv.v[5] = b[4] * a[0] - b[3] * a[1];
+    return mv;
+}
+
+/** @brief jointXform(joint, axis, q) * Xtree */
+static inline void JointXform(JointType joint, CoordinateAxis axis, qrFloat4 q, const PluckerTransform<float>& Xtree,
+                              XformX4& X)
+{
+    const qrFloat4 zero(0.f), one(1.f);
+    qrFloat4 R[3][3];
+    if (joint == JointType::Revolute) {
+        // coordinateRotation(axis, q)
+        qrFloat4 s, c;
+        simd::sinCos(q, s, c);
+        if (axis == CoordinateAxis::X) {
+            R[0][0] = one;  R[0][1] = zero; R[0][2] = zero;
+            R[1][0] = zero; R[1][1] = c;    R[1][2] = s;
+            R[2][0] = zero; R[2][1] = -s;   R[2][2] = c;
+        } else if (axis == CoordinateAxis::Y) {
+            R[0][0] = c;    R[0][1] = zero; R[0][2] = -s;
+            R[1][0] = zero; R[1][1] = one;  R[1][2] = zero;
+            R[2][0] = s;    R[2][1] = zero; R[2][2] = c;
+        } else {
+            R[0][0] = c;    R[0][1] = s;    R[0][2] = zero;
+            R[1][0] = -s;   R[1][1] = c;    R[1][2] = zero;
+            R[2][0] = zero; R[2][1] = zero; R[2][2] = one;
+        }
+        // the joint only rotates, E = R * Etree
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                X.E[i][j] = R[i][0] * qrFloat4(Xtree.E(0, j)) + R[i][1] * qrFloat4(Xtree.E(1, j)) +
+                            R[i][2] * qrFloat4(Xtree.E(2, j));
+            }
+            X.r[i] = qrFloat4(Xtree.r[i]);
+        }
+    } else if (joint == JointType::Prismatic) {
+        // the joint only translates by q along axis, r = rtree + Etree^T * q * axis
+        const int a = static_cast<int>(axis);
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                X.E[i][j] = qrFloat4(Xtree.E(i, j));
+            }
+            X.r[i] = qrFloat4(Xtree.r[i]) + qrFloat4(Xtree.E(a, i)) * q;
+        }
+    } else {
+        throw std::runtime_error("Unknown joint xform\n");
+    }
+}
+
+/**
+ * @brief Solve A x = b for the symmetric positive definite A, LDL^T without pivoting so every lane
+ * runs the same instructions
+ */
+static inline SVecX4 SolveSpd(const Mat6X4& A, const SVecX4& b)
+{
+    qrFloat4 L[6][6], D[6];
+    for (int j = 0; j < 6; j++) {
+        qrFloat4 dj = A.m[j][j];
+        for (int k = 0; k < j; k++) {
+            dj = dj - L[j][k] * L[j][k] * D[k];
+        }
+        D[j] = dj;
+        const qrFloat4 invD = qrFloat4(1.f) / dj;
+        for (int i = j + 1; i < 6; i++) {
+            qrFloat4 lij = A.m[i][j];
+            for (int k = 0; k < j; k++) {
+                lij = lij - L[i][k] * L[j][k] * D[k];
+            }
+            L[i][j] = lij * invD;
+        }
+    }
+    SVecX4 x = b;
+    for (int i = 1; i < 6; i++) {
+        for (int k = 0; k < i; k++) {
+            x.v[i] = x.v[i] - L[i][k] * x.v[k];
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        x.v[i] = x.v[i] / D[i];
+    }
+    for (int i = 4; i >= 0; i--) {
+        for (int k = i + 1; k < 6; k++) {
+            x.v[i] = x.v[i] - L[k][i] * x.v[k];
+        }
+    }
+    return x;
+}
+
+/** @brief One lane of a pack as float */
+static inline float Lane(qrFloat4 x, int lane)
+{
+    alignas(16) float lanes[4];
+    x.Store(lanes);
+    return lanes[lane];
+}
+
+template <int NJoints>
+struct BatchedFloatingBaseModel<NJoints>::Workspace {
+    XformX4 Xup[NDof], Xuprot[NDof];
+    SVecX4 v[NDof], vrot[NDof], c[NDof], crot[NDof];
+};
+
+// gathers member x of the lanes of a pack, lanes past valid repeat the last state
+#define QR_GATHER_LANES(array, valid, x) \
+    qrFloat4((array)[0].x, (array)[(valid) > 1 ? 1 : 0].x, \
+             (array)[(valid) > 2 ? 2 : (valid) - 1].x, (array)[(valid) > 3 ? 3 : (valid) - 1].x)
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::forwardKinematics(const State* states, int valid, bool velocities,
+                                                          Workspace& ws) const
+{
+    // quaternionToRotationMatrix
+    const qrFloat4 e0 = QR_GATHER_LANES(states, valid, bodyOrientation[0]);
+    const qrFloat4 e1 = QR_GATHER_LANES(states, valid, bodyOrientation[1]);
+    const qrFloat4 e2 = QR_GATHER_LANES(states, valid, bodyOrientation[2]);
+    const qrFloat4 e3 = QR_GATHER_LANES(states, valid, bodyOrientation[3]);
+    const qrFloat4 one(1.f), two(2.f);
+    qrFloat4 R[3][3];
+    R[0][0] = one - two * (e2 * e2 + e3 * e3);
+    R[1][0] = two * (e1 * e2 - e0 * e3);
+    R[2][0] = two * (e1 * e3 + e0 * e2);
+    R[0][1] = two * (e1 * e2 + e0 * e3);
+    R[1][1] = one - two * (e1 * e1 + e3 * e3);
+    R[2][1] = two * (e2 * e3 - e0 * e1);
+    R[0][2] = two * (e1 * e3 - e0 * e2);
+    R[1][2] = two * (e2 * e3 + e0 * e1);
+    R[2][2] = one - two * (e1 * e1 + e2 * e2);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            ws.Xup[5].E[i][j] = R[i][j];
+        }
+        ws.Xup[5].r[i] = QR_GATHER_LANES(states, valid, bodyPosition[i]);
+    }
+    for (int k = 0; k < 6; k++) {
+        ws.v[5].v[k] = QR_GATHER_LANES(states, valid, bodyVelocity[k]);
+    }
+
+    for (int i = 6; i < NDof; i++) {
+        const qrFloat4 q = QR_GATHER_LANES(states, valid, q[i - 6]);
+        JointXform(_jointTypes[i], _jointAxes[i], q, _Xtree[i], ws.Xup[i]);
+        JointXform(_jointTypes[i], _jointAxes[i], q * qrFloat4(_gearRatios[i]), _Xrot[i], ws.Xuprot[i]);
+        if (!velocities) continue;
+
+        const qrFloat4 qd = QR_GATHER_LANES(states, valid, qd[i - 6]);
+        SVecX4 vJ = Mul(_S[i], qd);
+        ws.v[i] = Apply(ws.Xup[i], ws.v[_parents[i]]) + vJ;
+
+        SVecX4 vJrot = Mul(_Srot[i], qd);
+        ws.vrot[i] = Apply(ws.Xuprot[i], ws.v[_parents[i]]) + vJrot;
+
+        ws.c[i] = MotionCross(ws.v[i], vJ);
+        ws.crot[i] = MotionCross(ws.vrot[i], vJrot);
+    }
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::abaPack(const State* states, const JointVector* tau,
+                                                StateDerivative* dstates, int valid) const
+{
+    Workspace ws;
+    forwardKinematics(states, valid, true, ws);
+
+    // articulated bodies
+    Mat6X4 IA[NDof];
+    SVecX4 U[NDof], Urot[NDof], Utot[NDof];
+    qrFloat4 d[NDof];
+    for (int i = 5; i < NDof; i++) {
+        IA[i] = Broadcast(_Ibody[i]);
+    }
+    for (int i = NDof - 1; i >= 6; i--) {
+        U[i] = Mul(IA[i], _S[i]);
+        Urot[i] = Mul(_Irot[i], Mul(_Srot[i], qrFloat4(1.f)));
+        Utot[i] = ApplyTranspose(ws.Xup[i], U[i]) + ApplyTranspose(ws.Xuprot[i], Urot[i]);
+        d[i] = Dot(_Srot[i], Urot[i]) + Dot(_S[i], U[i]);
+
+        // articulated inertia recursion
+        Mat6X4& Ia = IA[_parents[i]];
+        AddCongruence(ws.Xup[i], IA[i], Ia);
+        AddRigidCongruence(ws.Xuprot[i], Broadcast(_Irot[i]), Ia);
+        const qrFloat4 invD = qrFloat4(1.f) / d[i];
+        for (int r = 0; r < 6; r++) {
+            const qrFloat4 ur = Utot[i].v[r] * invD;
+            for (int c = 0; c < 6; c++) {
+                Ia.m[r][c] = Ia.m[r][c] - ur * Utot[i].v[c];
+            }
+        }
+    }
+
+    // bias forces
+    SVecX4 pA[NDof], pArot[NDof];
+    pA[5] = ForceCross(ws.v[5], Mul(_Ibody[5], ws.v[5]));
+    for (int i = 6; i < NDof; i++) {
+        pA[i] = ForceCross(ws.v[i], Mul(_Ibody[i], ws.v[i]));
+        pArot[i] = ForceCross(ws.vrot[i], Mul(_Irot[i], ws.vrot[i]));
+    }
+
+    qrFloat4 u[NDof];
+    for (int i = NDof - 1; i >= 6; i--) {
+        const qrFloat4 tau_i = QR_GATHER_LANES(tau, valid, operator[](i - 6));
+        u[i] = tau_i - Dot(_S[i], pA[i]) - Dot(_Srot[i], pArot[i]) - Dot(U[i], ws.c[i]) - Dot(Urot[i], ws.crot[i]);
+
+        SVecX4 pa = ApplyTranspose(ws.Xup[i], pA[i] + Mul(IA[i], ws.c[i])) +
+                    ApplyTranspose(ws.Xuprot[i], pArot[i] + Mul(_Irot[i], ws.crot[i]));
+        const qrFloat4 ud = u[i] / d[i];
+        for (int k = 0; k < 6; k++) {
+            pa.v[k] = pa.v[k] + Utot[i].v[k] * ud;
+        }
+        pA[_parents[i]] = pA[_parents[i]] + pa;
+    }
+
+    // include gravity and compute acceleration of floating base
+    SVecX4 a[NDof];
+    SVecX4 a0 = ZeroSVec();
+    for (int k = 0; k < 3; k++) {
+        a0.v[k + 3] = qrFloat4(-_gravity[k]);
+    }
+    a[5] = Apply(ws.Xup[5], a0);
+    SVecX4 rhs = MulTranspose(IA[5], a[5]);
+    for (int k = 0; k < 6; k++) {
+        rhs.v[k] = -pA[5].v[k] - rhs.v[k];
+    }
+    const SVecX4 afb = SolveSpd(IA[5], rhs);
+    a[5] = a[5] + afb;
+
+    // joint accelerations
+    qrFloat4 qdd[NDof];
+    for (int i = 6; i < NDof; i++) {
+        qdd[i] = (u[i] - Dot(Utot[i], a[_parents[i]])) / d[i];
+        a[i] = Apply(ws.Xup[i], a[_parents[i]]) + Mul(_S[i], qdd[i]) + ws.c[i];
+    }
+
+    // dBodyPosition = Rup^T * linear body velocity
+    qrFloat4 dp[3];
+    for (int k = 0; k < 3; k++) {
+        dp[k] = ws.Xup[5].E[0][k] * ws.v[5].v[3] + ws.Xup[5].E[1][k] * ws.v[5].v[4] +
+                ws.Xup[5].E[2][k] * ws.v[5].v[5];
+    }
+
+    for (int l = 0; l < valid; l++) {
+        StateDerivative& out = dstates[l];
+        for (int k = 0; k < 3; k++) {
+            out.dBodyPosition[k] = Lane(dp[k], l);
+        }
+        for (int k = 0; k < 6; k++) {
+            out.dBodyVelocity[k] = Lane(afb.v[k], l);
+        }
+        for (int i = 6; i < NDof; i++) {
+            out.qdd[i - 6] = Lane(qdd[i], l);
+        }
+    }
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::massMatrixPack(const State* states, MassMatrix* H, int valid) const
+{
+    Workspace ws;
+    forwardKinematics(states, valid, false, ws);
+
+    // composite inertias
+    Mat6X4 IC[NDof];
+    for (int i = 5; i < NDof; i++) {
+        IC[i] = Broadcast(_Ibody[i]);
+    }
+    for (int i = NDof - 1; i > 5; i--) {
+        AddRigidCongruence(ws.Xup[i], IC[i], IC[_parents[i]]);
+        AddRigidCongruence(ws.Xuprot[i], Broadcast(_Irot[i]), IC[_parents[i]]);
+    }
+
+    qrFloat4 Hx4[NDof][NDof];
+    for (int r = 0; r < NDof; r++) {
+        for (int c = 0; c < NDof; c++) {
+            Hx4[r][c] = qrFloat4(0.f);
+        }
+    }
+    // Top left corner is the locked inertia of the whole system
+    for (int r = 0; r < 6; r++) {
+        for (int c = 0; c < 6; c++) {
+            Hx4[r][c] = IC[5].m[r][c];
+        }
+    }
+    for (int j = 6; j < NDof; j++) {
+        // f = spatial force required for a unit qdd_j
+        SVecX4 f = Mul(IC[j], _S[j]);
+        const SVecX4 frot = Mul(_Irot[j], Mul(_Srot[j], qrFloat4(1.f)));
+        Hx4[j][j] = Dot(_S[j], f) + Dot(_Srot[j], frot);
+
+        // Propagate down the tree
+        f = ApplyTranspose(ws.Xup[j], f) + ApplyTranspose(ws.Xuprot[j], frot);
+        int i = _parents[j];
+        while (i > 5) {
+            Hx4[i][j] = Dot(_S[i], f);
+            Hx4[j][i] = Hx4[i][j];
+            f = ApplyTranspose(ws.Xup[i], f);
+            i = _parents[i];
+        }
+
+        // Force on floating base
+        for (int k = 0; k < 6; k++) {
+            Hx4[k][j] = f.v[k];
+            Hx4[j][k] = f.v[k];
+        }
+    }
+
+    for (int l = 0; l < valid; l++) {
+        for (int r = 0; r < NDof; r++) {
+            for (int c = 0; c < NDof; c++) {
+                H[l](r, c) = Lane(Hx4[r][c], l);
+            }
+        }
+    }
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::inverseDynamicsPack(const State* states, const StateDerivative* dstates,
+                                                            GeneralizedForce* genForce, int valid) const
+{
+    Workspace ws;
+    forwardKinematics(states, valid, true, ws);
+
+    // spatial accelerations, gravity enters as an acceleration of the base
+    SVecX4 a[NDof], arot[NDof];
+    SVecX4 aGravity = ZeroSVec();
+    for (int k = 0; k < 3; k++) {
+        aGravity.v[k + 3] = qrFloat4(-_gravity[k]);
+    }
+    a[5] = Apply(ws.Xup[5], aGravity);
+    if (dstates != nullptr) {
+        for (int k = 0; k < 6; k++) {
+            a[5].v[k] = a[5].v[k] + QR_GATHER_LANES(dstates, valid, dBodyVelocity[k]);
+        }
+    }
+    for (int i = 6; i < NDof; i++) {
+        a[i] = Apply(ws.Xup[i], a[_parents[i]]) + ws.c[i];
+        arot[i] = Apply(ws.Xuprot[i], a[_parents[i]]) + ws.crot[i];
+        if (dstates != nullptr) {
+            const qrFloat4 qdd = QR_GATHER_LANES(dstates, valid, qdd[i - 6]);
+            a[i] = a[i] + Mul(_S[i], qdd);
+            arot[i] = arot[i] + Mul(_Srot[i], qdd);
+        }
+    }
+
+    SVecX4 f[NDof], frot[NDof];
+    f[5] = Mul(_Ibody[5], a[5]) + ForceCross(ws.v[5], Mul(_Ibody[5], ws.v[5]));
+    for (int i = 6; i < NDof; i++) {
+        f[i] = Mul(_Ibody[i], a[i]) + ForceCross(ws.v[i], Mul(_Ibody[i], ws.v[i]));
+        frot[i] = Mul(_Irot[i], arot[i]) + ForceCross(ws.vrot[i], Mul(_Irot[i], ws.vrot[i]));
+    }
+
+    qrFloat4 tau[NDof];
+    for (int i = NDof - 1; i > 5; i--) {
+        // Pull off components of force along the joint
+        tau[i] = Dot(_S[i], f[i]) + Dot(_Srot[i], frot[i]);
+
+        // Propagate down the tree
+        f[_parents[i]] = f[_parents[i]] + ApplyTranspose(ws.Xup[i], f[i]) + ApplyTranspose(ws.Xuprot[i], frot[i]);
+    }
+    for (int k = 0; k < 6; k++) {
+        tau[k] = f[5].v[k];
+    }
+
+    for (int l = 0; l < valid; l++) {
+        for (int i = 0; i < NDof; i++) {
+            genForce[l][i] = Lane(tau[i], l);
+        }
+    }
+}
+
+#undef QR_GATHER_LANES
+
+template <int NJoints>
+template <typename PackFn>
+void BatchedFloatingBaseModel<NJoints>::forEachPack(int count, const PackFn& packFn) const
+{
+    const int lanes = Lanes;
+    const int packs = (count + lanes - 1) / lanes;
+    auto runPacks = [&](int firstPack, int lastPack) {
+        for (int p = firstPack; p < lastPack; p++) {
+            const int first = p * lanes;
+            packFn(first, std::min(lanes, count - first));
+        }
+    };
+
+    const int threads = std::min(_numThreads, packs);
+    if (threads <= 1) {
+        runPacks(0, packs);
+        return;
+    }
+    const int packsPerThread = (packs + threads - 1) / threads;
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (int t = 1; t < threads; t++) {
+        const int firstPack = t * packsPerThread;
+        const int lastPack = std::min(packs, firstPack + packsPerThread);
+        if (firstPack < lastPack) {
+            workers.emplace_back(runPacks, firstPack, lastPack);
+        }
+    }
+    runPacks(0, std::min(packs, packsPerThread));
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::runABA(const State* states, const JointVector* tau,
+                                               StateDerivative* dstates, int count) const
+{
+    forEachPack(count, [&](int first, int valid) {
+        abaPack(states + first, tau + first, dstates + first, valid);
+    });
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::massMatrix(const State* states, MassMatrix* H, int count) const
+{
+    forEachPack(count, [&](int first, int valid) {
+        massMatrixPack(states + first, H + first, valid);
+    });
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::inverseDynamics(const State* states, const StateDerivative* dstates,
+                                                        GeneralizedForce* genForce, int count) const
+{
+    forEachPack(count, [&](int first, int valid) {
+        inverseDynamicsPack(states + first, dstates + first, genForce + first, valid);
+    });
+}
+
+template <int NJoints>
+void BatchedFloatingBaseModel<NJoints>::biasForces(const State* states, GeneralizedForce* bias, int count) const
+{
+    forEachPack(count, [&](int first, int valid) {
+        inverseDynamicsPack(states + first, nullptr, bias + first, valid);
+    });
+}
+
+template class BatchedFloatingBaseModel<12>;
@@ -0,0 +1,536 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "dynamics/qr_fixed_floating_base_model.hpp"
+
+/**
+ * @brief jointXform(joint, axis, q) * Xtree
+ */
+template <typename T>
+static PluckerTransform<T> jointTransform(JointType joint, CoordinateAxis axis, T q,
+                                          const PluckerTransform<T> &Xtree) {
+    if (joint == JointType::Revolute) {
+        return PluckerTransform<T>(coordinateRotation(axis, q) * Xtree.E, Xtree.r);
+    } else if (joint == JointType::Prismatic) {
+        Vec3<T> d = Vec3<T>::Zero();
+        d[static_cast<int>(axis)] = q;
+        return PluckerTransform<T>(Xtree.E, Xtree.r + Xtree.E.transpose() * d);
+    }
+    throw std::runtime_error("Unknown joint xform\n");
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::addBase(const SpatialInertia<T> &inertia) {
+    if (_nDof) {
+        throw std::runtime_error("Cannot add base multiple times!\n");
+    }
+
+    Mat6<T> eye6 = Mat6<T>::Identity();
+    PluckerTransform<T> identity;
+    SVec<T> zero6 = SVec<T>::Zero();
+    Mat6<T> zero66 = Mat6<T>::Zero();
+    SpatialInertia<T> zeroInertia(zero66);
+    for (int i = 0; i < NDof; i++) {
+        _parents[i] = 0;
+        _gearRatios[i] = 0;
+        _d[i] = 0;
+        _u[i] = 0;
+        _jointTypes[i] = JointType::Nothing;
+        _jointAxes[i] = CoordinateAxis::X;
+        _Xtree[i] = identity;
+        _Xrot[i] = identity;
+        _Ibody[i] = zeroInertia;
+        _Irot[i] = zeroInertia;
+        _IC[i] = zeroInertia;
+        _Xup[i] = identity;
+        _Xuprot[i] = identity;
+        _Xa[i] = identity;
+        _IA[i] = eye6;
+        _v[i] = _vrot[i] = _a[i] = _arot[i] = _avp[i] = _avprot[i] = _c[i] = _crot[i] = zero6;
+        _S[i] = _Srot[i] = _fvp[i] = _fvprot[i] = _ag[i] = _agrot[i] = _f[i] = _frot[i] = zero6;
+        _U[i] = _Urot[i] = _Utot[i] = _pA[i] = _pArot[i] = _externalForces[i] = zero6;
+    }
+    _jointTypes[5] = JointType::FloatingBase;
+    _Ibody[5] = inertia;
+    _gearRatios[5] = 1;
+    _nDof = 6;
+
+    _H.setZero();
+    _Cqd.setZero();
+    _G.setZero();
+    _genForce.setZero();
+    _state.q.setZero();
+    _state.qd.setZero();
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::addBase(T mass, const Vec3<T> &com,
+                                                             const Mat3<T> &I) {
+    SpatialInertia<T> IS(mass, com, I);
+    addBase(IS);
+}
+
+template <typename T, int NJoints, int NContacts>
+int FixedFloatingBaseModel<T, NJoints, NContacts>::addBody(const SpatialInertia<T> &inertia,
+                                                            const SpatialInertia<T> &rotorInertia,
+                                                            T gearRatio, int parent, JointType jointType,
+                                                            CoordinateAxis jointAxis,
+                                                            const Mat6<T> &Xtree, const Mat6<T> &Xrot) {
+    if (parent >= _nDof || _nDof < 6) {
+        throw std::runtime_error(
+            "addBody got invalid parent: " + std::to_string(parent) +
+            " nDofs: " + std::to_string(_nDof) + "\n");
+    }
+    if (_nDof >= NDof) {
+        throw std::runtime_error("addBody: the model has only " + std::to_string(NJoints) + " joints\n");
+    }
+
+    const int i = _nDof;
+    _parents[i] = parent;
+    _gearRatios[i] = gearRatio;
+    _jointTypes[i] = jointType;
+    _jointAxes[i] = jointAxis;
+    _Xtree[i] = PluckerTransform<T>(Xtree);
+    _Xrot[i] = PluckerTransform<T>(Xrot);
+    _Ibody[i] = inertia;
+    _Irot[i] = rotorInertia;
+    // the motion subspace only depends on the joint
+    _S[i] = jointMotionSubspace<T>(jointType, jointAxis);
+    _Srot[i] = _S[i] * gearRatio;
+    _nDof++;
+    return _nDof;
+}
+
+template <typename T, int NJoints, int NContacts>
+int FixedFloatingBaseModel<T, NJoints, NContacts>::addGroundContactPoint(int bodyID,
+                                                                          const Vec3<T> &location) {
+    if (bodyID >= _nDof) {
+        throw std::runtime_error(
+            "addGroundContactPoint got invalid bodyID: " + std::to_string(bodyID) +
+            " nDofs: " + std::to_string(_nDof) + "\n");
+    }
+    if (_nGroundContact >= NContacts) {
+        throw std::runtime_error("addGroundContactPoint: the model has room for only " +
+                                 std::to_string(NContacts) + " contact points\n");
+    }
+    _gcParent[_nGroundContact] = bodyID;
+    _gcLocation[_nGroundContact] = location;
+    _pGC[_nGroundContact].setZero();
+    _vGC[_nGroundContact].setZero();
+    _Jc[_nGroundContact].setZero();
+    _Jcdqd[_nGroundContact].setZero();
+    return _nGroundContact++;
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::check() const {
+    if (_nDof != NDof)
+        throw std::runtime_error("Invalid dof: " + std::to_string(_nDof) + " bodies added, the model has " +
+                                 std::to_string(NDof) + "\n");
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::forwardKinematics() {
+    if (_kinematicsUpToDate) return;
+
+    // calculate joint transformations
+    Mat3<T> R = quaternionToRotationMatrix(_state.bodyOrientation);
+    _Xup[5] = PluckerTransform<T>(R, _state.bodyPosition);
+    _v[5] = _state.bodyVelocity;
+    for (int i = 6; i < NDof; i++) {
+        // joint xform
+        _Xup[i] = jointTransform(_jointTypes[i], _jointAxes[i], _state.q[i - 6], _Xtree[i]);
+        SVec<T> vJ = _S[i] * _state.qd[i - 6];
+        _v[i] = _Xup[i].apply(_v[_parents[i]]) + vJ;
+
+        // Same for rotors
+        _Xuprot[i] = jointTransform(_jointTypes[i], _jointAxes[i], _state.q[i - 6] * _gearRatios[i], _Xrot[i]);
+        SVec<T> vJrot = _Srot[i] * _state.qd[i - 6];
+        _vrot[i] = _Xuprot[i].apply(_v[_parents[i]]) + vJrot;
+
+        // Coriolis accelerations
+        _c[i] = motionCrossProduct(_v[i], vJ);
+        _crot[i] = motionCrossProduct(_vrot[i], vJrot);
+    }
+
+    // calculate from absolute transformations
+    _Xa[5] = _Xup[5];
+    for (int i = 6; i < NDof; i++) {
+        _Xa[i] = _Xup[i] * _Xa[_parents[i]];
+    }
+
+    // ground contact points
+    for (int j = 0; j < _nGroundContact; j++) {
+        int i = _gcParent[j];
+        SVec<T> vSpatial = _Xa[i].inverse().apply(_v[i]);  // from link to absolute
+        _pGC[j] = _Xa[i].r + _Xa[i].E.transpose() * _gcLocation[j];
+        _vGC[j] = spatialToLinearVelocity(vSpatial, _pGC[j]);
+    }
+    _kinematicsUpToDate = true;
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::contactJacobians() {
+    forwardKinematics();
+    biasAccelerations();
+
+    for (int k = 0; k < _nGroundContact; k++) {
+        _Jc[k].setZero();
+        int i = _gcParent[k];
+
+        // Rotation to absolute coords
+        Mat3<T> Rai = _Xa[i].E.transpose();
+        Mat6<T> Xc = createSXform(Rai, _gcLocation[k]);
+
+        // Bias acceleration
+        SVec<T> ac = Xc * _avp[i];
+        SVec<T> vc = Xc * _v[i];
+        _Jcdqd[k] = spatialToLinearAcceleration(ac, vc);
+
+        // rows for linear velocity in the world, from tips to base
+        Eigen::Matrix<T, 3, 6> Xout = Xc.template bottomRows<3>();
+        while (i > 5) {
+            _Jc[k].col(i) = Xout * _S[i];
+            Xout = Xout * _Xup[i].toMatrix();
+            i = _parents[i];
+        }
+        _Jc[k].template leftCols<6>() = Xout;
+    }
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::biasAccelerations() {
+    if (_biasAccelerationsUpToDate) return;
+    forwardKinematics();
+    _avp[5].setZero();
+
+    // from base to tips
+    for (int i = 6; i < NDof; i++) {
+        _avp[i] = _Xup[i].apply(_avp[_parents[i]]) + _c[i];
+        _avprot[i] = _Xuprot[i].apply(_avp[_parents[i]]) + _crot[i];
+    }
+    _biasAccelerationsUpToDate = true;
+}
+
+template <typename T, int NJoints, int NContacts>
+const typename FixedFloatingBaseModel<T, NJoints, NContacts>::GeneralizedForce&
+FixedFloatingBaseModel<T, NJoints, NContacts>::generalizedGravityForce() {
+    forwardKinematics();
+
+    SVec<T> aGravity;
+    aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
+    _ag[5] = _Xup[5].apply(aGravity);
+
+    // Gravity comp force is the same as force required to accelerate opposite gravity. The force of
+    // a subtree is summed from the tips instead of taken from the composite inertias, which saves
+    // transforming two inertias per body.
+    std::array<SVec<T>, NDof> fg;
+    fg[5] = _Ibody[5].getMatrix() * _ag[5];
+    for (int i = 6; i < NDof; i++) {
+        _ag[i] = _Xup[i].apply(_ag[_parents[i]]);
+        _agrot[i] = _Xuprot[i].apply(_ag[_parents[i]]);
+        fg[i] = _Ibody[i].getMatrix() * _ag[i];
+    }
+    for (int i = NDof - 1; i > 5; i--) {
+        // body and rotor
+        const SVec<T> fgrot = _Irot[i].getMatrix() * _agrot[i];
+        _G[i] = -_S[i].dot(fg[i]) - _Srot[i].dot(fgrot);
+        fg[_parents[i]] += _Xup[i].applyTranspose(fg[i]) + _Xuprot[i].applyTranspose(fgrot);
+    }
+    _G.template topRows<6>() = -fg[5];
+    return _G;
+}
+
+template <typename T, int NJoints, int NContacts>
+const typename FixedFloatingBaseModel<T, NJoints, NContacts>::GeneralizedForce&
+FixedFloatingBaseModel<T, NJoints, NContacts>::generalizedCoriolisForce() {
+    biasAccelerations();
+
+    // Floating base force
+    const Mat6<T> &Ifb = _Ibody[5].getMatrix();
+    SVec<T> hfb = Ifb * _v[5];
+    _fvp[5] = Ifb * _avp[5] + forceCrossProduct(_v[5], hfb);
+
+    for (int i = 6; i < NDof; i++) {
+        // Force on body i
+        const Mat6<T> &Ii = _Ibody[i].getMatrix();
+        SVec<T> hi = Ii * _v[i];
+        _fvp[i] = Ii * _avp[i] + forceCrossProduct(_v[i], hi);
+
+        // Force on rotor i
+        const Mat6<T> &Ir = _Irot[i].getMatrix();
+        SVec<T> hr = Ir * _vrot[i];
+        _fvprot[i] = Ir * _avprot[i] + forceCrossProduct(_vrot[i], hr);
+    }
+
+    for (int i = NDof - 1; i > 5; i--) {
+        // Extract force along the joints
+        _Cqd[i] = _S[i].dot(_fvp[i]) + _Srot[i].dot(_fvprot[i]);
+
+        // Propagate force down the tree
+        _fvp[_parents[i]] += _Xup[i].applyTranspose(_fvp[i]);
+        _fvp[_parents[i]] += _Xuprot[i].applyTranspose(_fvprot[i]);
+    }
+
+    // Force on floating base
+    _Cqd.template topRows<6>() = _fvp[5];
+    return _Cqd;
+}
+
+template <typename T, int NJoints, int NContacts>
+Mat3<T> FixedFloatingBaseModel<T, NJoints, NContacts>::getOrientation(int link_idx) {
+    forwardKinematics();
+    return _Xa[link_idx].E.transpose();
+}
+
+template <typename T, int NJoints, int NContacts>
+Vec3<T> FixedFloatingBaseModel<T, NJoints, NContacts>::getPosition(const int link_idx) {
+    forwardKinematics();
+    return _Xa[link_idx].r;
+}
+
+template <typename T, int NJoints, int NContacts>
+Vec3<T> FixedFloatingBaseModel<T, NJoints, NContacts>::getPosition(const int link_idx, const Vec3<T> &local_pos) {
+    forwardKinematics();
+    return _Xa[link_idx].r + _Xa[link_idx].E.transpose() * local_pos;  // from link to absolute
+}
+
+template <typename T, int NJoints, int NContacts>
+Vec3<T> FixedFloatingBaseModel<T, NJoints, NContacts>::getLinearVelocity(const int link_idx,
+                                                                         const Vec3<T> &point) {
+    forwardKinematics();
+    Mat3<T> Rai = getOrientation(link_idx);
+    return Rai * spatialToLinearVelocity(_v[link_idx], point);
+}
+
+template <typename T, int NJoints, int NContacts>
+Vec3<T> FixedFloatingBaseModel<T, NJoints, NContacts>::getLinearVelocity(const int link_idx) {
+    return getLinearVelocity(link_idx, Vec3<T>::Zero());
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::compositeInertias() {
+    if (_compositeInertiasUpToDate) return;
+
+    forwardKinematics();
+    // initialize
+    for (int i = 5; i < NDof; i++) {
+        _IC[i].setMatrix(_Ibody[i].getMatrix());
+    }
+    // backward loop
+    for (int i = NDof - 1; i > 5; i--) {
+        // Propagate inertia down the tree
+        _IC[_parents[i]].addMatrix(_Xup[i].rigidCongruence(_IC[i].getMatrix()));
+        _IC[_parents[i]].addMatrix(_Xuprot[i].rigidCongruence(_Irot[i].getMatrix()));
+    }
+    _compositeInertiasUpToDate = true;
+}
+
+template <typename T, int NJoints, int NContacts>
+const typename FixedFloatingBaseModel<T, NJoints, NContacts>::MassMatrix&
+FixedFloatingBaseModel<T, NJoints, NContacts>::massMatrix() {
+    compositeInertias();
+    _H.setZero();
+
+    // Top left corner is the locked inertia of the whole system
+    _H.template topLeftCorner<6, 6>() = _IC[5].getMatrix();
+    for (int j = 6; j < NDof; j++) {
+        // f = spatial force required for a unit qdd_j
+        SVec<T> f = _IC[j].getMatrix() * _S[j];
+        SVec<T> frot = _Irot[j].getMatrix() * _Srot[j];
+
+        _H(j, j) = _S[j].dot(f) + _Srot[j].dot(frot);
+
+        // Propagate down the tree
+        f = _Xup[j].applyTranspose(f) + _Xuprot[j].applyTranspose(frot);
+        int i = _parents[j];
+        while (i > 5) {
+            // in here f is expressed in frame {i}
+            _H(i, j) = _S[i].dot(f);
+            _H(j, i) = _H(i, j);
+
+            // Propagate down the tree
+            f = _Xup[i].applyTranspose(f);
+            i = _parents[i];
+        }
+
+        // Force on floating base
+        _H.template block<6, 1>(0, j) = f;
+        _H.template block<1, 6>(j, 0) = f.adjoint();
+    }
+    return _H;
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::forwardAccelerationKinematics() {
+    if (_accelerationsUpToDate) {
+        return;
+    }
+
+    forwardKinematics();
+    biasAccelerations();
+
+    // Initialize gravity with model info
+    SVec<T> aGravity = SVec<T>::Zero();
+    aGravity.template tail<3>() = _gravity;
+
+    // Spatial force for floating base
+    _a[5] = -_Xup[5].apply(aGravity) + _dState.dBodyVelocity;
+
+    // loop through joints
+    for (int i = 6; i < NDof; i++) {
+        // spatial acceleration
+        _a[i] = _Xup[i].apply(_a[_parents[i]]) + _S[i] * _dState.qdd[i - 6] + _c[i];
+        _arot[i] = _Xuprot[i].apply(_a[_parents[i]]) + _Srot[i] * _dState.qdd[i - 6] + _crot[i];
+    }
+    _accelerationsUpToDate = true;
+}
+
+template <typename T, int NJoints, int NContacts>
+const typename FixedFloatingBaseModel<T, NJoints, NContacts>::GeneralizedForce&
+FixedFloatingBaseModel<T, NJoints, NContacts>::inverseDynamics(const StateDerivative &dState) {
+    setDState(dState);
+    forwardAccelerationKinematics();
+
+    // Spatial force for floating base
+    SVec<T> hb = _Ibody[5].getMatrix() * _v[5];
+    _f[5] = _Ibody[5].getMatrix() * _a[5] + forceCrossProduct(_v[5], hb);
+
+    // loop through joints
+    for (int i = 6; i < NDof; i++) {
+        // spatial momentum
+        SVec<T> hi = _Ibody[i].getMatrix() * _v[i];
+        SVec<T> hr = _Irot[i].getMatrix() * _vrot[i];
+
+        // spatial force
+        _f[i] = _Ibody[i].getMatrix() * _a[i] + forceCrossProduct(_v[i], hi);
+        _frot[i] = _Irot[i].getMatrix() * _arot[i] + forceCrossProduct(_vrot[i], hr);
+    }
+
+    for (int i = NDof - 1; i > 5; i--) {
+        // Pull off components of force along the joint
+        _genForce[i] = _S[i].dot(_f[i]) + _Srot[i].dot(_frot[i]);
+
+        // Propagate down the tree
+        _f[_parents[i]] += _Xup[i].applyTranspose(_f[i]);
+        _f[_parents[i]] += _Xuprot[i].applyTranspose(_frot[i]);
+    }
+    _genForce.template head<6>() = _f[5];
+    return _genForce;
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::updateArticulatedBodies() {
+    if (_articulatedBodiesUpToDate) return;
+
+    forwardKinematics();
+
+    _IA[5] = _Ibody[5].getMatrix();
+    for (int i = 6; i < NDof; i++) {
+        _IA[i] = _Ibody[i].getMatrix();
+    }
+
+    // Pat's magic principle of least constraint (Guass too!)
+    for (int i = NDof - 1; i >= 6; i--) {
+        _U[i] = _IA[i] * _S[i];
+        _Urot[i] = _Irot[i].getMatrix() * _Srot[i];
+        _Utot[i] = _Xup[i].applyTranspose(_U[i]) + _Xuprot[i].applyTranspose(_Urot[i]);
+
+        _d[i] = _Srot[i].transpose() * _Urot[i];
+        _d[i] += _S[i].transpose() * _U[i];
+
+        // articulated inertia recursion
+        Mat6<T> Ia = _Xup[i].congruence(_IA[i]) + _Xuprot[i].rigidCongruence(_Irot[i].getMatrix()) -
+                     _Utot[i] * _Utot[i].transpose() / _d[i];
+        _IA[_parents[i]] += Ia;
+    }
+
+    _invIA5.compute(_IA[5]);
+    _articulatedBodiesUpToDate = true;
+}
+
+template <typename T, int NJoints, int NContacts>
+void FixedFloatingBaseModel<T, NJoints, NContacts>::runABA(const JointVector &tau, StateDerivative &dstate) {
+    forwardKinematics();
+    updateArticulatedBodies();
+
+    // create spatial vector for gravity
+    SVec<T> aGravity;
+    aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
+
+    // float-base articulated inertia
+    SVec<T> ivProduct = _Ibody[5].getMatrix() * _v[5];
+    _pA[5] = forceCrossProduct(_v[5], ivProduct);
+
+    // loop 1, down the tree
+    for (int i = 6; i < NDof; i++) {
+        ivProduct = _Ibody[i].getMatrix() * _v[i];
+        _pA[i] = forceCrossProduct(_v[i], ivProduct);
+
+        // same for rotors
+        ivProduct = _Irot[i].getMatrix() * _vrot[i];
+        _pArot[i] = forceCrossProduct(_vrot[i], ivProduct);
+    }
+
+    // adjust pA for external forces
+    for (int i = 5; i < NDof; i++) {
+        _pA[i] = _pA[i] - _Xa[i].inverse().applyTranspose(_externalForces[i]);
+    }
+
+    // Pat's magic principle of least constraint
+    for (int i = NDof - 1; i >= 6; i--) {
+        _u[i] = tau[i - 6] - _S[i].transpose() * _pA[i] -
+                _Srot[i].transpose() * _pArot[i] - _U[i].transpose() * _c[i] -
+                _Urot[i].transpose() * _crot[i];
+
+        // articulated inertia recursion
+        SVec<T> pa =
+            _Xup[i].applyTranspose(_pA[i] + _IA[i] * _c[i]) +
+            _Xuprot[i].applyTranspose(_pArot[i] + _Irot[i].getMatrix() * _crot[i]) +
+            _Utot[i] * _u[i] / _d[i];
+        _pA[_parents[i]] += pa;
+    }
+
+    // include gravity and compute acceleration of floating base
+    SVec<T> a0 = -aGravity;
+    SVec<T> ub = -_pA[5];
+    _a[5] = _Xup[5].apply(a0);
+    SVec<T> afb = _invIA5.solve(ub - _IA[5].transpose() * _a[5]);
+    _a[5] += afb;
+
+    // joint accelerations
+    for (int i = 6; i < NDof; i++) {
+        dstate.qdd[i - 6] = (_u[i] - _Utot[i].transpose() * _a[_parents[i]]) / _d[i];
+        _a[i] = _Xup[i].apply(_a[_parents[i]]) + _S[i] * dstate.qdd[i - 6] + _c[i];
+    }
+    // the accelerations of the bodies no longer belong to _dState
+    _accelerationsUpToDate = false;
+
+    // output
+    dstate.dBodyPosition = _Xup[5].E.transpose() * _state.bodyVelocity.template block<3, 1>(3, 0);
+    dstate.dBodyVelocity = afb;
+}
+
+template class FixedFloatingBaseModel<float, 12, 4>;
+template class FixedFloatingBaseModel<double, 12, 4>;
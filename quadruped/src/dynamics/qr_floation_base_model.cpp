@@ -942,4 +942,147 @@ DMat<T> FloatingBaseModel<T>::invContactInertia(
 }
 
 // template class FloatingBaseModel<double>;
+template <typename T>
+void FloatingBaseModel<T>::propagateDynamicsDerivative(size_t j, const SVec<T> &dv,
+                                                       const SVec<T> &dvrot, const SVec<T> &da,
+                                                       const SVec<T> &darot, const SVec<T> &dF,
+                                                       DMat<T> &out, size_t col) {
+    out.col(col).setZero();
+    _dv[j] = dv;
+    _dvrot[j] = dvrot;
+    _da[j] = da;
+    _darot[j] = darot;
+
+    // the velocities and accelerations of the subtree of j, from j to tips
+    _inSubtree[j] = true;
+    for (size_t i = j + 1; i < _nDof; i++) {
+        size_t p = _parents[i];
+        _inSubtree[i] = p >= j && _inSubtree[p];
+        if (!_inSubtree[i]) continue;
+
+        SVec<T> vJ = _S[i] * _state.qd[i - 6];
+        SVec<T> vJrot = _Srot[i] * _state.qd[i - 6];
+        _dv[i] = _Xup[i] * _dv[p];
+        _da[i] = _Xup[i] * _da[p] + motionCrossProduct(_dv[i], vJ);
+        _dvrot[i] = _Xuprot[i] * _dv[p];
+        _darot[i] = _Xuprot[i] * _da[p] + motionCrossProduct(_dvrot[i], vJrot);
+    }
+
+    // forces on the bodies and rotors of the subtree
+    for (size_t i = j; i < _nDof; i++) {
+        if (!_inSubtree[i]) continue;
+        const Mat6<T> &Ii = _Ibody[i].getMatrix();
+        SVec<T> hi = Ii * _v[i];
+        SVec<T> dhi = Ii * _dv[i];
+        _df[i] = Ii * _da[i] + forceCrossProduct(_dv[i], hi) + forceCrossProduct(_v[i], dhi);
+        if (i > 5) {
+            const Mat6<T> &Ir = _Irot[i].getMatrix();
+            SVec<T> hr = Ir * _vrot[i];
+            SVec<T> dhr = Ir * _dvrot[i];
+            _dfrot[i] = Ir * _darot[i] + forceCrossProduct(_dvrot[i], hr) + forceCrossProduct(_vrot[i], dhr);
+        }
+    }
+
+    // accumulate the forces of the subtree, from tips to j
+    for (size_t i = _nDof - 1; i > j; i--) {
+        if (!_inSubtree[i]) continue;
+        out(i, col) = _S[i].dot(_df[i]) + _Srot[i].dot(_dfrot[i]);
+        _df[_parents[i]] += _Xup[i].transpose() * _df[i] + _Xuprot[i].transpose() * _dfrot[i];
+    }
+    if (j == 5) {
+        out.col(col).template head<6>() = _df[5];
+        return;
+    }
+
+    // the path from j to the base only transmits the force
+    out(j, col) = _S[j].dot(_df[j]) + _Srot[j].dot(_dfrot[j]);
+    SVec<T> f = _Xup[j].transpose() * _df[j] + _Xuprot[j].transpose() * _dfrot[j] + dF;
+    size_t i = _parents[j];
+    while (i > 5) {
+        out(i, col) = _S[i].dot(f);
+        f = _Xup[i].transpose() * f;
+        i = _parents[i];
+    }
+    out.col(col).template head<6>() = f;
+}
+
+template <typename T>
+void FloatingBaseModel<T>::inverseDynamicsDerivatives(const FBModelStateDerivative<T> &dState,
+                                                      DMat<T> &dtau_dq, DMat<T> &dtau_dv) {
+    // nominal pass, leaves the force transmitted by each body to its parent in _f
+    inverseDynamics(dState);
+
+    if (_dv.size() != _nDof) {
+        _dv.resize(_nDof);
+        _dvrot.resize(_nDof);
+        _da.resize(_nDof);
+        _darot.resize(_nDof);
+        _df.resize(_nDof);
+        _dfrot.resize(_nDof);
+        _inSubtree.resize(_nDof);
+    }
+    dtau_dq.resize(_nDof, _nDof);
+    dtau_dv.resize(_nDof, _nDof);
+    const SVec<T> zero = SVec<T>::Zero();
+
+    // base rotation, only turns gravity in body coordinates:
+    // a5 = [0; -R g] + dBodyVelocity and d(-R g) = e_k x (R g)
+    Vec3<T> gBody = rotationFromSXform(_Xup[5]) * _gravity;
+    for (size_t k = 0; k < 3; k++) {
+        SVec<T> da = zero;
+        da.template tail<3>() = Vec3<T>::Unit(k).cross(gBody);
+        propagateDynamicsDerivative(5, zero, zero, da, zero, zero, dtau_dq, k);
+    }
+    // base translation does not appear in body coordinates
+    dtau_dq.template middleCols<3>(3).setZero();
+
+    // base velocity
+    for (size_t k = 0; k < 6; k++) {
+        propagateDynamicsDerivative(5, SVec<T>::Unit(k), zero, zero, zero, zero, dtau_dv, k);
+    }
+
+    for (size_t j = 6; j < _nDof; j++) {
+        size_t p = _parents[j];
+        SVec<T> vJ = _S[j] * _state.qd[j - 6];
+        SVec<T> vJrot = _Srot[j] * _state.qd[j - 6];
+
+        // joint position, d Xup / dq = -crm(S) Xup, the same for the rotor with Srot
+        SVec<T> vp = _Xup[j] * _v[p];
+        SVec<T> ap = _Xup[j] * _a[p];
+        SVec<T> vprot = _Xuprot[j] * _v[p];
+        SVec<T> aprot = _Xuprot[j] * _a[p];
+        SVec<T> dv = -motionCrossProduct(_S[j], vp);
+        SVec<T> da = -motionCrossProduct(_S[j], ap) + motionCrossProduct(dv, vJ);
+        SVec<T> dvrot = -motionCrossProduct(_Srot[j], vprot);
+        SVec<T> darot = -motionCrossProduct(_Srot[j], aprot) + motionCrossProduct(dvrot, vJrot);
+        // d (Xup^T f) / dq = Xup^T (S x* f)
+        SVec<T> dF = _Xup[j].transpose() * forceCrossProduct(_S[j], _f[j]) +
+                     _Xuprot[j].transpose() * forceCrossProduct(_Srot[j], _frot[j]);
+        propagateDynamicsDerivative(j, dv, dvrot, da, darot, dF, dtau_dq, j);
+
+        // joint velocity
+        SVec<T> dc = motionCrossProduct(_v[j], _S[j]);
+        SVec<T> dcrot = motionCrossProduct(_vrot[j], _Srot[j]);
+        propagateDynamicsDerivative(j, _S[j], _Srot[j], dc, dcrot, zero, dtau_dv, j);
+    }
+}
+
+template <typename T>
+void FloatingBaseModel<T>::forwardDynamicsDerivatives(const DVec<T> &tau,
+                                                      FBModelStateDerivative<T> &dstate,
+                                                      DMat<T> &dqdd_dq, DMat<T> &dqdd_dv,
+                                                      DMat<T> &dqdd_dtau) {
+    runABA(tau, dstate);
+    inverseDynamicsDerivatives(dstate, dqdd_dq, dqdd_dv);
+
+    // H * dqdd + dtau_dx = 0 along the solution, H is symmetric positive definite
+    Eigen::LLT<DMat<T>> Hllt(massMatrix());
+    Hllt.solveInPlace(dqdd_dq);
+    Hllt.solveInPlace(dqdd_dv);
+    dqdd_dq = -dqdd_dq;
+    dqdd_dv = -dqdd_dv;
+    dqdd_dtau = Hllt.solve(DMat<T>::Identity(_nDof, _nDof).rightCols(_nDof - 6));
+}
+
 template class FloatingBaseModel<float>;
+template class FloatingBaseModel<double>;
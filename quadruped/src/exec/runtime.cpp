@@ -24,6 +24,13 @@
 
 #include "exec/runtime.h"
 
+#include <memory>
+
+/**
+ * @brief the receiver started by setUpController, it has to live as long as the elevation map is in use.
+ */
+static std::unique_ptr<qrPointCloudReceiver> pointCloudReceiver;
+
 qrLocomotionController *setUpController(qrRobot *quadruped, std::string homeDir, ros::NodeHandle &nh, bool useMPC)
 {
     qrGaitGenerator *gaitGenerator;
@@ -36,8 +43,11 @@ qrLocomotionController *setUpController(qrRobot *quadruped, std::string homeDir,
 
     qrGroundSurfaceEstimator *groundEsitmator = new qrGroundSurfaceEstimator(quadruped, homeDir + "/" + prefix + "_config/terrain.yaml");
     std::cout << "init groundEsitmator finish\n" << std::endl;
+
+    // feeds the depth clouds into the elevation map kept by the ground estimator
+    pointCloudReceiver.reset(new qrPointCloudReceiver(nh, &groundEsitmator->elevationMap));
     
-    qrRobotEstimator *stateEstimator = new qrRobotEstimator(quadruped, gaitGenerator, groundEsitmator);
+    qrRobotEstimator *stateEstimator = new qrRobotEstimator(quadruped, groundEsitmator);
     std::cout << "init robotEstimator finish\n" << std::endl;
      
     qrComPlanner  *comPlanner  = new qrComPlanner (quadruped, gaitGenerator, stateEstimator);
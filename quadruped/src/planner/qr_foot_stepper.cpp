@@ -25,6 +25,7 @@
 #include "planner/qr_foot_stepper.h"
 #include "quadprogpp/QuadProg++.hh"
 #include "quadprogpp/Array.hh"
+#include "common/qr_log.h"
 
 qrFootStepper ::qrFootStepper (qrTerrain& terrain, float defaultFootholdOffset, std::string level)
 {
@@ -97,7 +98,7 @@ double  qrFootStepper ::CheckSolution(Eigen::Matrix<float, 1, 4> currentFoothold
         quadprogpp::solve_quadprog(G, a, CE, e, CI, -b, x);
     }
     catch (std::overflow_error) {
-        std::cout << "overflow_error when compute foothold" << std::endl;
+        QR_LOG_WARN_EVERY(1.f, "overflow_error when compute foothold");
         return MAXIMUM_STEP;
     }
 
@@ -130,10 +131,8 @@ int qrFootStepper ::StepGenerator(Eigen::Matrix<float, 1, 4>& currentFootholdsX,
         for (int legId = 0; legId < 4; ++legId) {
             float defaultNextFootholdX = defaultNextFootholdsX[legId];
             if (std::abs(defaultNextFootholdX - gap.distance) <= gap.width / 2) {
-                printf("meet gap!, gap = %f, legId = %d \n", gap.distance, legId);
-                std::cout << "distance between defaultNextFootholdX and gap: "
-                        << gap.distance - defaultNextFootholdX
-                        << std::endl;
+                QR_LOG_DEBUG("meet gap!, gap = %f, legId = %d, distance between defaultNextFootholdX and gap: %f",
+                             gap.distance, legId, gap.distance - defaultNextFootholdX);
                 float stepDeltaX = 0.f;
                 if (legId <= 1) { // front leg meet the gap
                     frontGap = gap;
@@ -180,7 +179,10 @@ std::tuple<Eigen::Matrix<float,3,4>, Eigen::Matrix<float,3,4>> qrFootStepper ::G
                                                                 Eigen::Matrix<float, 6, 1>& desiredComPose,
                                                                 std::vector<int>& legIds)
 {   
-    std::cout << "currentFootholds" << currentFootholds << std::endl;
+    QR_LOG_DEBUG("currentFootholds x: %f %f %f %f, y: %f %f %f %f, z: %f %f %f %f",
+                 currentFootholds(0, 0), currentFootholds(0, 1), currentFootholds(0, 2), currentFootholds(0, 3),
+                 currentFootholds(1, 0), currentFootholds(1, 1), currentFootholds(1, 2), currentFootholds(1, 3),
+                 currentFootholds(2, 0), currentFootholds(2, 1), currentFootholds(2, 2), currentFootholds(2, 3));
     Eigen::Matrix<float, 3, 4> nextFootholds = currentFootholds;
     Eigen::Matrix<float, 3, 1> constOffset = {0.1f, 0.f, 0.f};
     dZ << 0.f, 0.f, 0.f, 0.f; 
@@ -203,7 +205,7 @@ std::tuple<Eigen::Matrix<float,3,4>, Eigen::Matrix<float,3,4>> qrFootStepper ::G
         int maxBackFootK = std::max(fourFootOnWhichStairK[2], fourFootOnWhichStairK[3]);
         int maxFrontFootK = std::max(fourFootOnWhichStairK[1], fourFootOnWhichStairK[0]);
         int minFrontFootK = std::min(fourFootOnWhichStairK[1], fourFootOnWhichStairK[0]);
-        printf("[up] fourFootOnWhichStairK = %d, %d, %d, %d\n", fourFootOnWhichStairK[0],fourFootOnWhichStairK[1],fourFootOnWhichStairK[2],fourFootOnWhichStairK[3]);
+        QR_LOG_DEBUG("[up] fourFootOnWhichStairK = %d, %d, %d, %d\n", fourFootOnWhichStairK[0],fourFootOnWhichStairK[1],fourFootOnWhichStairK[2],fourFootOnWhichStairK[3]);
         for (int legId : legIds) {
             Vec3<float> nextFootPos = nextFootholds.col(legId) + constOffset;
             int footOnWhichStairK = fourFootOnWhichStairK[legId];
@@ -214,7 +216,7 @@ std::tuple<Eigen::Matrix<float,3,4>, Eigen::Matrix<float,3,4>> qrFootStepper ::G
                 nextFootholds.col(legId) = nextFootPos;
                 continue;
             }
-            printf("foot stepper leg [%d]: tmp = %f\n", legId, tmp);
+            QR_LOG_DEBUG("foot stepper leg [%d]: tmp = %f", legId, tmp);
             if (nextFootPos[0] > stairUp.startPoint[0] - 0.1 + tmp && nextFootPos[0] < stairUp.startPoint[0] - 0.05 + tmp) {
                 nextFootPos[0] = stairUp.startPoint[0] - 0.08 + tmp;
             } else if (nextFootPos[0] >= stairUp.startPoint[0] - 0.05 + tmp &&nextFootPos[0] < stairUp.startPoint[0] + 0.02 + tmp) {
@@ -266,7 +268,7 @@ std::tuple<Eigen::Matrix<float,3,4>, Eigen::Matrix<float,3,4>> qrFootStepper ::G
         int maxBackFootK = std::max(fourFootOnWhichStairK[2], fourFootOnWhichStairK[3]);
         int maxFrontFootK = std::max(fourFootOnWhichStairK[1], fourFootOnWhichStairK[0]);
         int minFrontFootK = std::min(fourFootOnWhichStairK[1], fourFootOnWhichStairK[0]);
-        printf("[down] fourFootOnWhichStairK = %d, %d, %d, %d\n", fourFootOnWhichStairK[0],fourFootOnWhichStairK[1],fourFootOnWhichStairK[2],fourFootOnWhichStairK[3]);
+        QR_LOG_DEBUG("[down] fourFootOnWhichStairK = %d, %d, %d, %d\n", fourFootOnWhichStairK[0],fourFootOnWhichStairK[1],fourFootOnWhichStairK[2],fourFootOnWhichStairK[3]);
         for (int legId : legIds) {
             Vec3<float> nextFootPos = nextFootholds.col(legId) + constOffset;
             int footOnWhichStairK = fourFootOnWhichStairK[legId];
@@ -277,7 +279,7 @@ std::tuple<Eigen::Matrix<float,3,4>, Eigen::Matrix<float,3,4>> qrFootStepper ::G
                 nextFootholds.col(legId) = nextFootPos;
                 continue;
             }
-            printf("foot stepper leg [%d]: tmp = %f\n", legId, tmp);
+            QR_LOG_DEBUG("foot stepper leg [%d]: tmp = %f", legId, tmp);
             if (nextFootPos[0] > stairDown.startPoint[0] - 0.1 + tmp && nextFootPos[0] < stairDown.startPoint[0] - 0.05 + tmp) {
                 nextFootPos[0] = stairDown.startPoint[0] - 0.09 + tmp;
             } else if (nextFootPos[0] >= stairDown.startPoint[0] - 0.05 + tmp && nextFootPos[0] < stairDown.startPoint[0] + 0.02 + tmp) {
@@ -336,7 +338,8 @@ Eigen::Matrix<float, 3, 4> qrFootStepper ::GetOptimalFootholdsOffset(Eigen::Matr
         while (currentFootholdsX.row(0)[3] < lastGap.distance + lastGap.width / 2.0 ) {        
             int flag = StepGenerator(currentFootholdsX, desiredFootholdsOffset);
             if (flag == -2) {
-                std::cout << "[ERROR]: no valid solution." << std::endl;
+                QR_LOG_ERROR("no valid solution.");
+                qrLog::Instance().Flush();
                 exit(-1);                    
             }
             if (flag == -1) {
@@ -0,0 +1,166 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "planner/qr_foothold_optimizer.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "common/qr_simd.h"
+
+void qrFootholdOptimizerParameters::Load(const YAML::Node &node)
+{
+    if (!node) {
+        return;
+    }
+    if (node["search_radius"]) searchRadius = node["search_radius"].as<int>();
+    if (node["step_weight"]) stepWeight = node["step_weight"].as<float>();
+    if (node["slope_weight"]) slopeWeight = node["slope_weight"].as<float>();
+    if (node["edge_weight"]) edgeWeight = node["edge_weight"].as<float>();
+    if (node["reach_weight"]) reachWeight = node["reach_weight"].as<float>();
+    if (node["max_edge"]) maxEdge = node["max_edge"].as<float>();
+    if (node["max_slope"]) maxSlope = node["max_slope"].as<float>();
+    if (node["min_leg_length"]) minLegLength = node["min_leg_length"].as<float>();
+    if (node["max_leg_length"]) maxLegLength = node["max_leg_length"].as<float>();
+}
+
+qrFootholdOptimizer::qrFootholdOptimizer(const qrFootholdOptimizerParameters &parametersIn)
+    : parameters(parametersIn)
+{
+}
+
+bool qrFootholdOptimizer::Optimize(const qrElevationMapSnapshot &map,
+                                   const Vec3<float> &nominal,
+                                   const Vec3<float> &hip,
+                                   float nominalLegLength,
+                                   Vec3<float> &foothold) const
+{
+    // the candidates keep two cells to the map border for the edge test
+    const int margin = 2;
+    const int size = map.size;
+    const float resolution = map.resolution;
+    const int centerX = int(std::floor((nominal[0] - map.origin[0]) / resolution));
+    const int centerY = int(std::floor((nominal[1] - map.origin[1]) / resolution));
+    const int firstX = std::max(centerX - parameters.searchRadius, margin);
+    const int lastX = std::min(centerX + parameters.searchRadius, size - 1 - margin);
+    const int firstY = std::max(centerY - parameters.searchRadius, margin);
+    const int lastY = std::min(centerY + parameters.searchRadius, size - 1 - margin);
+    if (firstX > lastX || lastY - firstY < 3) {
+        return false;
+    }
+
+    const qrFloat4 infinity(std::numeric_limits<float>::infinity());
+    const qrFloat4 laneOffset(0.5f, 1.5f, 2.5f, 3.5f);
+    const qrFloat4 cellSize(resolution);
+    const qrFloat4 inverseTwoCells(0.5f / resolution);
+    const qrFloat4 maxEdge(parameters.maxEdge);
+    const qrFloat4 maxSlopeSquared(parameters.maxSlope * parameters.maxSlope);
+    const qrFloat4 minLegLengthSquared(parameters.minLegLength * parameters.minLegLength);
+    const qrFloat4 maxLegLengthSquared(parameters.maxLegLength * parameters.maxLegLength);
+    const qrFloat4 legLength(nominalLegLength);
+    const qrFloat4 stepWeight(parameters.stepWeight);
+    const qrFloat4 slopeWeight(parameters.slopeWeight);
+    const qrFloat4 edgeWeight(parameters.edgeWeight);
+    const qrFloat4 reachWeight(parameters.reachWeight);
+    const qrFloat4 originY(map.origin[1]);
+    const qrFloat4 nominalY(nominal[1]);
+    const qrFloat4 hipY(hip[1]);
+    const qrFloat4 hipZ(hip[2]);
+
+    float bestCost = std::numeric_limits<float>::infinity();
+    int bestX = -1;
+    int bestY = -1;
+    alignas(16) float costs[4];
+    for (int ix = firstX; ix <= lastX; ++ix) {
+        const float *rows[5];
+        for (int k = 0; k < 5; ++k) {
+            rows[k] = map.height.data() + (ix + k - 2) * size;
+        }
+        const float x = map.origin[0] + (ix + 0.5f) * resolution;
+        const qrFloat4 toNominalX(x - nominal[0]);
+        const qrFloat4 toHipX(x - hip[0]);
+        for (int iy = firstY; iy <= lastY; iy += 4) {
+            // the last group is moved back to end at lastY, the overlap is scored twice
+            const int start = std::min(iy, lastY - 3);
+            const qrFloat4 h = qrFloat4::Load(rows[2] + start);
+
+            // a neighbour that is unknown or too high or too low makes the cell infeasible,
+            // the largest jump also counts for the two cell ring, where unknown cells are skipped
+            qrFloat4 feasible = qrFloat4(0.f) < infinity;
+            qrFloat4 edge(0.f);
+            for (int k = 1; k < 4; ++k) {
+                for (int offset = -1; offset <= 1; ++offset) {
+                    if (k == 2 && offset == 0) {
+                        continue;
+                    }
+                    const qrFloat4 jump = simd::abs(qrFloat4::Load(rows[k] + start + offset) - h);
+                    feasible = feasible & (jump < maxEdge);
+                    edge = simd::select(jump > edge, jump, edge);
+                }
+            }
+            for (int k = 0; k < 5; ++k) {
+                for (int offset = -2; offset <= 2; ++offset) {
+                    if (k != 0 && k != 4 && offset != -2 && offset != 2) {
+                        continue;
+                    }
+                    const qrFloat4 jump = simd::abs(qrFloat4::Load(rows[k] + start + offset) - h);
+                    edge = simd::select(jump > edge, jump, edge);
+                }
+            }
+
+            const qrFloat4 gradientX = (qrFloat4::Load(rows[3] + start) - qrFloat4::Load(rows[1] + start)) * inverseTwoCells;
+            const qrFloat4 gradientY = (qrFloat4::Load(rows[2] + start + 1) - qrFloat4::Load(rows[2] + start - 1)) * inverseTwoCells;
+            const qrFloat4 slopeSquared = gradientX * gradientX + gradientY * gradientY;
+            feasible = feasible & (slopeSquared < maxSlopeSquared);
+
+            const qrFloat4 y = originY + (qrFloat4(float(start)) + laneOffset) * cellSize;
+            const qrFloat4 toNominalY = y - nominalY;
+            const qrFloat4 toHipY = y - hipY;
+            const qrFloat4 toHipZ = h - hipZ;
+            const qrFloat4 reachSquared = toHipX * toHipX + toHipY * toHipY + toHipZ * toHipZ;
+            feasible = feasible & (minLegLengthSquared < reachSquared) & (reachSquared < maxLegLengthSquared);
+            const qrFloat4 reachError = simd::sqrt(reachSquared) - legLength;
+
+            const qrFloat4 cost = stepWeight * (toNominalX * toNominalX + toNominalY * toNominalY)
+                                  + slopeWeight * slopeSquared
+                                  + edgeWeight * edge
+                                  + reachWeight * reachError * reachError;
+            simd::select(feasible, cost, infinity).Store(costs);
+            for (int lane = 0; lane < 4; ++lane) {
+                if (costs[lane] < bestCost) {
+                    bestCost = costs[lane];
+                    bestX = ix;
+                    bestY = start + lane;
+                }
+            }
+        }
+    }
+    if (bestX < 0) {
+        return false;
+    }
+    foothold << map.origin[0] + (bestX + 0.5f) * resolution,
+                map.origin[1] + (bestY + 0.5f) * resolution,
+                map.height[bestX * size + bestY];
+    return true;
+}
@@ -30,6 +30,8 @@ qrFootholdPlanner::qrFootholdPlanner(qrRobot *robotIn, qrGroundSurfaceEstimator
     timeSinceReset(0.f)
 {
     footstepper = new qrFootStepper(terrain, 0.10f, "optimal");
+    footholdOptimizer.parameters.maxLegLength = 0.9f * (robot->config->upperLegLength + robot->config->lowerLegLength);
+    footholdOptimizer.parameters.Load(groundEsitmator->footStepperConfig["foothold_optimizer"]);
     Reset();
 }
 
@@ -50,14 +52,12 @@ void qrFootholdPlanner::UpdateOnce(Eigen::Matrix<float, 3, 4> currentFootholds,
     desiredFootholds = currentFootholds;
     if (legIds.empty()) { // if is empty, update all legs.
         legIds = {0,1,2,3};
-    } else {
-        std::cout<<"update foothold of Legs : ";
-        for(int legId : legIds) {
-            std::cout << legId << " ";
-        }
-        std::cout << "\n";
     }
-    
+    if (ComputeOptimizedFootholds(currentFootholds, legIds)) {
+        return;
+    }
+    // nothing is mapped around the legs yet, e.g. no depth camera, follow the scripted terrain
+    desiredFootholds = currentFootholds;
     if (terrain.terrainType != TerrainType::STAIRS) { 
         ComputeFootholdsOffset(currentFootholds, comPose, desiredComPose, legIds);
     } else {
@@ -65,6 +65,34 @@ void qrFootholdPlanner::UpdateOnce(Eigen::Matrix<float, 3, 4> currentFootholds,
     }
 }
 
+bool qrFootholdPlanner::ComputeOptimizedFootholds(const Eigen::Matrix<float, 3, 4>& currentFootholds,
+                                                  const std::vector<int>& legIds)
+{
+    bool found = false;
+    desiredFootholdsOffset.setZero();
+    for (int legId : legIds) {
+        const Vec3<float> nominal = currentFootholds.col(legId) + footstepper->GetDefaultFootholdOffset(legId);
+        // the base covers about half of the step while the leg swings
+        const Vec3<float> baseDisplacement = 0.5f * (nominal - currentFootholds.col(legId));
+        Vec3<float> foothold;
+        found = OptimizeFoothold(legId, nominal, baseDisplacement, foothold) || found;
+        desiredFootholds.col(legId) = foothold;
+        desiredFootholdsOffset.col(legId) = foothold - currentFootholds.col(legId);
+    }
+    return found;
+}
+
+bool qrFootholdPlanner::OptimizeFoothold(int legId, const Vec3<float>& nominal, const Vec3<float>& baseDisplacement,
+                                         Vec3<float>& foothold)
+{
+    const qrElevationMapSnapshot& map = groundEsitmator->elevationMap.GetSnapshot();
+    Vec3<float> hip = robot->state.GetBaseRotationMatrix() * robot->config->defaultHipPosition.col(legId)
+                      + robot->GetBasePosition();
+    hip.head<2>() += baseDisplacement.head<2>();
+    foothold = nominal;
+    return footholdOptimizer.Optimize(map, nominal, hip, robot->config->bodyHeight, foothold);
+}
+
 Eigen::Matrix<float, 3, 4> qrFootholdPlanner::ComputeFootholdsOffset(Eigen::Matrix<float, 3, 4> currentFootholds,
                                                                 Eigen::Matrix<float, 6, 1> currentComPose,
                                                                 Eigen::Matrix<float, 6, 1> desiredComPose,
@@ -84,4 +112,4 @@ Eigen::Matrix<float, 3, 4> qrFootholdPlanner::ComputeNextFootholds(Eigen::Matrix
     desiredFootholds = std::get<0>(res);
     desiredFootholdsOffset = std::get<1>(res);
     return desiredFootholdsOffset;
-}
\ No newline at end of file
+}
\ No newline at end of file
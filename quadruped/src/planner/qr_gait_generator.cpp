@@ -23,11 +23,90 @@
 // SOFTWARE.
 
 #include "planner/qr_gait_generator.h"
+#include "common/qr_log.h"
 
 using namespace Eigen;
 using namespace std;
 
-qrGaitGenerator::qrGaitGenerator() {}
+void qrGaitParams::Load(const YAML::Node &node)
+{
+    const YAML::Node gaitNode = node["gait_params"];
+    gait = gaitNode["gait"].as<string>();
+    for (YAML::const_iterator it = gaitNode.begin(); it != gaitNode.end(); ++it) {
+        if (!it->second.IsMap()) {
+            continue;
+        }
+        const YAML::Node &paramNode = it->second;
+        qrGaitParam param;
+        vector<float> list = paramNode["stance_duration"].as<vector<float>>();
+        vector<int> stateList = paramNode["initial_leg_state"].as<vector<int>>();
+        if (list.size() != 4 || stateList.size() != 4) {
+            throw std::runtime_error(it->first.as<string>() + ": every leg needs a value");
+        }
+        param.stanceDuration = Eigen::Matrix<float, 4, 1>::Map(list.data());
+        param.initialLegState = Eigen::Matrix<int, 4, 1>::Map(stateList.data());
+        list = paramNode["duty_factor"].as<vector<float>>();
+        if (list.size() != 4) {
+            throw std::runtime_error(it->first.as<string>() + ": every leg needs a duty_factor");
+        }
+        param.dutyFactor = Eigen::Matrix<float, 4, 1>::Map(list.data());
+        list = paramNode["init_phase_full_cycle"].as<vector<float>>();
+        if (list.size() != 4) {
+            throw std::runtime_error(it->first.as<string>() + ": every leg needs an init_phase_full_cycle");
+        }
+        param.initialLegPhase = Eigen::Matrix<float, 4, 1>::Map(list.data());
+        param.contactDetectionPhaseThreshold = paramNode["contact_detection_phase_threshold"].as<float>();
+        gaits[it->first.as<string>()] = param;
+    }
+}
+
+void qrGaitParams::Validate() const
+{
+    if (gaits.find(gait) == gaits.end()) {
+        throw std::runtime_error("the gait " + gait + " is not defined");
+    }
+    for (const auto &entry : gaits) {
+        const qrGaitParam &param = entry.second;
+        for (int legId = 0; legId < 4; ++legId) {
+            if (param.dutyFactor[legId] < 0.f || param.dutyFactor[legId] > 1.f) {
+                throw std::runtime_error(entry.first + ": duty_factor must be in [0, 1]");
+            }
+            if (param.stanceDuration[legId] < 0.f
+                || (param.stanceDuration[legId] == 0.f && param.dutyFactor[legId] > 0.001f)) {
+                throw std::runtime_error(entry.first + ": stance_duration must be positive");
+            }
+            if (param.initialLegPhase[legId] < 0.f || param.initialLegPhase[legId] > 1.f) {
+                throw std::runtime_error(entry.first + ": init_phase_full_cycle must be in [0, 1]");
+            }
+            if (param.initialLegState[legId] != LegState::SWING && param.initialLegState[legId] != LegState::STANCE) {
+                throw std::runtime_error(entry.first + ": initial_leg_state must be 0 or 1");
+            }
+        }
+        if (param.contactDetectionPhaseThreshold < 0.f || param.contactDetectionPhaseThreshold > 1.f) {
+            throw std::runtime_error(entry.first + ": contact_detection_phase_threshold must be in [0, 1]");
+        }
+    }
+}
+
+namespace {
+
+/**
+ * @brief Whether two compilations of a gait have the same timing.
+ */
+bool SameGait(const qrGaitDescriptor &a, const qrGaitDescriptor &b)
+{
+    return a.stanceDuration == b.stanceDuration && a.dutyFactor == b.dutyFactor
+           && a.initialLegState == b.initialLegState && a.initialLegPhase == b.initialLegPhase
+           && a.contactDetectionPhaseThreshold == b.contactDetectionPhaseThreshold;
+}
+
+} // namespace
+
+qrGaitGenerator::qrGaitGenerator()
+{
+    curGaitType.reserve(qrGaitDescriptor::nameLength);
+    nextGaitType.reserve(qrGaitDescriptor::nameLength);
+}
 
 qrGaitGenerator::qrGaitGenerator(qrRobot *robot,
                                 Eigen::Matrix<float, 4, 1> stanceDuration,
@@ -35,87 +114,184 @@ qrGaitGenerator::qrGaitGenerator(qrRobot *robot,
                                 Eigen::Matrix<int, 4, 1> initialLegState,
                                 Eigen::Matrix<float, 4, 1> initialLegPhase,
                                 float contactDetectionPhaseThreshold)
+    : qrGaitGenerator()
 {
     this->robot = robot;
-    this->stanceDuration = stanceDuration;
-    this->dutyFactor = dutyFactor;
-    this->initialLegState = initialLegState;
-    this->initialLegPhase = initialLegPhase;
-    this->contactDetectionPhaseThreshold = contactDetectionPhaseThreshold;
-    this->swingDuration = stanceDuration.cwiseQuotient(dutyFactor) - stanceDuration;
-
-    for (int legId = 0; legId < initialLegState.size(); legId++) {
-        if (initialLegState[legId] == LegState::SWING) {
-            initStateRadioInCycle[legId] = 1 - dutyFactor[legId];
-            nextLegState[legId] = LegState::STANCE;
-        } else {
-            initStateRadioInCycle[legId] = dutyFactor[legId];
-            nextLegState[legId] = LegState::SWING;
-        }
+    qrGaitDescriptor gait;
+    if (!gait.Compile("custom", stanceDuration, dutyFactor, initialLegState, initialLegPhase,
+                      contactDetectionPhaseThreshold)) {
+        throw std::runtime_error("qrGaitGenerator: stance durations must be positive");
     }
-
+    gaitLibrary.Set(gait);
+    this->CreateGait("custom");
     this->Reset(0);
 }
 
 qrGaitGenerator::qrGaitGenerator(qrRobot *robot, string configFilePath)
+    : qrGaitGenerator()
 {
 
     this->configFilePath = configFilePath;
-    config = YAML::LoadFile(configFilePath);
+    config = std::make_shared<qrConfig<qrGaitParams>>(configFilePath);
 
     this->robot = robot;
-    string gait = config["gait_params"]["gait"].as<string>();
+    configVersion = config->GetVersion();
+    LoadGaits(config->Get());
+    string gait = config->Get().gait;
     cout << "qrGaitGenerator Set gait: " << gait << endl;
     this->CreateGait(gait);
     Reset(0);
 }
+
+void qrGaitGenerator::LoadGaits(const qrGaitParams &params)
+{
+    qrGaitDescriptor gait;
+    for (const auto &entry : params.gaits) {
+        const qrGaitParam &param = entry.second;
+        if (!gait.Compile(entry.first, param.stanceDuration, param.dutyFactor, param.initialLegState,
+                          param.initialLegPhase, param.contactDetectionPhaseThreshold)) {
+            QR_LOG_WARN("qrGaitGenerator: cannot compile gait %s", entry.first.c_str());
+            continue;
+        }
+        const int index = gaitLibrary.Set(gait);
+        if (index < 0) {
+            QR_LOG_WARN("qrGaitGenerator: no room for gait %s", entry.first.c_str());
+        } else if (index == gaitIndex && !SameGait(gait, activeGait)) {
+            activeGaitOutdated = true;
+            RequestGait(index);
+        }
+    }
+}
+
 void qrGaitGenerator::CreateGait(string gaitType)
 {
+    const int index = gaitLibrary.Find(gaitType);
+    if (index < 0) {
+        cout << "qrGaitGenerator: unknown gait " << gaitType << ", keep " << curGaitType << endl;
+        this->nextGaitType = this->curGaitType;
+        return;
+    }
 
-    this->curGaitType = gaitType;
-    vector<float> stanceDurationList = config["gait_params"][gaitType]["stance_duration"].as<vector<float >>();
-    stanceDuration = Eigen::MatrixXf::Map(&stanceDurationList[0], 4, 1);
-    vector<float> dutyFactorList = config["gait_params"][gaitType]["duty_factor"].as<vector<float >>();
-    dutyFactor = Eigen::MatrixXf::Map(&dutyFactorList[0], 4, 1);
-    vector<int> initialLegStateList = config["gait_params"][gaitType]["initial_leg_state"].as<vector<int >>();
-    initialLegState = Eigen::MatrixXi::Map(&initialLegStateList[0], 4, 1);
-    vector<float> initialLegPhaseList = config["gait_params"][gaitType]["init_phase_full_cycle"].as<vector<float >>();
-    initialLegPhase = Eigen::MatrixXf::Map(&initialLegPhaseList[0], 4, 1);
-    contactDetectionPhaseThreshold = config["gait_params"][gaitType]["contact_detection_phase_threshold"].as<float>();
+    ApplyGait(index, 0.f);
+    lastLegState = initialLegState;
+    for (int legId = 0; legId < initialLegState.size(); legId++) {
+        if (initialLegState[legId] == LegState::USERDEFINED_SWING) {
+            printf("Leg [%i] is userdefined leg!\n", legId);
+        }
+    }
+}
 
+void qrGaitGenerator::ApplyGait(int index, float timeShift)
+{
+    activeGait = gaitLibrary.Get(index);
+    gaitIndex = index;
+    gaitTimeShift = timeShift;
+    activeGaitOutdated = false;
+
+    stanceDuration = activeGait.stanceDuration;
+    swingDuration = activeGait.swingDuration;
+    dutyFactor = activeGait.dutyFactor;
+    initialLegPhase = activeGait.initialLegPhase;
+    fullCyclePeriod = activeGait.fullCyclePeriod;
+    initStateRadioInCycle = activeGait.initStateRadioInCycle;
+    initialLegState = activeGait.initialLegState;
+    nextLegState = activeGait.nextLegState;
+    contactDetectionPhaseThreshold = activeGait.contactDetectionPhaseThreshold;
     for (int legId = 0; legId < initialLegState.size(); legId++) {
-        // when dutyFactor is about 0, the leg seems like keeping swinging
-        // user can use this to make special swing trajectories
-        if (math::almostEqual(dutyFactor[legId],0.f, 0.001f)) {
-            swingDuration[legId] = 1e3;
-            initialLegState[legId] = LegState::USERDEFINED_SWING;
-            curLegState[legId] =  LegState::USERDEFINED_SWING;
+        if (initialLegState[legId] == LegState::USERDEFINED_SWING) {
+            curLegState[legId] = LegState::USERDEFINED_SWING;
             lastLegState[legId] = LegState::USERDEFINED_SWING;
-            nextLegState[legId] = LegState::USERDEFINED_SWING;
-            printf("Leg [%i] is userdefined leg!\n", legId);
-        } else {
-            // assume the block means one period, '\' means stance, '_' means swing,then if duty factor is 0.7:
-            // when the leg starts with stance,its period is |\\\\\\\___|
-            // otherwise, it will look like |___\\\\\\\|
-            swingDuration[legId] = stanceDuration[legId]/dutyFactor[legId] - stanceDuration[legId];
-            lastLegState = initialLegState;
-            if (initialLegState[legId] == LegState::SWING) {
-                initStateRadioInCycle[legId] = 1 - dutyFactor[legId];
-                nextLegState[legId] = LegState::STANCE;
-            } else {
-                initStateRadioInCycle[legId] = dutyFactor[legId];
-                nextLegState[legId] = LegState::SWING;
-            }
         }
     }
-    this->nextGaitType = this->curGaitType;
+    // both strings reserved nameLength characters, so this does not allocate
+    this->curGaitType.assign(activeGait.name);
+    this->nextGaitType.assign(activeGait.name);
+}
+
+void qrGaitGenerator::RequestGait(int index)
+{
+    requestedGait.store(index, std::memory_order_release);
+}
+
+void qrGaitGenerator::PostGait(const qrGaitDescriptor &gait, bool switchTo)
+{
+    std::lock_guard<std::mutex> lock(postMutex);
+    postedGait = gait;
+    switchToPostedGait = switchTo;
+    hasPostedGait.store(true, std::memory_order_release);
+}
+
+void qrGaitGenerator::TakeGaits()
+{
+    if (config && config->GetVersion() != configVersion) {
+        configVersion = config->GetVersion();
+        LoadGaits(config->Get());
+    }
+    if (!hasPostedGait.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(postMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return;
+    }
+    hasPostedGait.store(false, std::memory_order_relaxed);
+    const int index = gaitLibrary.Set(postedGait);
+    if (index < 0) {
+        return;
+    }
+    if (index == gaitIndex && !SameGait(postedGait, activeGait)) {
+        activeGaitOutdated = true;
+        RequestGait(index);
+    } else if (switchToPostedGait) {
+        RequestGait(index);
+    }
 }
 
 void qrGaitGenerator::ModifyGait() {
-    if (this->nextGaitType != this->curGaitType) {
-        this->curGaitType = this->nextGaitType;
-        this->CreateGait(this->curGaitType);
+    if (this->nextGaitType == this->curGaitType) {
+        return;
+    }
+    const int index = gaitLibrary.Find(this->nextGaitType);
+    if (index < 0) {
+        QR_LOG_WARN("qrGaitGenerator: unknown gait %s, keep %s", nextGaitType.c_str(), curGaitType.c_str());
+    } else {
+        RequestGait(index);
     }
+    this->nextGaitType.assign(this->curGaitType);
+}
+
+void qrGaitGenerator::Transition(float currentTime)
+{
+    int target = requestedGait.load(std::memory_order_acquire);
+    if (target < 0 || target >= gaitLibrary.Size()) {
+        return;
+    }
+    if (target == gaitIndex && !activeGaitOutdated) {
+        requestedGait.compare_exchange_strong(target, -1);
+        transitionTarget = -1;
+        return;
+    }
+    if (target != transitionTarget) {
+        transitionTarget = target;
+        transitionStart = currentTime;
+    }
+
+    Eigen::Matrix<int, 4, 1> runningState;
+    Eigen::Matrix<float, 4, 1> runningPhase;
+    float phase;
+    for (int legId = 0; legId < 4; legId++) {
+        runningState[legId] = activeGait.Evaluate(legId, currentTime + gaitTimeShift, phase, runningPhase[legId]);
+    }
+    // do not wait longer than two cycles of the running gait for an instant that fits
+    const bool force = currentTime - transitionStart > 2.f * activeGait.referencePeriod;
+    const qrGaitDescriptor &gait = gaitLibrary.Get(target);
+    const int sample = gait.FindSwitchSample(runningState, runningPhase, switchTolerance, force);
+    if (sample < 0) {
+        return;
+    }
+    requestedGait.compare_exchange_strong(target, -1);
+    transitionTarget = -1;
+    ApplyGait(target, sample * gait.referencePeriod / qrGaitDescriptor::phaseSamples - currentTime);
 }
 
 void qrGaitGenerator::Reset(float currentTime)
@@ -129,9 +305,11 @@ void qrGaitGenerator::Reset(float currentTime)
 
 void qrGaitGenerator::Update(float currentTime)
 {
+    this->TakeGaits();
     this->ModifyGait();
+    this->Transition(currentTime);
     Eigen::Matrix<bool, 4, 1> contactState = robot->GetFootContacts();
-    float fullCyclePeriod, augmentedTime, ratio;
+    const float gaitTime = currentTime + gaitTimeShift;
 
     for (int legId = 0; legId < initialLegState.size(); legId++) {
         if (initialLegState[legId] == LegState::USERDEFINED_SWING) {
@@ -146,19 +324,7 @@ void qrGaitGenerator::Update(float currentTime)
             curLegState[legId] = desiredLegState[legId];
         }
         
-        fullCyclePeriod = stanceDuration[legId] / dutyFactor[legId];
-        augmentedTime = initialLegPhase[legId] * fullCyclePeriod + currentTime;
-        phaseInFullCycle[legId] = fmod(augmentedTime, fullCyclePeriod) / fullCyclePeriod;
-        
-        ratio = initStateRadioInCycle[legId];
-        if (phaseInFullCycle[legId] < ratio) {
-            desiredLegState[legId] = initialLegState[legId];
-            normalizedPhase[legId] = phaseInFullCycle[legId] / ratio;
-            
-        } else {
-            desiredLegState[legId] = nextLegState[legId];
-            normalizedPhase(legId) = (phaseInFullCycle[legId] - ratio) / (1 - ratio);
-        }
+        desiredLegState[legId] = activeGait.Evaluate(legId, gaitTime, phaseInFullCycle[legId], normalizedPhase[legId]);
         
         legState[legId] = desiredLegState[legId];
 
@@ -0,0 +1,183 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "planner/qr_gait_library.h"
+
+namespace {
+
+/**
+ * @brief How far a leg jumps within its stance or swing when it goes over from one gait to another.
+ */
+float PhaseJump(int fromState, float fromPhase, int toState, float toPhase)
+{
+    if (fromState == LegState::USERDEFINED_SWING) {
+        return 0.f;
+    }
+    if (toState == LegState::USERDEFINED_SWING) {
+        return fromState == LegState::STANCE ? 0.f : 1.f - fromPhase;
+    }
+    if (fromState == LegState::STANCE) {
+        return toState == LegState::STANCE ? 0.f : toPhase;
+    }
+    return toState == LegState::SWING ? std::fabs(fromPhase - toPhase) : 1.f - fromPhase;
+}
+
+} // namespace
+
+bool qrGaitDescriptor::Compile(const std::string &gaitName,
+                               const Vec4<float> &stanceDurationIn,
+                               const Vec4<float> &dutyFactorIn,
+                               const Vec4<int> &initialLegStateIn,
+                               const Vec4<float> &initialLegPhaseIn,
+                               float contactDetectionPhaseThresholdIn)
+{
+    if (gaitName.size() >= nameLength) {
+        return false;
+    }
+    std::memset(name, 0, nameLength);
+    std::memcpy(name, gaitName.c_str(), gaitName.size());
+    stanceDuration = stanceDurationIn;
+    dutyFactor = dutyFactorIn;
+    initialLegState = initialLegStateIn;
+    initialLegPhase = initialLegPhaseIn;
+    contactDetectionPhaseThreshold = contactDetectionPhaseThresholdIn;
+    referencePeriod = 0.f;
+
+    for (int legId = 0; legId < 4; ++legId) {
+        if (dutyFactor[legId] < 0.f || dutyFactor[legId] > 1.f
+            || (initialLegState[legId] != LegState::SWING && initialLegState[legId] != LegState::STANCE)) {
+            return false;
+        }
+        // when dutyFactor is about 0, the leg seems like keeping swinging
+        // user can use this to make special swing trajectories
+        if (std::fabs(dutyFactor[legId]) < 0.001f) {
+            swingDuration[legId] = 1e3;
+            fullCyclePeriod[legId] = stanceDuration[legId] + swingDuration[legId];
+            initStateRadioInCycle[legId] = 0.f;
+            initialLegState[legId] = LegState::USERDEFINED_SWING;
+            nextLegState[legId] = LegState::USERDEFINED_SWING;
+            continue;
+        }
+        if (stanceDuration[legId] <= 0.f) {
+            return false;
+        }
+        // assume the block means one period, '\' means stance, '_' means swing,then if duty factor is 0.7:
+        // when the leg starts with stance,its period is |\\\\\\\___|
+        // otherwise, it will look like |___\\\\\\\|
+        fullCyclePeriod[legId] = stanceDuration[legId] / dutyFactor[legId];
+        swingDuration[legId] = fullCyclePeriod[legId] - stanceDuration[legId];
+        referencePeriod = std::max(referencePeriod, fullCyclePeriod[legId]);
+        if (initialLegState[legId] == LegState::SWING) {
+            initStateRadioInCycle[legId] = 1 - dutyFactor[legId];
+            nextLegState[legId] = LegState::STANCE;
+        } else {
+            initStateRadioInCycle[legId] = dutyFactor[legId];
+            nextLegState[legId] = LegState::SWING;
+        }
+    }
+    if (referencePeriod <= 0.f) {
+        referencePeriod = 1.f;
+    }
+
+    float phaseInFullCycle;
+    for (int k = 0; k < phaseSamples; ++k) {
+        const float gaitTime = k * referencePeriod / phaseSamples;
+        for (int legId = 0; legId < 4; ++legId) {
+            sampleState[k][legId] = Evaluate(legId, gaitTime, phaseInFullCycle, samplePhase[k][legId]);
+        }
+    }
+    return true;
+}
+
+int qrGaitDescriptor::Evaluate(int legId, float gaitTime, float &phaseInFullCycle, float &normalizedPhase) const
+{
+    if (initialLegState[legId] == LegState::USERDEFINED_SWING) {
+        phaseInFullCycle = 0.f;
+        normalizedPhase = 0.f;
+        return LegState::USERDEFINED_SWING;
+    }
+    const float period = fullCyclePeriod[legId];
+    float phase = std::fmod(initialLegPhase[legId] * period + gaitTime, period);
+    if (phase < 0.f) {
+        phase += period;
+    }
+    phaseInFullCycle = phase / period;
+
+    const float ratio = initStateRadioInCycle[legId];
+    if (phaseInFullCycle < ratio) {
+        normalizedPhase = phaseInFullCycle / ratio;
+        return initialLegState[legId];
+    }
+    normalizedPhase = (phaseInFullCycle - ratio) / (1.f - ratio);
+    return nextLegState[legId];
+}
+
+int qrGaitDescriptor::FindSwitchSample(const Vec4<int> &legState, const Vec4<float> &normalizedPhase,
+                                       float tolerance, bool force) const
+{
+    int best = -1;
+    float bestJump = 2.f;
+    for (int k = 0; k < phaseSamples; ++k) {
+        float jump = 0.f;
+        for (int legId = 0; legId < 4; ++legId) {
+            jump = std::max(jump, PhaseJump(legState[legId], normalizedPhase[legId],
+                                            sampleState[k][legId], samplePhase[k][legId]));
+        }
+        if (jump < bestJump) {
+            bestJump = jump;
+            best = k;
+        }
+    }
+    if (bestJump > tolerance && !force) {
+        return -1;
+    }
+    return best;
+}
+
+int qrGaitLibrary::Set(const qrGaitDescriptor &gait)
+{
+    int index = 0;
+    while (index < count && std::strcmp(gaits[index].name, gait.name) != 0) {
+        ++index;
+    }
+    if (index == capacity) {
+        return -1;
+    }
+    gaits[index] = gait;
+    count = std::max(count, index + 1);
+    return index;
+}
+
+int qrGaitLibrary::Find(const std::string &name) const
+{
+    for (int index = 0; index < count; ++index) {
+        if (std::strcmp(gaits[index].name, name.c_str()) == 0) {
+            return index;
+        }
+    }
+    return -1;
+}
@@ -23,6 +23,8 @@
 // SOFTWARE.
 
 #include "robots/qr_robot_config.h"
+#include <limits>
+#include "common/qr_simd.h"
 
 std::unordered_map<int, std::string> modeMap = {{0, "velocity"}, {1, "position"}, {2, "walk"}, {3, "advanced_trot"}};
 
@@ -66,6 +68,8 @@ void qrRobotConfig::Load(std::string path, LocomotionMode mode)
     LoadHipPosition();
     LoadKps();
     LoadKds();
+    LoadSensorFilter();
+    LoadLatencyCompensation();
 }
 
 void qrRobotConfig::LoadKps()
@@ -88,6 +92,30 @@ void qrRobotConfig::LoadKds()
     motorKds << kds, kds, kds, kds;
 }
 
+void qrRobotConfig::LoadSensorFilter()
+{
+    // optional, the sensors are not filtered without it
+    const YAML::Node filterNode = node["sensor_filter"];
+    if (!filterNode) {
+        return;
+    }
+    jointVelocityCutoff = filterNode["joint_velocity_cutoff"].as<float>();
+    imuCutoff = filterNode["imu_cutoff"].as<float>();
+    footForceCutoff = filterNode["foot_force_cutoff"].as<float>();
+}
+
+void qrRobotConfig::LoadLatencyCompensation()
+{
+    // optional, the state is used as observed without it
+    const YAML::Node latencyNode = node["latency_compensation"];
+    if (!latencyNode) {
+        return;
+    }
+    latencyCompensation = latencyNode["enable"].as<bool>();
+    fixedLatency = latencyNode["latency"].as<float>();
+    maxLatency = latencyNode["max_latency"].as<float>();
+}
+
 void qrRobotConfig::LoadComOffset(LocomotionMode mode)
 {
     std::vector<float> comOffsetList = node["robot_params"][modeMap[mode]]["com_offset"].as<std::vector<float >>();
@@ -177,16 +205,60 @@ Eigen::Matrix<float, 3, 3> qrRobotConfig::AnalyticalLegJacobian(Eigen::Matrix<fl
     return J;
 }
 
-Eigen::Matrix<float, 3, 4> qrRobotConfig::FootPositionsInBaseFrame(Eigen::Matrix<float, 12, 1> footAngles)
+void qrRobotConfig::AnalyticalLegJacobians(const Eigen::Matrix<float, 12, 1> &motorAngles,
+                                           std::array<Eigen::Matrix<float, 3, 3>, 4> &jacobians)
 {
-    Eigen::Map<Eigen::MatrixXf> reshapedFootAngles(footAngles.data(), 3, 4);
-
-    Eigen::MatrixXf footPositions = Eigen::Matrix<float, 3, 4>::Zero();
-    for (int legId = 0; legId < qrRobotConfig::numLegs; legId++) {
-        Eigen::Matrix<float, 3, 1> singleFootAngles;
-        singleFootAngles << reshapedFootAngles.col(legId);
-        footPositions.col(legId) = FootPositionInHipFrame(singleFootAngles, pow((-1), legId + 1));
+    // the same expressions as AnalyticalLegJacobian, lane i is leg i
+    const qrFloat4 signedHipLength = qrFloat4(-hipLength, hipLength, -hipLength, hipLength);
+    const qrFloat4 upper(upperLegLength), lower(lowerLegLength);
+    const qrFloat4 t0 = qrFloat4::Gather(motorAngles.data(), 3);
+    const qrFloat4 t1 = qrFloat4::Gather(motorAngles.data() + 1, 3);
+    const qrFloat4 t2 = qrFloat4::Gather(motorAngles.data() + 2, 3);
+
+    qrFloat4 s0, c0, s2, c2, sEff, cEff;
+    simd::sinCos(t0, s0, c0);
+    simd::sinCos(t2, s2, c2);
+    const qrFloat4 lEff = simd::sqrt(upper * upper + lower * lower + qrFloat4(2.f) * upper * lower * c2);
+    simd::sinCos(t1 + qrFloat4(0.5f) * t2, sEff, cEff);
+    const qrFloat4 kneeTerm = lower * upper * s2 / lEff;
+    const qrFloat4 half(0.5f);
+
+    const qrFloat4 J[3][3] = {
+        {qrFloat4(0.f), -lEff * cEff, kneeTerm * sEff - lEff * cEff * half},
+        {-signedHipLength * s0 + lEff * c0 * cEff, -lEff * s0 * sEff, -kneeTerm * s0 * cEff - lEff * s0 * sEff * half},
+        {signedHipLength * c0 + lEff * s0 * cEff, lEff * sEff * c0, kneeTerm * c0 * cEff + lEff * sEff * c0 * half}};
+    alignas(16) float lanes[4];
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            J[row][col].Store(lanes);
+            for (int legId = 0; legId < qrRobotConfig::numLegs; ++legId) {
+                jacobians[legId](row, col) = lanes[legId];
+            }
+        }
     }
+}
+
+Eigen::Matrix<float, 3, 4> qrRobotConfig::FootPositionsInBaseFrame(const Eigen::Matrix<float, 12, 1> &footAngles)
+{
+    // the same expressions as FootPositionInHipFrame, lane i is leg i
+    const qrFloat4 signedHipLength = qrFloat4(-hipLength, hipLength, -hipLength, hipLength);
+    const qrFloat4 upper(upperLegLength), lower(lowerLegLength);
+    const qrFloat4 thetaAB = qrFloat4::Gather(footAngles.data(), 3);
+    const qrFloat4 thetaHip = qrFloat4::Gather(footAngles.data() + 1, 3);
+    const qrFloat4 thetaKnee = qrFloat4::Gather(footAngles.data() + 2, 3);
+
+    qrFloat4 sinAB, cosAB, sinKnee, cosKnee, sinSwing, cosSwing;
+    simd::sinCos(thetaAB, sinAB, cosAB);
+    simd::sinCos(thetaKnee, sinKnee, cosKnee);
+    const qrFloat4 legDistance = simd::sqrt(upper * upper + lower * lower + qrFloat4(2.f) * upper * lower * cosKnee);
+    simd::sinCos(thetaHip + qrFloat4(0.5f) * thetaKnee, sinSwing, cosSwing);
+    const qrFloat4 offXHip = -legDistance * sinSwing;
+    const qrFloat4 offZHip = -legDistance * cosSwing;
+
+    Eigen::Matrix<float, 3, 4> footPositions;
+    offXHip.Scatter(footPositions.data(), 3);
+    (cosAB * signedHipLength - sinAB * offZHip).Scatter(footPositions.data() + 1, 3);
+    (sinAB * signedHipLength + cosAB * offZHip).Scatter(footPositions.data() + 2, 3);
     return footPositions + hipOffset;
 }
 
@@ -205,6 +277,38 @@ void qrRobotConfig::ComputeMotorAnglesFromFootLocalPosition(int legId,
 
 }
 
+Eigen::Matrix<float, 12, 1> qrRobotConfig::ComputeMotorAnglesFromFootLocalPositions(const Eigen::Matrix<float, 3, 4> &footLocalPositions)
+{
+    // the same expressions as FootPositionInHipFrameToJointAngle, lane i is leg i
+    const Eigen::Matrix<float, 3, 4> footPositions = footLocalPositions - hipOffset;
+    const qrFloat4 signedHipLength = qrFloat4(-hipLength, hipLength, -hipLength, hipLength);
+    const qrFloat4 upper(upperLegLength), lower(lowerLegLength);
+    const qrFloat4 x = qrFloat4::Gather(footPositions.data(), 3);
+    const qrFloat4 y = qrFloat4::Gather(footPositions.data() + 1, 3);
+    const qrFloat4 z = qrFloat4::Gather(footPositions.data() + 2, 3);
+
+    // cos(thetaKnee), out of [-1, 1] if the foot is out of reach, then acos gives NaN
+    const qrFloat4 cosKnee = (x * x + y * y + z * z - signedHipLength * signedHipLength - upper * upper - lower * lower)
+        / (qrFloat4(2.f) * lower * upper);
+    const qrFloat4 thetaKnee = -simd::acos(cosKnee);
+    const qrFloat4 l = simd::sqrt(upper * upper + lower * lower + qrFloat4(2.f) * upper * lower * cosKnee);
+    const qrFloat4 thetaHip = simd::asin(-x / l) - qrFloat4(0.5f) * thetaKnee;
+    // l * cos(thetaHip + thetaKnee / 2) = l * cos(asin(-x / l))
+    const qrFloat4 lCosSq = l * l - x * x;
+    const qrFloat4 lCos = simd::sqrt(simd::select(lCosSq < qrFloat4(0.f), qrFloat4(0.f), lCosSq));
+    const qrFloat4 c1 = signedHipLength * y - lCos * z;
+    const qrFloat4 s1 = lCos * y + signedHipLength * z;
+    // thetaKnee and thetaHip are NaN if the foot is out of reach, so is thetaAB
+    const qrFloat4 thetaAB = simd::select(simd::abs(cosKnee) > qrFloat4(1.f),
+                                          qrFloat4(std::numeric_limits<float>::quiet_NaN()), simd::atan2(s1, c1));
+
+    Eigen::Matrix<float, 12, 1> jointAngles;
+    thetaAB.Scatter(jointAngles.data(), 3);
+    thetaHip.Scatter(jointAngles.data() + 1, 3);
+    thetaKnee.Scatter(jointAngles.data() + 2, 3);
+    return jointAngles;
+}
+
 Eigen::Matrix<float, 3, 1> qrRobotConfig::ComputeMotorVelocityFromFootLocalVelocity(int legId,
                                                 Eigen::Matrix<float, 3, 1> legAngles,
                                                 Eigen::Matrix<float, 3, 1> footLocalVelocity)
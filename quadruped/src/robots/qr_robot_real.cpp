@@ -34,6 +34,7 @@ qrRobotReal::qrRobotReal(std::string robotName, LocomotionMode mode):
     lastResetTime = GetTimeSinceReset();
 
     UpdateRobotState();
+    state.SetSensorFilter(1.f / timeStep);
     std::cout << "-------qrRobotReal init Complete-------" << std::endl;
 }
 
@@ -64,6 +64,7 @@ qrRobotSim::qrRobotSim(ros::NodeHandle &nhIn, std::string robotName, LocomotionM
     timeStep = 0.001;
     this->ResetTimer();
     lastResetTime = GetTimeSinceReset();
+    state.SetSensorFilter(1.f / timeStep);
 
     std::cout << "-------qrRobotSim init Complete-------" << std::endl;
 }
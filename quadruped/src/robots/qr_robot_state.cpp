@@ -33,6 +33,7 @@ qrRobotState::qrRobotState()
     baseRollPitchYaw << 0.f, 0.f, 0.f;
     baseRollPitchYawRate << 0.f, 0.f, 0.f;
     motorVelocities = Eigen::Matrix<float, 12, 1>::Zero();
+    baseAcceleration << 0.f, 0.f, 9.81f;
     footForce << 0.f, 0.f, 0.f, 0.f;
     footContact << 1, 1, 1, 1;
     baseVelocity << 0.0, 0.0, 0.0;
@@ -52,13 +53,19 @@ void qrRobotState::Update()
     baseRollPitchYaw << imu.rpy[0], imu.rpy[1], CalibrateYaw();
     baseOrientation = math::rpyToQuat(baseRollPitchYaw);
     baseRollPitchYawRate << imu.gyroscope[0], imu.gyroscope[1], imu.gyroscope[2];
+    baseAcceleration << imu.accelerometer[0], imu.accelerometer[1], imu.accelerometer[2];
     for (int motorId = 0; motorId < qrRobotConfig::numMotors; motorId++) {
         motorAngles[motorId] = motorState[motorId].q;
         motorVelocities[motorId] = motorState[motorId].dq;
     }
+    Eigen::Matrix<float, 4, 1> contactForce = footForce;
+    if (sensorFilterEnabled) {
+        FilterSensors(contactForce);
+    }
     for (int footId = 0; footId < qrRobotConfig::numLegs; footId++) {
-        footContact[footId] = footForce[footId] > 5 ? true : false;
+        footContact[footId] = contactForce[footId] > 5 ? true : false;
     }
+    validKinematics = 0;
 }
 
 void qrRobotState::SetRobotConfig(qrRobotConfig *config)
@@ -67,6 +74,50 @@ void qrRobotState::SetRobotConfig(qrRobotConfig *config)
 }
 
 
+void qrRobotState::SetSensorFilter(float sampleFrequency)
+{
+    const float cutoffs[3] = {config->jointVelocityCutoff, config->imuCutoff, config->footForceCutoff};
+    const int firstChannels[3] = {JOINT_VELOCITY, GYROSCOPE, FOOT_FORCE};
+    const int channelCounts[3] = {12, 6, 4};
+    sensorFilterEnabled = false;
+    for (int i = 0; i < 3; ++i) {
+        if (cutoffs[i] > 0.f && cutoffs[i] < 0.5f * sampleFrequency) {
+            sensorFilter.SetButterworthLowPass(firstChannels[i], channelCounts[i], cutoffs[i], sampleFrequency);
+            sensorFilterEnabled = true;
+        } else {
+            sensorFilter.SetPassThrough(firstChannels[i], channelCounts[i]);
+        }
+    }
+    // start from the last readings instead of zero
+    Eigen::Matrix<float, SENSOR_CHANNELS, 1> sensors;
+    sensors << motorVelocities, baseRollPitchYawRate, baseAcceleration, footForce;
+    sensorFilter.Reset(sensors);
+}
+
+void qrRobotState::SetPredictedState(const Eigen::Matrix<float, 12, 1> &predictedMotorAngles,
+                                     const Eigen::Matrix<float, 12, 1> &predictedMotorVelocities,
+                                     const Eigen::Matrix<float, 4, 1> &predictedOrientation,
+                                     const Eigen::Matrix<float, 3, 1> &predictedAngularVelocity)
+{
+    motorAngles = predictedMotorAngles;
+    motorVelocities = predictedMotorVelocities;
+    baseOrientation = predictedOrientation;
+    baseRollPitchYaw = math::quatToRPY(predictedOrientation);
+    baseRollPitchYawRate = predictedAngularVelocity;
+    validKinematics = 0;
+}
+
+void qrRobotState::FilterSensors(Eigen::Matrix<float, 4, 1> &filteredFootForce)
+{
+    Eigen::Matrix<float, SENSOR_CHANNELS, 1> sensors;
+    sensors << motorVelocities, baseRollPitchYawRate, baseAcceleration, footForce;
+    const Eigen::Matrix<float, SENSOR_CHANNELS, 1> &filtered = sensorFilter.Filter(sensors);
+    motorVelocities = filtered.segment<12>(JOINT_VELOCITY);
+    baseRollPitchYawRate = filtered.segment<3>(GYROSCOPE);
+    baseAcceleration = filtered.segment<3>(ACCELEROMETER);
+    filteredFootForce = filtered.segment<4>(FOOT_FORCE);
+}
+
 float qrRobotState::CalibrateYaw()
 {
     float calibratedYaw = imu.rpy[2] - yawOffset;
@@ -78,26 +129,41 @@ float qrRobotState::CalibrateYaw()
     return calibratedYaw;
 }
 
-Eigen::Matrix<float, 3, 4> qrRobotState::GetFootPositionsInBaseFrame()
+const Eigen::Matrix<float, 3, 4>& qrRobotState::GetFootPositionsInBaseFrame() const
 {
-    return config->FootPositionsInBaseFrame(this->motorAngles);
+    if (!(validKinematics & FOOT_POSITIONS)) {
+        footPositionsInBaseFrame = config->FootPositionsInBaseFrame(this->motorAngles);
+        validKinematics |= FOOT_POSITIONS;
+    }
+    return footPositionsInBaseFrame;
 }
 
-Eigen::Matrix<float, 3, 4> qrRobotState::GetFootPositionsInWorldFrame(bool useInput, Vec3<float> basePositionIn, Quat<float> baseOrientationIn)
+Eigen::Matrix<float, 3, 4> qrRobotState::GetFootPositionsInWorldFrame(bool useInput, Vec3<float> basePositionIn, Quat<float> baseOrientationIn) const
 {
-    Eigen::Matrix<float, 3, 4> footPositionsInBaseFrame = GetFootPositionsInBaseFrame(); // base to  world frame
     if (!useInput) {
-        return math::invertRigidTransform(basePosition, baseOrientation, footPositionsInBaseFrame);
+        // basePosition may be changed by the pose estimator within a tick, so only the rotation is cached
+        return (GetBaseRotationMatrix() * GetFootPositionsInBaseFrame()).colwise() + basePosition;
     } else {
-        return math::invertRigidTransform(basePositionIn, baseOrientationIn, footPositionsInBaseFrame);
+        return math::invertRigidTransform(basePositionIn, baseOrientationIn, GetFootPositionsInBaseFrame());
+    }
+}
+
+const Mat3<float>& qrRobotState::GetBaseRotationMatrix() const
+{
+    if (!(validKinematics & BASE_ROTATION)) {
+        baseRotationMatrix = math::quaternionToRotationMatrix(baseOrientation).transpose();
+        validKinematics |= BASE_ROTATION;
     }
+    return baseRotationMatrix;
 }
 
-Eigen::Matrix<float, 3, 3> qrRobotState::ComputeJacobian(int legId)
+const Eigen::Matrix<float, 3, 3>& qrRobotState::ComputeJacobian(int legId) const
 {
-    Eigen::Matrix<float, 3, 1> legMotorAngles;
-    legMotorAngles << this->motorAngles.block(legId * 3, 0, 3, 1);
-    return config->AnalyticalLegJacobian(legMotorAngles, legId);
+    if (!(validKinematics & LEG_JACOBIANS)) {
+        config->AnalyticalLegJacobians(this->motorAngles, legJacobians);
+        validKinematics |= LEG_JACOBIANS;
+    }
+    return legJacobians[legId];
 }
 
 std::map<int, float> qrRobotState::MapContactForceToJointTorques(int legId, Eigen::Matrix<float, 3, 1> contractForce)
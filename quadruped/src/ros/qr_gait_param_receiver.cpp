@@ -24,8 +24,8 @@
 
 #include "ros/qr_gait_param_receiver.h"
 
-qrGaitParamReceiver::qrGaitParamReceiver(ros::NodeHandle &nhIn)
-    : nh(nhIn)
+qrGaitParamReceiver::qrGaitParamReceiver(ros::NodeHandle &nhIn, qrGaitGenerator *gaitGeneratorIn)
+    : nh(nhIn), gaitGenerator(gaitGeneratorIn)
 {
     ROS_INFO("gait param topic: %s", gaitParamTopic.c_str());
     gaitParamSub = nh.subscribe(gaitParamTopic, 10, &qrGaitParamReceiver::GaitParamCallback, this);
@@ -88,6 +88,16 @@ void qrGaitParamReceiver::GaitParamCallback(const unitree_legged_msgs::GaitParam
                             msg->initFullCycle[3];
 
     this->contactDetectionPhaseThreshold = msg->contactDetectionPhaseThreshold;
+
+    if (gaitGenerator) {
+        qrGaitDescriptor gait;
+        if (gait.Compile(gaitName, stanceDuration, dutyFactor, initialLegState, initialLegPhase,
+                         contactDetectionPhaseThreshold)) {
+            gaitGenerator->PostGait(gait, true);
+        } else {
+            ROS_WARN("gait %s is invalid and ignored", gaitName.c_str());
+        }
+    }
     
     this->flag = true;
 }
@@ -0,0 +1,66 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ros/qr_ground_truth_receiver.h"
+
+qrGroundTruthReceiver::qrGroundTruthReceiver(ros::NodeHandle &nhIn, qrGroundTruth *groundTruthIn, std::string linkNameIn)
+    : nh(nhIn), groundTruth(groundTruthIn), linkName(linkNameIn), spinner(1, &queue)
+{
+    ros::SubscribeOptions options = ros::SubscribeOptions::create<gazebo_msgs::LinkStates>(
+        "/gazebo/link_states", 1, boost::bind(&qrGroundTruthReceiver::LinkStatesCallback, this, _1),
+        ros::VoidPtr(), &queue);
+    options.transport_hints = ros::TransportHints().tcpNoDelay();
+    linkStatesSub = nh.subscribe(options);
+    spinner.start();
+}
+
+qrGroundTruthReceiver::~qrGroundTruthReceiver()
+{
+    spinner.stop();
+    linkStatesSub.shutdown();
+}
+
+void qrGroundTruthReceiver::LinkStatesCallback(const gazebo_msgs::LinkStates::ConstPtr &msg)
+{
+    if (linkIndex >= msg->name.size() || msg->name[linkIndex] != linkName) {
+        linkIndex = 0;
+        while (linkIndex < msg->name.size() && msg->name[linkIndex] != linkName) {
+            ++linkIndex;
+        }
+        if (linkIndex >= msg->name.size() || linkIndex >= msg->pose.size() || linkIndex >= msg->twist.size()) {
+            ROS_WARN_THROTTLE(1.0, "link %s is not in /gazebo/link_states", linkName.c_str());
+            return;
+        }
+    }
+
+    const geometry_msgs::Pose &pose = msg->pose[linkIndex];
+    const geometry_msgs::Twist &twist = msg->twist[linkIndex];
+    qrGroundTruthPose truth;
+    truth.stamp = ros::Time::now().toSec();
+    truth.position << pose.position.x, pose.position.y, pose.position.z;
+    truth.orientation << pose.orientation.w, pose.orientation.x, pose.orientation.y, pose.orientation.z;
+    truth.linearVelocity << twist.linear.x, twist.linear.y, twist.linear.z;
+    truth.angularVelocity << twist.angular.x, twist.angular.y, twist.angular.z;
+    groundTruth->Publish(truth);
+}
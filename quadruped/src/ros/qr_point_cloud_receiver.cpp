@@ -0,0 +1,106 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "ros/qr_point_cloud_receiver.h"
+
+#include <cmath>
+#include <cstring>
+
+qrPointCloudReceiver::qrPointCloudReceiver(ros::NodeHandle &nhIn, qrElevationMap *mapIn, std::string worldFrameIn)
+    : nh(nhIn), map(mapIn), worldFrame(worldFrameIn), spinner(1, &queue)
+{
+    std::vector<std::string> topics;
+    if (!nh.getParam("point_cloud_topics", topics)) {
+        topics.push_back("/velodyne_points");
+    }
+    nh.param("point_cloud_tf_timeout", transformTimeout, 0.05);
+    for (const std::string &topic : topics) {
+        ROS_INFO("point cloud topic: %s", topic.c_str());
+        ros::SubscribeOptions options = ros::SubscribeOptions::create<sensor_msgs::PointCloud2>(
+            topic, 1, boost::bind(&qrPointCloudReceiver::PointCloudCallback, this, _1), ros::VoidPtr(), &queue);
+        pointCloudSubs.push_back(nh.subscribe(options));
+    }
+    spinner.start();
+}
+
+qrPointCloudReceiver::~qrPointCloudReceiver()
+{
+    spinner.stop();
+    for (ros::Subscriber &sub : pointCloudSubs) {
+        sub.shutdown();
+    }
+}
+
+void qrPointCloudReceiver::PointCloudCallback(const sensor_msgs::PointCloud2::ConstPtr &msg)
+{
+    int offset[3] = {-1, -1, -1};
+    const char *names[3] = {"x", "y", "z"};
+    for (const sensor_msgs::PointField &field : msg->fields) {
+        for (int i = 0; i < 3; ++i) {
+            if (field.name == names[i] && field.datatype == sensor_msgs::PointField::FLOAT32) {
+                offset[i] = field.offset;
+            }
+        }
+    }
+    if (offset[0] < 0 || offset[1] < 0 || offset[2] < 0) {
+        ROS_WARN_THROTTLE(1.0, "point cloud in %s has no FLOAT32 x, y, z fields", msg->header.frame_id.c_str());
+        return;
+    }
+
+    tf::StampedTransform transform;
+    try {
+        // the cloud is usually stamped ahead of the newest transform, wait for it rather than failing to extrapolate
+        tfListener.waitForTransform(worldFrame, msg->header.frame_id, msg->header.stamp, ros::Duration(transformTimeout));
+        tfListener.lookupTransform(worldFrame, msg->header.frame_id, msg->header.stamp, transform);
+    } catch (tf::TransformException &ex) {
+        ROS_WARN_THROTTLE(1.0, "%s", ex.what());
+        return;
+    }
+    Mat3<float> rotation;
+    Vec3<float> translation;
+    const tf::Matrix3x3 &basis = transform.getBasis();
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            rotation(r, c) = basis[r][c];
+        }
+    }
+    translation << transform.getOrigin().x(), transform.getOrigin().y(), transform.getOrigin().z();
+
+    const size_t count = size_t(msg->width) * msg->height;
+    points.clear();
+    points.reserve(3 * count);
+    for (uint32_t row = 0; row < msg->height; ++row) {
+        const uint8_t *data = msg->data.data() + row * msg->row_step;
+        for (uint32_t column = 0; column < msg->width; ++column, data += msg->point_step) {
+            float xyz[3];
+            for (int i = 0; i < 3; ++i) {
+                std::memcpy(xyz + i, data + offset[i], sizeof(float));
+            }
+            if (std::isfinite(xyz[0]) && std::isfinite(xyz[1]) && std::isfinite(xyz[2])) {
+                points.insert(points.end(), xyz, xyz + 3);
+            }
+        }
+    }
+    map->AddPointCloud(points.data(), int(points.size() / 3), rotation, translation);
+}
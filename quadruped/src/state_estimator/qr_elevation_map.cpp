@@ -0,0 +1,304 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_estimator/qr_elevation_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+#include "common/qr_simd.h"
+
+namespace {
+
+const float unknown = std::numeric_limits<float>::quiet_NaN();
+
+const float noPoint = -std::numeric_limits<float>::infinity();
+
+} // namespace
+
+float qrElevationMapSnapshot::GetHeight(float x, float y) const
+{
+    int ix, iy;
+    if (!GetIndex(x, y, ix, iy)) {
+        return unknown;
+    }
+    return height[ix * size + iy];
+}
+
+qrElevationMap::qrElevationMap(int sizeIn, float resolutionIn, int maxPointsIn)
+    : size(sizeIn), resolution(resolutionIn), maxPoints(maxPointsIn),
+      targetCornerX(-sizeIn / 2), targetCornerY(-sizeIn / 2), footholdHead(0), footholdTail(0)
+{
+    Cell empty = {unknown, unknown};
+    grid.assign(size * size, empty);
+    cloudMax.assign(size * size, noPoint);
+    touchedCells.reserve(size * size);
+    pendingPoints.resize(3 * maxPoints);
+    workingPoints.resize(3 * maxPoints);
+    pendingRotation.setIdentity();
+    pendingTranslation.setZero();
+    workingRotation.setIdentity();
+    workingTranslation.setZero();
+    cornerX = targetCornerX.load();
+    cornerY = targetCornerY.load();
+    for (qrElevationMapSnapshot &snapshot : snapshots.GetSlots()) {
+        snapshot.size = size;
+        snapshot.resolution = resolution;
+        snapshot.origin << cornerX * resolution, cornerY * resolution;
+        snapshot.height.assign(size * size, unknown);
+        snapshot.variance.assign(size * size, unknown);
+    }
+    worker = std::thread(&qrElevationMap::Run, this);
+}
+
+qrElevationMap::~qrElevationMap()
+{
+    {
+        std::lock_guard<std::mutex> lock(cloudMutex);
+        stopWorker = true;
+    }
+    cloudReady.notify_one();
+    worker.join();
+}
+
+void qrElevationMap::SetCenter(const Vec3<float> &basePosition)
+{
+    targetCornerX.store(int(std::floor(basePosition[0] / resolution)) - size / 2, std::memory_order_relaxed);
+    targetCornerY.store(int(std::floor(basePosition[1] / resolution)) - size / 2, std::memory_order_relaxed);
+}
+
+void qrElevationMap::AddFoothold(const Vec3<float> &footPosition)
+{
+    const unsigned int head = footholdHead.load(std::memory_order_relaxed);
+    if (head - footholdTail.load(std::memory_order_acquire) >= footholdCapacity) {
+        return;
+    }
+    footholds[head % footholdCapacity] = footPosition;
+    footholdHead.store(head + 1, std::memory_order_release);
+}
+
+void qrElevationMap::AddPointCloud(const float *xyz, int count, const Mat3<float> &rotation,
+                                   const Vec3<float> &translation, float variance)
+{
+    count = std::min(count, maxPoints);
+    {
+        std::lock_guard<std::mutex> lock(cloudMutex);
+        // a cloud the worker has not taken yet is replaced by the newer one
+        std::memcpy(pendingPoints.data(), xyz, 3 * count * sizeof(float));
+        pendingCount = count;
+        pendingRotation = rotation;
+        pendingTranslation = translation;
+        pendingVariance = variance;
+        hasPendingCloud = true;
+    }
+    cloudReady.notify_one();
+}
+
+const qrElevationMapSnapshot &qrElevationMap::GetSnapshot()
+{
+    return snapshots.GetFront();
+}
+
+void qrElevationMap::Run()
+{
+    while (true) {
+        bool hasCloud = false;
+        {
+            std::unique_lock<std::mutex> lock(cloudMutex);
+            // footholds and scrolling do not signal, they are picked up at the latest after the timeout
+            cloudReady.wait_for(lock, std::chrono::milliseconds(10), [this] {
+                return hasPendingCloud || stopWorker;
+            });
+            if (stopWorker) {
+                return;
+            }
+            if (hasPendingCloud) {
+                std::swap(pendingPoints, workingPoints);
+                workingCount = pendingCount;
+                workingRotation = pendingRotation;
+                workingTranslation = pendingTranslation;
+                workingVariance = pendingVariance;
+                hasPendingCloud = false;
+                hasCloud = true;
+            }
+        }
+
+        bool changed = false;
+        const int newCornerX = targetCornerX.load(std::memory_order_relaxed);
+        const int newCornerY = targetCornerY.load(std::memory_order_relaxed);
+        if (newCornerX != cornerX || newCornerY != cornerY) {
+            Scroll(newCornerX, newCornerY);
+            changed = true;
+        }
+
+        unsigned int tail = footholdTail.load(std::memory_order_relaxed);
+        const unsigned int head = footholdHead.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const Vec3<float> &foothold = footholds[tail % footholdCapacity];
+            const int globalX = int(std::floor(foothold[0] / resolution));
+            const int globalY = int(std::floor(foothold[1] / resolution));
+            if (globalX - cornerX >= 0 && globalX - cornerX < size && globalY - cornerY >= 0 && globalY - cornerY < size) {
+                Fuse(At(globalX, globalY), foothold[2], footholdVariance);
+                changed = true;
+            }
+        }
+        footholdTail.store(tail, std::memory_order_release);
+
+        if (hasCloud) {
+            InsertPendingCloud();
+            changed = true;
+        }
+        if (changed) {
+            Publish();
+        }
+    }
+}
+
+void qrElevationMap::Scroll(int newCornerX, int newCornerY)
+{
+    // the cells of the old window that are not in the new one are cleared for reuse
+    if (newCornerX > cornerX) {
+        ClearColumns(cornerX, std::min(newCornerX, cornerX + size) - 1);
+    } else if (newCornerX < cornerX) {
+        ClearColumns(std::max(newCornerX + size, cornerX), cornerX + size - 1);
+    }
+    cornerX = newCornerX;
+    if (newCornerY > cornerY) {
+        ClearRows(cornerY, std::min(newCornerY, cornerY + size) - 1);
+    } else if (newCornerY < cornerY) {
+        ClearRows(std::max(newCornerY + size, cornerY), cornerY + size - 1);
+    }
+    cornerY = newCornerY;
+}
+
+void qrElevationMap::ClearColumns(int firstGlobalX, int lastGlobalX)
+{
+    Cell empty = {unknown, unknown};
+    for (int globalX = firstGlobalX; globalX <= lastGlobalX; ++globalX) {
+        std::fill_n(grid.begin() + Wrap(globalX) * size, size, empty);
+    }
+}
+
+void qrElevationMap::ClearRows(int firstGlobalY, int lastGlobalY)
+{
+    Cell empty = {unknown, unknown};
+    for (int globalY = firstGlobalY; globalY <= lastGlobalY; ++globalY) {
+        const int y = Wrap(globalY);
+        for (int x = 0; x < size; ++x) {
+            grid[x * size + y] = empty;
+        }
+    }
+}
+
+void qrElevationMap::Fuse(Cell &cell, float height, float variance)
+{
+    const float innovation = height - cell.height;
+    // unknown cells and measurements far outside of the current estimate, e.g. an obstacle that
+    // moved, restart the cell
+    if (!(innovation * innovation <= 9.f * (cell.variance + variance))) {
+        cell.height = height;
+        cell.variance = variance;
+        return;
+    }
+    const float gain = cell.variance / (cell.variance + variance);
+    cell.height += gain * innovation;
+    cell.variance = std::max((1.f - gain) * cell.variance, minVariance);
+}
+
+void qrElevationMap::InsertPendingCloud()
+{
+    const Mat3<float> &R = workingRotation;
+    const Vec3<float> &t = workingTranslation;
+    const qrFloat4 r00(R(0, 0)), r01(R(0, 1)), r02(R(0, 2));
+    const qrFloat4 r10(R(1, 0)), r11(R(1, 1)), r12(R(1, 2));
+    const qrFloat4 r20(R(2, 0)), r21(R(2, 1)), r22(R(2, 2));
+    const qrFloat4 tx(t[0]), ty(t[1]), tz(t[2]);
+    const qrFloat4 inverseResolution(1.f / resolution);
+    const qrFloat4 corner0 = qrFloat4(float(cornerX)), corner1 = qrFloat4(float(cornerY));
+
+    const float *points = workingPoints.data();
+    alignas(16) float tail[12];
+    for (int first = 0; first < workingCount; first += 4) {
+        const float *p = points + 3 * first;
+        if (first + 4 > workingCount) {
+            // repeat the last point into the missing lanes, a point counts once per cell anyway
+            for (int i = 0; i < 4; ++i) {
+                const int source = std::min(first + i, workingCount - 1);
+                std::memcpy(tail + 3 * i, points + 3 * source, 3 * sizeof(float));
+            }
+            p = tail;
+        }
+        const qrFloat4 x = qrFloat4::Gather(p, 3);
+        const qrFloat4 y = qrFloat4::Gather(p + 1, 3);
+        const qrFloat4 z = qrFloat4::Gather(p + 2, 3);
+        const qrFloat4 worldX = r00 * x + r01 * y + r02 * z + tx;
+        const qrFloat4 worldY = r10 * x + r11 * y + r12 * z + ty;
+        const qrFloat4 worldZ = r20 * x + r21 * y + r22 * z + tz;
+        // cell index inside the window, points with NaN coordinates are dropped below
+        alignas(16) float cellX[4], cellY[4], heights[4];
+        (simd::floor(worldX * inverseResolution) - corner0).Store(cellX);
+        (simd::floor(worldY * inverseResolution) - corner1).Store(cellY);
+        worldZ.Store(heights);
+        for (int i = 0; i < 4; ++i) {
+            if (!(cellX[i] >= 0.f && cellX[i] < size && cellY[i] >= 0.f && cellY[i] < size)
+                || heights[i] != heights[i]) {
+                continue;
+            }
+            const int index = Wrap(cornerX + int(cellX[i])) * size + Wrap(cornerY + int(cellY[i]));
+            if (cloudMax[index] == noPoint) {
+                touchedCells.push_back(index);
+            }
+            cloudMax[index] = std::max(cloudMax[index], heights[i]);
+        }
+    }
+
+    // the top of every cell is what a foot would step on
+    for (int index : touchedCells) {
+        Fuse(grid[index], cloudMax[index], workingVariance);
+        cloudMax[index] = noPoint;
+    }
+    touchedCells.clear();
+}
+
+void qrElevationMap::Publish()
+{
+    qrElevationMapSnapshot &snapshot = snapshots.GetBack();
+    snapshot.origin << cornerX * resolution, cornerY * resolution;
+    snapshot.sequence = ++sequence;
+    // unwrap the ring buffer, every column is contiguous in two pieces
+    const int splitY = size - Wrap(cornerY);
+    for (int ix = 0; ix < size; ++ix) {
+        const Cell *column = grid.data() + Wrap(cornerX + ix) * size;
+        float *height = snapshot.height.data() + ix * size;
+        float *variance = snapshot.variance.data() + ix * size;
+        for (int iy = 0; iy < size; ++iy) {
+            const Cell &cell = column[iy < splitY ? Wrap(cornerY) + iy : iy - splitY];
+            height[iy] = cell.height;
+            variance[iy] = cell.variance;
+        }
+    }
+    snapshots.Publish();
+}
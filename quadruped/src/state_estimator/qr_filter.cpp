@@ -23,18 +23,23 @@
 // SOFTWARE.
 #include "state_estimator/qr_filter.h"
 
-qrMovingWindowFilter::qrMovingWindowFilter()
+qrMovingWindowFilter::qrMovingWindowFilter(): qrMovingWindowFilter(DEFAULT_WINDOW_SIZE)
 {
-    moveWindowSize = DEFAULT_WINDOW_SIZE;
-    sum = 0.;
-    correction = 0.;
 }
 
 qrMovingWindowFilter::qrMovingWindowFilter(unsigned int windowSizeIn)
 {
-    moveWindowSize = windowSizeIn;
+    moveWindowSize = windowSizeIn > 0 ? windowSizeIn : 1;
+    values.resize(moveWindowSize);
+    Reset();
+}
+
+void qrMovingWindowFilter::Reset()
+{
     sum = 0.;
     correction = 0.;
+    head = 0;
+    count = 0;
 }
 
 void qrMovingWindowFilter::NeumaierSum(const double &value)
@@ -60,14 +65,15 @@ void qrMovingWindowFilter::NeumaierSum(const double &value)
  */
 double qrMovingWindowFilter::CalculateAverage(const double &newValue)
 {
-    auto dequeLen = valueDeque.size();
-    if (dequeLen >= moveWindowSize) {
+    if (count >= moveWindowSize) {
         // The left most value to be subtracted from the moving sum.
-        NeumaierSum(-valueDeque[0]);
-        valueDeque.pop_front();
+        NeumaierSum(-values[head]);
+    } else {
+        ++count;
     }
 
     NeumaierSum(newValue);
-    valueDeque.push_back(newValue);
+    values[head] = newValue;
+    head = head + 1 == moveWindowSize ? 0 : head + 1;
     return (sum + correction) / moveWindowSize;
 }
@@ -34,21 +34,27 @@ qrGroundSurfaceEstimator::qrGroundSurfaceEstimator(qrRobot *robotIn, std::string
 void qrGroundSurfaceEstimator::Update(float currentTime)
 {   
     Eigen::Matrix<bool, 4, 1> contactState = robot->GetFootContacts();
-
-    if(!ShouldUpdate(contactState)){
-        return ;
+    Eigen::Matrix<bool, 4, 1> touchDown = contactState.array() && !lastContactState.array();
+    lastContactState = contactState;
+    elevationMap.SetCenter(robot->GetBasePosition());
+    if (!touchDown.any()) {
+        return;
     }
 
-    // equation of the plane is pZ(x,y) = a_0 + a_1 * x + a_2 * y
-    // then the least square problem is min||Wa - pZ||_2
-    Eigen::Matrix<double, 3, 4> footPositionsInBaseFrame = robot->state.GetFootPositionsInBaseFrame().cast<double>();
-    pZ = footPositionsInBaseFrame.row(2);
-    W.col(1) = footPositionsInBaseFrame.row(0);
-    W.col(2) = footPositionsInBaseFrame.row(1);
-    
-    // the analytic solution is (W^T * W)^(-1) * W^T * pZ
-    Mat3<double> ww = W.transpose()* W;
-    a = ww.inverse()* W.transpose()*pZ;
+    // the footholds stay put in the world frame while the base moves on
+    const Mat3<float>& rotMat = robot->state.GetBaseRotationMatrix();
+    Eigen::Matrix<double, 3, 4> footPositionsWorldFrame =
+        (rotMat * robot->state.GetFootPositionsInBaseFrame()).cast<double>();
+    Vec3<double> basePosition = robot->GetBasePosition().cast<double>();
+    footPositionsWorldFrame.colwise() += basePosition;
+
+    MovePlaneOrigin(basePosition.head<2>());
+    for (int legId = 0; legId < 4; ++legId) {
+        if (touchDown[legId]) {
+            FoldFoothold(footPositionsWorldFrame.col(legId));
+            elevationMap.AddFoothold(footPositionsWorldFrame.col(legId).cast<float>());
+        }
+    }
     GetNormalVector(true);
     ComputeControlFrame();
 }
@@ -76,9 +82,14 @@ void qrGroundSurfaceEstimator::Reset(float currentTime) {
         default : throw std::domain_error("no such terrain!");
     }
 
+    // a weak prior of flat ground at z = 0, the first footholds decide the plane
     a = Eigen::Matrix<double, 3, 1>::Zero();
-    W = Eigen::Matrix<double, 4, 3>::Ones();
-    pZ = Vec4<double>::Zero();
+    planeCovariance = 1e4 * Mat3<double>::Identity();
+    planeOrigin = Vec2<double>::Zero();
+    forgettingFactor = 0.98;
+    if (footStepperConfig["plane_forgetting_factor"]) {
+        forgettingFactor = footStepperConfig["plane_forgetting_factor"].as<double>();
+    }
     n << 0.f, 0.f, 1.f;
     controlFrameRPY << 0., 0., 0.;
     controlFrameOrientation << 1.0, 0, 0, 0;
@@ -91,10 +102,31 @@ void qrGroundSurfaceEstimator::Reset(float currentTime) {
 
 float qrGroundSurfaceEstimator::GetZ(float x, float y)
 {
-    float z = a.transpose() * Vec3<double>(1, x, y);
+    float z = a.transpose() * Vec3<double>(1, x - planeOrigin[0], y - planeOrigin[1]);
     return z;
 }
 
+void qrGroundSurfaceEstimator::MovePlaneOrigin(const Vec2<double>& origin)
+{
+    // a' = T a and P' = T P T' with T = [1 dx dy; 0 1 0; 0 0 1]
+    Vec2<double> delta = origin - planeOrigin;
+    Mat3<double> T = Mat3<double>::Identity();
+    T(0, 1) = delta[0];
+    T(0, 2) = delta[1];
+    a[0] += a[1] * delta[0] + a[2] * delta[1];
+    planeCovariance = T * planeCovariance * T.transpose();
+    planeOrigin = origin;
+}
+
+void qrGroundSurfaceEstimator::FoldFoothold(const Vec3<double>& footPosition)
+{
+    Vec3<double> phi(1., footPosition[0] - planeOrigin[0], footPosition[1] - planeOrigin[1]);
+    Vec3<double> Pphi = planeCovariance * phi;
+    Vec3<double> gain = Pphi / (forgettingFactor + phi.dot(Pphi));
+    a += gain * (footPosition[2] - phi.dot(a));
+    planeCovariance = (planeCovariance - gain * Pphi.transpose()) / forgettingFactor;
+}
+
 Eigen::Matrix<double, 3, 1> qrGroundSurfaceEstimator::GetNormalVector(bool update)
 {
     // z axis of normal vector should be positive.It will be easy to calculate the control frame
@@ -104,7 +136,7 @@ Eigen::Matrix<double, 3, 1> qrGroundSurfaceEstimator::GetNormalVector(bool updat
         n /= factor;
     }
 
-    return n; // in base frame
+    return n; // in world frame
 }
 
 Eigen::Matrix<double, 4, 4> qrGroundSurfaceEstimator::ComputeControlFrame()
@@ -113,7 +145,7 @@ Eigen::Matrix<double, 4, 4> qrGroundSurfaceEstimator::ComputeControlFrame()
     // z axis is the norm vector of the plane
     // y axis is the cross of x axis and z axis
     Quat<double> quat = robot->GetBaseOrientation().cast<double>();
-    Vec3<double> nInWorldFrame = math::invertRigidTransform<double>({0,0,0},quat, n);
+    Vec3<double> nInWorldFrame = n;
     Vec3<double> xAxis = math::quaternionToRotationMatrix(quat).transpose().col(0);
     Vec3<double> yAxis = nInWorldFrame.cross(xAxis);
     yAxis.normalize();
@@ -137,24 +169,3 @@ Eigen::Matrix<float, 3, 3> qrGroundSurfaceEstimator::GetAlignedDirections()
     Mat3<float> R = controlFrame.block<3,3>(0,0).cast<float>();   
     return R;
 }
-
-bool qrGroundSurfaceEstimator::ShouldUpdate(const Eigen::Matrix<bool, 4, 1> &contactState)
-{
-    bool shouldUpdate = false;
-    int N=0;
-    int i=0;
-    for(i=0; i < 4; ++i) {
-        if (contactState[i]) {
-            if ((!lastContactState[i])) {
-                shouldUpdate = true;
-            }
-            ++N;
-        }
-    }
-    lastContactState = contactState;
-    // when all foot on the ground and contact state changed will the plane update
-    if (N <= 3 || !shouldUpdate) {
-        return false;
-    }
-    return true;
-}
\ No newline at end of file
@@ -0,0 +1,108 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_estimator/qr_ground_truth.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "common/qr_se3.h"
+
+void qrGroundTruth::Publish(const qrGroundTruthPose &pose)
+{
+    qrGroundTruthPose &slot = poses.GetBack();
+    slot = pose;
+    slot.sequence = ++sequence;
+    slot.receiveTime = Now();
+    poses.Publish();
+}
+
+const qrGroundTruthPose &qrGroundTruth::GetLatest()
+{
+    return poses.GetFront();
+}
+
+double qrGroundTruth::Now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void qrGroundTruthErrorMetrics::Add(const qrGroundTruthPose &truth,
+                                    const Vec3<float> &position,
+                                    const Vec3<float> &velocity,
+                                    float yaw,
+                                    double now)
+{
+    if (truth.sequence == 0 || truth.sequence == lastSequence) {
+        return;
+    }
+    lastSequence = truth.sequence;
+    ++count;
+
+    const Vec3<float> positionError = position - truth.position;
+    const Vec3<float> velocityError = velocity - truth.linearVelocity;
+    // wrap into [-pi, pi)
+    float yawError = yaw - math::quatToRPY(truth.orientation)[2];
+    yawError -= 2.f * float(M_PI) * std::floor((yawError + float(M_PI)) / (2.f * float(M_PI)));
+    const float age = float(now - truth.receiveTime);
+
+    positionSquaredSum += positionError.cwiseAbs2().cast<double>();
+    velocitySquaredSum += velocityError.cwiseAbs2().cast<double>();
+    yawSquaredSum += double(yawError) * yawError;
+    ageSum += age;
+    maxPositionError = std::max(maxPositionError, positionError.norm());
+    maxVelocityError = std::max(maxVelocityError, velocityError.norm());
+    maxYawError = std::max(maxYawError, std::abs(yawError));
+    maxAge = std::max(maxAge, age);
+}
+
+void qrGroundTruthErrorMetrics::Reset()
+{
+    // keep lastSequence so that the measurement in hand is not counted again
+    count = 0;
+    positionSquaredSum.setZero();
+    velocitySquaredSum.setZero();
+    yawSquaredSum = 0.;
+    ageSum = 0.;
+    maxPositionError = 0.f;
+    maxVelocityError = 0.f;
+    maxYawError = 0.f;
+    maxAge = 0.f;
+}
+
+Vec3<float> qrGroundTruthErrorMetrics::PositionRms() const
+{
+    return count ? Vec3<float>((positionSquaredSum / double(count)).cwiseSqrt().cast<float>()) : Vec3<float>::Zero();
+}
+
+Vec3<float> qrGroundTruthErrorMetrics::VelocityRms() const
+{
+    return count ? Vec3<float>((velocitySquaredSum / double(count)).cwiseSqrt().cast<float>()) : Vec3<float>::Zero();
+}
+
+float qrGroundTruthErrorMetrics::YawRms() const
+{
+    return count ? float(std::sqrt(yawSquaredSum / double(count))) : 0.f;
+}
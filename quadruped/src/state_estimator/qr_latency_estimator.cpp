@@ -0,0 +1,158 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_estimator/qr_latency_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+/**
+ * @brief how many ticks of swinging joints, weighted by their age, the estimate needs before it is trusted.
+ */
+const float minWeight = 100.f;
+
+} // namespace
+
+qrLatencyEstimator::qrLatencyEstimator(float timeWindowIn, float minCorrelationIn)
+    : timeWindow(timeWindowIn), minCorrelation(minCorrelationIn)
+{
+    Reset();
+}
+
+void qrLatencyEstimator::Reset()
+{
+    sumX.setZero();
+    sumXY.setZero();
+    sumXX.setZero();
+    sumY.setZero();
+    sumYY.setZero();
+    sumWeight.setZero();
+    latency = 0.f;
+    correlation = 0.f;
+    converged = false;
+    jointResponse.setZero();
+    computeTimeSum = 0.f;
+    computeTimeWeight = 0.f;
+    maxComputeTime = 0.f;
+}
+
+void qrLatencyEstimator::Update(const qrStateHistory &history, float dt)
+{
+    if (history.Size() < maxLag + 1 || dt <= 0.f) {
+        return;
+    }
+    const float forgetting = std::exp(-dt / timeWindow);
+    sumX *= forgetting;
+    sumXY *= forgetting;
+    sumXX *= forgetting;
+    sumY *= forgetting;
+    sumYY *= forgetting;
+    sumWeight *= forgetting;
+
+    const qrStateSample &s0 = history.Get(0);
+    const qrStateSample &s1 = history.Get(1);
+    bool learned = false;
+    for (int legId = 0; legId < 4; ++legId) {
+        bool inAir = true;
+        for (int age = 0; age <= maxLag && inAir; ++age) {
+            const qrStateSample &sample = history.Get(age);
+            inAir = !sample.footContact[legId] && (age == 0 || sample.hasCommand);
+        }
+        if (!inAir) {
+            continue;
+        }
+        for (int motorId = 3 * legId; motorId < 3 * legId + 3; ++motorId) {
+            // acceleration over the last tick
+            const float y = (s0.motorVelocities[motorId] - s1.motorVelocities[motorId]) / dt;
+            sumY[motorId] += y;
+            sumYY[motorId] += y * y;
+            sumWeight[motorId] += 1.f;
+            for (int lag = 1; lag <= maxLag; ++lag) {
+                // the torque the command of that tick makes at the joint state before the acceleration,
+                // as the PD loop of the motor closes on the state it is in, not on the one observed back then
+                const float x = history.Get(lag).Effort(motorId, s1.motorAngles[motorId], s1.motorVelocities[motorId]);
+                sumX(motorId, lag - 1) += x;
+                sumXY(motorId, lag - 1) += x * y;
+                sumXX(motorId, lag - 1) += x * x;
+            }
+        }
+        learned = true;
+    }
+    if (!learned) {
+        return;
+    }
+
+    // covariances pooled over the motors
+    Eigen::Matrix<float, 1, maxLag> xy = Eigen::Matrix<float, 1, maxLag>::Zero();
+    Eigen::Matrix<float, 1, maxLag> xx = Eigen::Matrix<float, 1, maxLag>::Zero();
+    float yy = 0.f;
+    for (int motorId = 0; motorId < 12; ++motorId) {
+        if (sumWeight[motorId] <= 0.f) {
+            continue;
+        }
+        const float inverseWeight = 1.f / sumWeight[motorId];
+        xy += sumXY.row(motorId) - sumX.row(motorId) * (sumY[motorId] * inverseWeight);
+        xx += sumXX.row(motorId) - sumX.row(motorId).cwiseAbs2() * inverseWeight;
+        yy += sumYY[motorId] - sumY[motorId] * sumY[motorId] * inverseWeight;
+    }
+    Eigen::Matrix<float, 1, maxLag> rho;
+    for (int i = 0; i < maxLag; ++i) {
+        rho[i] = xx[i] * yy > 0.f ? xy[i] / std::sqrt(xx[i] * yy) : 0.f;
+    }
+    int best;
+    correlation = rho.maxCoeff(&best);
+    // refine the peak between the ticks by a parabola through its neighbours
+    float offset = 0.f;
+    if (best > 0 && best < maxLag - 1) {
+        const float curvature = rho[best - 1] - 2.f * rho[best] + rho[best + 1];
+        if (curvature < 0.f) {
+            offset = std::max(-0.5f, std::min(0.5f, 0.5f * (rho[best - 1] - rho[best + 1]) / curvature));
+        }
+    }
+    // a delay of one tick, index 0, is what an instant transport takes
+    latency = std::max(0.f, (best + offset) * dt);
+    for (int motorId = 0; motorId < 12; ++motorId) {
+        jointResponse[motorId] = 0.f;
+        if (sumWeight[motorId] <= 0.f) {
+            continue;
+        }
+        const float inverseWeight = 1.f / sumWeight[motorId];
+        const float motorXY = sumXY(motorId, best) - sumX(motorId, best) * sumY[motorId] * inverseWeight;
+        const float motorXX = sumXX(motorId, best) - sumX(motorId, best) * sumX(motorId, best) * inverseWeight;
+        if (motorXX > 0.f) {
+            jointResponse[motorId] = std::max(0.f, motorXY / motorXX);
+        }
+    }
+    converged = sumWeight.maxCoeff() > minWeight && correlation > minCorrelation;
+}
+
+void qrLatencyEstimator::AddComputeTime(float seconds)
+{
+    const float forgetting = 0.999f;
+    computeTimeSum = forgetting * computeTimeSum + seconds;
+    computeTimeWeight = forgetting * computeTimeWeight + 1.f;
+    maxComputeTime = std::max(maxComputeTime, seconds);
+}
@@ -0,0 +1,148 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_estimator/qr_linear_kf.h"
+
+qrLinearKF::qrLinearKF(float processNoisePosition,
+                       float processNoiseVelocity,
+                       float processNoiseFoot,
+                       float sensorNoiseFootPosition,
+                       float sensorNoiseFootVelocity,
+                       float sensorNoiseFootHeight,
+                       float initialVarianceIn)
+    : initialVariance(initialVarianceIn), lastDeltaTime(0.001f)
+{
+    processNoise.head<3>().setConstant(processNoisePosition / 20.f);
+    processNoise.segment<3>(3).setConstant(processNoiseVelocity * 9.8f / 20.f);
+    processNoise.tail<12>().setConstant(processNoiseFoot);
+    sensorNoise.head<12>().setConstant(sensorNoiseFootPosition);
+    sensorNoise.segment<3>(12).setConstant(sensorNoiseFootVelocity);
+    sensorNoise.tail<4>().setConstant(sensorNoiseFootHeight);
+    Reset(Vec3<float>::Zero(), Vec3<float>::Zero(), Eigen::Matrix<float, 3, 4>::Zero());
+}
+
+void qrLinearKF::Reset(const Vec3<float> &position, const Vec3<float> &velocity,
+                       const Eigen::Matrix<float, 3, 4> &footPositions)
+{
+    x.head<3>() = position;
+    x.segment<3>(3) = velocity;
+    for (int legId = 0; legId < 4; ++legId) {
+        x.segment<3>(6 + 3 * legId) = footPositions.col(legId);
+    }
+    P = StateMatrix::Identity() * initialVariance;
+}
+
+void qrLinearKF::Predict(float deltaTime, const Vec3<float> &acceleration)
+{
+    lastDeltaTime = deltaTime;
+    x.head<3>() += deltaTime * x.segment<3>(3) + 0.5f * deltaTime * deltaTime * acceleration;
+    x.segment<3>(3) += deltaTime * acceleration;
+
+    // P = A P A' with A = I + dt E, E moving the velocity into the position: only the position rows and
+    // columns change.
+    P.topRows<3>() += deltaTime * P.middleRows<3>(3);
+    P.leftCols<3>() += deltaTime * P.middleCols<3>(3);
+    P.diagonal() += deltaTime * processNoise;
+}
+
+void qrLinearKF::Update(const Eigen::Matrix<float, 3, 4> &footPositions,
+                        const Eigen::Matrix<float, 3, 4> &footVelocities,
+                        const Vec4<float> &trust)
+{
+    // innovation y - C x, and the noise of each leg scaled by how much it is trusted
+    Eigen::Matrix<float, NMeasure, 1> innovation;
+    Eigen::Matrix<float, NMeasure, 1> R = sensorNoise;
+    const Vec3<float> p = x.head<3>();
+    const Vec3<float> v = x.segment<3>(3);
+    // the four leg velocities observe the same state with diagonal noise, so they are fused into their
+    // information weighted mean, which gives the same estimate with a smaller S
+    Vec3<float> velocitySum = Vec3<float>::Zero();
+    float velocityInformation = 0.f;
+    for (int legId = 0; legId < 4; ++legId) {
+        const int foot = 6 + 3 * legId;
+        const float suspect = 1.f + (1.f - trust[legId]) * highSuspectNumber;
+        // base relative to the foot
+        innovation.segment<3>(3 * legId) = -footPositions.col(legId) - (p - x.segment<3>(foot));
+        // base velocity; the estimate itself when the foot slides or swings
+        Vec3<float> legVelocity = trust[legId] * (-footVelocities.col(legId)) + (1.f - trust[legId]) * v;
+        velocitySum += legVelocity / suspect;
+        velocityInformation += 1.f / suspect;
+        // foot height above the ground, or where the kinematics puts it in swing
+        float footHeight = (1.f - trust[legId]) * (p[2] + footPositions(2, legId));
+        innovation[15 + legId] = footHeight - x[foot + 2];
+
+        R.segment<3>(3 * legId) *= suspect;
+        R[15 + legId] *= suspect;
+        P.diagonal().segment<3>(foot) += lastDeltaTime * processNoise.segment<3>(foot) * (suspect - 1.f);
+    }
+    innovation.segment<3>(12) = velocitySum / velocityInformation - v;
+    R.segment<3>(12) /= velocityInformation;
+
+    // C P, row by row
+    for (int legId = 0; legId < 4; ++legId) {
+        const int foot = 6 + 3 * legId;
+        CP.middleRows<3>(3 * legId) = P.topRows<3>() - P.middleRows<3>(foot);
+        CP.row(15 + legId) = P.row(foot + 2);
+    }
+    CP.middleRows<3>(12) = P.middleRows<3>(3);
+    // S = (C P) C' + R, column by column
+    for (int legId = 0; legId < 4; ++legId) {
+        const int foot = 6 + 3 * legId;
+        S.middleCols<3>(3 * legId) = CP.leftCols<3>() - CP.middleCols<3>(foot);
+        S.col(15 + legId) = CP.col(foot + 2);
+    }
+    S.middleCols<3>(12) = CP.middleCols<3>(3);
+    S.diagonal() += R;
+
+    // K = P C' S^-1, i.e. K L L' = (C P)'. Both triangular solves run over the contiguous columns of K,
+    // which is much cheaper than the blocked solver at this size.
+    llt.compute(S);
+    const Eigen::Matrix<float, NMeasure, NMeasure> &L = llt.matrixLLT();
+    K = CP.transpose();
+    for (int j = 0; j < NMeasure; ++j) {
+        K.col(j) -= K.leftCols(j) * L.row(j).head(j).transpose();
+        K.col(j) /= L(j, j);
+    }
+    for (int j = NMeasure - 1; j >= 0; --j) {
+        K.col(j) -= K.rightCols(NMeasure - 1 - j) * L.col(j).tail(NMeasure - 1 - j);
+        K.col(j) /= L(j, j);
+    }
+    x.noalias() += K * innovation;
+
+    // I - K C, column by column
+    IKC.setIdentity();
+    IKC.middleCols<3>(3) -= K.middleCols<3>(12);
+    for (int legId = 0; legId < 4; ++legId) {
+        const int foot = 6 + 3 * legId;
+        IKC.leftCols<3>() -= K.middleCols<3>(3 * legId);
+        IKC.middleCols<3>(foot) += K.middleCols<3>(3 * legId);
+        IKC.col(foot + 2) -= K.col(15 + legId);
+    }
+    StateMatrix IKCP;
+    IKCP.noalias() = IKC * P;
+    P.noalias() = IKCP * IKC.transpose();
+    KR.noalias() = K * R.asDiagonal();
+    P.noalias() += KR * K.transpose();
+    P = 0.5f * (P + P.transpose()).eval();
+}
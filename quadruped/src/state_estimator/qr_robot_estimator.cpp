@@ -24,31 +24,27 @@
 
 #include "state_estimator/qr_robot_estimator.h"
 
-qrRobotEstimator::qrRobotEstimator(qrRobot *robotIn,
-                                qrGaitGenerator *gaitGeneratorIn,
-                                qrGroundSurfaceEstimator *groundEstimatorIn)
-    : robot(robotIn), velocityEstimator(robotIn, gaitGeneratorIn),
-        poseEstimator(robotIn, gaitGeneratorIn, groundEstimatorIn, &velocityEstimator)
-{        
-    estimatedVelocity = velocityEstimator.GetEstimatedVelocity();
-    estimatedAngularVelocity = velocityEstimator.GetEstimatedAngularVelocity();
-    const Vec6<float> &pose = poseEstimator.GetEstimatedPose();
-    estimatedPosition = pose.head(3);
-    estimatedRPY = pose.tail(3);
+
+qrRobotEstimator::qrRobotEstimator(qrRobot *robotIn, qrGroundSurfaceEstimator *groundEstimatorIn)
+    : robot(robotIn), groundEstimator(groundEstimatorIn)
+{
+    timeSinceReset = 0.f;
+    Reset(0.f);
     std::cout << "estimatedPosition = " << estimatedPosition.transpose() << std::endl;
-    lastTimestamp = 0.0;
 }
 
 void qrRobotEstimator::Reset(float currentTime)
 {
     timeSinceReset = robot->GetTimeSinceReset();
-    velocityEstimator.Reset(currentTime);
-    poseEstimator.Reset(currentTime);
-    estimatedVelocity = velocityEstimator.GetEstimatedVelocity();
-    estimatedAngularVelocity = velocityEstimator.GetEstimatedAngularVelocity();
-    const Vec6<float> &pose = poseEstimator.GetEstimatedPose();
-    estimatedPosition = pose.head(3);
-    estimatedRPY = pose.tail(3);
+    const Mat3<float> &rotMat = robot->state.GetBaseRotationMatrix();
+    Vec3<float> basePosition = robot->GetBasePosition();
+    Eigen::Matrix<float, 3, 4> footPositionsWorldFrame = rotMat * robot->state.GetFootPositionsInBaseFrame();
+    footPositionsWorldFrame.colwise() += basePosition;
+    filter.Reset(basePosition, Vec3<float>::Zero(), footPositionsWorldFrame);
+    estimatedPosition = basePosition;
+    estimatedRPY = robot->GetBaseRollPitchYaw();
+    estimatedVelocity.setZero();
+    estimatedAngularVelocity.setZero();
     lastTimestamp = 0.0;
     std::cout << "reset pos= " << estimatedPosition.transpose() << std::endl;
 }
@@ -68,12 +64,59 @@ float qrRobotEstimator::ComputeDeltaTime(const LowState *robotState)
 
 void qrRobotEstimator::Update(float currentTime)
 {
-    velocityEstimator.Update(currentTime);
-    poseEstimator.Update(currentTime);
+    const qrRobotState &state = robot->state;
+    float deltaTime = ComputeDeltaTime(&robot->lowstate);
+
+    // Propagate with the accelerometer reading in the world frame.
+    const Mat3<float> &rotMat = state.GetBaseRotationMatrix();
+    Vec3<float> accelerationWorldFrame = rotMat * state.baseAcceleration;
+    accelerationWorldFrame[2] -= 9.81f;
+    filter.Predict(deltaTime, accelerationWorldFrame);
+
+    // Correct with the leg kinematics, foot velocities include the rotation of the base.
+    const Vec3<float> &omega = robot->GetBaseRollPitchYawRate();
+    const Eigen::Matrix<float, 3, 4> &footPositions = state.GetFootPositionsInBaseFrame();
+    const Eigen::Matrix<float, 12, 1> jointVelocities = robot->GetMotorVelocities();
+    Eigen::Matrix<float, 3, 4> footVelocities;
+    for (int legId = 0; legId < 4; ++legId) {
+        footVelocities.col(legId) = omega.cross(footPositions.col(legId))
+                                    + state.ComputeJacobian(legId) * jointVelocities.segment<3>(3 * legId);
+    }
+    Eigen::Matrix<float, 3, 4> footPositionsWorldFrame = rotMat * footPositions;
+    Vec4<float> trust = robot->GetFootContacts().cast<float>();
+    filter.Update(footPositionsWorldFrame, rotMat * footVelocities, trust);
+    UpdateHeightInControlFrame(footPositionsWorldFrame);
+
+    estimatedPosition = filter.GetPosition();
+    estimatedVelocity = rotMat.transpose() * filter.GetVelocity(); // base frame
+    estimatedRPY = robot->GetBaseRollPitchYaw();
+    estimatedAngularVelocity = omega;
+    // case 2 : in simulation case
+    if (robot->config->isSim) {
+        estimatedPosition[0] = robot->gazeboBasePosition[0];
+        estimatedPosition[1] = robot->gazeboBasePosition[1];
+    }
+    robot->state.basePosition = estimatedPosition;
+    robot->state.baseVelocity = estimatedVelocity;
+}
+
+void qrRobotEstimator::SetPredictedState(const Vec3<float> &predictedPosition, const Vec3<float> &predictedVelocity)
+{
+    estimatedPosition = predictedPosition;
+    estimatedVelocity = robot->state.GetBaseRotationMatrix().transpose() * predictedVelocity; // base frame
+    estimatedRPY = robot->GetBaseRollPitchYaw();
+    estimatedAngularVelocity = robot->state.baseRollPitchYawRate;
+    robot->state.basePosition = estimatedPosition;
+    robot->state.baseVelocity = estimatedVelocity;
+}
 
-    estimatedVelocity = velocityEstimator.GetEstimatedVelocity();
-    estimatedAngularVelocity = velocityEstimator.GetEstimatedAngularVelocity();
-    const Vec6<float> &pose = poseEstimator.GetEstimatedPose();
-    estimatedPosition = pose.head(3);
-    estimatedRPY = pose.tail(3);
+void qrRobotEstimator::UpdateHeightInControlFrame(const Eigen::Matrix<float, 3, 4> &footPositionsWorldFrame)
+{
+    Vec4<float> contacts = robot->GetFootContacts().cast<float>();
+    float contactNumber = contacts.sum();
+    if (contactNumber > 0.f) {
+        Mat3<float> groundOrientationMat = groundEstimator->GetAlignedDirections();
+        Vec4<float> heights = -(groundOrientationMat.col(2).transpose() * footPositionsWorldFrame).transpose();
+        robot->heightInControlFrame = heights.dot(contacts) / contactNumber;
+    }
 }
@@ -0,0 +1,49 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_estimator/qr_state_history.h"
+
+qrStateSample &qrStateHistory::Push(double time)
+{
+    newest = (newest + 1) % capacity;
+    if (size < capacity) {
+        ++size;
+    }
+    qrStateSample &sample = samples[newest];
+    sample.time = time;
+    sample.hasCommand = false;
+    return sample;
+}
+
+void qrStateHistory::RecordCommand(const Eigen::Matrix<float, 5, 12> &command,
+                                   const Eigen::Matrix<float, 3, 4> &contactForces)
+{
+    if (size == 0) {
+        return;
+    }
+    qrStateSample &sample = samples[newest];
+    sample.command = command;
+    sample.contactForces = contactForces;
+    sample.hasCommand = true;
+}
@@ -0,0 +1,111 @@
+// The MIT License
+
+// Copyright (c) 2022
+// Robot Motion and Vision Laboratory at East China Normal University
+// Contact: tophill.robotics@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "state_estimator/qr_state_predictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/qr_se3.h"
+
+qrStatePredictor::qrStatePredictor(qrRobotConfig *configIn)
+    : config(configIn)
+{
+}
+
+void qrStatePredictor::Predict(const qrStateHistory &history,
+                               const Eigen::Matrix<float, 12, 1> &jointResponse,
+                               float horizon,
+                               float dt,
+                               qrStateSample &predicted) const
+{
+    if (history.Size() == 0) {
+        return;
+    }
+    predicted = history.Get(0);
+    if (horizon <= 0.f || dt <= 0.f) {
+        return;
+    }
+    // the feet stay where they are over the few ticks predicted
+    const Eigen::Matrix<float, 3, 4> footPositions = config->FootPositionsInBaseFrame(predicted.motorAngles);
+    const float ticks = std::min(horizon / dt, float(history.Size() - 1));
+    const int wholeTicks = int(ticks);
+    const float fraction = ticks - wholeTicks;
+    // the command of the tick `age` ticks ago acts during the predicted tick wholeTicks - age,
+    // the fraction of a tick comes first and takes the command before those
+    if (fraction > 0.f && wholeTicks + 1 < history.Size()) {
+        Step(history.Get(wholeTicks + 1), jointResponse, footPositions, fraction * dt, predicted);
+    }
+    for (int age = wholeTicks; age >= 1; --age) {
+        Step(history.Get(age), jointResponse, footPositions, dt, predicted);
+    }
+}
+
+void qrStatePredictor::Step(const qrStateSample &commandSample,
+                            const Eigen::Matrix<float, 12, 1> &jointResponse,
+                            const Eigen::Matrix<float, 3, 4> &footPositions,
+                            float step,
+                            qrStateSample &state) const
+{
+    // semi-implicit Euler for the joints
+    for (int legId = 0; legId < 4; ++legId) {
+        for (int motorId = 3 * legId; motorId < 3 * legId + 3; ++motorId) {
+            float &q = state.motorAngles[motorId];
+            float &dq = state.motorVelocities[motorId];
+            if (commandSample.hasCommand && !state.footContact[legId]) {
+                dq += jointResponse[motorId] * commandSample.Effort(motorId, q, dq) * step;
+            }
+            q += dq * step;
+        }
+    }
+
+    // the ground pushes back on the stance feet
+    Vec3<float> force = Vec3<float>::Zero();
+    Vec3<float> torque = Vec3<float>::Zero();
+    bool pushing = false;
+    if (commandSample.hasCommand) {
+        for (int legId = 0; legId < 4; ++legId) {
+            if (!state.footContact[legId] || commandSample.contactForces.col(legId).isZero()) {
+                continue;
+            }
+            const Vec3<float> reaction = -commandSample.contactForces.col(legId);
+            force += reaction;
+            torque += footPositions.col(legId).cross(reaction);
+            pushing = true;
+        }
+    }
+    const Mat3<float> rotation = math::quaternionToRotationMatrix(state.baseOrientation).transpose();
+    if (pushing) {
+        const Vec3<float> acceleration = rotation * force / config->bodyMass + Vec3<float>(0.f, 0.f, -9.81f);
+        state.baseVelocity += acceleration * step;
+        if (std::abs(config->bodyInertia.determinant()) > 1e-9f) {
+            state.baseAngularVelocity += config->bodyInertia.inverse() * torque * step;
+        }
+    }
+    state.basePosition += state.baseVelocity * step;
+
+    // integrateQuat takes the angular velocity in world frame
+    const Vec3<float> omega = rotation * state.baseAngularVelocity;
+    state.baseOrientation = math::integrateQuat(state.baseOrientation, omega, step);
+}